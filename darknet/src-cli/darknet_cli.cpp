@@ -5,11 +5,39 @@
 #endif
 
 #include "darknet_internal.hpp"
+#include "gemm.hpp"
+#include "winograd.hpp"
+#include "quantize.hpp"
+#include "memory_plan.hpp"
 
 
 namespace
 {
 	static auto & cfg_and_state = Darknet::CfgAndState::get();
+
+	/// Exact value of an activation in double precision, to measure the error of @ref activate_array_simd().
+	double exact_activation(const double x, const ACTIVATION a)
+	{
+		switch (a)
+		{
+			case LOGISTIC:	return 1.0 / (1.0 + std::exp(-x));
+			case LOGGY:		return 2.0 / (1.0 + std::exp(-x)) - 1.0;
+			case SWISH:		return x / (1.0 + std::exp(-x));
+			case MISH:		return x * std::tanh(std::log1p(std::exp(x)));
+			case HARD_MISH:	return x > 0.0 ? x : x > -2.0 ? x * x / 2.0 + x : 0.0;
+			case TANH:		return std::tanh(x);
+			case ELU:		return x >= 0.0 ? x : std::expm1(x);
+			case SELU:		return x >= 0.0 ? 1.0507 * x : 1.0507 * 1.6732 * std::expm1(x);
+			case GELU:		return 0.5 * x * (1.0 + std::tanh(0.797885 * x + 0.035677 * x * x * x));
+			case LEAKY:		return x > 0.0 ? x : 0.1 * x;
+			case RELIE:		return x > 0.0 ? x : 0.01 * x;
+			case RELU:		return std::max(x, 0.0);
+			case RELU6:		return std::clamp(x, 0.0, 6.0);
+			case RAMP:		return std::max(x, 0.0) + 0.1 * x;
+			case HARDTAN:	return std::clamp(x, -1.0, 1.0);
+			default:		return activate(x, a);
+		}
+	}
 }
 
 
@@ -113,6 +141,866 @@ void speed(const char * cfgfile, int tics)
 }
 
 
+void activation_benchmark(int argc, char * argv[])
+{
+	TAT(TATPARMS);
+
+	// usage:  darknet activationbench [values]
+	const int count = (argc > 2 ? std::max(1024, atoi(argv[2])) : 1 << 20);
+
+	// the accuracy is checked on every value between -30 and 30 in steps of 1/4096, and on small values of both signs
+	std::vector<float> accuracy_inputs;
+	for (int i = -30 * 4096; i <= 30 * 4096; i ++)
+	{
+		accuracy_inputs.push_back(i / 4096.0f);
+	}
+	for (float v = 1.0e-7f; v < 1.0f; v *= 1.01f)
+	{
+		accuracy_inputs.push_back(v);
+		accuracy_inputs.push_back(-v);
+	}
+
+	// the speed is measured on values which look like the output of a convolution
+	std::mt19937 rng(1234);
+	std::normal_distribution<float> normal(0.0f, 3.0f);
+	std::vector<float> speed_inputs(count);
+	for (auto & v : speed_inputs)
+	{
+		v = normal(rng);
+	}
+
+	std::vector<Darknet::EActivationKernel> kernels;
+	for (const auto kernel : {Darknet::EActivationKernel::GENERIC, Darknet::EActivationKernel::AVX2, Darknet::EActivationKernel::AVX512})
+	{
+		if (activation_kernel_is_supported(kernel))
+		{
+			kernels.push_back(kernel);
+		}
+	}
+
+	*cfg_and_state.output
+		<< std::endl
+		<< "Activation benchmark with " << count << " values, where the error is a fraction of max(1, |y|) and must be below " << Darknet::activation_max_error << ":" << std::endl
+		<< std::endl
+		<< "  activation  kernel      max error   ns/value   speedup" << std::endl;
+
+	std::vector<float> values;
+	const int iterations = std::max(3, 64000000 / count);
+	bool all_ok = true;
+
+	for (const ACTIVATION a : {LOGISTIC, SWISH, MISH, HARD_MISH, TANH, GELU, ELU, SELU, LOGGY, LEAKY, RELIE, RELU, RELU6, RAMP, HARDTAN})
+	{
+		double generic_ns = 0.0;
+		for (const auto kernel : kernels)
+		{
+			values = accuracy_inputs;
+			activate_array_simd(values.data(), static_cast<int>(values.size()), a, kernel);
+			double max_error = 0.0;
+			for (size_t i = 0; i < values.size(); i ++)
+			{
+				const double exact = exact_activation(accuracy_inputs[i], a);
+				max_error = std::max(max_error, std::fabs(values[i] - exact) / std::max(1.0, std::fabs(exact)));
+			}
+			const bool ok = (max_error <= Darknet::activation_max_error);
+			all_ok = all_ok and ok;
+
+			std::chrono::high_resolution_clock::duration duration{};
+			for (int iteration = 0; iteration < iterations; iteration ++)
+			{
+				values = speed_inputs;
+				const auto timestamp_begin = std::chrono::high_resolution_clock::now();
+				activate_array_simd(values.data(), static_cast<int>(values.size()), a, kernel);
+				duration += std::chrono::high_resolution_clock::now() - timestamp_begin;
+			}
+			const double ns = std::chrono::duration<double, std::nano>(duration).count() / iterations / count;
+			if (kernel == Darknet::EActivationKernel::GENERIC)
+			{
+				generic_ns = ns;
+			}
+
+			*cfg_and_state.output
+				<< "  " << std::left << std::setw(10) << (kernel == kernels.front() ? Darknet::to_string(static_cast<Darknet::EActivation>(a)) : "")
+				<< "  " << std::setw(8) << activation_kernel_name(kernel) << std::right
+				<< "  " << std::setw(11) << std::scientific << std::setprecision(2) << max_error << (ok ? " " : "!")
+				<< "  " << std::setw(9) << std::fixed << std::setprecision(3) << ns
+				<< "  " << std::setw(7) << std::setprecision(1) << generic_ns / std::max(ns, 0.000001) << "x"
+				<< std::endl;
+		}
+	}
+
+	*cfg_and_state.output
+		<< std::endl
+		<< (all_ok ? "All of the activations are within the error bound." : "Some activations are not within the error bound (marked with \"!\").") << std::endl;
+}
+
+
+void nms_benchmark(int argc, char * argv[])
+{
+	TAT(TATPARMS);
+
+	// usage:  darknet nmsbench [classes]
+	const int classes = (argc > 2 ? std::max(1, atoi(argv[2])) : 80);
+	const float thresh = 0.45f;
+
+	*cfg_and_state.output
+		<< std::endl
+		<< "NMS benchmark with " << classes << " classes, comparing do_nms_sort() with do_nms_fast():" << std::endl
+		<< std::endl
+		<< "  candidates   objects   do_nms_sort   do_nms_fast   speedup   differences" << std::endl;
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+	std::normal_distribution<float> jitter(0.0f, 0.01f);
+
+	for (const int total : {250, 1000, 4000, 16000})
+	{
+		// crowded scene:  many objects, each one found by several neighbouring anchors and YOLO layers
+		const int objects = std::max(1, total / 25);
+		std::vector<Darknet::Box> centres(objects);
+		std::vector<int> object_class(objects);
+		for (int i = 0; i < objects; i ++)
+		{
+			centres[i] = {uniform(rng), uniform(rng), 0.02f + 0.2f * uniform(rng), 0.02f + 0.2f * uniform(rng)};
+			object_class[i] = rng() % classes;
+		}
+
+		std::vector<float> original_prob(static_cast<size_t>(total) * classes, 0.0f);
+		std::vector<Darknet::Detection> original(total);
+		for (int i = 0; i < total; i ++)
+		{
+			const int obj = rng() % objects;
+			auto & det = original[i];
+			det.bbox		= centres[obj];
+			det.bbox.x		+= jitter(rng);
+			det.bbox.y		+= jitter(rng);
+			det.bbox.w		*= 1.0f + 5.0f * jitter(rng);
+			det.bbox.h		*= 1.0f + 5.0f * jitter(rng);
+			det.classes		= classes;
+			det.objectness	= 0.25f + 0.75f * uniform(rng);
+			det.track_id	= i; // remember the original position since do_nms_sort() re-orders the detections
+			float * prob = original_prob.data() + static_cast<size_t>(i) * classes;
+			prob[object_class[obj]] = det.objectness * (0.3f + 0.7f * uniform(rng));
+			if (uniform(rng) < 0.1f)
+			{
+				// some objects are also similar to a second class
+				prob[rng() % classes] = det.objectness * 0.3f * uniform(rng);
+			}
+		}
+
+		const int iterations = std::max(3, 64000 / total);
+		std::vector<float> prob[2];
+		std::vector<Darknet::Detection> dets[2];
+		std::chrono::high_resolution_clock::duration duration[2];
+
+		for (int engine = 0; engine < 2; engine ++)
+		{
+			duration[engine] = std::chrono::high_resolution_clock::duration();
+			for (int iteration = 0; iteration < iterations; iteration ++)
+			{
+				prob[engine] = original_prob;
+				dets[engine] = original;
+				for (int i = 0; i < total; i ++)
+				{
+					dets[engine][i].prob = prob[engine].data() + static_cast<size_t>(i) * classes;
+				}
+
+				const auto timestamp_begin = std::chrono::high_resolution_clock::now();
+				if (engine == 0)
+				{
+					do_nms_sort(dets[engine].data(), total, classes, thresh);
+				}
+				else
+				{
+					do_nms_fast(dets[engine].data(), total, classes, thresh, DEFAULT_NMS, 0.0f);
+				}
+				duration[engine] += std::chrono::high_resolution_clock::now() - timestamp_begin;
+			}
+		}
+
+		// both engines must have kept exactly the same class probabilities for every detection
+		size_t differences = 0;
+		for (int i = 0; i < total; i ++)
+		{
+			const auto & det = dets[0][i];
+			const float * fast = prob[1].data() + static_cast<size_t>(det.track_id) * classes;
+			for (int k = 0; k < classes; k ++)
+			{
+				if (det.prob[k] != fast[k])
+				{
+					differences ++;
+				}
+			}
+		}
+
+		const double sort_ms = std::chrono::duration<double, std::milli>(duration[0]).count() / iterations;
+		const double fast_ms = std::chrono::duration<double, std::milli>(duration[1]).count() / iterations;
+
+		*cfg_and_state.output
+			<< "  " << std::setw(10) << total
+			<< "  " << std::setw(8) << objects
+			<< "  " << std::setw(9) << std::fixed << std::setprecision(3) << sort_ms << " ms"
+			<< "  " << std::setw(9) << fast_ms << " ms"
+			<< "  " << std::setw(7) << std::setprecision(1) << sort_ms / std::max(fast_ms, 0.000001) << "x"
+			<< "  " << std::setw(12) << differences
+			<< std::endl;
+	}
+}
+
+
+void gemm_benchmark(int argc, char * argv[])
+{
+	TAT(TATPARMS);
+
+	// usage:  darknet gemmbench [file.cfg ...]
+	std::vector<std::string> cfg_filenames;
+	for (int i = 2; i < argc; i ++)
+	{
+		const std::string arg = argv[i];
+		if (arg.size() > 4 and arg.substr(arg.size() - 4) == ".cfg")
+		{
+			cfg_filenames.push_back(arg);
+		}
+	}
+	if (cfg_filenames.empty())
+	{
+		cfg_filenames = {"cfg/yolov4-tiny.cfg", "cfg/yolov7-tiny.cfg"};
+	}
+
+	struct Engine
+	{
+		std::string name;
+		std::function<void(int, int, int, float *, float *, float *)> run; // M, N, K, A, B, C
+	};
+	std::vector<Engine> engines;
+
+	// the previous CPU kernels, as they were called by gemm_cpu()
+	engines.push_back({"row loop", [](int M, int N, int K, float * A, float * B, float * C)
+		{
+			#pragma omp parallel for
+			for (int t = 0; t < M; ++t)
+			{
+				gemm_nn(1, N, K, 1.0f, A + t * K, K, B, N, C + t * N, N);
+			}
+		}});
+	if (is_fma_avx2())
+	{
+		engines.push_back({"gemm_nn_fast", [](int M, int N, int K, float * A, float * B, float * C)
+			{
+				gemm_nn_fast(M, N, K, 1.0f, A, K, B, N, C, N);
+			}});
+	}
+
+	const auto original_kernel = gemm_packed_kernel();
+	for (const auto kernel : {Darknet::EGemmKernel::GENERIC, Darknet::EGemmKernel::AVX2, Darknet::EGemmKernel::AVX512})
+	{
+		if (gemm_packed_set_kernel(kernel))
+		{
+			engines.push_back({gemm_packed_kernel_name(kernel), [kernel](int M, int N, int K, float * A, float * B, float * C)
+				{
+					gemm_packed_set_kernel(kernel);
+					gemm_packed(M, N, K, 1.0f, A, K, B, N, C, N);
+				}});
+		}
+	}
+
+	for (const auto & cfg_filename : cfg_filenames)
+	{
+		if (not std::filesystem::exists(cfg_filename))
+		{
+			darknet_fatal_error(DARKNET_LOC, "cannot find \"%s\"", cfg_filename.c_str());
+		}
+
+		// M = filters, N = output width x height, K = input channels x kernel size x kernel size
+		std::map<std::tuple<int, int, int>, int> shapes;
+		Darknet::Network net = parse_network_cfg(const_cast<char *>(cfg_filename.c_str()));
+		for (int i = 0; i < net.n; ++i)
+		{
+			const Darknet::Layer & l = net.layers[i];
+			if (l.type == Darknet::ELayerType::CONVOLUTIONAL and not l.xnor)
+			{
+				shapes[{l.n / l.groups, l.out_w * l.out_h, l.size * l.size * l.c / l.groups}] += l.groups;
+			}
+		}
+		free_network(net);
+
+		*cfg_and_state.output
+			<< std::endl
+			<< "GEMM benchmark for " << cfg_filename << " (" << shapes.size() << " different convolution shapes):" << std::endl
+			<< std::endl
+			<< "      M       N       K  count";
+		for (const auto & engine : engines)
+		{
+			*cfg_and_state.output << "  " << std::setw(14) << engine.name;
+		}
+		*cfg_and_state.output << "  max difference" << std::endl;
+
+		std::vector<double> total_seconds(engines.size(), 0.0);
+		double total_flops = 0.0;
+
+		for (const auto & [shape, count] : shapes)
+		{
+			const auto & [M, N, K] = shape;
+			const double flops = 2.0 * M * N * K;
+			const int iterations = std::clamp(static_cast<int>(2.0e9 / flops), 2, 100);
+			total_flops += flops * count;
+
+			std::vector<float> A(static_cast<size_t>(M) * K);
+			std::vector<float> B(static_cast<size_t>(K) * N);
+			for (auto & f : A) f = rand_uniform(-1.0f, 1.0f);
+			for (auto & f : B) f = rand_uniform(0.0f, 1.0f);
+
+			std::vector<float> reference;
+			float max_difference = 0.0f;
+
+			*cfg_and_state.output << std::setw(7) << M << " " << std::setw(7) << N << " " << std::setw(7) << K << "  " << std::setw(5) << count;
+
+			for (size_t idx = 0; idx < engines.size(); idx ++)
+			{
+				std::vector<float> C(static_cast<size_t>(M) * N, 0.0f);
+				engines[idx].run(M, N, K, A.data(), B.data(), C.data()); // warm up, and check the results
+
+				if (reference.empty())
+				{
+					reference = C;
+				}
+				for (size_t i = 0; i < C.size(); i ++)
+				{
+					max_difference = std::max(max_difference, std::fabs(C[i] - reference[i]));
+				}
+
+				const auto timestamp_begin = std::chrono::high_resolution_clock::now();
+				for (int iteration = 0; iteration < iterations; iteration ++)
+				{
+					engines[idx].run(M, N, K, A.data(), B.data(), C.data());
+				}
+				const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - timestamp_begin).count() / iterations;
+				total_seconds[idx] += seconds * count;
+
+				*cfg_and_state.output << "  " << std::setw(8) << std::fixed << std::setprecision(1) << flops / seconds / 1.0e9 << " GFLOPS";
+			}
+
+			*cfg_and_state.output << "  " << std::setw(14) << std::scientific << std::setprecision(2) << max_difference << std::defaultfloat << std::endl;
+		}
+
+		*cfg_and_state.output << "                         total";
+		for (size_t idx = 0; idx < engines.size(); idx ++)
+		{
+			*cfg_and_state.output << "  " << std::setw(8) << std::fixed << std::setprecision(1) << total_flops / total_seconds[idx] / 1.0e9 << " GFLOPS";
+		}
+		*cfg_and_state.output << std::endl;
+
+		*cfg_and_state.output << "             time per network";
+		for (size_t idx = 0; idx < engines.size(); idx ++)
+		{
+			*cfg_and_state.output << "  " << std::setw(12) << std::fixed << std::setprecision(2) << total_seconds[idx] * 1000.0 << " ms";
+		}
+		*cfg_and_state.output << std::defaultfloat << std::endl;
+	}
+
+	gemm_packed_set_kernel(original_kernel);
+}
+
+
+void convolution_benchmark(int argc, char * argv[])
+{
+	TAT(TATPARMS);
+
+	// usage:  darknet convbench [file.cfg ...]
+	std::vector<std::string> cfg_filenames;
+	for (int i = 2; i < argc; i ++)
+	{
+		const std::string arg = argv[i];
+		if (arg.size() > 4 and arg.substr(arg.size() - 4) == ".cfg")
+		{
+			cfg_filenames.push_back(arg);
+		}
+	}
+	if (cfg_filenames.empty())
+	{
+		cfg_filenames = {"cfg/yolov4-tiny.cfg", "cfg/yolov7-tiny.cfg"};
+	}
+
+	cfg_and_state.gpu_index = -1;
+
+	for (const auto & cfg_filename : cfg_filenames)
+	{
+		if (not std::filesystem::exists(cfg_filename))
+		{
+			darknet_fatal_error(DARKNET_LOC, "cannot find \"%s\"", cfg_filename.c_str());
+		}
+
+		Darknet::Network net = parse_network_cfg_custom(const_cast<char *>(cfg_filename.c_str()), 1, 1);
+
+		*cfg_and_state.output
+			<< std::endl
+			<< "Convolution benchmark for " << cfg_filename << " (" << gemm_packed_kernel_name(gemm_packed_kernel()) << " GEMM kernel):" << std::endl
+			<< std::endl
+			<< "layer  size       input  channels  filters     im2col    implicit    Winograd  implicit error  Winograd error  inference" << std::endl;
+
+		double total_im2col		= 0.0;
+		double total_inference	= 0.0;
+		size_t im2col_workspace	= 0;
+
+		for (int i = 0; i < net.n; ++i)
+		{
+			Darknet::Layer & l = net.layers[i];
+			if (l.type != Darknet::ELayerType::CONVOLUTIONAL or l.xnor)
+			{
+				continue;
+			}
+
+			im2col_workspace = std::max(im2col_workspace, l.workspace_size);
+
+			pack_convolutional_weights(l);
+			if (winograd_is_supported(l))
+			{
+				winograd_transform_weights(l);
+			}
+
+			const double flops = 2.0 * l.n * l.out_w * l.out_h * l.size * l.size * l.c / l.groups;
+			const int repeat = std::clamp(static_cast<int>(1.0e9 / flops), 2, 50);
+			const auto result = compare_convolution_algorithms(l, repeat);
+
+			// this is the algorithm pack_conv_weights() would use
+			std::string inference = "im2col";
+			double inference_milliseconds = result.im2col_milliseconds;
+			if (winograd_is_preferred(l))
+			{
+				inference = "Winograd";
+				inference_milliseconds = result.winograd_milliseconds;
+			}
+			else if (result.implicit_milliseconds > 0.0)
+			{
+				inference = "implicit";
+				inference_milliseconds = result.implicit_milliseconds;
+			}
+			total_im2col	+= result.im2col_milliseconds;
+			total_inference	+= inference_milliseconds;
+
+			auto milliseconds = [](const double ms) -> std::string
+			{
+				std::stringstream ss;
+				if (ms > 0.0)
+				{
+					ss << std::fixed << std::setprecision(3) << ms << " ms";
+				}
+				else
+				{
+					ss << "-";
+				}
+				return ss.str();
+			};
+			auto error = [](const double ms, const float err) -> std::string
+			{
+				std::stringstream ss;
+				if (ms > 0.0)
+				{
+					ss << std::scientific << std::setprecision(2) << err;
+				}
+				else
+				{
+					ss << "-";
+				}
+				return ss.str();
+			};
+
+			*cfg_and_state.output
+				<< std::setw(5) << i
+				<< "  " << std::setw(4) << (std::to_string(l.size) + "/" + std::to_string(l.stride_x))
+				<< "  " << std::setw(9) << (std::to_string(l.w) + "x" + std::to_string(l.h))
+				<< "  " << std::setw(8) << l.c / l.groups
+				<< "  " << std::setw(7) << l.n / l.groups
+				<< "  " << std::setw(9) << milliseconds(result.im2col_milliseconds)
+				<< "  " << std::setw(10) << milliseconds(result.implicit_milliseconds)
+				<< "  " << std::setw(10) << milliseconds(result.winograd_milliseconds)
+				<< "  " << std::setw(14) << error(result.implicit_milliseconds, result.implicit_error)
+				<< "  " << std::setw(14) << error(result.winograd_milliseconds, result.winograd_error)
+				<< "  " << inference
+				<< std::endl;
+		}
+
+		recalculate_workspace_size(&net);
+		size_t inference_workspace = 0;
+		for (int i = 0; i < net.n; ++i)
+		{
+			inference_workspace = std::max(inference_workspace, net.layers[i].workspace_size);
+		}
+
+		*cfg_and_state.output
+			<< std::fixed << std::setprecision(2)
+			<< "total:  im2col=" << total_im2col << " ms, inference=" << total_inference << " ms" << std::endl
+			<< "workspace:  im2col=" << size_to_IEC_string(im2col_workspace) << ", inference=" << size_to_IEC_string(inference_workspace)
+			<< std::defaultfloat << std::endl;
+
+		free_network(net);
+	}
+}
+
+
+void layer_benchmark(int argc, char * argv[])
+{
+	TAT(TATPARMS);
+
+	// usage:  darknet layerbench [file.cfg ...]
+	std::vector<std::string> cfg_filenames;
+	for (int i = 2; i < argc; i ++)
+	{
+		const std::string arg = argv[i];
+		if (arg.size() > 4 and arg.substr(arg.size() - 4) == ".cfg")
+		{
+			cfg_filenames.push_back(arg);
+		}
+	}
+	if (cfg_filenames.empty())
+	{
+		cfg_filenames = {"cfg/yolov4-tiny.cfg", "cfg/yolov7-tiny.cfg", "cfg/yolov4-csp.cfg"};
+	}
+
+	cfg_and_state.gpu_index = -1;
+
+	std::vector<Darknet::EBlasKernel> kernels;
+	for (const auto kernel : {Darknet::EBlasKernel::GENERIC, Darknet::EBlasKernel::AVX2, Darknet::EBlasKernel::AVX512})
+	{
+		if (blas_kernel_is_supported(kernel))
+		{
+			kernels.push_back(kernel);
+		}
+	}
+
+	std::mt19937 rng(1234);
+	std::normal_distribution<float> normal(0.0f, 1.0f);
+
+	for (const auto & cfg_filename : cfg_filenames)
+	{
+		if (not std::filesystem::exists(cfg_filename))
+		{
+			darknet_fatal_error(DARKNET_LOC, "cannot find \"%s\"", cfg_filename.c_str());
+		}
+
+		Darknet::Network net = parse_network_cfg_custom(const_cast<char *>(cfg_filename.c_str()), 1, 1);
+
+		*cfg_and_state.output
+			<< std::endl
+			<< "Layer benchmark for " << cfg_filename << ", comparing the previous CPU inference code with each kernel:" << std::endl
+			<< std::endl
+			<< "layer  type      size       input    output";
+		for (const auto kernel : kernels)
+		{
+			*cfg_and_state.output << "  " << std::setw(9) << blas_kernel_name(kernel);
+		}
+		*cfg_and_state.output << "   previous  speedup  differences" << std::endl;
+
+		std::vector<double> total(kernels.size(), 0.0);
+		double total_previous = 0.0;
+
+		for (int i = 0; i < net.n; ++i)
+		{
+			Darknet::Layer & l = net.layers[i];
+
+			std::function<void(float *)> previous;
+			std::function<void(Darknet::EBlasKernel, float *)> current;
+			std::string size;
+			std::vector<float> input(static_cast<size_t>(l.inputs) * l.batch);
+			for (auto & v : input)
+			{
+				v = normal(rng);
+			}
+
+			if (l.type == Darknet::ELayerType::MAXPOOL and not l.maxpool_depth and not l.avgpool and l.stride_x == l.stride_y)
+			{
+				size		= std::to_string(l.size) + "/" + std::to_string(l.stride_x);
+				previous	= [&](float * out) { forward_maxpool_layer_avx(input.data(), out, nullptr, l.size, l.w, l.h, l.out_w, l.out_h, l.c, l.pad, l.stride, l.batch); };
+				current		= [&](const Darknet::EBlasKernel kernel, float * out) { maxpool_cpu(input.data(), l.batch, l.c, l.h, l.w, l.size, l.stride_x, l.stride_y, l.pad, l.out_h, l.out_w, out, kernel); };
+			}
+			else if (l.type == Darknet::ELayerType::UPSAMPLE and not l.reverse)
+			{
+				size		= "x" + std::to_string(l.stride);
+				previous	= [&](float * out)
+				{
+					fill_cpu(l.outputs * l.batch, 0, out, 1);
+					upsample_cpu(input.data(), l.w, l.h, l.c, l.batch, l.stride, 1, l.scale, out);
+				};
+				current		= [&](const Darknet::EBlasKernel kernel, float * out) { upsample_forward_cpu(input.data(), l.w, l.h, l.c, l.batch, l.stride, l.scale, out, kernel); };
+			}
+			else if (l.type == Darknet::ELayerType::SHORTCUT)
+			{
+				size = std::to_string(l.n + 1) + " in";
+				for (int j = 0; j < l.n; j ++)
+				{
+					for (int k = 0; k < l.input_sizes[j] * l.batch; k ++)
+					{
+						l.layers_output[j][k] = normal(rng);
+					}
+				}
+				previous	= [&](float * out)
+				{
+					const Darknet::Layer & from = net.layers[l.index];
+					if (l.nweights == 0 and l.n == 1 and from.w == l.w and from.h == l.h and from.c == l.c)
+					{
+						const int count = l.batch * l.outputs;
+						#pragma omp parallel for
+						for (int k = 0; k < count; ++k)
+						{
+							out[k] = input[k] + from.output[k];
+						}
+					}
+					else
+					{
+						shortcut_multilayer_cpu(l.outputs * l.batch, l.outputs, l.batch, l.n, l.input_sizes, l.layers_output, out, input.data(), l.weights, l.nweights, l.weights_normalization);
+					}
+				};
+				current		= [&](const Darknet::EBlasKernel kernel, float * out) { shortcut_forward_cpu(l.outputs, l.batch, l.n, l.input_sizes, l.layers_output, input.data(), l.weights, l.nweights, l.weights_normalization, out, kernel); };
+			}
+			else
+			{
+				continue;
+			}
+
+			// memory bound, so repeat until roughly 1 GiB has been read or written
+			const double bytes = sizeof(float) * (static_cast<double>(l.inputs) + l.outputs) * l.batch;
+			const int repeat = std::clamp(static_cast<int>(1.0e9 / bytes), 5, 500);
+
+			auto time_it = [&](const std::function<void(float *)> & f, std::vector<float> & out) -> double
+			{
+				out.assign(static_cast<size_t>(l.outputs) * l.batch, 0.0f);
+				f(out.data());
+				const auto timestamp_begin = std::chrono::high_resolution_clock::now();
+				for (int r = 0; r < repeat; r ++)
+				{
+					f(out.data());
+				}
+				return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - timestamp_begin).count() / repeat;
+			};
+
+			std::vector<float> expected;
+			std::vector<float> actual;
+			const double previous_milliseconds = time_it(previous, expected);
+			total_previous += previous_milliseconds;
+
+			*cfg_and_state.output
+				<< std::setw(5) << i
+				<< "  " << std::left << std::setw(8) << Darknet::to_string(l.type) << std::right
+				<< "  " << std::setw(4) << size
+				<< "  " << std::setw(10) << (std::to_string(l.w) + "x" + std::to_string(l.h) + "x" + std::to_string(l.c))
+				<< "  " << std::setw(8) << (std::to_string(l.out_w) + "x" + std::to_string(l.out_h))
+				<< std::fixed << std::setprecision(3);
+
+			double best_milliseconds = previous_milliseconds;
+			float max_difference = 0.0f;
+			for (size_t k = 0; k < kernels.size(); k ++)
+			{
+				const double ms = time_it([&](float * out) { current(kernels[k], out); }, actual);
+				total[k] += ms;
+				best_milliseconds = std::min(best_milliseconds, ms);
+				for (size_t j = 0; j < actual.size(); j ++)
+				{
+					max_difference = std::max(max_difference, std::fabs(actual[j] - expected[j]));
+				}
+				*cfg_and_state.output << "  " << std::setw(6) << ms << " ms";
+			}
+
+			*cfg_and_state.output
+				<< "  " << std::setw(6) << previous_milliseconds << " ms"
+				<< "  " << std::setw(6) << std::setprecision(1) << previous_milliseconds / std::max(best_milliseconds, 0.000001) << "x"
+				<< "  " << std::setw(11) << std::scientific << std::setprecision(2) << max_difference
+				<< std::defaultfloat << std::endl;
+		}
+
+		*cfg_and_state.output << std::fixed << std::setprecision(3) << "total:  previous=" << total_previous << " ms";
+		for (size_t k = 0; k < kernels.size(); k ++)
+		{
+			*cfg_and_state.output << ", " << blas_kernel_name(kernels[k]) << "=" << total[k] << " ms";
+		}
+		*cfg_and_state.output << std::defaultfloat << std::endl;
+
+		free_network(net);
+	}
+}
+
+
+void memory_plan_report(int argc, char * argv[])
+{
+	TAT(TATPARMS);
+
+	// usage:  darknet memplan [file.cfg ...]
+	std::vector<std::string> cfg_filenames;
+	for (int i = 2; i < argc; i ++)
+	{
+		const std::string arg = argv[i];
+		if (arg.size() > 4 and arg.substr(arg.size() - 4) == ".cfg")
+		{
+			cfg_filenames.push_back(arg);
+		}
+	}
+	if (cfg_filenames.empty())
+	{
+		cfg_filenames = {"cfg/yolov4-tiny.cfg", "cfg/yolov7-tiny.cfg", "cfg/yolov4-csp.cfg"};
+	}
+
+	cfg_and_state.gpu_index = -1;
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+	*cfg_and_state.output
+		<< "Layer outputs used by CPU inference with a batch size of 1, with and without sharing the outputs:" << std::endl
+		<< std::endl
+		<< "    layers     before      after  saved  buffers  zero-copy routes  differences  cfg" << std::endl;
+
+	for (const auto & cfg_filename : cfg_filenames)
+	{
+		if (not std::filesystem::exists(cfg_filename))
+		{
+			darknet_fatal_error(DARKNET_LOC, "cannot find \"%s\"", cfg_filename.c_str());
+		}
+
+		// the random weights are enough, but they must go through the same steps as when loading a .weights file since
+		// the fused shortcuts decide which outputs are written
+		Darknet::Network net = parse_network_cfg_custom(const_cast<char *>(cfg_filename.c_str()), 1, 1);
+		fuse_conv_batchnorm(net);
+		pack_conv_weights(net);
+
+		std::vector<float> input(get_network_input_size(net));
+		for (auto & v : input)
+		{
+			v = uniform(rng);
+		}
+
+		// everything read once the network has finished must be the same with or without the plan
+		auto run = [&]() -> std::vector<float>
+		{
+			network_predict(net, input.data());
+			std::vector<float> outputs;
+			for (int i = 0; i < net.n; ++i)
+			{
+				const Darknet::Layer & l = net.layers[i];
+				if (i + 1 == net.n or l.type == Darknet::ELayerType::YOLO or l.type == Darknet::ELayerType::GAUSSIAN_YOLO or l.type == Darknet::ELayerType::REGION)
+				{
+					outputs.insert(outputs.end(), l.output, l.output + static_cast<size_t>(l.outputs) * l.batch);
+				}
+			}
+			return outputs;
+		};
+
+		release_inference_memory(net);
+		const auto expected = run();
+		const auto memory = plan_inference_memory(net);
+		const auto actual = run();
+
+		size_t differences = 0;
+		for (size_t i = 0; i < actual.size(); i ++)
+		{
+			if (std::memcmp(&actual[i], &expected[i], sizeof(float)))
+			{
+				differences ++;
+			}
+		}
+
+		*cfg_and_state.output
+			<< std::setw(10) << net.n
+			<< std::setw(11) << size_to_IEC_string(memory.unplanned_bytes)
+			<< std::setw(11) << size_to_IEC_string(memory.planned_bytes)
+			<< std::setw(6) << std::lround(100.0 * (1.0 - static_cast<double>(memory.planned_bytes) / std::max(memory.unplanned_bytes, size_t(1)))) << "%"
+			<< std::setw(9) << memory.buffers
+			<< std::setw(18) << memory.zero_copy_routes
+			<< std::setw(13) << differences
+			<< "  " << cfg_filename << std::endl;
+
+		free_network(net);
+	}
+}
+
+void calibrate(int argc, char * argv[])
+{
+	TAT(TATPARMS);
+
+	// usage:  darknet calibrate <file.cfg> <file.weights> <directory of images> [<file.data>]
+	if (cfg_and_state.cfg_filename.empty())
+	{
+		darknet_fatal_error(DARKNET_LOC, "must specify a .cfg file to load");
+	}
+	if (cfg_and_state.weights_filename.empty())
+	{
+		darknet_fatal_error(DARKNET_LOC, "must specify a .weights file to load");
+	}
+
+	Darknet::VStr images;
+	for (const auto & filename : cfg_and_state.filenames)
+	{
+		if (std::filesystem::is_directory(filename))
+		{
+			for (const auto & entry : std::filesystem::directory_iterator(filename))
+			{
+				const auto ext = Darknet::lowercase(entry.path().extension().string());
+				if (ext == ".jpg" or ext == ".jpeg" or ext == ".png" or ext == ".bmp")
+				{
+					images.push_back(entry.path().string());
+				}
+			}
+		}
+	}
+	if (images.empty())
+	{
+		darknet_fatal_error(DARKNET_LOC, "must specify a directory of images to calibrate the INT8 quantization");
+	}
+	std::sort(images.begin(), images.end());
+
+	cfg_and_state.gpu_index = -1;
+
+	const std::string cfg_filename		= cfg_and_state.cfg_filename.string();
+	const std::string weights_filename	= cfg_and_state.weights_filename.string();
+
+	Darknet::Network net = parse_network_cfg_custom(const_cast<char *>(cfg_filename.c_str()), 1, 1);
+	load_weights(&net, weights_filename.c_str());
+	fuse_conv_batchnorm(net);
+	pack_conv_weights(net);
+	calculate_binary_weights(&net);
+
+	// the calibration must run in floating point, even when --int8 was used
+	int8_prepare_network(net, {});
+
+	*cfg_and_state.output << "Calibrating the INT8 quantization of " << cfg_filename << " using " << images.size() << " images." << std::endl;
+
+	const auto scales = int8_calibrate(net, images);
+
+	std::filesystem::path table = cfg_and_state.weights_filename;
+	table.replace_extension(".int8");
+	int8_save_calibration(table, scales);
+
+	const size_t layers = std::count_if(scales.begin(), scales.end(), [](const float scale) { return scale > 0.0f; });
+	*cfg_and_state.output << "Saved the input scales of " << layers << " layers to " << table.string() << " (use it with --int8)." << std::endl;
+
+	if (not cfg_and_state.data_filename.empty())
+	{
+		// compare the mAP% of the same network before and after the quantization
+		const std::string data_filename = cfg_and_state.data_filename.string();
+		const float thresh		= find_float_arg(argc, argv, "-thresh", .25);
+		const float iou_thresh	= find_float_arg(argc, argv, "-iou_thresh", .5);
+
+		list * options = read_data_cfg(data_filename.c_str());
+		Darknet::load_names(&net, option_find_str(options, "names", "unknown.names"));
+		free_list_contents_kvp(options);
+		free_list(options);
+
+		const float fp32_map = validate_detector_map(data_filename.c_str(), cfg_filename.c_str(), weights_filename.c_str(), thresh, iou_thresh, 0, net.letter_box, &net);
+
+		int8_prepare_network(net, scales);
+
+		const float int8_map = validate_detector_map(data_filename.c_str(), cfg_filename.c_str(), weights_filename.c_str(), thresh, iou_thresh, 0, net.letter_box, &net);
+
+		*cfg_and_state.output
+			<< std::endl
+			<< "mAP@" << std::fixed << std::setprecision(2) << iou_thresh << ":"
+			<< " FP32=" << Darknet::format_map_accuracy(fp32_map) << ","
+			<< " INT8=" << Darknet::format_map_accuracy(int8_map) << ","
+			<< " delta=" << std::showpos << 100.0f * (int8_map - fp32_map) << std::noshowpos << "%"
+			<< std::defaultfloat << std::endl;
+	}
+
+	free_network(net);
+}
+
+
 void operations(char *cfgfile)
 {
 	TAT(TATPARMS);
@@ -547,12 +1435,19 @@ int main(int argc, char **argv)
 
 		/// @todo V3 "3d" seems to combine 2 images into a single alpha-blended composite.  It works...but does it belong in Darknet?  What is this for?
 		else if (cfg_and_state.command == "3d")				{ Darknet::composite_3d(argv[2], argv[3], argv[4], (argc > 5) ? atof(argv[5]) : 0); }
+		else if (cfg_and_state.command == "activationbench")	{ activation_benchmark(argc, argv);	}
 		else if (cfg_and_state.command == "average")		{ average			(argc, argv);	}
+		else if (cfg_and_state.command == "calibrate")		{ calibrate			(argc, argv);	}
 		else if (cfg_and_state.command == "cfglayers")		{ Darknet::cfg_layers();			}
+		else if (cfg_and_state.command == "convbench")		{ convolution_benchmark(argc, argv);	}
 		else if (cfg_and_state.command == "denormalize")	{ denormalize_net	(argv[2], argv[3], argv[4]); }
 		else if (cfg_and_state.command == "detector")		{ run_detector		(argc, argv);	}
+		else if (cfg_and_state.command == "gemmbench")		{ gemm_benchmark	(argc, argv);	}
 		else if (cfg_and_state.command == "help")			{ Darknet::display_usage();			}
+		else if (cfg_and_state.command == "layerbench")		{ layer_benchmark	(argc, argv);	}
+		else if (cfg_and_state.command == "memplan")		{ memory_plan_report(argc, argv);	}
 		else if (cfg_and_state.command == "nightmare")		{ run_nightmare		(argc, argv);	}
+		else if (cfg_and_state.command == "nmsbench")		{ nms_benchmark		(argc, argv);	}
 		else if (cfg_and_state.command == "normalize")		{ normalize_net		(argv[2], argv[3], argv[4]); }
 		else if (cfg_and_state.command == "oneoff")			{ oneoff			(argv[2], argv[3], argv[4]); }
 		else if (cfg_and_state.command == "ops")			{ operations		(argv[2]); }
@@ -0,0 +1,252 @@
+// Servidor multi-cámara: un único proceso con todas las cámaras y un pool pequeño de
+// redes cargadas por modelo, en lugar de un simple_stream_progressive por cámara.
+//
+// Las cámaras se añaden y eliminan en caliente con comandos por stdin (una línea por comando):
+//
+//     add <id> <puerto> <rtsp_url> <nombre_camara> <config_file> <settings_file> <model_cfg> <model_weights> <model_names>
+//     remove <id>
+//     list
+//     echo <id> <campos>...
+//     quit
+//
+// Todos los campos de 'add' y 'echo' pueden ir entre comillas dobles, con \" y \\ para las comillas
+// y las barras dentro del campo, de forma que una ruta o una URL RTSP (o su contraseña) pueden
+// tener espacios.  'echo' devuelve los campos tal y como se han leído, de nuevo entre comillas,
+// para que api_server.js compruebe al arrancar que los dos lados entienden igual el protocolo.
+//
+// Cada comando responde con una línea que empieza por '@' para que el proceso que controla
+// el servidor (src/server/api_server.js) pueda distinguirla del resto del log:
+//
+//     @started <id> <puerto>  |  @stopped <id>  |  @camera <id> <puerto> <nombre>  |  @error <id> <mensaje>
+//     @echo <id> <campos>...
+//
+// Los frames de las cámaras que comparten modelo se agrupan en lotes: lo que llega dentro de
+// --batch-window milisegundos (hasta --batch frames) se procesa en una sola inferencia.
+
+#include "camera_stream.hpp"
+#include <csignal>
+#include <iomanip>
+
+namespace
+{
+    std::mutex output_mutex;
+
+    void reply(const std::string& line) {
+        std::lock_guard<std::mutex> lock(output_mutex);
+        std::cout << "@" << line << std::endl;
+    }
+
+    // Lee el resto de los campos de un comando, cada uno con o sin comillas (ver arriba)
+    std::vector<std::string> read_fields(std::istream& in) {
+        std::vector<std::string> fields;
+        std::string field;
+        while (in >> std::quoted(field)) {
+            fields.push_back(field);
+        }
+        return fields;
+    }
+
+    class CameraServer {
+    public:
+        CameraServer(size_t networks_per_model, const BatchOptions& batch)
+            : networks_per_model_(networks_per_model), batch_(batch) {}
+
+        ~CameraServer() { stop_all(); }
+
+        void add(const std::string& id, int port, const std::string& rtsp_url, const std::string& camera_name,
+                 const std::string& config_file, const std::string& settings_file, const ModelFiles& model) {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            if (cameras_.count(id)) {
+                reply("error " + id + " la cámara ya está en marcha");
+                return;
+            }
+
+            DetectionConfig config = loadDetectionConfig(config_file);
+            CameraSettings settings = loadCameraSettingsFile(settings_file);
+
+            std::shared_ptr<NetworkPool> pool;
+            if (settings.detectionEnabled) {
+                pool = get_pool(model);
+            }
+
+            try {
+                auto stream = std::make_unique<CameraStream>(id, port, rtsp_url, camera_name, config, settings, pool);
+                stream->start();
+                cameras_[id] = std::move(stream);
+                reply("started " + id + " " + std::to_string(port));
+            }
+            catch (const std::exception& e) {
+                reply("error " + id + " " + e.what());
+            }
+            release_unused_pools();
+        }
+
+        void remove(const std::string& id) {
+            std::unique_ptr<CameraStream> stream;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = cameras_.find(id);
+                if (it == cameras_.end()) {
+                    reply("error " + id + " la cámara no está en marcha");
+                    return;
+                }
+                stream = std::move(it->second);
+                cameras_.erase(it);
+            }
+
+            stream->stop();
+            stream.reset();
+            reply("stopped " + id);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            release_unused_pools();
+        }
+
+        void list() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto& [id, stream] : cameras_) {
+                reply("camera " + id + " " + std::to_string(stream->port()) + " " + stream->name() +
+                      (stream->running() ? "" : " (detenida)"));
+            }
+            reply("end");
+        }
+
+        void stop_all() {
+            std::map<std::string, std::unique_ptr<CameraStream>> cameras;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                cameras.swap(cameras_);
+            }
+            for (auto& [id, stream] : cameras) {
+                stream->stop();
+                reply("stopped " + id);
+            }
+            cameras.clear();
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            pools_.clear();
+        }
+
+    private:
+        // Un pool por modelo, compartido por todas las cámaras que lo usan
+        std::shared_ptr<NetworkPool> get_pool(const ModelFiles& model) {
+            auto& pool = pools_[model.key()];
+            if (!pool) {
+                std::cout << "Cargando " << networks_per_model_ << " red(es) para " << model.config << std::endl;
+                pool = std::make_shared<NetworkPool>(model, networks_per_model_, batch_, cpu_shares_);
+            }
+            return pool;
+        }
+
+        // Liberar las redes de los modelos que ya no usa ninguna cámara
+        void release_unused_pools() {
+            for (auto it = pools_.begin(); it != pools_.end();) {
+                if (it->second.use_count() == 1) {
+                    std::cout << "Liberando redes de " << it->second->model().config << std::endl;
+                    it = pools_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        size_t networks_per_model_;
+        BatchOptions batch_;
+        std::shared_ptr<CpuShares> cpu_shares_ = std::make_shared<CpuShares>();  // Núcleos de cada red, de todos los pools
+        std::mutex mutex_;
+        std::map<std::string, std::unique_ptr<CameraStream>> cameras_;
+        std::map<std::string, std::shared_ptr<NetworkPool>> pools_;
+    };
+
+    std::atomic<bool> quit_requested{false};
+
+    void signal_handler(int) {
+        quit_requested = true;
+        // Desbloquear la lectura de stdin
+        close(STDIN_FILENO);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t networks_per_model = 2;
+    BatchOptions batch;
+    batch.max_batch = 4;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "--networks" || arg == "-n") && i + 1 < argc) {
+            networks_per_model = std::max(1, std::stoi(argv[++i]));
+        } else if ((arg == "--batch" || arg == "-b") && i + 1 < argc) {
+            batch.max_batch = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--batch-window" && i + 1 < argc) {
+            batch.window = std::chrono::milliseconds(std::max(0, std::stoi(argv[++i])));
+        } else {
+            std::cerr << "Uso: " << argv[0] << " [--networks <redes_por_modelo>] [--batch <frames_por_lote>] [--batch-window <ms>]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::signal(SIGTERM, signal_handler);
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::cout << "Servidor de cámaras iniciado (" << networks_per_model << " red(es) por modelo, lotes de hasta "
+              << batch.max_batch << " frames en " << std::chrono::duration_cast<std::chrono::milliseconds>(batch.window).count()
+              << " ms)" << std::endl;
+    reply("ready");
+
+    CameraServer server(networks_per_model, batch);
+
+    std::string line;
+    while (!quit_requested && std::getline(std::cin, line)) {
+        std::istringstream iss(line);
+        std::string command;
+        if (!(iss >> command)) continue;
+
+        if (command == "add") {
+            // id, puerto, url, nombre, config y settings, y opcionalmente los tres ficheros del modelo
+            const auto fields = read_fields(iss);
+            if (fields.size() < 6) {
+                reply("error " + (fields.empty() ? std::string("-") : fields[0]) + " faltan parámetros en 'add'");
+                continue;
+            }
+            const std::string& id = fields[0];
+            ModelFiles model;
+            if (fields.size() > 6) model.config = fields[6];
+            if (fields.size() > 7) model.weights = fields[7];
+            if (fields.size() > 8) model.names = fields[8];
+
+            try {
+                server.add(id, std::stoi(fields[1]), fields[2], fields[3], fields[4], fields[5], model);
+            }
+            catch (const std::exception& e) {
+                reply("error " + id + " " + e.what());
+            }
+        } else if (command == "echo") {
+            const auto fields = read_fields(iss);
+            std::ostringstream oss;
+            oss << "echo " << (fields.empty() ? std::string("-") : fields[0]);
+            for (size_t i = 1; i < fields.size(); i++) {
+                oss << " " << std::quoted(fields[i]);
+            }
+            reply(oss.str());
+        } else if (command == "remove") {
+            std::string id;
+            if (iss >> id) {
+                server.remove(id);
+            }
+        } else if (command == "list") {
+            server.list();
+        } else if (command == "quit") {
+            break;
+        } else {
+            reply("error - comando desconocido: " + command);
+        }
+    }
+
+    std::cout << "Deteniendo todas las cámaras..." << std::endl;
+    server.stop_all();
+
+    return 0;
+}
@@ -0,0 +1,1551 @@
+#pragma once
+
+// Piezas comunes a simple_stream_progressive y camera_server:
+// configuración de cámara, pool de redes compartidas y el servidor MJPEG de cada cámara.
+
+#include "darknet.hpp"
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <netinet/tcp.h>
+#include <sstream>
+#include <errno.h>
+
+#define BOUNDARY "frame"
+
+struct DetectionConfig {
+    std::map<int, bool> enabled;
+
+    bool isEnabled(int classId) const {
+        auto it = enabled.find(classId);
+        return it == enabled.end() || it->second;
+    }
+
+    // Clases desactivadas, en el formato que espera Darknet::skipped_classes()
+    Darknet::SInt disabled() const {
+        Darknet::SInt classes;
+        for (const auto& [classId, on] : enabled) {
+            if (!on) classes.insert(classId);
+        }
+        return classes;
+    }
+};
+
+// Estructura para configuración avanzada de cámara
+struct CameraSettings {
+    std::string quality = "medium";
+    std::string resolution = "720p";
+    int jpegQuality = 75;
+    bool detectionEnabled = true;
+    bool showBoundingBoxes = true;
+    bool showLabels = true;
+    bool showConfidence = true;
+    double minConfidence = 0.5;
+
+    // Obtener resolución en píxeles
+    void getResolution(int& width, int& height) const {
+        if (resolution == "480p") {
+            width = 854; height = 480;
+        } else if (resolution == "720p") {
+            width = 1280; height = 720;
+        } else if (resolution == "1080p") {
+            width = 1920; height = 1080;
+        } else { // original
+            width = 0; height = 0; // No redimensionar
+        }
+    }
+
+    // Obtener límite máximo de resolución para evitar problemas de rendimiento
+    void getMaxResolution(int& maxWidth, int& maxHeight) const {
+        if (quality == "ultra") {
+            maxWidth = 2560; maxHeight = 1440; // Límite en 1440p para ultra
+        } else if (quality == "high") {
+            maxWidth = 1920; maxHeight = 1080; // Límite en 1080p para high
+        } else {
+            maxWidth = 1280; maxHeight = 720; // Límite en 720p para medium/low
+        }
+    }
+};
+
+// Ficheros que identifican un modelo; dos cámaras con el mismo modelo comparten pool
+struct ModelFiles {
+    std::string config = "cfg/yolov4-tiny.cfg";
+    std::string weights = "yolov4-tiny.weights";
+    std::string names = "cfg/coco.names";
+
+    std::string key() const {
+        return config + "|" + weights + "|" + names;
+    }
+};
+
+inline DetectionConfig loadDetectionConfig(const std::string& configFile) {
+    DetectionConfig config;
+
+    try {
+        std::ifstream file(configFile);
+        if (!file.is_open()) {
+            std::cerr << "No se pudo abrir archivo de configuración: " << configFile << std::endl;
+            return config;
+        }
+
+        std::string json_str((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+
+        // Simple JSON parsing
+        size_t pos = 0;
+
+        // Primero buscar "enabledClasses" (formato nuevo como array)
+        pos = json_str.find("\"enabledClasses\"");
+        if (pos != std::string::npos) {
+            pos = json_str.find("[", pos);
+            if (pos != std::string::npos) {
+                size_t end = json_str.find("]", pos);
+                std::string enabled_array = json_str.substr(pos + 1, end - pos - 1);
+
+                // Parse array values
+                int idx = 0;
+                size_t value_pos = 0;
+                while (value_pos < enabled_array.length()) {
+                    // Skip whitespace
+                    while (value_pos < enabled_array.length() &&
+                           (enabled_array[value_pos] == ' ' ||
+                            enabled_array[value_pos] == '\n' ||
+                            enabled_array[value_pos] == '\t')) {
+                        value_pos++;
+                    }
+
+                    if (value_pos >= enabled_array.length()) break;
+
+                    // Check for true/false
+                    if (enabled_array.substr(value_pos, 4) == "true") {
+                        config.enabled[idx] = true;
+                        value_pos += 4;
+                    } else if (enabled_array.substr(value_pos, 5) == "false") {
+                        config.enabled[idx] = false;
+                        value_pos += 5;
+                    }
+
+                    // Skip to next value (after comma)
+                    size_t comma_pos = enabled_array.find(",", value_pos);
+                    if (comma_pos != std::string::npos) {
+                        value_pos = comma_pos + 1;
+                        idx++;
+                    } else {
+                        break;
+                    }
+                }
+            }
+        } else {
+            // Buscar sección "enabled" (formato antiguo como objeto)
+            pos = json_str.find("\"enabled\"");
+            if (pos != std::string::npos) {
+                pos = json_str.find("{", pos);
+                if (pos != std::string::npos) {
+                    size_t end = json_str.find("}", pos);
+                    std::string enabled_section = json_str.substr(pos + 1, end - pos - 1);
+
+                    size_t idx_pos = 0;
+                    while ((idx_pos = enabled_section.find("\"", idx_pos)) != std::string::npos) {
+                        size_t idx_end = enabled_section.find("\"", idx_pos + 1);
+                        if (idx_end != std::string::npos) {
+                            std::string idx_str = enabled_section.substr(idx_pos + 1, idx_end - idx_pos - 1);
+                            int idx = std::stoi(idx_str);
+
+                            size_t bool_pos = enabled_section.find(":", idx_end);
+                            if (bool_pos != std::string::npos) {
+                                bool value = enabled_section.find("true", bool_pos) != std::string::npos;
+                                config.enabled[idx] = value;
+                            }
+                        }
+                        idx_pos = idx_end + 1;
+                    }
+                }
+            }
+        }
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error cargando configuración de detección: " << e.what() << std::endl;
+    }
+
+    return config;
+}
+
+inline CameraSettings loadCameraSettingsFile(const std::string& settingsFile) {
+    CameraSettings settings;
+
+    try {
+        std::ifstream file(settingsFile);
+
+        if (!file.is_open()) {
+            std::cout << "Usando configuración por defecto (no se encontró " << settingsFile << ")" << std::endl;
+            return settings;
+        }
+
+        std::string json_str((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+
+        // Parser JSON simple
+        auto findValue = [&json_str](const std::string& key) -> std::string {
+            size_t pos = json_str.find("\"" + key + "\"");
+            if (pos == std::string::npos) return "";
+
+            pos = json_str.find(":", pos);
+            if (pos == std::string::npos) return "";
+            pos++;
+
+            // Saltar espacios
+            while (pos < json_str.length() && (json_str[pos] == ' ' || json_str[pos] == '\t')) pos++;
+
+            if (json_str[pos] == '"') {
+                // String value
+                pos++;
+                size_t end = json_str.find("\"", pos);
+                if (end != std::string::npos) {
+                    return json_str.substr(pos, end - pos);
+                }
+            } else {
+                // Number or boolean
+                size_t end = json_str.find_first_of(",}", pos);
+                if (end != std::string::npos) {
+                    std::string value = json_str.substr(pos, end - pos);
+                    // Eliminar espacios
+                    value.erase(value.find_last_not_of(" \n\r\t") + 1);
+                    return value;
+                }
+            }
+            return "";
+        };
+
+        std::string quality = findValue("quality");
+        if (!quality.empty()) settings.quality = quality;
+
+        std::string resolution = findValue("resolution");
+        if (!resolution.empty()) settings.resolution = resolution;
+
+        std::string jpegQuality = findValue("jpegQuality");
+        if (!jpegQuality.empty()) settings.jpegQuality = std::stoi(jpegQuality);
+
+        std::string detectionEnabled = findValue("detectionEnabled");
+        if (!detectionEnabled.empty()) settings.detectionEnabled = (detectionEnabled == "true");
+
+        std::string showBoundingBoxes = findValue("showBoundingBoxes");
+        if (!showBoundingBoxes.empty()) settings.showBoundingBoxes = (showBoundingBoxes == "true");
+
+        std::string showLabels = findValue("showLabels");
+        if (!showLabels.empty()) settings.showLabels = (showLabels == "true");
+
+        std::string showConfidence = findValue("showConfidence");
+        if (!showConfidence.empty()) settings.showConfidence = (showConfidence == "true");
+
+        std::string minConfidence = findValue("minConfidence");
+        if (!minConfidence.empty()) settings.minConfidence = std::stod(minConfidence);
+
+        std::cout << "Configuración cargada:" << std::endl;
+        std::cout << "  - Calidad: " << settings.quality << std::endl;
+        std::cout << "  - Resolución: " << settings.resolution << std::endl;
+        std::cout << "  - JPEG: " << settings.jpegQuality << "%" << std::endl;
+        std::cout << "  - Detección: " << (settings.detectionEnabled ? "Activada" : "Desactivada") << std::endl;
+        if (settings.detectionEnabled) {
+            std::cout << "  - Mostrar cajas: " << (settings.showBoundingBoxes ? "Sí" : "No") << std::endl;
+            std::cout << "  - Mostrar etiquetas: " << (settings.showLabels ? "Sí" : "No") << std::endl;
+            std::cout << "  - Mostrar confianza: " << (settings.showConfidence ? "Sí" : "No") << std::endl;
+            std::cout << "  - Confianza mínima: " << (settings.minConfidence * 100) << "%" << std::endl;
+        }
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error cargando configuración avanzada: " << e.what() << std::endl;
+    }
+
+    return settings;
+}
+
+inline CameraSettings loadCameraSettings(int cameraId) {
+    return loadCameraSettingsFile("/home/xabi/Documentos/Deteccion/logs/camera_" + std::to_string(cameraId) + "_settings.json");
+}
+
+// Agrupación de frames de varias cámaras en una sola inferencia.
+// max_batch = 1 desactiva los lotes: cada frame se procesa en cuanto llega.
+struct BatchOptions {
+    size_t max_batch = 1;
+    std::chrono::microseconds window{5000};     // Espera máxima para completar un lote
+};
+
+class NetworkPool;
+
+// Reparto de los núcleos entre todas las redes del proceso, de todos los pools.
+// Cada pool se registra con su número de redes, y la red i de un pool usa la parte
+// (redes de los pools anteriores + i) de un reparto en tantas partes como redes hay en total,
+// así que dos redes no comparten núcleos mientras haya núcleos para todas.
+// Al añadir o quitar un pool cambia el reparto (generation()); cada pool lo aplica a cada red
+// la próxima vez que la presta, cuando nadie la está usando.
+class CpuShares {
+public:
+    void add(const NetworkPool* pool, size_t networks) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pools_.emplace_back(pool, networks);
+        generation_++;
+    }
+
+    void remove(const NetworkPool* pool) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pools_.erase(std::remove_if(pools_.begin(), pools_.end(),
+            [pool](const auto& entry) { return entry.first == pool; }), pools_.end());
+        generation_++;
+    }
+
+    size_t generation() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return generation_;
+    }
+
+    // Núcleos de la red 'index' de 'pool', y la generación del reparto al que pertenecen
+    Darknet::VInt cpus(const NetworkPool* pool, size_t index, size_t& generation) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t first = 0;
+        size_t total = 0;
+        for (const auto& [entry, networks] : pools_) {
+            if (entry == pool) first = total;
+            total += networks;
+        }
+        generation = generation_;
+        if (first + index >= total) return {};
+        return Darknet::split_cpus(first + index, total);
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::pair<const NetworkPool*, size_t>> pools_;
+    size_t generation_ = 0;
+};
+
+// Pool de redes neuronales para un mismo modelo.
+// Los pesos se cargan una sola vez; el resto de instancias son contextos de ejecución que
+// comparten esos pesos y solo reservan sus propias activaciones (en GPU, donde no hay
+// contextos, se carga la red completa otra vez).
+// Cada red solo la usa un hilo a la vez; las cámaras piden prestada una red para
+// cada frame con acquire() y la devuelven automáticamente al destruir el Lease.
+//
+// Con lotes activados, detect() deja el frame en una cola y un despachador por red junta
+// los frames que llegan de distintas cámaras dentro de la ventana en un único predict batch-N.
+//
+// Cada red usa su propia parte de los núcleos (ver CpuShares). Los pools de un mismo proceso
+// deben compartir el mismo CpuShares; sin él, el pool reparte los núcleos solo entre sus redes.
+class NetworkPool {
+public:
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(NetworkPool* pool, Darknet::NetworkPtr net) : pool_(pool), net_(net) {}
+        Lease(Lease&& other) noexcept : pool_(other.pool_), net_(other.net_) {
+            other.pool_ = nullptr;
+            other.net_ = nullptr;
+        }
+        Lease& operator=(Lease&& other) noexcept {
+            if (this != &other) {
+                reset();
+                pool_ = other.pool_;
+                net_ = other.net_;
+                other.pool_ = nullptr;
+                other.net_ = nullptr;
+            }
+            return *this;
+        }
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease() { reset(); }
+
+        explicit operator bool() const { return net_ != nullptr; }
+        Darknet::NetworkPtr get() const { return net_; }
+
+        void reset() {
+            if (pool_ && net_) {
+                pool_->release(net_);
+            }
+            pool_ = nullptr;
+            net_ = nullptr;
+        }
+
+    private:
+        NetworkPool* pool_ = nullptr;
+        Darknet::NetworkPtr net_ = nullptr;
+    };
+
+    NetworkPool(const ModelFiles& model, size_t instances, const BatchOptions& batch = BatchOptions(),
+                std::shared_ptr<CpuShares> cpu_shares = nullptr)
+        : model_(model), instances_(std::max<size_t>(1, instances)), batch_(batch),
+          cpu_shares_(cpu_shares ? cpu_shares : std::make_shared<CpuShares>()) {
+        start_time_ = std::chrono::steady_clock::now();
+        cpu_shares_->add(this, instances_);
+        loader_ = std::thread(&NetworkPool::load, this);
+        if (batch_.max_batch > 1) {
+            for (size_t i = 0; i < instances_; i++) {
+                dispatchers_.emplace_back(&NetworkPool::dispatch, this);
+            }
+        }
+    }
+
+    ~NetworkPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        queue_cv_.notify_all();
+        for (auto& dispatcher : dispatchers_) {
+            dispatcher.join();
+        }
+        if (loader_.joinable()) {
+            loader_.join();
+        }
+
+        // Esperar a que se devuelvan todas las redes antes de liberarlas.
+        // Orden inverso: los contextos antes que la red que tiene los pesos.
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return idle_.size() == all_.size(); });
+        for (auto it = all_.rbegin(); it != all_.rend(); ++it) {
+            Darknet::NetworkPtr net = *it;
+            Darknet::free_neural_network(net);
+        }
+        all_.clear();
+        idle_.clear();
+        cpu_shares_->remove(this);
+    }
+
+    NetworkPool(const NetworkPool&) = delete;
+    NetworkPool& operator=(const NetworkPool&) = delete;
+
+    const ModelFiles& model() const { return model_; }
+
+    // Al menos una red cargada y lista para usar
+    bool ready() const { return loaded_ > 0; }
+    bool failed() const { return failed_; }
+
+    std::vector<std::string> class_names() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return class_names_;
+    }
+
+    // Bloquea hasta que haya una red libre (o el pool se esté cerrando)
+    Lease acquire() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return stopping_ || !idle_.empty(); });
+        if (stopping_) {
+            return Lease();
+        }
+        Darknet::NetworkPtr net = idle_.back();
+        idle_.pop_back();
+        apply_cpu_share(net);
+        return Lease(this, net);
+    }
+
+    // Detectar objetos en un frame. Las clases en 'skipped' se descartan dentro de la red, antes
+    // de decodificar las cajas y de la NMS. Con lotes activados se bloquea hasta que el despachador
+    // procese el lote en el que entró el frame.
+    Darknet::Predictions detect(const cv::Mat& image, const Darknet::SInt& skipped = {}) {
+        if (batch_.max_batch <= 1) {
+            Lease lease = acquire();
+            if (!lease) return {};
+            apply_skipped_classes(lease.get(), skipped);
+            return Darknet::predict(lease.get(), image);
+        }
+
+        auto request = std::make_shared<Request>();
+        request->image = image;
+        request->skipped = skipped;
+        auto result = request->result.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) return {};
+            queue_.push_back(request);
+        }
+        queue_cv_.notify_one();
+
+        return result.get();
+    }
+
+private:
+    struct Request {
+        cv::Mat image;
+        Darknet::SInt skipped;
+        std::promise<Darknet::Predictions> result;
+    };
+
+    // Pasar una red libre al reparto de núcleos actual si ha cambiado desde la última vez.
+    // Se llama con mutex_ tomado y la red fuera de idle_, así que nadie la está usando.
+    void apply_cpu_share(Darknet::NetworkPtr net) {
+        size_t& applied = cpu_generation_[net];
+        if (applied == cpu_shares_->generation()) return;
+        const size_t index = std::find(all_.begin(), all_.end(), net) - all_.begin();
+        Darknet::set_thread_pool(net, Darknet::create_thread_pool(0, cpu_shares_->cpus(this, index, applied)));
+    }
+
+    // Cambiar las clases descartadas de una red solo si son distintas; la red está alquilada,
+    // así que nadie más la está usando
+    static void apply_skipped_classes(Darknet::NetworkPtr net, const Darknet::SInt& skipped) {
+        if (Darknet::skipped_classes(net) != skipped) {
+            Darknet::skipped_classes(net, skipped);
+        }
+    }
+
+    // Quitar de cada objeto las clases que descarta la cámara. El objeto se queda con la mejor de
+    // las clases que le quedan (igual que al decodificar solo con las clases de esta cámara), y
+    // desaparece si no le queda ninguna.
+    static void remove_skipped_classes(Darknet::Predictions& predictions, const Darknet::SInt& skipped) {
+        for (auto& pred : predictions) {
+            for (const int class_idx : skipped) {
+                pred.prob.erase(class_idx);
+            }
+            pred.best_class = -1;
+            for (const auto& [class_idx, probability] : pred.prob) {
+                if (pred.best_class == -1 || probability > pred.prob[pred.best_class]) {
+                    pred.best_class = class_idx;
+                }
+            }
+        }
+        predictions.erase(std::remove_if(predictions.begin(), predictions.end(),
+            [](const Darknet::Prediction& pred) { return pred.best_class < 0; }),
+            predictions.end());
+    }
+
+    // Un despachador por red: espera al primer frame, deja pasar la ventana (o hasta llenar
+    // el lote) para recoger frames de otras cámaras y los procesa todos juntos.
+    void dispatch() {
+        while (true) {
+            std::vector<std::shared_ptr<Request>> batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                queue_cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                if (stopping_) break;
+
+                const auto deadline = std::chrono::steady_clock::now() + batch_.window;
+                queue_cv_.wait_until(lock, deadline, [this] { return stopping_ || queue_.size() >= batch_.max_batch; });
+                if (stopping_) break;
+
+                while (!queue_.empty() && batch.size() < batch_.max_batch) {
+                    batch.push_back(std::move(queue_.front()));
+                    queue_.pop_front();
+                }
+            }
+            if (batch.empty()) continue;    // Otro despachador se llevó los frames
+
+            Lease lease = acquire();
+            if (!lease) {
+                for (auto& request : batch) request->result.set_value({});
+                break;
+            }
+
+            try {
+                std::vector<cv::Mat> images;
+                images.reserve(batch.size());
+                for (const auto& request : batch) {
+                    images.push_back(request->image);
+                }
+
+                // En la red solo se descartan las clases que descartan todas las cámaras del lote
+                Darknet::SInt skipped = batch.front()->skipped;
+                for (const auto& request : batch) {
+                    for (auto it = skipped.begin(); it != skipped.end();) {
+                        it = request->skipped.count(*it) ? std::next(it) : skipped.erase(it);
+                    }
+                }
+                apply_skipped_classes(lease.get(), skipped);
+
+                std::vector<Darknet::Predictions> results = Darknet::predict(lease.get(), images);
+                for (size_t i = 0; i < batch.size(); i++) {
+                    // Con cámaras de configuración distinta en el mismo lote, quitar lo que esta no quiere
+                    if (batch[i]->skipped.size() != skipped.size()) {
+                        remove_skipped_classes(results[i], batch[i]->skipped);
+                    }
+                    batch[i]->result.set_value(std::move(results[i]));
+                }
+            } catch (...) {
+                for (auto& request : batch) {
+                    request->result.set_exception(std::current_exception());
+                }
+            }
+        }
+
+        // Al cerrar, los frames que quedan en la cola se devuelven sin detecciones
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& request : queue_) {
+            request->result.set_value({});
+        }
+        queue_.clear();
+    }
+
+    void release(Darknet::NetworkPtr net) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            idle_.push_back(net);
+        }
+        cv_.notify_one();
+    }
+
+    // La carga de redes no es reentrante en darknet, así que se serializa entre todos los pools
+    static std::mutex& load_mutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    Darknet::NetworkPtr load_network() {
+        const char* args[] = {
+            "camera_stream",
+            model_.names.c_str(),
+            model_.config.c_str(),
+            model_.weights.c_str()
+        };
+
+        char* mutable_args[4];
+        for (int j = 0; j < 4; j++) {
+            mutable_args[j] = const_cast<char*>(args[j]);
+        }
+
+        Darknet::Parms parms = Darknet::parse_arguments(4, mutable_args);
+        return Darknet::load_neural_network(parms);
+    }
+
+    void load() {
+        Darknet::NetworkPtr weights = nullptr;
+        for (size_t i = 0; i < instances_; i++) {
+            try {
+                Darknet::NetworkPtr net = nullptr;
+                {
+                    std::lock_guard<std::mutex> lock(load_mutex());
+                    if (stopping_) return;
+
+                    if (weights) {
+                        try {
+                            net = Darknet::create_execution_context(weights, std::max<int>(1, batch_.max_batch));
+                        } catch (const std::exception& e) {
+                            std::cout << "[pool " << model_.config << "] Sin contextos compartidos (" << e.what()
+                                      << "), cargando la red completa" << std::endl;
+                        }
+                    }
+                    if (!net) {
+                        net = load_network();
+                        if (!weights) weights = net;
+                    }
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (class_names_.empty()) {
+                        // Cargar nombres de clases
+                        std::ifstream names_file(model_.names);
+                        std::string line;
+                        while (std::getline(names_file, line)) {
+                            if (!line.empty()) {
+                                class_names_.push_back(line);
+                            }
+                        }
+                    }
+                    all_.push_back(net);
+                    idle_.push_back(net);
+                }
+                loaded_++;
+                cv_.notify_one();
+
+                auto load_time = std::chrono::steady_clock::now() - start_time_;
+                auto seconds = std::chrono::duration_cast<std::chrono::seconds>(load_time).count();
+                std::cout << "[pool " << model_.config << "] Red " << (i + 1) << "/" << instances_
+                          << " cargada en " << seconds << " segundos" << std::endl;
+
+            } catch (const std::exception& e) {
+                std::cerr << "[pool " << model_.config << "] Error cargando red neuronal: " << e.what() << std::endl;
+                if (loaded_ == 0) {
+                    failed_ = true;
+                }
+                return;
+            }
+        }
+    }
+
+    ModelFiles model_;
+    size_t instances_;
+    BatchOptions batch_;
+    std::shared_ptr<CpuShares> cpu_shares_;
+    std::map<Darknet::NetworkPtr, size_t> cpu_generation_;
+    std::chrono::steady_clock::time_point start_time_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable queue_cv_;
+    std::deque<std::shared_ptr<Request>> queue_;
+    std::vector<std::thread> dispatchers_;
+    std::vector<Darknet::NetworkPtr> all_;
+    std::vector<Darknet::NetworkPtr> idle_;
+    std::vector<std::string> class_names_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<size_t> loaded_{0};
+    std::atomic<bool> failed_{false};
+    std::thread loader_;
+};
+
+// Buzón de una sola plaza entre etapas del pipeline: el productor nunca se bloquea y
+// siempre gana el frame más reciente. Si el consumidor no llegó a recoger el anterior,
+// se descarta y se cuenta en dropped().
+template <typename T>
+class LatestSlot {
+public:
+    void put(T value) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (has_value_) {
+                dropped_++;
+            }
+            value_ = std::move(value);
+            has_value_ = true;
+        }
+        cv_.notify_one();
+    }
+
+    // Espera un valor nuevo; devuelve false si el buzón se cerró
+    bool take(T& out) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return has_value_ || closed_; });
+        if (!has_value_) {
+            return false;
+        }
+        out = std::move(value_);
+        has_value_ = false;
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    T value_{};
+    bool has_value_ = false;
+    bool closed_ = false;
+    std::atomic<uint64_t> dropped_{0};
+};
+
+// Frame que recorre las etapas captura -> detección -> anotación/codificación
+struct PipelineFrame {
+    cv::Mat image;                      // Frame ya redimensionado según settings
+    Darknet::Predictions predictions;
+    double scale_factor = 1.0;          // De coordenadas de detección a coordenadas de image
+    std::string status;                 // Texto de estado de la detección ("Cargando deteccion...")
+    cv::Scalar status_color;
+    bool detection_active = false;
+};
+
+// Último JPEG publicado por una cámara. Se codifica una sola vez y se comparte por referencia
+// (shared_ptr) con todos los clientes HTTP; cada cliente lee a su ritmo y, si se retrasa,
+// simplemente salta al frame más reciente. Cada cambio se avisa por un eventfd para que el
+// bucle epoll del servidor se despierte.
+class FrameBroadcast {
+public:
+    using Frame = std::shared_ptr<const std::vector<uchar>>;
+
+    void set_notify_fd(int fd) { notify_fd_ = fd; }
+
+    void publish(std::vector<uchar> jpeg) {
+        Frame frame = std::make_shared<const std::vector<uchar>>(std::move(jpeg));
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            latest_ = std::move(frame);
+            sequence_++;
+            failed_ = false;
+        }
+        notify();
+    }
+
+    // Avisar a los clientes en espera de que la captura no está disponible
+    void fail() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            latest_.reset();
+            failed_ = true;
+        }
+        notify();
+    }
+
+    // Nuevo intento de conexión: los clientes que lleguen ahora vuelven a esperar frames
+    void retry() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        failed_ = false;
+    }
+
+    // Último frame publicado y su número de secuencia (nullptr si aún no hay ninguno)
+    Frame latest(uint64_t& sequence, bool& failed) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sequence = sequence_;
+        failed = failed_;
+        return latest_;
+    }
+
+    void notify() {
+        if (notify_fd_ >= 0) {
+            uint64_t one = 1;
+            ssize_t ignored = write(notify_fd_, &one, sizeof(one));
+            (void)ignored;
+        }
+    }
+
+private:
+    mutable std::mutex mutex_;
+    Frame latest_;
+    uint64_t sequence_ = 0;
+    bool failed_ = false;
+    int notify_fd_ = -1;
+};
+
+// Servidor MJPEG de una cámara. Escucha en su propio puerto y, si la detección está
+// habilitada, usa las redes del pool compartido con el resto de cámaras del mismo modelo.
+// Hay una sola captura y codificación por cámara mientras haya al menos un cliente conectado,
+// independientemente del número de clientes.
+class CameraStream {
+public:
+    CameraStream(const std::string& id, int port, const std::string& rtsp_url, const std::string& camera_name,
+                 const DetectionConfig& config, const CameraSettings& settings, std::shared_ptr<NetworkPool> pool)
+        : id_(id), port_(port), rtsp_url_(rtsp_url), camera_name_(camera_name),
+          config_(config), settings_(settings), pool_(std::move(pool)), skipped_classes_(config_.disabled()) {}
+
+    ~CameraStream() { stop(); }
+
+    CameraStream(const CameraStream&) = delete;
+    CameraStream& operator=(const CameraStream&) = delete;
+
+    const std::string& id() const { return id_; }
+    int port() const { return port_; }
+    const std::string& name() const { return camera_name_; }
+    const std::shared_ptr<NetworkPool>& pool() const { return pool_; }
+    bool running() const { return running_; }
+    int viewers() const { return viewers_; }
+
+    // Abre el puerto y arranca los hilos del servidor; lanza excepción si el puerto no está disponible
+    void start() {
+        std::cout << "[" << camera_name_ << "] Iniciando en puerto " << port_ << std::endl;
+
+        // Crear socket servidor
+        server_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (server_fd_ < 0) {
+            throw std::runtime_error("Error creando socket");
+        }
+
+        int opt = 1;
+        setsockopt(server_fd_, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt));
+
+        // Configurar TCP_NODELAY para menor latencia
+        setsockopt(server_fd_, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = INADDR_ANY;
+        address.sin_port = htons(port_);
+
+        if (bind(server_fd_, (struct sockaddr*)&address, sizeof(address)) < 0) {
+            close(server_fd_);
+            server_fd_ = -1;
+            throw std::runtime_error("Error en bind puerto " + std::to_string(port_));
+        }
+
+        listen(server_fd_, 16);
+
+        // epoll para el socket de escucha, los clientes y el aviso de frame nuevo
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_fd_ < 0 || event_fd_ < 0) {
+            close_fds();
+            throw std::runtime_error("Error creando epoll");
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = server_fd_;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, server_fd_, &ev);
+        ev.data.fd = event_fd_;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &ev);
+        broadcast_.set_notify_fd(event_fd_);
+
+        std::cout << "[" << camera_name_ << "] Servidor escuchando en puerto " << port_ << std::endl;
+
+        stop_requested_ = false;
+        running_ = true;
+        capture_thread_ = std::thread(&CameraStream::capture_loop, this);
+        thread_ = std::thread(&CameraStream::run, this);
+    }
+
+    // Detiene el servidor: desconecta a todos los clientes, cierra la captura y libera el puerto
+    void stop() {
+        {
+            // Con el mutex tomado, para que el aviso no se pierda entre la comprobación del
+            // predicado en capture_loop() y su espera en viewers_cv_
+            std::lock_guard<std::mutex> lock(viewers_mutex_);
+            stop_requested_ = true;
+        }
+        viewers_cv_.notify_all();
+        broadcast_.notify();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        if (capture_thread_.joinable()) {
+            capture_thread_.join();
+        }
+        broadcast_.set_notify_fd(-1);
+        close_fds();
+        running_ = false;
+    }
+
+    // Bloquea hasta que el servidor termine (por stop() o por error)
+    void wait() {
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+private:
+    // Máximo de frames pendientes de envío por cliente (el que se está enviando + el siguiente)
+    static constexpr size_t kMaxQueuedFrames = 2;
+
+    // Un frame MJPEG pendiente: cabecera de la parte, JPEG compartido y separador final
+    struct OutgoingFrame {
+        std::string header;
+        FrameBroadcast::Frame jpeg;
+        size_t offset = 0;              // Bytes ya enviados de header + jpeg + "\r\n"
+
+        size_t size() const { return header.size() + (jpeg ? jpeg->size() : 0) + 2; }
+    };
+
+    struct Client {
+        int fd = -1;
+        bool streaming = false;         // Ya se envió la cabecera HTTP 200
+        bool closing = false;           // Cerrar en cuanto se vacíe la cola (respuesta 503)
+        bool want_write = false;        // EPOLLOUT activado
+        uint64_t sequence = 0;          // Último frame encolado
+        uint64_t frames_sent = 0;
+        uint64_t frames_skipped = 0;
+        std::chrono::steady_clock::time_point connected_at;
+        std::deque<OutgoingFrame> queue;
+    };
+
+    void close_fds() {
+        if (event_fd_ >= 0) { close(event_fd_); event_fd_ = -1; }
+        if (epoll_fd_ >= 0) { close(epoll_fd_); epoll_fd_ = -1; }
+        if (server_fd_ >= 0) { close(server_fd_); server_fd_ = -1; }
+    }
+
+    // Bucle de eventos: un único hilo atiende a todos los clientes con sockets no bloqueantes
+    void run() {
+        std::map<int, Client> clients;
+        std::vector<epoll_event> events(64);
+
+        try {
+            while (!stop_requested_) {
+                int count = epoll_wait(epoll_fd_, events.data(), events.size(), 200);
+                if (count < 0) {
+                    if (errno == EINTR) continue;
+                    throw std::runtime_error(std::string("epoll_wait: ") + strerror(errno));
+                }
+
+                bool frame_ready = false;
+                for (int i = 0; i < count; i++) {
+                    const int fd = events[i].data.fd;
+                    if (fd == server_fd_) {
+                        accept_clients(clients);
+                    } else if (fd == event_fd_) {
+                        uint64_t value;
+                        while (read(event_fd_, &value, sizeof(value)) > 0) {}
+                        frame_ready = true;
+                    } else {
+                        auto it = clients.find(fd);
+                        if (it == clients.end()) continue;
+                        Client& client = it->second;
+
+                        bool alive = true;
+                        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                            alive = false;
+                        }
+                        if (alive && (events[i].events & EPOLLIN)) {
+                            alive = read_request(client);
+                        }
+                        if (alive && (events[i].events & EPOLLOUT)) {
+                            alive = flush(client);
+                        }
+                        if (!alive) {
+                            disconnect(clients, it);
+                        }
+                    }
+                }
+
+                if (frame_ready) {
+                    distribute_frame(clients);
+                }
+                expire_waiting_clients(clients);
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << "[" << camera_name_ << "] Error: " << e.what() << std::endl;
+        }
+
+        while (!clients.empty()) {
+            disconnect(clients, clients.begin());
+        }
+        running_ = false;
+    }
+
+    void accept_clients(std::map<int, Client>& clients) {
+        while (true) {
+            int client_sock = accept4(server_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client_sock < 0) return;
+
+            // Configurar TCP_NODELAY en el socket del cliente también
+            int nodelay = 1;
+            setsockopt(client_sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = client_sock;
+            epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, client_sock, &ev);
+
+            Client& client = clients[client_sock];
+            client.fd = client_sock;
+            client.connected_at = std::chrono::steady_clock::now();
+
+            // Registrar el cliente; la captura arranca con el primero
+            {
+                std::lock_guard<std::mutex> lock(viewers_mutex_);
+                viewers_++;
+            }
+            viewers_cv_.notify_all();
+            std::cout << "[" << camera_name_ << "] Cliente conectado (" << viewers_ << " en total)" << std::endl;
+
+            // Si ya hay un frame, el cliente empieza a recibir sin esperar al siguiente
+            uint64_t sequence;
+            bool failed;
+            FrameBroadcast::Frame jpeg = broadcast_.latest(sequence, failed);
+            if (jpeg) {
+                enqueue(client, jpeg, sequence);
+                if (!flush(client)) {
+                    disconnect(clients, clients.find(client_sock));
+                }
+            }
+        }
+    }
+
+    // La solicitud HTTP no se interpreta: se lee y se descarta. Devuelve false si el cliente cerró.
+    bool read_request(Client& client) {
+        char buffer[1024];
+        while (true) {
+            ssize_t n = read(client.fd, buffer, sizeof(buffer));
+            if (n > 0) continue;
+            if (n == 0) return false;
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+    }
+
+    // Repartir el último frame publicado a todos los clientes
+    void distribute_frame(std::map<int, Client>& clients) {
+        uint64_t sequence;
+        bool failed;
+        FrameBroadcast::Frame jpeg = broadcast_.latest(sequence, failed);
+
+        for (auto it = clients.begin(); it != clients.end();) {
+            Client& client = it->second;
+            bool alive = true;
+
+            if (failed && !client.streaming && !client.closing) {
+                reject(client);
+                alive = flush(client);
+            } else if (jpeg && sequence != client.sequence && !client.closing) {
+                enqueue(client, jpeg, sequence);
+                alive = flush(client);
+            }
+
+            if (alive) {
+                ++it;
+            } else {
+                it = disconnect(clients, it);
+            }
+        }
+    }
+
+    // Devolver un 503 a los clientes que llevan demasiado tiempo esperando el primer frame
+    void expire_waiting_clients(std::map<int, Client>& clients) {
+        const auto now = std::chrono::steady_clock::now();
+        for (auto it = clients.begin(); it != clients.end();) {
+            Client& client = it->second;
+            if (!client.streaming && !client.closing && now - client.connected_at > std::chrono::seconds(15)) {
+                reject(client);
+                if (!flush(client)) {
+                    it = disconnect(clients, it);
+                    continue;
+                }
+            }
+            ++it;
+        }
+    }
+
+    void reject(Client& client) {
+        OutgoingFrame response;
+        response.header = "HTTP/1.0 503 Service Unavailable\r\n"
+                          "Content-Type: text/plain\r\n\r\n"
+                          "Error: No se pudo conectar a la cámara";
+        client.queue.clear();
+        client.queue.push_back(std::move(response));
+        client.closing = true;
+    }
+
+    // Encolar un frame para un cliente. Si su cola está llena, el frame pendiente que aún no
+    // ha empezado a enviarse se sustituye por el nuevo: un cliente lento solo pierde sus frames.
+    void enqueue(Client& client, const FrameBroadcast::Frame& jpeg, uint64_t sequence) {
+        OutgoingFrame frame;
+        if (!client.streaming) {
+            // Enviar cabecera HTTP junto con el primer frame
+            frame.header = "HTTP/1.0 200 OK\r\n"
+                           "Server: YOLO-Stream\r\n"
+                           "Connection: close\r\n"
+                           "Cache-Control: no-cache\r\n"
+                           "Access-Control-Allow-Origin: *\r\n"
+                           "Content-Type: multipart/x-mixed-replace; boundary=" BOUNDARY "\r\n\r\n";
+            client.streaming = true;
+        }
+        frame.header += "--" BOUNDARY "\r\n"
+                        "Content-Type: image/jpeg\r\n"
+                        "Content-Length: " + std::to_string(jpeg->size()) + "\r\n\r\n";
+        frame.jpeg = jpeg;
+
+        if (client.sequence != 0) {
+            client.frames_skipped += sequence - client.sequence - 1;
+        }
+        client.sequence = sequence;
+
+        if (client.queue.size() >= kMaxQueuedFrames) {
+            // Solo el primero de la cola puede estar a medio enviar (y lleva la cabecera HTTP)
+            client.queue.back() = std::move(frame);
+            client.frames_skipped++;
+        } else {
+            client.queue.push_back(std::move(frame));
+        }
+    }
+
+    // Enviar todo lo posible sin bloquear: cabecera, JPEG y separador de cada frame van en
+    // un solo sendmsg(), con MSG_NOSIGNAL para que un cliente que cierra la conexión a mitad
+    // de un frame no mate el proceso con SIGPIPE. Devuelve false si hay que desconectar al cliente.
+    bool flush(Client& client) {
+        static const char trailer[] = "\r\n";
+
+        while (!client.queue.empty()) {
+            iovec iov[3 * kMaxQueuedFrames];
+            int iov_count = 0;
+
+            for (const auto& frame : client.queue) {
+                const char* parts[3] = { frame.header.data(), frame.jpeg ? (const char*)frame.jpeg->data() : nullptr, trailer };
+                size_t sizes[3] = { frame.header.size(), frame.jpeg ? frame.jpeg->size() : 0, frame.jpeg ? 2u : 0u };
+                size_t skip = frame.offset;
+                for (int p = 0; p < 3; p++) {
+                    if (skip >= sizes[p]) {
+                        skip -= sizes[p];
+                        continue;
+                    }
+                    iov[iov_count].iov_base = const_cast<char*>(parts[p] + skip);
+                    iov[iov_count].iov_len = sizes[p] - skip;
+                    iov_count++;
+                    skip = 0;
+                }
+            }
+
+            msghdr msg{};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = iov_count;
+            ssize_t written = sendmsg(client.fd, &msg, MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                return false;
+            }
+
+            // Avanzar por la cola según lo enviado
+            size_t remaining = written;
+            while (remaining > 0 && !client.queue.empty()) {
+                OutgoingFrame& front = client.queue.front();
+                const size_t total = front.jpeg ? front.size() : front.header.size();
+                const size_t pending = total - front.offset;
+                if (remaining >= pending) {
+                    remaining -= pending;
+                    if (front.jpeg) {
+                        client.frames_sent++;
+                    }
+                    client.queue.pop_front();
+                } else {
+                    front.offset += remaining;
+                    remaining = 0;
+                }
+            }
+        }
+
+        if (client.queue.empty() && client.closing) {
+            return false;
+        }
+
+        // Pedir EPOLLOUT solo mientras queden datos pendientes
+        const bool want_write = !client.queue.empty();
+        if (want_write != client.want_write) {
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            if (want_write) {
+                ev.events |= EPOLLOUT;
+            }
+            ev.data.fd = client.fd;
+            epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, client.fd, &ev);
+            client.want_write = want_write;
+        }
+        return true;
+    }
+
+    std::map<int, Client>::iterator disconnect(std::map<int, Client>& clients, std::map<int, Client>::iterator it) {
+        Client& client = it->second;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, client.fd, nullptr);
+        close(client.fd);
+
+        if (client.streaming) {
+            std::cout << "[" << camera_name_ << "] Cliente desconectado tras " << client.frames_sent
+                      << " frames (" << client.frames_skipped << " saltados por ir lento)" << std::endl;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(viewers_mutex_);
+            viewers_--;
+        }
+        viewers_cv_.notify_all();
+
+        return clients.erase(it);
+    }
+
+    // Captura compartida: se abre con el primer cliente y se cierra cuando se va el último
+    void capture_loop() {
+        while (!stop_requested_) {
+            {
+                std::unique_lock<std::mutex> lock(viewers_mutex_);
+                viewers_cv_.wait(lock, [this] { return stop_requested_ || viewers_ > 0; });
+            }
+            if (stop_requested_) break;
+
+            broadcast_.retry();
+            if (!run_pipeline()) {
+                // No se pudo abrir la cámara: avisar a los clientes y reintentar en unos segundos
+                broadcast_.fail();
+                std::unique_lock<std::mutex> lock(viewers_mutex_);
+                viewers_cv_.wait_for(lock, std::chrono::seconds(2), [this] { return stop_requested_.load(); });
+            }
+        }
+    }
+
+    // Devuelve false si no se pudo abrir la cámara
+    bool run_pipeline() {
+        // Abrir stream RTSP inmediatamente
+        cv::VideoCapture cap;
+
+        // Configurar para conexión rápida
+        cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('H', '2', '6', '4'));
+        cap.set(cv::CAP_PROP_BUFFERSIZE, 1);
+
+        std::cout << "[" << camera_name_ << "] Conectando a RTSP (sin esperar detección)..." << std::endl;
+        cap.open(rtsp_url_, cv::CAP_FFMPEG);
+
+        if (!cap.isOpened()) {
+            std::cerr << "[" << camera_name_ << "] Error abriendo RTSP" << std::endl;
+            return false;
+        }
+
+        // Configurar resolución según settings
+        int target_width, target_height;
+        settings_.getResolution(target_width, target_height);
+
+        if (target_width > 0 && target_height > 0) {
+            cap.set(cv::CAP_PROP_FRAME_WIDTH, target_width);
+            cap.set(cv::CAP_PROP_FRAME_HEIGHT, target_height);
+        }
+
+        cap.set(cv::CAP_PROP_BUFFERSIZE, 0);  // Sin buffer para menor latencia
+        cap.set(cv::CAP_PROP_FPS, 30);
+
+        // Obtener resolución real
+        int actual_width = cap.get(cv::CAP_PROP_FRAME_WIDTH);
+        int actual_height = cap.get(cv::CAP_PROP_FRAME_HEIGHT);
+        std::cout << "[" << camera_name_ << "] Resolución: " << actual_width << "x" << actual_height << std::endl;
+        std::cout << "[" << camera_name_ << "] Stream iniciado" << std::endl;
+
+        // Cada etapa corre en su propio hilo y se comunica con la siguiente por un buzón
+        // de una plaza, así la captura nunca espera a la inferencia y los frames atrasados
+        // se descartan en lugar de acumularse. La última etapa publica en broadcast_.
+        LatestSlot<PipelineFrame> captured;
+        LatestSlot<PipelineFrame> detected;
+        std::atomic<bool> session_stop{false};
+        std::atomic<bool> detection_active{false};
+
+        auto stop_session = [&]() {
+            session_stop = true;
+            captured.close();
+            detected.close();
+        };
+
+        std::thread detect_thread([&]() {
+            detect_stage(captured, detected, detection_active);
+            stop_session();
+        });
+        std::thread encode_thread([&]() {
+            encode_stage(detected, captured, detection_active);
+            stop_session();
+        });
+
+        capture_stage(cap, captured, session_stop);
+
+        stop_session();
+        detect_thread.join();
+        encode_thread.join();
+
+        cap.release();
+        std::cout << "[" << camera_name_ << "] Stream detenido" << std::endl;
+        return true;
+    }
+
+    // Etapa de captura: lee y redimensiona frames sin esperar nunca a las etapas siguientes
+    void capture_stage(cv::VideoCapture& cap, LatestSlot<PipelineFrame>& output, const std::atomic<bool>& session_stop) {
+        int target_width, target_height;
+        settings_.getResolution(target_width, target_height);
+
+        // Aplicar límite máximo para evitar congelamiento
+        int maxWidth, maxHeight;
+        settings_.getMaxResolution(maxWidth, maxHeight);
+
+        while (!stop_requested_ && !session_stop && viewers_ > 0) {
+            // Un Mat nuevo en cada lectura: el anterior puede seguir en uso en otra etapa
+            cv::Mat frame;
+            if (!cap.read(frame)) break;
+            if (frame.empty()) continue;
+
+            bool needsResize = false;
+            double scale = 1.0;
+
+            // Si hay resolución objetivo específica
+            if (target_width > 0 && target_height > 0) {
+                scale = std::min((double)target_width/frame.cols, (double)target_height/frame.rows);
+                needsResize = true;
+            }
+            // Si excede el límite máximo
+            else if (frame.cols > maxWidth || frame.rows > maxHeight) {
+                scale = std::min((double)maxWidth/frame.cols, (double)maxHeight/frame.rows);
+                needsResize = true;
+            }
+
+            PipelineFrame out;
+            if (needsResize && scale < 1.0) {
+                cv::resize(frame, out.image, cv::Size(), scale, scale);
+            } else {
+                out.image = frame;
+            }
+            output.put(std::move(out));
+        }
+    }
+
+    // Etapa de detección: siempre trabaja sobre el frame capturado más reciente
+    void detect_stage(LatestSlot<PipelineFrame>& input, LatestSlot<PipelineFrame>& output, std::atomic<bool>& detection_active) {
+        // Dar a la red unos segundos tras cargarse antes de activar la detección
+        const auto detection_delay = std::chrono::seconds(2);
+        std::chrono::steady_clock::time_point ready_since;
+        bool pool_ready = false;
+        const bool detection_enabled = settings_.detectionEnabled && pool_;
+
+        PipelineFrame frame;
+        while (input.take(frame)) {
+            // Mostrar estado de detección solo si está habilitada
+            if (detection_enabled && !detection_active) {
+                if (!pool_->ready()) {
+                    frame.status = "Cargando deteccion...";
+                    frame.status_color = cv::Scalar(0, 255, 255);
+                } else if (!pool_ready) {
+                    pool_ready = true;
+                    ready_since = std::chrono::steady_clock::now();
+                } else if (std::chrono::steady_clock::now() - ready_since < detection_delay) {
+                    frame.status = "Iniciando deteccion...";
+                    frame.status_color = cv::Scalar(0, 255, 0);
+                } else {
+                    detection_active = true;
+                    class_names_ = pool_->class_names();
+                    std::cout << "[" << camera_name_ << "] Detección activa en stream" << std::endl;
+                }
+            }
+
+            // Hacer detección solo si está lista y habilitada
+            if (detection_enabled && detection_active) {
+                frame.detection_active = true;
+                detect(frame);
+            }
+
+            output.put(std::move(frame));
+        }
+    }
+
+    // Etapa de anotación y codificación JPEG; cada frame se codifica una sola vez para todos los clientes
+    void encode_stage(LatestSlot<PipelineFrame>& input, const LatestSlot<PipelineFrame>& captured, const std::atomic<bool>& detection_active) {
+        // Configurar JPEG con calidad según settings
+        std::vector<int> jpeg_params = {cv::IMWRITE_JPEG_QUALITY, settings_.jpegQuality};
+
+        int frame_count = 0;
+        auto last_time = std::chrono::steady_clock::now();
+
+        PipelineFrame frame;
+        while (input.take(frame)) {
+            if (!frame.status.empty()) {
+                cv::putText(frame.image, frame.status,
+                    cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX,
+                    0.7, frame.status_color, 2);
+            }
+
+            if (frame.detection_active) {
+                draw_predictions(frame);
+            }
+
+            // Codificar a JPEG
+            std::vector<uchar> jpeg_buf;
+            if (!cv::imencode(".jpg", frame.image, jpeg_buf, jpeg_params)) continue;
+
+            broadcast_.publish(std::move(jpeg_buf));
+            frame_count++;
+
+            // Mostrar FPS y frames descartados en cada etapa
+            auto now = std::chrono::steady_clock::now();
+            if (std::chrono::duration_cast<std::chrono::seconds>(now - last_time).count() >= 1) {
+                std::cout << "[" << camera_name_ << "] FPS: " << frame_count
+                         << (detection_active ? " (con detección)" : " (sin detección)")
+                         << " - clientes: " << viewers_
+                         << " - descartados detección/codificación: "
+                         << captured.dropped() << "/" << input.dropped() << std::endl;
+                frame_count = 0;
+                last_time = now;
+            }
+        }
+    }
+
+    void detect(PipelineFrame& frame) {
+        // Crear versión reducida para detección (más rápida)
+        cv::Mat detection_frame;
+        frame.scale_factor = 1.0;
+        if (frame.image.cols > 640) {
+            double scale = 640.0 / frame.image.cols;
+            cv::resize(frame.image, detection_frame, cv::Size(), scale, scale);
+            frame.scale_factor = (double)frame.image.cols / detection_frame.cols;
+        } else {
+            detection_frame = frame.image;
+        }
+
+        try {
+            // El pool junta este frame con los de otras cámaras que lleguen a la vez
+            frame.predictions = pool_->detect(detection_frame, skipped_classes_);
+        } catch (const std::exception& e) {
+            // Ignorar errores de detección
+        }
+    }
+
+    void draw_predictions(PipelineFrame& frame) {
+        cv::Mat& process_frame = frame.image;
+        const double scale_factor = frame.scale_factor;
+
+        for (const auto& pred : frame.predictions) {
+            if (pred.best_class >= 0 && pred.best_class < class_names_.size()) {
+                float confidence = pred.prob.at(pred.best_class);
+
+                // Verificar confianza mínima
+                if (confidence < settings_.minConfidence) {
+                    continue;
+                }
+
+                std::string class_name = class_names_[pred.best_class];
+
+                // Escalar rectángulo al tamaño del frame original
+                cv::Rect scaled_rect(
+                    pred.rect.x * scale_factor,
+                    pred.rect.y * scale_factor,
+                    pred.rect.width * scale_factor,
+                    pred.rect.height * scale_factor
+                );
+
+                // Dibujar caja si está habilitado
+                if (settings_.showBoundingBoxes) {
+                    cv::rectangle(process_frame, scaled_rect, cv::Scalar(0, 255, 0), 2);
+                }
+
+                // Preparar etiqueta
+                if (settings_.showLabels || settings_.showConfidence) {
+                    std::string label;
+                    if (settings_.showLabels) {
+                        label = class_name;
+                    }
+                    if (settings_.showConfidence) {
+                        if (settings_.showLabels) label += " ";
+                        label += std::to_string(int(confidence * 100)) + "%";
+                    }
+
+                    if (!label.empty()) {
+                        int baseline;
+                        cv::Size label_size = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseline);
+
+                        cv::rectangle(process_frame,
+                            cv::Point(scaled_rect.x, scaled_rect.y - label_size.height - 10),
+                            cv::Point(scaled_rect.x + label_size.width, scaled_rect.y),
+                            cv::Scalar(0, 255, 0), cv::FILLED);
+
+                        cv::putText(process_frame, label,
+                            cv::Point(scaled_rect.x, scaled_rect.y - 5),
+                            cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 0), 1);
+                    }
+                }
+            }
+        }
+    }
+
+    std::string id_;
+    int port_;
+    std::string rtsp_url_;
+    std::string camera_name_;
+    DetectionConfig config_;
+    CameraSettings settings_;
+    std::shared_ptr<NetworkPool> pool_;
+    Darknet::SInt skipped_classes_;    // Las clases desactivadas no llegan a salir de la red
+    std::vector<std::string> class_names_;
+
+    FrameBroadcast broadcast_;
+    std::mutex viewers_mutex_;
+    std::condition_variable viewers_cv_;
+    std::atomic<int> viewers_{0};
+
+    int server_fd_ = -1;
+    int epoll_fd_ = -1;
+    int event_fd_ = -1;
+    std::atomic<bool> stop_requested_{false};
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    std::thread capture_thread_;
+};
@@ -3,9 +3,10 @@
  */
 
 #include "darknet.hpp"
-#include "darknet_image.hpp"
 
-#include <set>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <thread>
 
 /** @file
@@ -18,7 +19,7 @@
  *
  *     processing DSCN1582A.MOV:
  *     -> total number of CPUs ..... 16
- *     -> threads for this video ... 4
+ *     -> prediction workers ....... 16
  *     -> neural network size ...... 224 x 160 x 3
  *     -> input video dimensions ... 640 x 480
  *     -> input video frame count .. 1230
@@ -36,196 +37,61 @@
 /// Everything we know about a specific video frame is stored in one of these objects.
 struct Frame
 {
-	size_t					index;			///< zero-based frame index into the video
-	cv::Mat					mat;			///< the original frame, and then the annotated frame
-	Darknet::Image			img;			///< Darknet-specific image, resized original frame
-	Darknet::Predictions	predictions;	///< all predictions made by Darknet/YOLO for this frame
-
-	/// std::set uses @p operator<() to ensure the frames are ordered numerically within the set
-	bool operator<(const Frame & rhs) const
-	{
-		return index < rhs.index;
-	}
+	cv::Mat									mat;			///< the original frame, and then the annotated frame
+	std::future<Darknet::Predictions>		predictions;	///< all predictions made by Darknet/YOLO for this frame
 };
 
 
-bool				all_threads_must_exit	= false;	///< if something goes wrong, this flag gets set to @p true
-Darknet::NetworkPtr	net						= nullptr;	///< Darknet/YOLO neural network pointer
-cv::Size			network_dimensions;					///< dimensions of the neural network that was loaded
-std::set<Frame>		frames_waiting_for_resize;			///< once a frame is read from the video, it is stored here
-std::set<Frame>		frames_waiting_for_prediction;		///< once a frame has been resized, it is stored here
-std::set<Frame>		frames_waiting_for_output;			///< once a frame has been predicted, it is stored here
-std::mutex			waiting_for_resize;					///< mutex to protect access to @ref frames_waiting_for_resize
-std::mutex			waiting_for_prediction;				///< mutex to protect access to @ref frames_waiting_for_prediction
-std::mutex			waiting_for_output;					///< mutex to protect access to @ref frames_waiting_for_output
-std::chrono::high_resolution_clock::duration wait_threads_duration;	///< amount of time spent waiting for other threads to finish running
-std::chrono::high_resolution_clock::duration reader_work_duration;	///< amount of time spent reading frames
-std::chrono::high_resolution_clock::duration resize_work_duration;	///< amount of time spent resizing frames
-std::chrono::high_resolution_clock::duration predict_work_duration;	///< amount of time spent predicting frames
+bool					all_threads_must_exit	= false;	///< if something goes wrong, this flag gets set to @p true
+Darknet::NetworkPtr		net						= nullptr;	///< Darknet/YOLO neural network pointer
+size_t					max_frames_in_flight	= 0;		///< how far ahead of the output thread the reader may get
+std::deque<Frame>		frames_in_flight;					///< frames in the order they were read, waiting for their predictions
+std::mutex				frames_mutex;						///< mutex to protect access to @ref frames_in_flight
+std::condition_variable	frames_cv;							///< signalled when a frame is added to or removed from @ref frames_in_flight
+bool					reader_is_done			= false;	///< set once the reader has queued the last frame
 std::chrono::high_resolution_clock::duration output_work_duration;	///< amount of time spent on the output video
-size_t				reader_must_pause		= 0;
-size_t				resize_thread_starved	= 0;
-size_t				predict_thread_starved	= 0;
-size_t				output_thread_starved	= 0;
-size_t				waiting_for_threads		= 0;
-size_t				expected_next_index		= 0; ///< keep track of which frame has been written to disk
-
-
-void resize_thread()
-{
-	try
-	{
-		while (all_threads_must_exit == false)
-		{
-			if ( frames_waiting_for_resize.empty())
-			{
-				resize_thread_starved ++;
-				std::this_thread::sleep_for(std::chrono::milliseconds(1));
-				continue;
-			}
-
-			const auto timestamp_begin = std::chrono::high_resolution_clock::now();
-
-			Frame frame;
-			if (true)
-			{
-				std::scoped_lock lock(waiting_for_resize);
-				auto iter = frames_waiting_for_resize.begin();
-				frame = *iter;
-				frames_waiting_for_resize.erase(iter);
-			}
-
-			cv::Mat tmp;
-			if (frame.mat.size() == network_dimensions)
-			{
-				tmp = frame.mat.clone();
-			}
-			else
-			{
-				cv::resize(frame.mat, tmp, network_dimensions, cv::INTER_NEAREST);
-			}
 
-			frame.img = Darknet::bgr_mat_to_rgb_image(tmp);
 
-			if (true)
-			{
-				std::scoped_lock lock(waiting_for_prediction);
-				frames_waiting_for_prediction.insert(frame);
-			}
-
-			const auto timestamp_end = std::chrono::high_resolution_clock::now();
-			resize_work_duration += timestamp_end - timestamp_begin;
-		}
-	}
-	catch(const std::exception & e)
-	{
-		std::cout << "ERROR: resize thread exception: " << e.what() << std::endl;
-		all_threads_must_exit = true;
-	}
-
-	return;
-}
-
-
-void detection_thread(size_t & total_objects_found)
+void output_thread(cv::VideoWriter & out, size_t & total_objects_found)
 {
 	try
 	{
-		while (all_threads_must_exit == false)
+		while (true)
 		{
-			if (frames_waiting_for_prediction.empty())
-			{
-				predict_thread_starved ++;
-				std::this_thread::sleep_for(std::chrono::milliseconds(1));
-				continue;
-			}
-
-			// if we get here we know we have at least 1 frame where we can call predict()
-			const auto timestamp_begin = std::chrono::high_resolution_clock::now();
-
 			Frame frame;
 			if (true)
 			{
-				std::scoped_lock lock(waiting_for_prediction);
-				auto iter = frames_waiting_for_prediction.begin();
-				frame = *iter;
-				frames_waiting_for_prediction.erase(iter);
-			}
-
-			frame.predictions = Darknet::predict(net, frame.img, frame.mat.size());
-			Darknet::annotate(net, frame.predictions, frame.mat);
-
-			total_objects_found += frame.predictions.size();
-
-			// in case multiple resize threads are running, we have no idea in which order the frames have been processed,
-			// so pass them to another thread which will ensure the frames are re-ordered before creating the output video
-			std::scoped_lock lock(waiting_for_output);
-			frames_waiting_for_output.insert(frame);
-
-			const auto timestamp_end = std::chrono::high_resolution_clock::now();
-			predict_work_duration += timestamp_end - timestamp_begin;
-		}
-	}
-	catch(const std::exception & e)
-	{
-		std::cout << "ERROR: detection thread exception: " << e.what() << std::endl;
-		all_threads_must_exit = true;
-	}
-
-	return;
-}
-
-
-void output_thread(cv::VideoWriter & out)
-{
-	try
-	{
-		expected_next_index = 0;
-
-		while (all_threads_must_exit == false)
-		{
-			if (frames_waiting_for_output.empty())
-			{
-				output_thread_starved ++;
-				std::this_thread::sleep_for(std::chrono::milliseconds(1));
-				continue;
+				std::unique_lock lock(frames_mutex);
+				frames_cv.wait(lock, []{ return all_threads_must_exit or reader_is_done or not frames_in_flight.empty(); });
+				if (frames_in_flight.empty())
+				{
+					break;
+				}
+				frame = std::move(frames_in_flight.front());
+				frames_in_flight.pop_front();
 			}
+			frames_cv.notify_all();
 
-			// we have at least 1 frame ready...but is it the right one?
-
-			if (frames_waiting_for_output.begin()->index != expected_next_index)
-			{
-				output_thread_starved ++;
-				std::this_thread::yield();
-				continue;
-			}
+			// the frames were queued in order, so waiting on the oldest one keeps the output video in order even though
+			// several worker threads are predicting at the same time
+			const auto predictions = frame.predictions.get();
 
-			// if we get here, then the next frame we want is at the front of the set
 			const auto timestamp_begin = std::chrono::high_resolution_clock::now();
 
-			Frame frame;
-			if (true)
-			{
-				std::scoped_lock lock(waiting_for_output);
-				auto iter = frames_waiting_for_output.begin();
-				frame = *iter;
-				frames_waiting_for_output.erase(iter);
-			}
-
+			Darknet::annotate(net, predictions, frame.mat);
 			out.write(frame.mat);
-			expected_next_index ++;
+			total_objects_found += predictions.size();
 
 			const auto timestamp_end = std::chrono::high_resolution_clock::now();
 			output_work_duration += timestamp_end - timestamp_begin;
-
-//			cv::imshow("output", frame.mat);
-//			cv::waitKey(5);
 		}
 	}
 	catch(const std::exception & e)
 	{
 		std::cout << "ERROR: output thread exception: " << e.what() << std::endl;
+		std::scoped_lock lock(frames_mutex);
 		all_threads_must_exit = true;
+		frames_cv.notify_all();
 	}
 
 	return;
@@ -244,9 +110,11 @@ int main(int argc, char * argv[])
 		int network_height = 0;
 		int network_channels = 0;
 		Darknet::network_dimensions(net, network_width, network_height, network_channels);
-		network_dimensions = cv::Size(network_width, network_height);
 
-		std::vector<std::thread> threads;
+		// one worker per CPU core, each with its own execution context sharing the weights of the network
+		const size_t workers = std::max(1u, std::thread::hardware_concurrency());
+		max_frames_in_flight = 2 * workers;
+		Darknet::set_async_workers(net, workers, max_frames_in_flight);
 
 		for (const auto & parm : parms)
 		{
@@ -275,17 +143,9 @@ int main(int argc, char * argv[])
 
 			size_t total_objects_found				= 0;
 			size_t frame_counter					= 0;
-			wait_threads_duration	= std::chrono::high_resolution_clock::duration();
-			reader_work_duration	= std::chrono::high_resolution_clock::duration();
-			resize_work_duration	= std::chrono::high_resolution_clock::duration();
-			predict_work_duration	= std::chrono::high_resolution_clock::duration();
 			output_work_duration	= std::chrono::high_resolution_clock::duration();
-			reader_must_pause		= 0;
-			resize_thread_starved	= 0;
-			predict_thread_starved	= 0;
-			output_thread_starved	= 0;
-			waiting_for_threads		= 0;
-			expected_next_index		= 0;
+			all_threads_must_exit	= false;
+			reader_is_done			= false;
 
 			cv::VideoWriter out(output_filename, cv::VideoWriter::fourcc('m', 'p', '4', 'v'), fps, cv::Size(video_width, video_height));
 			if (not out.isOpened())
@@ -297,26 +157,18 @@ int main(int argc, char * argv[])
 			/* These are the tasks that must be performed:
 				*
 				*		1) read the frames from the video file
-				*		2) resize the frames, convert to RGB, convert to Darknet::Image format
-				*		3) call Darknet/YOLO predict() and annotate() on each frame
-				*		4) write the annotated image to the output video
-				*
-				* From a complexity point of view, each one of those tasks takes longer than the task before.  So reading is simple,
-				* resizing take a bit more time than reading, predicting takes more time than resizing, and the longest of all is
-				* writing the video back to disk because of the re-encoding.
+				*		2) call Darknet/YOLO predict() on each frame
+				*		3) annotate each frame and write it to the output video
 				*
-				* By rate limiting the first and fastest task, we can control the rest of the tasks after that.
+				* Task #2 is done by the worker pool behind Darknet::predict_async().  The reader (this thread) is rate limited
+				* to keep at most max_frames_in_flight frames between itself and the output thread, which is also the depth
+				* of the prediction queue so no frame is ever dropped.
 				*/
-
-			// start all the threads we'll need -- the "main" thread will take care of task #1 (reading)
-			all_threads_must_exit = false;
-			threads.emplace_back(resize_thread);									// task #2
-			threads.emplace_back(detection_thread, std::ref(total_objects_found));	// task #3
-			threads.emplace_back(output_thread, std::ref(out));						// task #4
+			std::thread output(output_thread, std::ref(out), std::ref(total_objects_found));
 
 			std::cout
 				<< "-> total number of CPUs ..... " << std::thread::hardware_concurrency()			<< std::endl
-				<< "-> threads for this video ... " << threads.size() + 1 /* this thread */			<< std::endl
+				<< "-> prediction workers ....... " << workers										<< std::endl
 				<< "-> neural network size ...... " << network_width << " x " << network_height << " x " << network_channels << std::endl
 				<< "-> input video dimensions ... " << video_width << " x " << video_height			<< std::endl
 				<< "-> input video frame count .. " << video_frames_count							<< std::endl
@@ -326,25 +178,27 @@ int main(int argc, char * argv[])
 
 			const auto timestamp_when_video_started = std::chrono::high_resolution_clock::now();
 
-			while (all_threads_must_exit == false)
+			while (true)
 			{
-				const auto timestamp_begin = std::chrono::high_resolution_clock::now();
-
 				Frame frame;
-				frame.index = frame_counter;
 				cap >> frame.mat;
 				if (frame.mat.empty())
 				{
 					break;
 				}
 
-				// place the frame on the queue so it can be resized
-				if (true)
+				std::unique_lock lock(frames_mutex);
+				frames_cv.wait(lock, []{ return all_threads_must_exit or frames_in_flight.size() < max_frames_in_flight; });
+				if (all_threads_must_exit)
 				{
-					std::scoped_lock lock(waiting_for_resize);
-					frames_waiting_for_resize.insert(frame);
+					break;
 				}
 
+				frame.predictions = Darknet::predict_async(net, frame.mat);
+				frames_in_flight.push_back(std::move(frame));
+				lock.unlock();
+				frames_cv.notify_all();
+
 				frame_counter ++;
 				if (frame_counter % fps_rounded == 0)
 				{
@@ -354,30 +208,17 @@ int main(int argc, char * argv[])
 						<< " (" << percentage << "%)\r"
 						<< std::flush;
 				}
-
-				const auto timestamp_end = std::chrono::high_resolution_clock::now();
-				reader_work_duration += timestamp_end - timestamp_begin;
-
-				while (	all_threads_must_exit == false and
-						frames_waiting_for_resize		.size() +
-						frames_waiting_for_prediction	.size() +
-						frames_waiting_for_output		.size() > 5)
-				{
-					// reader thread is getting too far ahead of the other threads, we need to slow down
-					reader_must_pause ++;
-					std::this_thread::sleep_for(std::chrono::milliseconds(1));
-				}
 			}
 
-			// even though we finished reading the frames from the input video, the other threads may not yet have finished
-			const auto begin_waiting = std::chrono::high_resolution_clock::now();
-			while (all_threads_must_exit == false and expected_next_index < frame_counter)
+			// even though we finished reading the frames from the input video, the output thread may not yet have finished
+			if (true)
 			{
-				waiting_for_threads ++;
-				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				std::scoped_lock lock(frames_mutex);
+				reader_is_done = true;
 			}
-			wait_threads_duration = std::chrono::high_resolution_clock::now() - begin_waiting;
-			all_threads_must_exit = true;
+			frames_cv.notify_all();
+			output.join();
+			frames_in_flight.clear();
 
 			const auto timestamp_when_video_ended = std::chrono::high_resolution_clock::now();
 			const auto processing_duration = timestamp_when_video_ended - timestamp_when_video_started;
@@ -392,25 +233,10 @@ int main(int argc, char * argv[])
 				<< "-> average objects/frame .... " << static_cast<float>(total_objects_found) / frame_counter	<< std::endl
 #if 0
 				// timing details are commented out, they're mostly for development purpose not end user consumption
-				<< "-> reader chose to pause .... " << reader_must_pause										<< std::endl
-				<< "-> resize thread starved .... " << resize_thread_starved									<< std::endl
-				<< "-> predict thread starved ... " << predict_thread_starved									<< std::endl
-				<< "-> output thread starved .... " << output_thread_starved									<< std::endl
-				<< "-> waiting for threads ...... " << waiting_for_threads										<< std::endl
-				<< "-> time spent reading ....... " << std::chrono::duration_cast<std::chrono::milliseconds>(reader_work_duration).count() << " milliseconds" << std::endl
-				<< "-> time spent resizing ...... " << std::chrono::duration_cast<std::chrono::milliseconds>(resize_work_duration).count() << " milliseconds" << std::endl
-				<< "-> time spent predicting .... " << std::chrono::duration_cast<std::chrono::milliseconds>(predict_work_duration).count() << " milliseconds" << std::endl
+				<< "-> frames dropped ........... " << Darknet::dropped_async_predictions(net)					<< std::endl
 				<< "-> time spent output video .. " << std::chrono::duration_cast<std::chrono::milliseconds>(output_work_duration).count() << " milliseconds" << std::endl
-				<< "-> time waiting for threads . " << std::chrono::duration_cast<std::chrono::milliseconds>(wait_threads_duration).count() << " milliseconds" << std::endl
 #endif
 				;
-
-			// all threads should have exited by now
-			for (auto & t : threads)
-			{
-				t.join();
-			}
-			threads.clear();
 		}
 
 		Darknet::free_neural_network(net);
@@ -124,39 +124,26 @@ void activate_array(float *x, const int n, const ACTIVATION a)
 {
 	TAT(TATPARMS);
 
-	int i;
-	if (a == LINEAR) {}
-	else if (a == LEAKY) {
-		#pragma omp parallel for
-		for (i = 0; i < n; ++i) {
-			x[i] = leaky_activate(x[i]);
-		}
-	}
-	else if (a == LOGISTIC) {
-		#pragma omp parallel for
-		for (i = 0; i < n; ++i) {
-			x[i] = logistic_activate(x[i]);
-		}
-	}
-	else {
-		for (i = 0; i < n; ++i) {
-			x[i] = activate(x[i], a);
-		}
-	}
+	activate_array_simd(x, n, a);
 }
 
 void activate_array_swish(float *x, const int n, float * output_sigmoid, float * output)
 {
 	TAT(TATPARMS);
 
-	int i;
-	#pragma omp parallel for
-	for (i = 0; i < n; ++i) {
-		float x_val = x[i];
-		float sigmoid = logistic_activate(x_val);
-		output_sigmoid[i] = sigmoid;
-		output[i] = x_val * sigmoid;
-	}
+	// the backward pass needs the sigmoid, so it is calculated separately
+	std::memmove(output_sigmoid, x, n * sizeof(float));
+	activate_array_simd(output_sigmoid, n, LOGISTIC);
+
+	const int chunk = 16384;
+	Darknet::parallel_for((n + chunk - 1) / chunk, [&](const int block)
+	{
+		const int end = std::min(n, (block + 1) * chunk);
+		for (int i = block * chunk; i < end; ++i)
+		{
+			output[i] = x[i] * output_sigmoid[i];
+		}
+	});
 }
 
 // https://github.com/digantamisra98/Mish
@@ -164,38 +151,26 @@ void activate_array_mish(float *x, const int n, float * activation_input, float
 {
 	TAT(TATPARMS);
 
-	const float MISH_THRESHOLD = 20;
-	int i;
-	#pragma omp parallel for
-	for (i = 0; i < n; ++i) {
-		float x_val = x[i];
-		activation_input[i] = x_val;    // store value before activation
-		output[i] = x_val * tanh_activate( softplus_activate(x_val, MISH_THRESHOLD) );
+	// store value before activation
+	std::memmove(activation_input, x, n * sizeof(float));
+	if (output != x)
+	{
+		std::memmove(output, x, n * sizeof(float));
 	}
-}
-
-static float hard_mish_yashas(float x)
-{
-	TAT(TATPARMS);
-
-	if (x > 0)
-		return x;
-	if (x > -2)
-		return x * x / 2 + x;
-	return 0;
+	activate_array_simd(output, n, MISH);
 }
 
 void activate_array_hard_mish(float *x, const int n, float * activation_input, float * output)
 {
 	TAT(TATPARMS);
 
-	int i;
-	#pragma omp parallel for
-	for (i = 0; i < n; ++i) {
-		float x_val = x[i];
-		activation_input[i] = x_val;    // store value before activation
-		output[i] = hard_mish_yashas(x_val);
+	// store value before activation
+	std::memmove(activation_input, x, n * sizeof(float));
+	if (output != x)
+	{
+		std::memmove(output, x, n * sizeof(float));
 	}
+	activate_array_simd(output, n, HARD_MISH);
 }
 
 void activate_array_normalize_channels(float *x, const int n, int batch, int channels, int wh_step, float *output)
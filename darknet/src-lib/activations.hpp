@@ -20,6 +20,44 @@ void activate_array_normalize_channels(float *x, const int n, int batch, int cha
 void gradient_array_normalize_channels(float *x, const int n, int batch, int channels, int wh_step, float *delta);
 void activate_array_normalize_channels_softmax(float *x, const int n, int batch, int channels, int wh_step, float *output, int use_max_val);
 void gradient_array_normalize_channels_softmax(float *x, const int n, int batch, int channels, int wh_step, float *delta);
+
+namespace Darknet
+{
+	/** The implementations which can be used by @ref activate_array_simd().
+	 * @since 2026-10-17
+	 */
+	enum class EActivationKernel
+	{
+		AUTO	,	///< pick the fastest implementation supported by the CPU
+		GENERIC	,	///< plain C++, one value at a time
+		AVX2	,	///< AVX2 + FMA, 8 values at a time
+		AVX512	,	///< AVX-512F, 16 values at a time
+	};
+
+	/** Largest error of @ref activate_array_simd() compared with the exact value @p y of the activation, as a fraction
+	 * of @p max(1, |y|).  This is checked by the @p "activationbench" command.
+	 * @since 2026-10-17
+	 */
+	constexpr float activation_max_error = 1.0e-6f;
+}
+
+/** Apply the element-wise activation @p a to the @p n values of @p x, using AVX2 or AVX-512 with polynomial
+ * approximations of the exponential and the hyperbolic tangent.  See activations_simd.cpp for details.  Unlike
+ * @ref activate_array_swish() and @ref activate_array_mish(), this does not store what the backward pass needs.
+ * Large arrays are split between the threads of the network with @ref Darknet::parallel_for().
+ *
+ * The @p NORM_CHAN activations are not element-wise and are not supported.
+ *
+ * @since 2026-10-17
+ */
+void activate_array_simd(float *x, const int n, const ACTIVATION a, Darknet::EActivationKernel kernel = Darknet::EActivationKernel::AUTO);
+
+/// Whether the CPU and the build support @p kernel.  @since 2026-10-17
+bool activation_kernel_is_supported(Darknet::EActivationKernel kernel);
+
+/// Short name of an activation kernel, such as @p "avx2".  @since 2026-10-17
+const char * activation_kernel_name(Darknet::EActivationKernel kernel);
+
 #ifdef DARKNET_GPU
 void activate_array_ongpu(float *x, int n, ACTIVATION a);
 void activate_array_swish_ongpu(float *x, int n, float *output_sigmoid_gpu, float *output_gpu);
@@ -0,0 +1,562 @@
+/** @file
+ * Vectorized element-wise activations for CPU inference.
+ *
+ * Every transcendental activation is built from a single exponential, which is evaluated the same way as in Cephes:
+ * @p x is split into @p n ln(2) + @p r where @p n is an integer and |r| <= ln(2)/2, @p e^r is a degree 7 polynomial,
+ * and @p 2^n is written straight into the exponent bits of the result.  From there:
+ *
+ *     logistic(x)	= 1 / (1 + e^-x)
+ *     swish(x)		= x / (1 + e^-x)
+ *     tanh(x)		= 1 - 2 / (e^2x + 1), or an odd polynomial when |x| < 0.625 where the subtraction would cancel
+ *     mish(x)		= x tanh(log(1 + e^x)) = x m / (m + 2), where m = e^x (e^x + 2)
+ *     gelu(x)		= x (1 + tanh(u)) / 2 = x / (1 + e^-2u), where u = 0.797885 x + 0.035677 x^3
+ *
+ * so mish needs neither a logarithm nor a hyperbolic tangent:  one exponential and one division replace the
+ * @p expf(), @p logf(), and @p expf() of the scalar version.  Compared with the exact value @p y computed in double
+ * precision, the error of every activation is at most @ref Darknet::activation_max_error times @p max(1, |y|), which is
+ * a few units in the last place.  The @p "activationbench" command measures both the error and the speed of each
+ * activation.
+ *
+ * The AVX2 and AVX-512 versions are compiled with function-level target attributes like the GEMM microkernels, so both
+ * exist in the same binary and the one to use is selected at runtime.  They use the same sequence of operations, but
+ * since this file is built with @p -Ofast the compiler is free to fuse some of them and to divide with an approximate
+ * reciprocal, so the two can differ in the last bit.
+ */
+
+#include "darknet_internal.hpp"
+#include "gemm.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define DARKNET_ACTIVATION_X86
+#endif
+
+#if defined(__GNUC__)
+#define DARKNET_ACTIVATION_TARGET(features) __attribute__((target(features)))
+#else
+#define DARKNET_ACTIVATION_TARGET(features)
+#endif
+
+
+namespace
+{
+	// Note there is no TAT() in any of these functions:  they are called for every block of the GEMM output.
+
+	// range where e^x is a normal float
+	constexpr float exp_min		= -87.3f;
+	constexpr float exp_max		= 88.3f;
+	constexpr float log2e		= 1.44269504088896341f;
+	constexpr float ln2_hi		= 0.693359375f;		///< the first bits of ln(2), so n * ln2_hi is exact
+	constexpr float ln2_lo		= -2.12194440e-4f;	///< ln(2) - ln2_hi
+
+	// e^r = 1 + r + r^2 (p0 r^5 + p1 r^4 + ... + p5) for |r| <= ln(2)/2
+	constexpr float exp_p0		= 1.9875691500e-4f;
+	constexpr float exp_p1		= 1.3981999507e-3f;
+	constexpr float exp_p2		= 8.3334519073e-3f;
+	constexpr float exp_p3		= 4.1665795894e-2f;
+	constexpr float exp_p4		= 1.6666665459e-1f;
+	constexpr float exp_p5		= 5.0000001201e-1f;
+
+	// tanh(x) = x + x^3 (t0 x^8 + t1 x^6 + ... + t4) for |x| < 0.625
+	constexpr float tanh_small	= 0.625f;
+	constexpr float tanh_t0		= -5.70498872745e-3f;
+	constexpr float tanh_t1		= 2.06390887954e-2f;
+	constexpr float tanh_t2		= -5.37397155531e-2f;
+	constexpr float tanh_t3		= 1.33314422036e-1f;
+	constexpr float tanh_t4		= -3.33332819422e-1f;
+
+	/// Same threshold as @ref activate_array_mish(), above which mish(x) is @p x.
+	constexpr float mish_threshold = 20.0f;
+
+	constexpr float selu_lambda	= 1.0507f;
+	constexpr float selu_alpha	= 1.6732f;
+
+#ifdef DARKNET_ACTIVATION_X86
+
+	DARKNET_ACTIVATION_TARGET("avx2,fma")
+	inline __m256 exp_avx2(__m256 x)
+	{
+		x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(exp_min)), _mm256_set1_ps(exp_max));
+
+		const __m256 n = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		__m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(ln2_hi), x);
+		r = _mm256_fnmadd_ps(n, _mm256_set1_ps(ln2_lo), r);
+
+		__m256 p = _mm256_set1_ps(exp_p0);
+		p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(exp_p1));
+		p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(exp_p2));
+		p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(exp_p3));
+		p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(exp_p4));
+		p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(exp_p5));
+		p = _mm256_fmadd_ps(p, _mm256_mul_ps(r, r), _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+
+		const __m256i scale = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+
+		return _mm256_mul_ps(p, _mm256_castsi256_ps(scale));
+	}
+
+	DARKNET_ACTIVATION_TARGET("avx2,fma")
+	inline __m256 tanh_avx2(const __m256 x)
+	{
+		const __m256 one = _mm256_set1_ps(1.0f);
+
+		const __m256 z = _mm256_mul_ps(x, x);
+		__m256 p = _mm256_set1_ps(tanh_t0);
+		p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(tanh_t1));
+		p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(tanh_t2));
+		p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(tanh_t3));
+		p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(tanh_t4));
+		const __m256 small = _mm256_fmadd_ps(_mm256_mul_ps(p, z), x, x);
+
+		const __m256 e = exp_avx2(_mm256_add_ps(x, x));
+		const __m256 large = _mm256_sub_ps(one, _mm256_div_ps(_mm256_set1_ps(2.0f), _mm256_add_ps(e, one)));
+
+		const __m256 abs_x = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x);
+
+		return _mm256_blendv_ps(large, small, _mm256_cmp_ps(abs_x, _mm256_set1_ps(tanh_small), _CMP_LT_OQ));
+	}
+
+	DARKNET_ACTIVATION_TARGET("avx512f")
+	inline __m512 exp_avx512(__m512 x)
+	{
+		x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(exp_min)), _mm512_set1_ps(exp_max));
+
+		const __m512 n = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		__m512 r = _mm512_fnmadd_ps(n, _mm512_set1_ps(ln2_hi), x);
+		r = _mm512_fnmadd_ps(n, _mm512_set1_ps(ln2_lo), r);
+
+		__m512 p = _mm512_set1_ps(exp_p0);
+		p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(exp_p1));
+		p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(exp_p2));
+		p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(exp_p3));
+		p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(exp_p4));
+		p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(exp_p5));
+		p = _mm512_fmadd_ps(p, _mm512_mul_ps(r, r), _mm512_add_ps(r, _mm512_set1_ps(1.0f)));
+
+		const __m512i scale = _mm512_slli_epi32(_mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127)), 23);
+
+		return _mm512_mul_ps(p, _mm512_castsi512_ps(scale));
+	}
+
+	DARKNET_ACTIVATION_TARGET("avx512f")
+	inline __m512 tanh_avx512(const __m512 x)
+	{
+		const __m512 one = _mm512_set1_ps(1.0f);
+
+		const __m512 z = _mm512_mul_ps(x, x);
+		__m512 p = _mm512_set1_ps(tanh_t0);
+		p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(tanh_t1));
+		p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(tanh_t2));
+		p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(tanh_t3));
+		p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(tanh_t4));
+		const __m512 small = _mm512_fmadd_ps(_mm512_mul_ps(p, z), x, x);
+
+		const __m512 e = exp_avx512(_mm512_add_ps(x, x));
+		const __m512 large = _mm512_sub_ps(one, _mm512_div_ps(_mm512_set1_ps(2.0f), _mm512_add_ps(e, one)));
+
+		const __m512 abs_x = _mm512_abs_ps(x);
+
+		return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(abs_x, _mm512_set1_ps(tanh_small), _CMP_LT_OQ), large, small);
+	}
+
+#endif
+
+	/* Each activation has a generic version which is what activations.hpp does for a single value, and (when it is
+	 * worth vectorizing) an AVX2 and an AVX-512 version.
+	 */
+
+	struct Leaky
+	{
+		static float generic(const float x) { return leaky_activate(x); }
+#ifdef DARKNET_ACTIVATION_X86
+		DARKNET_ACTIVATION_TARGET("avx2,fma")	static __m256 avx2(const __m256 x)		{ return _mm256_max_ps(x, _mm256_mul_ps(x, _mm256_set1_ps(0.1f))); }
+		DARKNET_ACTIVATION_TARGET("avx512f")	static __m512 avx512(const __m512 x)	{ return _mm512_max_ps(x, _mm512_mul_ps(x, _mm512_set1_ps(0.1f))); }
+#endif
+	};
+
+	struct Relie
+	{
+		static float generic(const float x) { return relie_activate(x); }
+#ifdef DARKNET_ACTIVATION_X86
+		DARKNET_ACTIVATION_TARGET("avx2,fma")	static __m256 avx2(const __m256 x)		{ return _mm256_max_ps(x, _mm256_mul_ps(x, _mm256_set1_ps(0.01f))); }
+		DARKNET_ACTIVATION_TARGET("avx512f")	static __m512 avx512(const __m512 x)	{ return _mm512_max_ps(x, _mm512_mul_ps(x, _mm512_set1_ps(0.01f))); }
+#endif
+	};
+
+	struct Relu
+	{
+		static float generic(const float x) { return relu_activate(x); }
+#ifdef DARKNET_ACTIVATION_X86
+		DARKNET_ACTIVATION_TARGET("avx2,fma")	static __m256 avx2(const __m256 x)		{ return _mm256_max_ps(x, _mm256_setzero_ps()); }
+		DARKNET_ACTIVATION_TARGET("avx512f")	static __m512 avx512(const __m512 x)	{ return _mm512_max_ps(x, _mm512_setzero_ps()); }
+#endif
+	};
+
+	struct Relu6
+	{
+		static float generic(const float x) { return relu6_activate(x); }
+#ifdef DARKNET_ACTIVATION_X86
+		DARKNET_ACTIVATION_TARGET("avx2,fma")	static __m256 avx2(const __m256 x)		{ return _mm256_min_ps(_mm256_max_ps(x, _mm256_setzero_ps()), _mm256_set1_ps(6.0f)); }
+		DARKNET_ACTIVATION_TARGET("avx512f")	static __m512 avx512(const __m512 x)	{ return _mm512_min_ps(_mm512_max_ps(x, _mm512_setzero_ps()), _mm512_set1_ps(6.0f)); }
+#endif
+	};
+
+	struct Ramp
+	{
+		static float generic(const float x) { return ramp_activate(x); }
+#ifdef DARKNET_ACTIVATION_X86
+		DARKNET_ACTIVATION_TARGET("avx2,fma")	static __m256 avx2(const __m256 x)		{ return _mm256_fmadd_ps(x, _mm256_set1_ps(0.1f), _mm256_max_ps(x, _mm256_setzero_ps())); }
+		DARKNET_ACTIVATION_TARGET("avx512f")	static __m512 avx512(const __m512 x)	{ return _mm512_fmadd_ps(x, _mm512_set1_ps(0.1f), _mm512_max_ps(x, _mm512_setzero_ps())); }
+#endif
+	};
+
+	struct Hardtan
+	{
+		static float generic(const float x) { return hardtan_activate(x); }
+#ifdef DARKNET_ACTIVATION_X86
+		DARKNET_ACTIVATION_TARGET("avx2,fma")	static __m256 avx2(const __m256 x)		{ return _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-1.0f)), _mm256_set1_ps(1.0f)); }
+		DARKNET_ACTIVATION_TARGET("avx512f")	static __m512 avx512(const __m512 x)	{ return _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(-1.0f)), _mm512_set1_ps(1.0f)); }
+#endif
+	};
+
+	struct Logistic
+	{
+		static float generic(const float x) { return logistic_activate(x); }
+#ifdef DARKNET_ACTIVATION_X86
+		DARKNET_ACTIVATION_TARGET("avx2,fma")
+		static __m256 avx2(const __m256 x)
+		{
+			const __m256 one = _mm256_set1_ps(1.0f);
+			return _mm256_div_ps(one, _mm256_add_ps(one, exp_avx2(_mm256_sub_ps(_mm256_setzero_ps(), x))));
+		}
+		DARKNET_ACTIVATION_TARGET("avx512f")
+		static __m512 avx512(const __m512 x)
+		{
+			const __m512 one = _mm512_set1_ps(1.0f);
+			return _mm512_div_ps(one, _mm512_add_ps(one, exp_avx512(_mm512_sub_ps(_mm512_setzero_ps(), x))));
+		}
+#endif
+	};
+
+	struct Loggy
+	{
+		static float generic(const float x) { return loggy_activate(x); }
+#ifdef DARKNET_ACTIVATION_X86
+		DARKNET_ACTIVATION_TARGET("avx2,fma")
+		static __m256 avx2(const __m256 x)
+		{
+			const __m256 one = _mm256_set1_ps(1.0f);
+			return _mm256_sub_ps(_mm256_div_ps(_mm256_set1_ps(2.0f), _mm256_add_ps(one, exp_avx2(_mm256_sub_ps(_mm256_setzero_ps(), x)))), one);
+		}
+		DARKNET_ACTIVATION_TARGET("avx512f")
+		static __m512 avx512(const __m512 x)
+		{
+			const __m512 one = _mm512_set1_ps(1.0f);
+			return _mm512_sub_ps(_mm512_div_ps(_mm512_set1_ps(2.0f), _mm512_add_ps(one, exp_avx512(_mm512_sub_ps(_mm512_setzero_ps(), x)))), one);
+		}
+#endif
+	};
+
+	struct Swish
+	{
+		static float generic(const float x) { return x * logistic_activate(x); }
+#ifdef DARKNET_ACTIVATION_X86
+		DARKNET_ACTIVATION_TARGET("avx2,fma")
+		static __m256 avx2(const __m256 x)
+		{
+			return _mm256_div_ps(x, _mm256_add_ps(_mm256_set1_ps(1.0f), exp_avx2(_mm256_sub_ps(_mm256_setzero_ps(), x))));
+		}
+		DARKNET_ACTIVATION_TARGET("avx512f")
+		static __m512 avx512(const __m512 x)
+		{
+			return _mm512_div_ps(x, _mm512_add_ps(_mm512_set1_ps(1.0f), exp_avx512(_mm512_sub_ps(_mm512_setzero_ps(), x))));
+		}
+#endif
+	};
+
+	struct Tanh
+	{
+		static float generic(const float x) { return tanh_activate(x); }
+#ifdef DARKNET_ACTIVATION_X86
+		DARKNET_ACTIVATION_TARGET("avx2,fma")	static __m256 avx2(const __m256 x)		{ return tanh_avx2(x); }
+		DARKNET_ACTIVATION_TARGET("avx512f")	static __m512 avx512(const __m512 x)	{ return tanh_avx512(x); }
+#endif
+	};
+
+	struct Mish
+	{
+		static float generic(const float x)
+		{
+			// same as the vectorized versions, since x tanh(softplus(x)) loses most of its precision when x is negative
+			const float e = std::exp(std::min(x, mish_threshold));
+			const float m = e * (e + 2.0f);
+			return x * m / (m + 2.0f);
+		}
+#ifdef DARKNET_ACTIVATION_X86
+		DARKNET_ACTIVATION_TARGET("avx2,fma")
+		static __m256 avx2(const __m256 x)
+		{
+			// above the threshold m / (m + 2) rounds to 1, so clamping also keeps m from overflowing
+			const __m256 e = exp_avx2(_mm256_min_ps(x, _mm256_set1_ps(mish_threshold)));
+			const __m256 m = _mm256_mul_ps(e, _mm256_add_ps(e, _mm256_set1_ps(2.0f)));
+			return _mm256_div_ps(_mm256_mul_ps(x, m), _mm256_add_ps(m, _mm256_set1_ps(2.0f)));
+		}
+		DARKNET_ACTIVATION_TARGET("avx512f")
+		static __m512 avx512(const __m512 x)
+		{
+			const __m512 e = exp_avx512(_mm512_min_ps(x, _mm512_set1_ps(mish_threshold)));
+			const __m512 m = _mm512_mul_ps(e, _mm512_add_ps(e, _mm512_set1_ps(2.0f)));
+			return _mm512_div_ps(_mm512_mul_ps(x, m), _mm512_add_ps(m, _mm512_set1_ps(2.0f)));
+		}
+#endif
+	};
+
+	struct HardMish
+	{
+		static float generic(const float x) { return x > 0.0f ? x : x > -2.0f ? x * x / 2.0f + x : 0.0f; }
+#ifdef DARKNET_ACTIVATION_X86
+		DARKNET_ACTIVATION_TARGET("avx2,fma")
+		static __m256 avx2(const __m256 x)
+		{
+			// x (x/2 + 1) is x^2/2 + x, which is also x when x is 0
+			const __m256 curve = _mm256_mul_ps(x, _mm256_fmadd_ps(x, _mm256_set1_ps(0.5f), _mm256_set1_ps(1.0f)));
+			const __m256 result = _mm256_blendv_ps(curve, x, _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GT_OQ));
+			return _mm256_and_ps(result, _mm256_cmp_ps(x, _mm256_set1_ps(-2.0f), _CMP_GT_OQ));
+		}
+		DARKNET_ACTIVATION_TARGET("avx512f")
+		static __m512 avx512(const __m512 x)
+		{
+			const __m512 curve = _mm512_mul_ps(x, _mm512_fmadd_ps(x, _mm512_set1_ps(0.5f), _mm512_set1_ps(1.0f)));
+			const __m512 result = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_GT_OQ), curve, x);
+			return _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(x, _mm512_set1_ps(-2.0f), _CMP_GT_OQ), result);
+		}
+#endif
+	};
+
+	struct Elu
+	{
+		static float generic(const float x) { return elu_activate(x); }
+#ifdef DARKNET_ACTIVATION_X86
+		DARKNET_ACTIVATION_TARGET("avx2,fma")
+		static __m256 avx2(const __m256 x)
+		{
+			const __m256 negative = _mm256_sub_ps(exp_avx2(x), _mm256_set1_ps(1.0f));
+			return _mm256_blendv_ps(negative, x, _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+		DARKNET_ACTIVATION_TARGET("avx512f")
+		static __m512 avx512(const __m512 x)
+		{
+			const __m512 negative = _mm512_sub_ps(exp_avx512(x), _mm512_set1_ps(1.0f));
+			return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_GE_OQ), negative, x);
+		}
+#endif
+	};
+
+	struct Selu
+	{
+		static float generic(const float x) { return selu_activate(x); }
+#ifdef DARKNET_ACTIVATION_X86
+		DARKNET_ACTIVATION_TARGET("avx2,fma")
+		static __m256 avx2(const __m256 x)
+		{
+			const __m256 negative = _mm256_mul_ps(_mm256_set1_ps(selu_lambda * selu_alpha), _mm256_sub_ps(exp_avx2(x), _mm256_set1_ps(1.0f)));
+			const __m256 positive = _mm256_mul_ps(_mm256_set1_ps(selu_lambda), x);
+			return _mm256_blendv_ps(negative, positive, _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+		DARKNET_ACTIVATION_TARGET("avx512f")
+		static __m512 avx512(const __m512 x)
+		{
+			const __m512 negative = _mm512_mul_ps(_mm512_set1_ps(selu_lambda * selu_alpha), _mm512_sub_ps(exp_avx512(x), _mm512_set1_ps(1.0f)));
+			const __m512 positive = _mm512_mul_ps(_mm512_set1_ps(selu_lambda), x);
+			return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_GE_OQ), negative, positive);
+		}
+#endif
+	};
+
+	struct Gelu
+	{
+		static float generic(const float x) { return gelu_activate(x); }
+#ifdef DARKNET_ACTIVATION_X86
+		// x (1 + tanh(u)) / 2 is x / (1 + e^-2u), which does not cancel when tanh(u) is close to -1
+		DARKNET_ACTIVATION_TARGET("avx2,fma")
+		static __m256 avx2(const __m256 x)
+		{
+			const __m256 minus_2u = _mm256_mul_ps(x, _mm256_fmadd_ps(_mm256_mul_ps(x, x), _mm256_set1_ps(-2.0f * 0.035677f), _mm256_set1_ps(-2.0f * 0.797885f)));
+			return _mm256_div_ps(x, _mm256_add_ps(_mm256_set1_ps(1.0f), exp_avx2(minus_2u)));
+		}
+		DARKNET_ACTIVATION_TARGET("avx512f")
+		static __m512 avx512(const __m512 x)
+		{
+			const __m512 minus_2u = _mm512_mul_ps(x, _mm512_fmadd_ps(_mm512_mul_ps(x, x), _mm512_set1_ps(-2.0f * 0.035677f), _mm512_set1_ps(-2.0f * 0.797885f)));
+			return _mm512_div_ps(x, _mm512_add_ps(_mm512_set1_ps(1.0f), exp_avx512(minus_2u)));
+		}
+#endif
+	};
+
+	template <typename Activation>
+	void apply_generic(float * x, const int n)
+	{
+		for (int i = 0; i < n; i ++)
+		{
+			x[i] = Activation::generic(x[i]);
+		}
+	}
+
+#ifdef DARKNET_ACTIVATION_X86
+	template <typename Activation>
+	DARKNET_ACTIVATION_TARGET("avx2,fma")
+	void apply_avx2(float * x, const int n)
+	{
+		int i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			_mm256_storeu_ps(x + i, Activation::avx2(_mm256_loadu_ps(x + i)));
+		}
+
+		if (i < n)
+		{
+			// the last few values go through the same code so they are rounded the same way
+			float tail[8] = {};
+			std::memcpy(tail, x + i, (n - i) * sizeof(float));
+			_mm256_storeu_ps(tail, Activation::avx2(_mm256_loadu_ps(tail)));
+			std::memcpy(x + i, tail, (n - i) * sizeof(float));
+		}
+	}
+
+	template <typename Activation>
+	DARKNET_ACTIVATION_TARGET("avx512f")
+	void apply_avx512(float * x, const int n)
+	{
+		int i = 0;
+		for (; i + 16 <= n; i += 16)
+		{
+			_mm512_storeu_ps(x + i, Activation::avx512(_mm512_loadu_ps(x + i)));
+		}
+
+		if (i < n)
+		{
+			const __mmask16 mask = static_cast<__mmask16>((1u << (n - i)) - 1u);
+			_mm512_mask_storeu_ps(x + i, mask, Activation::avx512(_mm512_maskz_loadu_ps(mask, x + i)));
+		}
+	}
+#endif
+
+	template <typename Activation>
+	void apply(const Darknet::EActivationKernel kernel, float * x, const int n)
+	{
+		switch (kernel)
+		{
+#ifdef DARKNET_ACTIVATION_X86
+			case Darknet::EActivationKernel::AVX2:		apply_avx2<Activation>(x, n);	break;
+			case Darknet::EActivationKernel::AVX512:	apply_avx512<Activation>(x, n);	break;
+#endif
+			default:									apply_generic<Activation>(x, n);	break;
+		}
+	}
+
+	void activate_block(const Darknet::EActivationKernel kernel, float * x, const int n, const ACTIVATION a)
+	{
+		switch (a)
+		{
+			case LINEAR:	break;
+			case REVLEAKY:
+			case LEAKY:		apply<Leaky>	(kernel, x, n);	break;
+			case RELIE:		apply<Relie>	(kernel, x, n);	break;
+			case RELU:		apply<Relu>		(kernel, x, n);	break;
+			case RELU6:		apply<Relu6>	(kernel, x, n);	break;
+			case RAMP:		apply<Ramp>		(kernel, x, n);	break;
+			case HARDTAN:	apply<Hardtan>	(kernel, x, n);	break;
+			case LOGISTIC:	apply<Logistic>	(kernel, x, n);	break;
+			case LOGGY:		apply<Loggy>	(kernel, x, n);	break;
+			case SWISH:		apply<Swish>	(kernel, x, n);	break;
+			case TANH:		apply<Tanh>		(kernel, x, n);	break;
+			case MISH:		apply<Mish>		(kernel, x, n);	break;
+			case HARD_MISH:	apply<HardMish>	(kernel, x, n);	break;
+			case ELU:		apply<Elu>		(kernel, x, n);	break;
+			case SELU:		apply<Selu>		(kernel, x, n);	break;
+			case GELU:		apply<Gelu>		(kernel, x, n);	break;
+			default:
+			{
+				// rarely used, and not worth vectorizing
+				for (int i = 0; i < n; i ++)
+				{
+					x[i] = activate(x[i], a);
+				}
+				break;
+			}
+		}
+	}
+
+	Darknet::EActivationKernel best_kernel()
+	{
+		static const Darknet::EActivationKernel kernel =
+			activation_kernel_is_supported(Darknet::EActivationKernel::AVX512)	? Darknet::EActivationKernel::AVX512	:
+			activation_kernel_is_supported(Darknet::EActivationKernel::AVX2)	? Darknet::EActivationKernel::AVX2		:
+			Darknet::EActivationKernel::GENERIC;
+
+		return kernel;
+	}
+}
+
+
+bool activation_kernel_is_supported(const Darknet::EActivationKernel kernel)
+{
+	TAT(TATPARMS);
+
+	switch (kernel)
+	{
+		case Darknet::EActivationKernel::AUTO:		return true;
+		case Darknet::EActivationKernel::GENERIC:	return true;
+#ifdef DARKNET_ACTIVATION_X86
+		case Darknet::EActivationKernel::AVX2:		return is_fma_avx2() == 1;
+		case Darknet::EActivationKernel::AVX512:	return is_avx512() == 1;
+#endif
+		default:									return false;
+	}
+}
+
+
+const char * activation_kernel_name(const Darknet::EActivationKernel kernel)
+{
+	TAT(TATPARMS);
+
+	switch (kernel)
+	{
+		case Darknet::EActivationKernel::AUTO:		return "auto";
+		case Darknet::EActivationKernel::GENERIC:	return "generic";
+		case Darknet::EActivationKernel::AVX2:		return "avx2";
+		case Darknet::EActivationKernel::AVX512:	return "avx512";
+	}
+
+	return "unknown";
+}
+
+
+void activate_array_simd(float *x, const int n, const ACTIVATION a, Darknet::EActivationKernel kernel)
+{
+	// no TAT() since this is called for every block of the GEMM output
+
+	if (a == LINEAR or n <= 0)
+	{
+		return;
+	}
+
+	if (kernel == Darknet::EActivationKernel::AUTO or not activation_kernel_is_supported(kernel))
+	{
+		kernel = best_kernel();
+	}
+
+	// only large arrays are worth splitting between threads, and the GEMM epilogue is already running in a thread
+	const int chunk = 16384;
+	if (n < 4 * chunk)
+	{
+		activate_block(kernel, x, n, a);
+		return;
+	}
+
+	Darknet::parallel_for((n + chunk - 1) / chunk, [&](const int block)
+	{
+		const int i = block * chunk;
+		activate_block(kernel, x + i, std::min(chunk, n - i), a);
+	});
+}
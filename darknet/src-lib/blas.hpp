@@ -52,6 +52,44 @@ void softmax_x_ent_cpu(int n, float *pred, float *truth, float *delta, float *er
 void constrain_cpu(int size, float ALPHA, float *X);
 void fix_nan_and_inf_cpu(float *input, size_t size);
 
+namespace Darknet
+{
+	/** The implementations which can be used by @ref maxpool_cpu(), @ref upsample_forward_cpu(), and
+	 * @ref shortcut_forward_cpu().
+	 * @since 2026-10-17
+	 */
+	enum class EBlasKernel
+	{
+		AUTO	,	///< pick the fastest implementation supported by the CPU
+		GENERIC	,	///< plain C++
+		AVX2	,	///< AVX2, 8 values at a time
+		AVX512	,	///< AVX-512F, 16 values at a time
+	};
+}
+
+/// Whether the CPU and the build support @p kernel.  @since 2026-10-17
+bool blas_kernel_is_supported(Darknet::EBlasKernel kernel);
+
+/// Short name of a kernel, such as @p "avx2".  @since 2026-10-17
+const char * blas_kernel_name(Darknet::EBlasKernel kernel);
+
+/** Max pooling for CPU inference, with any window size and stride.  This gives the same output as the training code in
+ * @ref forward_maxpool_layer(), but does not store the indexes needed by the backward pass.  See blas_simd.cpp.
+ * @since 2026-10-17
+ */
+void maxpool_cpu(const float *src, int batch, int c, int h, int w, int size, int stride_x, int stride_y, int pad, int out_h, int out_w, float *dst, Darknet::EBlasKernel kernel = Darknet::EBlasKernel::AUTO);
+
+/** Same as the forward direction of @ref upsample_cpu(), but every value of @p out is written so it does not need to be
+ * cleared first.  A stride of 2 is vectorized.
+ * @since 2026-10-17
+ */
+void upsample_forward_cpu(const float *in, int w, int h, int c, int batch, int stride, float scale, float *out, Darknet::EBlasKernel kernel = Darknet::EBlasKernel::AUTO);
+
+/** Same as @ref shortcut_multilayer_cpu() with @p size set to @p outputs * @p batch, but vectorized.
+ * @since 2026-10-17
+ */
+void shortcut_forward_cpu(int outputs, int batch, int n, const int *outputs_of_layers, float * const *layers_output, const float *in, const float *weights, int nweights, WEIGHTS_NORMALIZATION_T weights_normalization, float *out, Darknet::EBlasKernel kernel = Darknet::EBlasKernel::AUTO);
+
 
 int check_sim(size_t i, size_t j, contrastive_params *contrast_p, int contrast_p_size);
 float find_sim(size_t i, size_t j, contrastive_params *contrast_p, int contrast_p_size);
@@ -0,0 +1,706 @@
+/** @file
+ * Vectorized max pooling, nearest-neighbour upsampling, and residual additions for CPU inference.
+ *
+ * These layers do almost no arithmetic, so their speed depends on how the memory is read and written.
+ *
+ * Max pooling is separable:  the maximum of a @p size x @p size window is the maximum over @p size columns of the
+ * maximum over @p size rows.  For each output row, the maximum of the input rows in its window is written into a
+ * buffer with the padding filled in with @p -FLT_MAX, so the horizontal pass never checks the bounds and reads whole
+ * vectors.  With a stride of 2 the even columns are separated from the odd ones with a shuffle.  A 13 x 13 window (as
+ * in the SPP blocks) is then 26 comparisons per output instead of 169.  Since the maximum is exact, the output is the
+ * same as the training code in @ref forward_maxpool_layer() bit for bit.  The 2 x 2 window with a stride of 2 used by
+ * all of the tiny networks is special:  it reads both input rows straight into registers.  (The previous @ref forward_maxpool_layer_avx() was
+ * not:  with a stride of 1 it skipped entire vectors when the first of them was in the padding, so some outputs near
+ * the left edge of small images such as the 5 x 5 SPP window on a 13 x 13 grid missed part of their window.)
+ *
+ * The 2x upsampling duplicates each value with a shuffle and writes the same vector to both output rows, without the
+ * divisions of @ref upsample_cpu() and without first clearing the output.
+ *
+ * The residual addition of the shortcut layers adds whole vectors, and for shortcut layers with weights, the weights
+ * are normalized once per call instead of once per value.  The additions are done in the same order as in
+ * @ref shortcut_multilayer_cpu().
+ *
+ * The @p "layerbench" command compares these with the previous implementations.
+ */
+
+#include "darknet_internal.hpp"
+#include "gemm.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define DARKNET_BLAS_X86
+#endif
+
+#if defined(__GNUC__)
+#define DARKNET_BLAS_TARGET(features) __attribute__((target(features)))
+#else
+#define DARKNET_BLAS_TARGET(features)
+#endif
+
+
+namespace
+{
+	// Note there is no TAT() in any of these functions:  they are called for every row of every channel.
+
+	/// Extra room at the end of the row buffers, so the vectorized horizontal pass never needs a tail.
+	constexpr int row_padding = 32;
+
+	inline int round_up(const int n, const int multiple)
+	{
+		return (n + multiple - 1) / multiple * multiple;
+	}
+
+	// ---- max pooling, horizontal pass:  row[x] = max(padded[x * stride + 0 ... x * stride + size - 1]) ----
+
+	void maxpool_row_generic(const float * padded, const int size, const int stride, const int out_w, float * row)
+	{
+		if (size == 2 and stride == 2)
+		{
+			// by far the most common, and simple enough for the compiler to vectorize
+			for (int x = 0; x < out_w; x ++)
+			{
+				row[x] = std::max(padded[2 * x], padded[2 * x + 1]);
+			}
+			return;
+		}
+
+		for (int x = 0; x < out_w; x ++)
+		{
+			const float * p = padded + x * stride;
+			float max = p[0];
+			for (int m = 1; m < size; m ++)
+			{
+				max = std::max(max, p[m]);
+			}
+			row[x] = max;
+		}
+	}
+
+	void maxpool_column_generic(const float * rows, const int count, const int row_stride, const int out_w, float * out)
+	{
+		for (int x = 0; x < out_w; x ++)
+		{
+			float max = rows[x];
+			for (int r = 1; r < count; r ++)
+			{
+				max = std::max(max, rows[static_cast<size_t>(r) * row_stride + x]);
+			}
+			out[x] = max;
+		}
+	}
+
+	/// 2 x 2 window with a stride of 2 which never crosses the right edge:  both rows are read once, with no buffer.
+	void maxpool_2x2_generic(const float * row0, const float * row1, const int out_w, float * out)
+	{
+		for (int x = 0; x < out_w; x ++)
+		{
+			out[x] = std::max(std::max(row0[2 * x], row0[2 * x + 1]), std::max(row1[2 * x], row1[2 * x + 1]));
+		}
+	}
+
+#ifdef DARKNET_BLAS_X86
+
+	DARKNET_BLAS_TARGET("avx2,fma")
+	inline __m256 even_avx2(const float * p)
+	{
+		// p[0], p[2], ... p[14]
+		const __m256 v = _mm256_shuffle_ps(_mm256_loadu_ps(p), _mm256_loadu_ps(p + 8), _MM_SHUFFLE(2, 0, 2, 0));
+		return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(v), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+
+	/// The output row is rounded up to a multiple of 8, which is why the buffers have @ref row_padding.
+	DARKNET_BLAS_TARGET("avx2,fma")
+	void maxpool_row_avx2(const float * padded, const int size, const int stride, const int out_w, float * row)
+	{
+		if (stride == 1)
+		{
+			for (int x = 0; x < out_w; x += 8)
+			{
+				__m256 max = _mm256_loadu_ps(padded + x);
+				for (int m = 1; m < size; m ++)
+				{
+					max = _mm256_max_ps(max, _mm256_loadu_ps(padded + x + m));
+				}
+				_mm256_storeu_ps(row + x, max);
+			}
+		}
+		else if (stride == 2)
+		{
+			for (int x = 0; x < out_w; x += 8)
+			{
+				__m256 max = even_avx2(padded + 2 * x);
+				for (int m = 1; m < size; m ++)
+				{
+					max = _mm256_max_ps(max, even_avx2(padded + 2 * x + m));
+				}
+				_mm256_storeu_ps(row + x, max);
+			}
+		}
+		else
+		{
+			maxpool_row_generic(padded, size, stride, out_w, row);
+		}
+	}
+
+	DARKNET_BLAS_TARGET("avx2,fma")
+	void maxpool_column_avx2(const float * rows, const int count, const int row_stride, const int out_w, float * out)
+	{
+		int x = 0;
+		for (; x + 8 <= out_w; x += 8)
+		{
+			__m256 max = _mm256_loadu_ps(rows + x);
+			for (int r = 1; r < count; r ++)
+			{
+				max = _mm256_max_ps(max, _mm256_loadu_ps(rows + static_cast<size_t>(r) * row_stride + x));
+			}
+			_mm256_storeu_ps(out + x, max);
+		}
+		maxpool_column_generic(rows + x, count, row_stride, out_w - x, out + x);
+	}
+
+	DARKNET_BLAS_TARGET("avx2,fma")
+	void maxpool_2x2_avx2(const float * row0, const float * row1, const int out_w, float * out)
+	{
+		int x = 0;
+		for (; x + 8 <= out_w; x += 8)
+		{
+			const __m256 a = _mm256_max_ps(_mm256_loadu_ps(row0 + 2 * x	), _mm256_loadu_ps(row1 + 2 * x		));
+			const __m256 b = _mm256_max_ps(_mm256_loadu_ps(row0 + 2 * x + 8), _mm256_loadu_ps(row1 + 2 * x + 8	));
+			const __m256 even	= _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+			const __m256 odd	= _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+			const __m256 max	= _mm256_max_ps(even, odd);
+			_mm256_storeu_ps(out + x, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(max), _MM_SHUFFLE(3, 1, 2, 0))));
+		}
+		maxpool_2x2_generic(row0 + 2 * x, row1 + 2 * x, out_w - x, out + x);
+	}
+
+	DARKNET_BLAS_TARGET("avx512f")
+	inline __m512 even_avx512(const float * p)
+	{
+		const __m512i even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+		return _mm512_permutex2var_ps(_mm512_loadu_ps(p), even, _mm512_loadu_ps(p + 16));
+	}
+
+	/// The output row is rounded up to a multiple of 16, which is why the buffers have @ref row_padding.
+	DARKNET_BLAS_TARGET("avx512f")
+	void maxpool_row_avx512(const float * padded, const int size, const int stride, const int out_w, float * row)
+	{
+		if (stride == 1)
+		{
+			for (int x = 0; x < out_w; x += 16)
+			{
+				__m512 max = _mm512_loadu_ps(padded + x);
+				for (int m = 1; m < size; m ++)
+				{
+					max = _mm512_max_ps(max, _mm512_loadu_ps(padded + x + m));
+				}
+				_mm512_storeu_ps(row + x, max);
+			}
+		}
+		else if (stride == 2)
+		{
+			for (int x = 0; x < out_w; x += 16)
+			{
+				__m512 max = even_avx512(padded + 2 * x);
+				for (int m = 1; m < size; m ++)
+				{
+					max = _mm512_max_ps(max, even_avx512(padded + 2 * x + m));
+				}
+				_mm512_storeu_ps(row + x, max);
+			}
+		}
+		else
+		{
+			maxpool_row_generic(padded, size, stride, out_w, row);
+		}
+	}
+
+	DARKNET_BLAS_TARGET("avx512f")
+	void maxpool_column_avx512(const float * rows, const int count, const int row_stride, const int out_w, float * out)
+	{
+		for (int x = 0; x < out_w; x += 16)
+		{
+			const __mmask16 mask = (out_w - x >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (out_w - x)) - 1u));
+			__m512 max = _mm512_maskz_loadu_ps(mask, rows + x);
+			for (int r = 1; r < count; r ++)
+			{
+				max = _mm512_max_ps(max, _mm512_maskz_loadu_ps(mask, rows + static_cast<size_t>(r) * row_stride + x));
+			}
+			_mm512_mask_storeu_ps(out + x, mask, max);
+		}
+	}
+
+	DARKNET_BLAS_TARGET("avx512f")
+	void maxpool_2x2_avx512(const float * row0, const float * row1, const int out_w, float * out)
+	{
+		const __m512i even	= _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+		const __m512i odd	= _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+
+		for (int x = 0; x < out_w; x += 16)
+		{
+			const int n = std::min(16, out_w - x);
+			const __mmask16 mask	= (n == 16 ? 0xFFFF : static_cast<__mmask16>((1u << n) - 1u));
+			const __mmask16 mask_a	= (n >= 8 ? 0xFFFF : static_cast<__mmask16>((1u << (2 * n)) - 1u));
+			const __mmask16 mask_b	= (n <= 8 ? 0 : static_cast<__mmask16>((1u << (2 * (n - 8))) - 1u));
+
+			const __m512 a = _mm512_max_ps(_mm512_maskz_loadu_ps(mask_a, row0 + 2 * x		), _mm512_maskz_loadu_ps(mask_a, row1 + 2 * x		));
+			const __m512 b = _mm512_max_ps(_mm512_maskz_loadu_ps(mask_b, row0 + 2 * x + 16	), _mm512_maskz_loadu_ps(mask_b, row1 + 2 * x + 16	));
+			const __m512 max = _mm512_max_ps(_mm512_permutex2var_ps(a, even, b), _mm512_permutex2var_ps(a, odd, b));
+			_mm512_mask_storeu_ps(out + x, mask, max);
+		}
+	}
+
+#endif
+
+	void maxpool_2x2(const Darknet::EBlasKernel kernel, const float * row0, const float * row1, const int out_w, float * out)
+	{
+		switch (kernel)
+		{
+#ifdef DARKNET_BLAS_X86
+			case Darknet::EBlasKernel::AVX2:	maxpool_2x2_avx2	(row0, row1, out_w, out);	break;
+			case Darknet::EBlasKernel::AVX512:	maxpool_2x2_avx512	(row0, row1, out_w, out);	break;
+#endif
+			default:							maxpool_2x2_generic	(row0, row1, out_w, out);	break;
+		}
+	}
+
+	void maxpool_row(const Darknet::EBlasKernel kernel, const float * padded, const int size, const int stride, const int out_w, float * row)
+	{
+		switch (kernel)
+		{
+#ifdef DARKNET_BLAS_X86
+			case Darknet::EBlasKernel::AVX2:	maxpool_row_avx2	(padded, size, stride, out_w, row);	break;
+			case Darknet::EBlasKernel::AVX512:	maxpool_row_avx512	(padded, size, stride, out_w, row);	break;
+#endif
+			default:							maxpool_row_generic	(padded, size, stride, out_w, row);	break;
+		}
+	}
+
+	void maxpool_column(const Darknet::EBlasKernel kernel, const float * rows, const int count, const int row_stride, const int out_w, float * out)
+	{
+		switch (kernel)
+		{
+#ifdef DARKNET_BLAS_X86
+			case Darknet::EBlasKernel::AVX2:	maxpool_column_avx2		(rows, count, row_stride, out_w, out);	break;
+			case Darknet::EBlasKernel::AVX512:	maxpool_column_avx512	(rows, count, row_stride, out_w, out);	break;
+#endif
+			default:							maxpool_column_generic	(rows, count, row_stride, out_w, out);	break;
+		}
+	}
+
+	// ---- 2x nearest-neighbour upsampling of one row into two output rows ----
+
+	void upsample_row_generic(const float * in, const int w, const int stride, const float scale, float * out)
+	{
+		for (int x = 0; x < w; x ++)
+		{
+			const float v = scale * in[x];
+			for (int k = 0; k < stride; k ++)
+			{
+				out[x * stride + k] = v;
+			}
+		}
+	}
+
+#ifdef DARKNET_BLAS_X86
+
+	DARKNET_BLAS_TARGET("avx2,fma")
+	void upsample2_row_avx2(const float * in, const int w, const float scale, float * out0, float * out1)
+	{
+		const __m256 s = _mm256_set1_ps(scale);
+
+		int x = 0;
+		for (; x + 8 <= w; x += 8)
+		{
+			const __m256 v	= _mm256_mul_ps(s, _mm256_loadu_ps(in + x));
+			const __m256 lo	= _mm256_unpacklo_ps(v, v);	// 0 0 1 1 | 4 4 5 5
+			const __m256 hi	= _mm256_unpackhi_ps(v, v);	// 2 2 3 3 | 6 6 7 7
+			const __m256 a	= _mm256_permute2f128_ps(lo, hi, 0x20);
+			const __m256 b	= _mm256_permute2f128_ps(lo, hi, 0x31);
+			_mm256_storeu_ps(out0 + 2 * x		, a);
+			_mm256_storeu_ps(out0 + 2 * x + 8	, b);
+			_mm256_storeu_ps(out1 + 2 * x		, a);
+			_mm256_storeu_ps(out1 + 2 * x + 8	, b);
+		}
+
+		upsample_row_generic(in + x, w - x, 2, scale, out0 + 2 * x);
+		std::memcpy(out1 + 2 * x, out0 + 2 * x, 2 * (w - x) * sizeof(float));
+	}
+
+	DARKNET_BLAS_TARGET("avx512f")
+	void upsample2_row_avx512(const float * in, const int w, const float scale, float * out0, float * out1)
+	{
+		const __m512 s			= _mm512_set1_ps(scale);
+		const __m512i first		= _mm512_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7);
+		const __m512i second	= _mm512_setr_epi32(8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14, 15, 15);
+
+		for (int x = 0; x < w; x += 16)
+		{
+			const int n = std::min(16, w - x);
+			const __mmask16 mask	= (n == 16 ? 0xFFFF : static_cast<__mmask16>((1u << n) - 1u));
+			const __mmask16 mask_a	= (n >= 8 ? 0xFFFF : static_cast<__mmask16>((1u << (2 * n)) - 1u));
+			const __mmask16 mask_b	= (n <= 8 ? 0 : static_cast<__mmask16>((1u << (2 * (n - 8))) - 1u));
+
+			const __m512 v = _mm512_mul_ps(s, _mm512_maskz_loadu_ps(mask, in + x));
+			const __m512 a = _mm512_permutexvar_ps(first, v);
+			const __m512 b = _mm512_permutexvar_ps(second, v);
+			_mm512_mask_storeu_ps(out0 + 2 * x		, mask_a, a);
+			_mm512_mask_storeu_ps(out0 + 2 * x + 16	, mask_b, b);
+			_mm512_mask_storeu_ps(out1 + 2 * x		, mask_a, a);
+			_mm512_mask_storeu_ps(out1 + 2 * x + 16	, mask_b, b);
+		}
+	}
+
+#endif
+
+	// ---- residual addition:  out = a + b ----
+
+	void add_generic(const float * a, const float * b, float * out, const int n)
+	{
+		for (int i = 0; i < n; i ++)
+		{
+			out[i] = a[i] + b[i];
+		}
+	}
+
+#ifdef DARKNET_BLAS_X86
+
+	DARKNET_BLAS_TARGET("avx2,fma")
+	void add_avx2(const float * a, const float * b, float * out, const int n)
+	{
+		int i = 0;
+		for (; i + 32 <= n; i += 32)
+		{
+			_mm256_storeu_ps(out + i		, _mm256_add_ps(_mm256_loadu_ps(a + i		), _mm256_loadu_ps(b + i		)));
+			_mm256_storeu_ps(out + i + 8	, _mm256_add_ps(_mm256_loadu_ps(a + i + 8	), _mm256_loadu_ps(b + i + 8	)));
+			_mm256_storeu_ps(out + i + 16	, _mm256_add_ps(_mm256_loadu_ps(a + i + 16	), _mm256_loadu_ps(b + i + 16	)));
+			_mm256_storeu_ps(out + i + 24	, _mm256_add_ps(_mm256_loadu_ps(a + i + 24	), _mm256_loadu_ps(b + i + 24	)));
+		}
+		for (; i + 8 <= n; i += 8)
+		{
+			_mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+		}
+		add_generic(a + i, b + i, out + i, n - i);
+	}
+
+	DARKNET_BLAS_TARGET("avx512f")
+	void add_avx512(const float * a, const float * b, float * out, const int n)
+	{
+		int i = 0;
+		for (; i + 64 <= n; i += 64)
+		{
+			_mm512_storeu_ps(out + i		, _mm512_add_ps(_mm512_loadu_ps(a + i		), _mm512_loadu_ps(b + i		)));
+			_mm512_storeu_ps(out + i + 16	, _mm512_add_ps(_mm512_loadu_ps(a + i + 16	), _mm512_loadu_ps(b + i + 16	)));
+			_mm512_storeu_ps(out + i + 32	, _mm512_add_ps(_mm512_loadu_ps(a + i + 32	), _mm512_loadu_ps(b + i + 32	)));
+			_mm512_storeu_ps(out + i + 48	, _mm512_add_ps(_mm512_loadu_ps(a + i + 48	), _mm512_loadu_ps(b + i + 48	)));
+		}
+		for (; i < n; i += 16)
+		{
+			const __mmask16 mask = (n - i >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (n - i)) - 1u));
+			_mm512_mask_storeu_ps(out + i, mask, _mm512_add_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i)));
+		}
+	}
+
+#endif
+
+	void add(const Darknet::EBlasKernel kernel, const float * a, const float * b, float * out, const int n)
+	{
+		switch (kernel)
+		{
+#ifdef DARKNET_BLAS_X86
+			case Darknet::EBlasKernel::AVX2:	add_avx2	(a, b, out, n);	break;
+			case Darknet::EBlasKernel::AVX512:	add_avx512	(a, b, out, n);	break;
+#endif
+			default:							add_generic	(a, b, out, n);	break;
+		}
+	}
+
+	/// Work in blocks of this many values, so large tensors are split between the threads without splitting cache lines.
+	constexpr int add_block = 4096;
+
+	/// @p out = @p a + @p b, split between the threads when it is worth it.
+	void parallel_add(const Darknet::EBlasKernel kernel, const float * a, const float * b, float * out, const int n)
+	{
+		if (n < 4 * add_block)
+		{
+			add(kernel, a, b, out, n);
+			return;
+		}
+
+		Darknet::parallel_for((n + add_block - 1) / add_block, [&](const int block)
+		{
+			const int i = block * add_block;
+			add(kernel, a + i, b + i, out + i, std::min(add_block, n - i));
+		});
+	}
+
+	Darknet::EBlasKernel best_kernel()
+	{
+		static const Darknet::EBlasKernel kernel =
+			blas_kernel_is_supported(Darknet::EBlasKernel::AVX512)	? Darknet::EBlasKernel::AVX512	:
+			blas_kernel_is_supported(Darknet::EBlasKernel::AVX2)	? Darknet::EBlasKernel::AVX2	:
+			Darknet::EBlasKernel::GENERIC;
+
+		return kernel;
+	}
+
+	Darknet::EBlasKernel select(const Darknet::EBlasKernel kernel)
+	{
+		if (kernel == Darknet::EBlasKernel::AUTO or not blas_kernel_is_supported(kernel))
+		{
+			return best_kernel();
+		}
+
+		return kernel;
+	}
+}
+
+
+bool blas_kernel_is_supported(const Darknet::EBlasKernel kernel)
+{
+	TAT(TATPARMS);
+
+	switch (kernel)
+	{
+		case Darknet::EBlasKernel::AUTO:	return true;
+		case Darknet::EBlasKernel::GENERIC:	return true;
+#ifdef DARKNET_BLAS_X86
+		case Darknet::EBlasKernel::AVX2:	return is_fma_avx2() == 1;
+		case Darknet::EBlasKernel::AVX512:	return is_avx512() == 1;
+#endif
+		default:							return false;
+	}
+}
+
+
+const char * blas_kernel_name(const Darknet::EBlasKernel kernel)
+{
+	TAT(TATPARMS);
+
+	switch (kernel)
+	{
+		case Darknet::EBlasKernel::AUTO:	return "auto";
+		case Darknet::EBlasKernel::GENERIC:	return "generic";
+		case Darknet::EBlasKernel::AVX2:	return "avx2";
+		case Darknet::EBlasKernel::AVX512:	return "avx512";
+	}
+
+	return "unknown";
+}
+
+
+void maxpool_cpu(const float * src, const int batch, const int c, const int h, const int w, const int size, const int stride_x, const int stride_y, const int pad, const int out_h, const int out_w, float * dst, Darknet::EBlasKernel kernel)
+{
+	TAT(TATPARMS);
+
+	kernel = select(kernel);
+
+	// same as forward_maxpool_layer():  the window of output (0, 0) starts at (offset, offset)
+	const int offset	= -pad / 2;
+	const int padded_w	= (out_w - 1) * stride_x + size;
+	const int planes	= batch * c;
+
+	if (size == 2 and stride_x == 2 and stride_y == 2 and offset == 0 and 2 * out_w <= w)
+	{
+		// the most common pooling (in all of the tiny networks) does not need the padding
+		Darknet::parallel_for(planes, [&](const int plane)
+		{
+			const float * in	= src + static_cast<size_t>(plane) * h * w;
+			float * out			= dst + static_cast<size_t>(plane) * out_h * out_w;
+
+			for (int oy = 0; oy < out_h; oy ++)
+			{
+				// with an odd height the last window only has one row
+				const float * row0 = in + static_cast<size_t>(2 * oy) * w;
+				const float * row1 = (2 * oy + 1 < h ? row0 + w : row0);
+				maxpool_2x2(kernel, row0, row1, out_w, out + static_cast<size_t>(oy) * out_w);
+			}
+		});
+
+		return;
+	}
+
+	// the planes are split in one part per thread, so the buffers are only allocated once per part
+	const int parts = std::max(1, std::min(planes, Darknet::parallel_threads()));
+
+	Darknet::parallel_for(parts, [&](const int part)
+	{
+		// the vertical maxima of the input rows of one output row with the padding filled in, and the horizontal
+		// maxima which are rounded up to whole vectors
+		std::vector<float> padded(padded_w + 2 * row_padding, -FLT_MAX);
+		std::vector<float> row(round_up(out_w, 16) + row_padding);
+
+		// the columns of the padded row which come from the image
+		const int x0 = std::clamp(-offset, 0, padded_w);
+		const int x1 = std::clamp(w - offset, x0, padded_w);
+
+		for (int plane = planes * part / parts; plane < planes * (part + 1) / parts; plane ++)
+		{
+			const float * in	= src + static_cast<size_t>(plane) * h * w;
+			float * out			= dst + static_cast<size_t>(plane) * out_h * out_w;
+
+			for (int oy = 0; oy < out_h; oy ++)
+			{
+				// clip the window to the image, the same as treating the padding as -FLT_MAX
+				const int y0 = std::max(0, offset + oy * stride_y);
+				const int y1 = std::min(h, offset + oy * stride_y + size);
+				float * out_row = out + static_cast<size_t>(oy) * out_w;
+
+				if (y1 <= y0)
+				{
+					std::fill(out_row, out_row + out_w, -FLT_MAX);
+					continue;
+				}
+
+				maxpool_column(kernel, in + static_cast<size_t>(y0) * w + x0 + offset, y1 - y0, w, x1 - x0, padded.data() + x0);
+				maxpool_row(kernel, padded.data(), size, stride_x, out_w, row.data());
+				std::memcpy(out_row, row.data(), out_w * sizeof(float));
+			}
+		}
+	});
+
+	return;
+}
+
+
+void upsample_forward_cpu(const float * in, const int w, const int h, const int c, const int batch, const int stride, const float scale, float * out, Darknet::EBlasKernel kernel)
+{
+	TAT(TATPARMS);
+
+	kernel = select(kernel);
+
+	const int out_w		= w * stride;
+	const int planes	= batch * c;
+
+	Darknet::parallel_for(planes, [&](const int plane)
+	{
+		const float * in_plane	= in + static_cast<size_t>(plane) * h * w;
+		float * out_plane		= out + static_cast<size_t>(plane) * h * w * stride * stride;
+
+		for (int y = 0; y < h; y ++)
+		{
+			const float * in_row	= in_plane + static_cast<size_t>(y) * w;
+			float * out_row			= out_plane + static_cast<size_t>(y) * stride * out_w;
+
+#ifdef DARKNET_BLAS_X86
+			if (stride == 2 and kernel == Darknet::EBlasKernel::AVX512)
+			{
+				upsample2_row_avx512(in_row, w, scale, out_row, out_row + out_w);
+				continue;
+			}
+			if (stride == 2 and kernel == Darknet::EBlasKernel::AVX2)
+			{
+				upsample2_row_avx2(in_row, w, scale, out_row, out_row + out_w);
+				continue;
+			}
+#endif
+
+			upsample_row_generic(in_row, w, stride, scale, out_row);
+			for (int k = 1; k < stride; k ++)
+			{
+				std::memcpy(out_row + static_cast<size_t>(k) * out_w, out_row, out_w * sizeof(float));
+			}
+		}
+	});
+
+	return;
+}
+
+
+void shortcut_forward_cpu(const int outputs, const int batch, const int n, const int * outputs_of_layers, float * const * layers_output, const float * in, const float * weights, const int nweights, const WEIGHTS_NORMALIZATION_T weights_normalization, float * out, Darknet::EBlasKernel kernel)
+{
+	TAT(TATPARMS);
+
+	kernel = select(kernel);
+
+	if (weights == nullptr)
+	{
+		for (int b = 0; b < batch; b ++)
+		{
+			const float * in_b	= in + static_cast<size_t>(b) * outputs;
+			float * out_b		= out + static_cast<size_t>(b) * outputs;
+
+			if (n == 0)
+			{
+				std::memcpy(out_b, in_b, outputs * sizeof(float));
+				continue;
+			}
+
+			// out = in + add[0] in one pass, then add the other layers one at a time in the same order as shortcut_multilayer_cpu()
+			for (int i = 0; i < n; i ++)
+			{
+				const int count			= std::min(outputs, outputs_of_layers[i]);
+				const float * add_b		= layers_output[i] + static_cast<size_t>(b) * outputs_of_layers[i];
+				parallel_add(kernel, (i == 0 ? in_b : out_b), add_b, out_b, count);
+
+				if (i == 0 and count < outputs)
+				{
+					std::memcpy(out_b + count, in_b + count, (outputs - count) * sizeof(float));
+				}
+			}
+		}
+
+		return;
+	}
+
+	// the weights are either one per layer, one per channel, or one per value, and they are normalized over the layers
+	const int layer_step	= nweights / (n + 1);
+	const int step			= outputs / layer_step;
+	std::vector<float> normalized(nweights);
+
+	for (int g = 0; g < layer_step; g ++)
+	{
+		float max_val = -FLT_MAX;
+		float sum = 1.0f;
+		if (weights_normalization)
+		{
+			if (weights_normalization == SOFTMAX_NORMALIZATION)
+			{
+				for (int i = 0; i < n + 1; i ++)
+				{
+					max_val = std::max(max_val, weights[g + i * layer_step]);
+				}
+			}
+			sum = 0.0001f;
+			for (int i = 0; i < n + 1; i ++)
+			{
+				const float w = weights[g + i * layer_step];
+				if		(weights_normalization == RELU_NORMALIZATION)		sum += relu_activate(w);
+				else if	(weights_normalization == SOFTMAX_NORMALIZATION)	sum += expf(w - max_val);
+			}
+		}
+
+		for (int i = 0; i < n + 1; i ++)
+		{
+			float w = weights[g + i * layer_step];
+			if		(weights_normalization == RELU_NORMALIZATION)		w = relu_activate(w) / sum;
+			else if	(weights_normalization == SOFTMAX_NORMALIZATION)	w = expf(w - max_val) / sum;
+			normalized[g + i * layer_step] = w;
+		}
+	}
+
+	const int total = outputs * batch;
+
+	Darknet::parallel_for((total + add_block - 1) / add_block, [&](const int block)
+	{
+		const int last = std::min(total, (block + 1) * add_block);
+		for (int id = block * add_block; id < last; id ++)
+		{
+			const int src_i = id % outputs;
+			const int src_b = id / outputs;
+			const int g = src_i / step;
+
+			float sum = in[id] * normalized[g];
+			for (int i = 0; i < n; i ++)
+			{
+				if (src_i < outputs_of_layers[i])
+				{
+					sum += layers_output[i][static_cast<size_t>(src_b) * outputs_of_layers[i] + src_i] * normalized[g + (i + 1) * layer_step];
+				}
+			}
+			out[id] = sum;
+		}
+	});
+
+	return;
+}
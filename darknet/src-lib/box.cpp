@@ -1,5 +1,9 @@
 #include "darknet_internal.hpp"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 namespace
 {
 	static auto & cfg_and_state = Darknet::CfgAndState::get();
@@ -1012,6 +1016,226 @@ void diounms_sort(detection *dets, int total, int classes, float thresh, NMS_KIN
 }
 
 
+namespace
+{
+	/** Scratch space reused by @ref do_nms_fast() so that once it has seen a busy frame it no longer allocates.  There is
+	 * one per thread since several networks (or execution contexts) may run NMS at the same time.
+	 */
+	struct NmsScratch
+	{
+		std::vector<int> bucket_offset;				///< @p classes + 1 offsets into @ref entries
+		std::vector<std::pair<float, int>> entries;	///< probability and detection index, grouped by class
+		std::vector<float> left;					///< SoA boxes of the bucket being processed
+		std::vector<float> right;
+		std::vector<float> top;
+		std::vector<float> bottom;
+		std::vector<float> area;
+		std::vector<int32_t> suppressed;			///< non-zero once a box has been suppressed
+	};
+
+	static thread_local NmsScratch nms_scratch;
+
+
+	/** Suppress every box in <tt>[first, count)</tt> which overlaps box @p idx by more than @p thresh.  This performs
+	 * the exact same float operations as @ref box_iou(), so the results are identical to @ref do_nms_sort().
+	 */
+	static inline void suppress_overlapping_boxes(NmsScratch & scratch, const int idx, int first, const int count, const float thresh)
+	{
+		TAT(TATPARMS);
+
+		const float * left		= scratch.left	.data();
+		const float * right		= scratch.right	.data();
+		const float * top		= scratch.top	.data();
+		const float * bottom	= scratch.bottom.data();
+		const float * area		= scratch.area	.data();
+		int32_t * suppressed	= scratch.suppressed.data();
+
+#if defined(__AVX2__)
+		const __m256 l1		= _mm256_set1_ps(left	[idx]);
+		const __m256 r1		= _mm256_set1_ps(right	[idx]);
+		const __m256 t1		= _mm256_set1_ps(top	[idx]);
+		const __m256 b1		= _mm256_set1_ps(bottom	[idx]);
+		const __m256 a1		= _mm256_set1_ps(area	[idx]);
+		const __m256 limit	= _mm256_set1_ps(thresh);
+		const __m256 zero	= _mm256_setzero_ps();
+
+		for (; first + 8 <= count; first += 8)
+		{
+			const __m256 w = _mm256_sub_ps(_mm256_min_ps(r1, _mm256_loadu_ps(right + first)), _mm256_max_ps(l1, _mm256_loadu_ps(left + first)));
+			const __m256 h = _mm256_sub_ps(_mm256_min_ps(b1, _mm256_loadu_ps(bottom + first)), _mm256_max_ps(t1, _mm256_loadu_ps(top + first)));
+			const __m256 overlaps = _mm256_and_ps(_mm256_cmp_ps(w, zero, _CMP_GT_OQ), _mm256_cmp_ps(h, zero, _CMP_GT_OQ));
+			if (_mm256_movemask_ps(overlaps) == 0)
+			{
+				continue;
+			}
+
+			const __m256 i = _mm256_mul_ps(w, h);
+			const __m256 u = _mm256_sub_ps(_mm256_add_ps(a1, _mm256_loadu_ps(area + first)), i);
+			const __m256 iou = _mm256_div_ps(i, u);
+			const __m256 mask = _mm256_and_ps(overlaps, _mm256_cmp_ps(iou, limit, _CMP_GT_OQ));
+
+			__m256i * dst = reinterpret_cast<__m256i *>(suppressed + first);
+			_mm256_storeu_si256(dst, _mm256_or_si256(_mm256_loadu_si256(dst), _mm256_castps_si256(mask)));
+		}
+#endif
+
+		for (; first < count; first ++)
+		{
+			const float w = std::min(right[idx], right[first]) - std::max(left[idx], left[first]);
+			const float h = std::min(bottom[idx], bottom[first]) - std::max(top[idx], top[first]);
+			if (w > 0.0f and h > 0.0f)
+			{
+				const float i = w * h;
+				if (i / (area[idx] + area[first] - i) > thresh)
+				{
+					suppressed[first] = 1;
+				}
+			}
+		}
+
+		return;
+	}
+}
+
+
+void do_nms_fast(detection * dets, int total, int classes, float thresh, NMS_KIND nms_kind, float beta1)
+{
+	TAT(TATPARMS);
+
+	if (total < 2 or classes < 1)
+	{
+		return;
+	}
+
+	NmsScratch & scratch = nms_scratch;
+
+	// count how many detections have a non-zero probability for each class; most only have one
+	scratch.bucket_offset.assign(classes + 1, 0);
+	int * offset = scratch.bucket_offset.data();
+	for (int i = 0; i < total; ++i)
+	{
+		if (dets[i].objectness == 0.0f)
+		{
+			continue;
+		}
+		const float * prob = dets[i].prob;
+		for (int k = 0; k < classes; ++k)
+		{
+			if (prob[k] != 0.0f)
+			{
+				offset[k + 1] ++;
+			}
+		}
+	}
+	for (int k = 0; k < classes; ++k)
+	{
+		offset[k + 1] += offset[k];
+	}
+
+	const int entries = offset[classes];
+	if (scratch.entries.size() < static_cast<size_t>(entries))
+	{
+		scratch.entries.resize(entries);
+	}
+
+	// fill in the buckets (using the offsets as insert positions, which we then shift back)
+	for (int i = 0; i < total; ++i)
+	{
+		if (dets[i].objectness == 0.0f)
+		{
+			continue;
+		}
+		const float * prob = dets[i].prob;
+		for (int k = 0; k < classes; ++k)
+		{
+			if (prob[k] != 0.0f)
+			{
+				scratch.entries[offset[k] ++] = {prob[k], i};
+			}
+		}
+	}
+	for (int k = classes; k > 0; --k)
+	{
+		offset[k] = offset[k - 1];
+	}
+	offset[0] = 0;
+
+	for (int k = 0; k < classes; ++k)
+	{
+		auto * bucket = scratch.entries.data() + offset[k];
+		const int count = offset[k + 1] - offset[k];
+		if (count < 2)
+		{
+			continue;
+		}
+
+		// sort each class only once, from high probability to low probability
+		std::sort(bucket, bucket + count,
+				[](const std::pair<float, int> & lhs, const std::pair<float, int> & rhs) -> bool
+				{
+					return rhs.first < lhs.first;
+				});
+
+		if (scratch.left.size() < static_cast<size_t>(count))
+		{
+			scratch.left		.resize(count);
+			scratch.right		.resize(count);
+			scratch.top			.resize(count);
+			scratch.bottom		.resize(count);
+			scratch.area		.resize(count);
+			scratch.suppressed	.resize(count);
+		}
+
+		for (int idx = 0; idx < count; ++idx)
+		{
+			const Darknet::Box & b = dets[bucket[idx].second].bbox;
+			scratch.left	[idx] = b.x - b.w / 2.0f;
+			scratch.right	[idx] = b.x + b.w / 2.0f;
+			scratch.top		[idx] = b.y - b.h / 2.0f;
+			scratch.bottom	[idx] = b.y + b.h / 2.0f;
+			scratch.area	[idx] = b.w * b.h;
+			scratch.suppressed[idx] = 0;
+		}
+
+		for (int idx = 0; idx < count; ++idx)
+		{
+			if (scratch.suppressed[idx])
+			{
+				continue;
+			}
+
+			if (nms_kind == DEFAULT_NMS or nms_kind == CORNERS_NMS)
+			{
+				suppress_overlapping_boxes(scratch, idx, idx + 1, count, thresh);
+				continue;
+			}
+
+			// the DIoU variants are not vectorized
+			const Darknet::Box & a = dets[bucket[idx].second].bbox;
+			for (int j = idx + 1; j < count; ++j)
+			{
+				const Darknet::Box & b = dets[bucket[j].second].bbox;
+				const float score = (nms_kind == GREEDY_NMS ? box_diou(a, b) : box_diounms(a, b, beta1));
+				if (score > thresh)
+				{
+					scratch.suppressed[j] = 1;
+				}
+			}
+		}
+
+		for (int idx = 0; idx < count; ++idx)
+		{
+			if (scratch.suppressed[idx])
+			{
+				dets[bucket[idx].second].prob[k] = 0.0f;
+			}
+		}
+	}
+
+	return;
+}
+
+
 Darknet::Box encode_box(const Darknet::Box & b, const Darknet::Box & anchor)
 {
 	TAT_REVIEWED(TATPARMS, "2024-05-12");
@@ -1,6 +1,9 @@
 #include "im2col.hpp"
 #include "col2im.hpp"
 #include "gemm.hpp"
+#include "winograd.hpp"
+#include "nchwc.hpp"
+#include "quantize.hpp"
 #include "darknet_internal.hpp"
 
 namespace
@@ -174,6 +177,28 @@ namespace
 
 		return weights;
 	}
+
+
+	/// Describe one group of one image for @ref gemm_prepacked_implicit().
+	inline Darknet::ConvolutionInput get_convolution_input(const Darknet::Layer & l, const float * image)
+	{
+		TAT(TATPARMS);
+
+		Darknet::ConvolutionInput input;
+		input.image		= image;
+		input.channels	= l.c / l.groups;
+		input.height	= l.h;
+		input.width		= l.w;
+		input.ksize		= l.size;
+		input.pad		= l.pad * l.dilation;
+		input.stride_x	= l.stride_x;
+		input.stride_y	= l.stride_y;
+		input.dilation	= l.dilation;
+		input.out_w		= convolutional_out_width(l);
+		input.out_h		= convolutional_out_height(l);
+
+		return input;
+	}
 }
 
 
@@ -279,6 +304,24 @@ size_t get_convolutional_workspace_size(const Darknet::Layer & l)
 {
 	TAT(TATPARMS);
 
+	if (l.int8_weights)
+	{
+		// quantized copy of the input, see quantize.cpp
+		return int8_convolutional_workspace_size(l);
+	}
+
+	if (l.nchwc_weights)
+	{
+		// the blocked layout only needs a padded copy of the input, see nchwc.cpp
+		return nchwc_convolutional_workspace_size(l);
+	}
+
+	if ((l.packed_weights or l.winograd_weights) and not l.antialiasing)
+	{
+		// CPU inference with the implicit GEMM or Winograd reads the input image directly, see pack_conv_weights()
+		return 0;
+	}
+
 	size_t workspace_size = get_workspace_size32(l);
 	size_t workspace_size16 = get_workspace_size16(l);
 	if (workspace_size16 > workspace_size)
@@ -1316,6 +1359,142 @@ void gemm_nn_custom(int M, int N, int K, float ALPHA, float *A, int lda, float *
 }
 
 
+void pack_convolutional_weights(Darknet::Layer & l)
+{
+	TAT(TATPARMS);
+
+	free(l.packed_weights);
+	l.packed_weights = nullptr;
+
+	if (l.xnor or l.binary or l.weights == nullptr)
+	{
+		// binary layers have their own bit-packed weights, see binary_align_weights()
+		return;
+	}
+
+	const Darknet::EGemmKernel kernel = gemm_packed_kernel();
+	const Darknet::EWeightFormat format =
+		cfg_and_state.is_set("bf16")	? Darknet::EWeightFormat::BF16 :
+		cfg_and_state.is_set("fp16")	? Darknet::EWeightFormat::FP16 :
+		Darknet::EWeightFormat::FP32;
+	const int m = l.n / l.groups;
+	const int k = l.size * l.size * l.c / l.groups;
+	const size_t per_group = gemm_prepack_a_size(kernel, format, m, k);
+
+	l.packed_weights = (float*)xcalloc(per_group * l.groups, sizeof(float));
+	l.packed_weights_kernel = static_cast<int>(kernel);
+	l.packed_weights_format = static_cast<int>(format);
+
+	for (int j = 0; j < l.groups; ++j)
+	{
+		gemm_prepack_a(kernel, format, m, k, l.weights + j * l.nweights / l.groups, k, l.packed_weights + j * per_group);
+	}
+
+	return;
+}
+
+
+Darknet::ConvolutionComparison compare_convolution_algorithms(const Darknet::Layer & l, const int repeat)
+{
+	TAT(TATPARMS);
+
+	if (l.packed_weights == nullptr)
+	{
+		throw std::invalid_argument("cannot compare the convolution algorithms without the packed weights");
+	}
+
+	const auto kernel		= static_cast<Darknet::EGemmKernel>(l.packed_weights_kernel);
+	const auto format		= static_cast<Darknet::EWeightFormat>(l.packed_weights_format);
+	const int m				= l.n / l.groups;
+	const int k				= l.size * l.size * l.c / l.groups;
+	const int n				= l.out_w * l.out_h;
+	const size_t packed_size	= gemm_prepack_a_size(kernel, format, m, k);
+	const size_t input_size		= static_cast<size_t>(l.c / l.groups) * l.h * l.w;
+	const bool is_1x1		= (l.size == 1 and l.stride_x == 1 and l.stride_y == 1 and l.dilation == 1);
+
+	std::vector<float> input(input_size * l.groups);
+	for (auto & f : input)
+	{
+		f = rand_uniform(0.0f, 1.0f);
+	}
+	std::vector<float> workspace(is_1x1 ? 0 : static_cast<size_t>(k) * n);
+
+	// returns the average milliseconds to convolve all the groups of one image
+	auto measure = [&](const std::function<void(int, const float *, float *)> & convolve, std::vector<float> & output) -> double
+	{
+		output.assign(static_cast<size_t>(l.n) * n, 0.0f);
+
+		double milliseconds = 0.0;
+		for (int iteration = -1; iteration < repeat; iteration ++) // iteration #-1 is to warm up
+		{
+			std::fill(output.begin(), output.end(), 0.0f);
+
+			const auto timestamp_begin = std::chrono::high_resolution_clock::now();
+			for (int group = 0; group < l.groups; group ++)
+			{
+				convolve(group, input.data() + group * input_size, output.data() + static_cast<size_t>(group) * m * n);
+			}
+			const auto timestamp_end = std::chrono::high_resolution_clock::now();
+
+			if (iteration >= 0)
+			{
+				milliseconds += std::chrono::duration<double, std::milli>(timestamp_end - timestamp_begin).count();
+			}
+		}
+
+		return milliseconds / std::max(1, repeat);
+	};
+
+	auto relative_error = [](const std::vector<float> & reference, const std::vector<float> & output) -> float
+	{
+		float max_value = 0.0f;
+		float max_difference = 0.0f;
+		for (size_t i = 0; i < reference.size(); i ++)
+		{
+			max_value		= std::max(max_value, std::fabs(reference[i]));
+			max_difference	= std::max(max_difference, std::fabs(output[i] - reference[i]));
+		}
+
+		return max_difference / std::max(max_value, FLT_MIN);
+	};
+
+	Darknet::ConvolutionComparison result = {};
+	std::vector<float> reference;
+	std::vector<float> output;
+
+	result.im2col_milliseconds = measure([&](const int group, const float * im, float * c)
+		{
+			const float * b = im;
+			if (not is_1x1)
+			{
+				im2col_cpu_ext(im, l.c / l.groups, l.h, l.w, l.size, l.size, l.pad * l.dilation, l.pad * l.dilation, l.stride_y, l.stride_x, l.dilation, l.dilation, workspace.data());
+				b = workspace.data();
+			}
+			gemm_prepacked(kernel, format, m, n, k, l.packed_weights + group * packed_size, b, n, c, n);
+		}, reference);
+
+	if (not is_1x1)
+	{
+		result.implicit_milliseconds = measure([&](const int group, const float * im, float * c)
+			{
+				gemm_prepacked_implicit(kernel, format, m, l.packed_weights + group * packed_size, get_convolution_input(l, im), c, n);
+			}, output);
+		result.implicit_error = relative_error(reference, output);
+	}
+
+	if (l.winograd_weights)
+	{
+		result.winograd_milliseconds = measure([&](const int group, const float * im, float * c)
+			{
+				winograd_convolution(l, group, im, c);
+			}, output);
+		result.winograd_error = relative_error(reference, output);
+	}
+
+	return result;
+}
+
+
 void binary_align_weights(Darknet::Layer *l)
 {
 	TAT(TATPARMS);
@@ -1417,11 +1596,41 @@ void forward_convolutional_layer(Darknet::Layer & l, Darknet::NetworkState state
 {
 	TAT(TATPARMS);
 
+	if (l.nchwc_weights and not state.train)
+	{
+		// direct convolution on the blocked layout, see nchwc.cpp
+		forward_convolutional_layer_nchwc(l, state);
+		return;
+	}
+
+	if (l.int8_weights and not state.train)
+	{
+		// INT8 GEMM on the quantized input, see quantize.cpp
+		forward_convolutional_layer_int8(l, state);
+		return;
+	}
+
 	int out_h = convolutional_out_height(l);
 	int out_w = convolutional_out_width(l);
 	int i, j;
 
-	fill_cpu(l.outputs*l.batch, 0, l.output, 1);
+	// CPU inference with the packed weights adds the bias and applies the activation (and the sum of a fused shortcut
+	// layer) while each block of the output is written, see fuse_conv_epilogues()
+	const bool fused = l.fused_activation and not state.train;
+	float * output = l.output;
+	Darknet::GemmEpilogue epilogue = {l.biases, l.activation, nullptr, LINEAR};
+	if (fused and l.fused_shortcut)
+	{
+		const Darknet::Layer & shortcut = state.net.layers[state.index + 1];
+		output = shortcut.output;
+		epilogue.add = state.net.layers[shortcut.input_layers[0]].output;
+		epilogue.add_activation = shortcut.activation;
+	}
+
+	if (not fused)
+	{
+		fill_cpu(l.outputs*l.batch, 0, l.output, 1);
+	}
 
 	if (l.xnor && (!l.align_bit_weights || state.train)) {
 		if (!l.align_bit_weights || state.train) {
@@ -1442,7 +1651,14 @@ void forward_convolutional_layer(Darknet::Layer & l, Darknet::NetworkState state
 		{
 			float *a = l.weights +j*l.nweights / l.groups;
 			float *b = state.workspace;
-			float *c = l.output +(i*l.groups + j)*n*m;
+			float *c = output +(i*l.groups + j)*n*m;
+
+			Darknet::GemmEpilogue group_epilogue = epilogue;
+			group_epilogue.bias = l.biases + j*m;
+			if (epilogue.add)
+			{
+				group_epilogue.add = epilogue.add + (i*l.groups + j)*n*m;
+			}
 
 			//gemm(0,0,m,n,k,1,a,k,b,n,1,c,n);
 			//gemm_nn_custom(m, n, k, 1, a, k, b, n, c, n);
@@ -1537,6 +1753,19 @@ void forward_convolutional_layer(Darknet::Layer & l, Darknet::NetworkState state
 				return;
 
 			}
+			else if (l.winograd_weights and not state.train)
+			{
+				// 3x3 stride 1 convolution without im2col, see winograd.cpp
+				winograd_convolution(l, j, state.input + (i*l.groups + j)*(l.c / l.groups)*l.h*l.w, c, fused ? &group_epilogue : nullptr);
+			}
+			else if (l.packed_weights and not state.train and not (l.size == 1 && l.stride == 1 && l.dilation == 1))
+			{
+				// implicit GEMM:  the packed GEMM reads the input image directly, so there is no im2col in the workspace
+				const Darknet::EGemmKernel kernel = static_cast<Darknet::EGemmKernel>(l.packed_weights_kernel);
+				const Darknet::EWeightFormat format = static_cast<Darknet::EWeightFormat>(l.packed_weights_format);
+				const auto input = get_convolution_input(l, state.input + (i*l.groups + j)*(l.c / l.groups)*l.h*l.w);
+				gemm_prepacked_implicit(kernel, format, m, l.packed_weights + j * gemm_prepack_a_size(kernel, format, m, k), input, c, n, fused ? &group_epilogue : nullptr);
+			}
 			else
 			{
 				float *im = state.input + (i*l.groups + j)*(l.c / l.groups)*l.h*l.w;
@@ -1557,27 +1786,40 @@ void forward_convolutional_layer(Darknet::Layer & l, Darknet::NetworkState state
 
 				}
 
-				gemm(0, 0, m, n, k, 1, a, k, b, n, 1, c, n);
+				if (l.packed_weights and not state.train)
+				{
+					const Darknet::EGemmKernel kernel = static_cast<Darknet::EGemmKernel>(l.packed_weights_kernel);
+					const Darknet::EWeightFormat format = static_cast<Darknet::EWeightFormat>(l.packed_weights_format);
+					const float * packed = l.packed_weights + j * gemm_prepack_a_size(kernel, format, m, k);
+					gemm_prepacked(kernel, format, m, n, k, packed, b, n, c, n, fused ? &group_epilogue : nullptr);
+				}
+				else
+				{
+					gemm(0, 0, m, n, k, 1, a, k, b, n, 1, c, n);
+				}
 				// bit-count to float
 			}
 		}
 	}
 
-	if(l.batch_normalize){
-		forward_batchnorm_layer(l, state);
-	}
-	else {
-		add_bias(l.output, l.biases, l.batch, l.n, out_h*out_w);
-	}
+	if (not fused) // otherwise the epilogue already did this
+	{
+		if(l.batch_normalize){
+			forward_batchnorm_layer(l, state);
+		}
+		else {
+			add_bias(l.output, l.biases, l.batch, l.n, out_h*out_w);
+		}
 
-	//activate_array(l.output, m*n*l.batch, l.activation);
-	if (l.activation == SWISH) activate_array_swish(l.output, l.outputs*l.batch, l.activation_input, l.output);
-	else if (l.activation == MISH) activate_array_mish(l.output, l.outputs*l.batch, l.activation_input, l.output);
-	else if (l.activation == HARD_MISH) activate_array_hard_mish(l.output, l.outputs*l.batch, l.activation_input, l.output);
-	else if (l.activation == NORM_CHAN) activate_array_normalize_channels(l.output, l.outputs*l.batch, l.batch, l.out_c, l.out_w*l.out_h, l.output);
-	else if (l.activation == NORM_CHAN_SOFTMAX) activate_array_normalize_channels_softmax(l.output, l.outputs*l.batch, l.batch, l.out_c, l.out_w*l.out_h, l.output, 0);
-	else if (l.activation == NORM_CHAN_SOFTMAX_MAXVAL) activate_array_normalize_channels_softmax(l.output, l.outputs*l.batch, l.batch, l.out_c, l.out_w*l.out_h, l.output, 1);
-	else activate_array_cpu_custom(l.output, l.outputs*l.batch, l.activation);
+		//activate_array(l.output, m*n*l.batch, l.activation);
+		if (l.activation == SWISH) activate_array_swish(l.output, l.outputs*l.batch, l.activation_input, l.output);
+		else if (l.activation == MISH) activate_array_mish(l.output, l.outputs*l.batch, l.activation_input, l.output);
+		else if (l.activation == HARD_MISH) activate_array_hard_mish(l.output, l.outputs*l.batch, l.activation_input, l.output);
+		else if (l.activation == NORM_CHAN) activate_array_normalize_channels(l.output, l.outputs*l.batch, l.batch, l.out_c, l.out_w*l.out_h, l.output);
+		else if (l.activation == NORM_CHAN_SOFTMAX) activate_array_normalize_channels_softmax(l.output, l.outputs*l.batch, l.batch, l.out_c, l.out_w*l.out_h, l.output, 0);
+		else if (l.activation == NORM_CHAN_SOFTMAX_MAXVAL) activate_array_normalize_channels_softmax(l.output, l.outputs*l.batch, l.batch, l.out_c, l.out_w*l.out_h, l.output, 1);
+		else activate_array_cpu_custom(l.output, l.outputs*l.batch, l.activation);
+	}
 
 	if(l.binary || l.xnor) swap_binary(&l);
 
@@ -34,6 +34,40 @@ void binarize_weights2(float *weights, int n, int size, char *binary, float *sca
 
 void binary_align_weights(Darknet::Layer *l);
 
+/** Create @ref Darknet::Layer::packed_weights from the (already fused) weights so the forward pass does not need to
+ * repack the weights into GEMM panels for every image.  The packed weights are stored as 16-bit values when the
+ * @p --fp16 or @p --bf16 parameter is used.
+ *
+ * @since 2026-10-17
+ */
+void pack_convolutional_weights(Darknet::Layer & l);
+
+namespace Darknet
+{
+	/** Result of @ref compare_convolution_algorithms().  The times are in milliseconds per image, and are zero when the
+	 * algorithm is not used for the layer.  The errors are the largest difference with the im2col output, relative to
+	 * the largest im2col output.
+	 *
+	 * @since 2026-10-17
+	 */
+	struct ConvolutionComparison
+	{
+		double im2col_milliseconds;		///< @p im2col_cpu_ext() into the workspace, then the packed GEMM
+		double implicit_milliseconds;	///< implicit GEMM which reads the input image directly (not for 1x1 layers)
+		double winograd_milliseconds;	///< Winograd F(4x4, 3x3), only when the layer has @ref Darknet::Layer::winograd_weights
+		float implicit_error;
+		float winograd_error;
+	};
+}
+
+/** Convolve a random image using each of the CPU algorithms available for @p l, and compare the time and the outputs.
+ * The layer must have @ref Darknet::Layer::packed_weights.  The bias and the activation are not included.  This is used
+ * to autotune the layers when the network is loaded, and by the @p convbench command.
+ *
+ * @since 2026-10-17
+ */
+Darknet::ConvolutionComparison compare_convolution_algorithms(const Darknet::Layer & l, int repeat);
+
 void backward_convolutional_layer(Darknet::Layer & l, Darknet::NetworkState state);
 
 void add_bias(float *output, float *biases, int batch, int n, int size);
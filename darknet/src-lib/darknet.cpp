@@ -129,6 +129,234 @@ namespace
 
 		return;
 	}
+
+	/** Apply NMS to the detections and convert them into the C++ predictions.  @p original_image_size is used to scale the
+	 * bounding boxes.  When @p free_results is set, this takes ownership of @p darknet_results which is freed before
+	 * returning.  Detections from the network's arena are not freed.
+	 */
+	static inline Darknet::Predictions to_predictions(Darknet::Network * net, Darknet::Detection * darknet_results, const int nboxes, const cv::Size & original_image_size, const bool free_results)
+	{
+		TAT(TATPARMS);
+
+		if (net->details->non_maximal_suppression_threshold)
+		{
+			auto & layer = net->layers[net->n - 1];
+			do_nms_fast(darknet_results, nboxes, layer.classes, net->details->non_maximal_suppression_threshold, DEFAULT_NMS, 0.0f);
+		}
+
+		// only reserve room for the objects which have a class above the threshold, not every candidate
+		int candidates = 0;
+		for (int detection_idx = 0; detection_idx < nboxes; detection_idx ++)
+		{
+			if (darknet_results[detection_idx].best_class_idx >= 0)
+			{
+				candidates ++;
+			}
+		}
+
+		Darknet::Predictions predictions;
+		predictions.reserve(candidates);
+
+		for (int detection_idx = 0; detection_idx < nboxes; detection_idx ++)
+		{
+			auto & det = darknet_results[detection_idx];
+
+			// NMS only ever clears probabilities, so if nothing was above the threshold when decoding there is nothing now
+			if (det.best_class_idx < 0)
+			{
+				continue;
+			}
+
+			/* The "det" object has an array called det.prob[].  That array is large enough for 1 entry per class in the network.
+			 * Each entry will be set to 0.0f, except for the ones that correspond to the class that was detected.  Note that it
+			 * is possible that multiple entries are non-zero!  We need to look at every entry and remember which ones are set.
+			 */
+
+			Darknet::Prediction pred;
+			pred.best_class = -1;
+
+			for (int class_idx = 0; class_idx < det.classes; class_idx ++)
+			{
+				const auto probability = det.prob[class_idx];
+				if (probability >= net->details->detection_threshold)
+				{
+					// remember this probability since it is higher than the user-specified threshold
+					pred.prob[class_idx] = probability;
+					if (pred.best_class == -1 or probability > det.prob[pred.best_class])
+					{
+						pred.best_class = class_idx;
+					}
+				}
+			}
+
+			// most of the output from Darknet/YOLO will have a confidence of 0.0f which we need to completely ignore
+			if (pred.best_class == -1)
+			{
+				continue;
+			}
+
+			// optional:  sometimes there are classes we want to completely ignore
+			if (net->details->classes_to_ignore.count(pred.best_class))
+			{
+				continue;
+			}
+
+			if (net->details->fix_out_of_bound_normalized_coordinates)
+			{
+				fix_out_of_bound_normalized_rect(det.bbox.x, det.bbox.y, det.bbox.w, det.bbox.h);
+			}
+
+			const int w = std::round(det.bbox.w * original_image_size.width				);
+			const int h = std::round(det.bbox.h * original_image_size.height			);
+			const int x = std::round(det.bbox.x * original_image_size.width	- w / 2.0f	);
+			const int y = std::round(det.bbox.y * original_image_size.height- h / 2.0f	);
+
+			pred.rect				= cv::Rect(cv::Point(x, y), cv::Size(w, h));
+			pred.normalized_point	= cv::Point2f(det.bbox.x, det.bbox.y);
+			pred.normalized_size	= cv::Size2f(det.bbox.w, det.bbox.h);
+
+			predictions.push_back(pred);
+		}
+
+		if (free_results)
+		{
+			free_detections(darknet_results, nboxes);
+		}
+
+		return predictions;
+	}
+
+
+	/** Convert the output of the last call to @p network_predict() into the C++ predictions.  @p image_w and @p image_h are the
+	 * dimensions of the image given to the network, and @p original_image_size is used to scale the bounding boxes.
+	 *
+	 * When the input was letterboxed, the boxes are first mapped from the network input back to the original image.
+	 */
+	static inline Darknet::Predictions get_predictions(Darknet::Network * net, const int image_w, const int image_h, const cv::Size & original_image_size)
+	{
+		TAT(TATPARMS);
+
+		const bool letter = net->details->letterbox;
+		const int boxes_w = letter ? original_image_size.width	: image_w;
+		const int boxes_h = letter ? original_image_size.height	: image_h;
+
+		int nboxes = 0;
+		auto darknet_results = make_network_boxes_arena(net, boxes_w, boxes_h, net->details->detection_threshold, 1, &nboxes, letter ? 1 : 0, 0);
+		if (darknet_results)
+		{
+			return to_predictions(net, darknet_results, nboxes, original_image_size, false);
+		}
+
+		const float hierarchy_threshold = 0.5f;
+		darknet_results = get_network_boxes(net, boxes_w, boxes_h, net->details->detection_threshold, hierarchy_threshold, 0, 1, &nboxes, letter ? 1 : 0);
+
+		return to_predictions(net, darknet_results, nboxes, original_image_size, true);
+	}
+
+
+	/** Set the batch size used by the next call to @p network_predict().  The layer buffers are only reallocated (with
+	 * @p resize_network()) when the batch grows beyond what has already been allocated, so switching back and forth between
+	 * single images and batches of images does not allocate.
+	 */
+	static inline void set_inference_batch(Darknet::Network * net, const int batch)
+	{
+		TAT(TATPARMS);
+
+		if (batch > net->details->allocated_batch)
+		{
+			if (net->details->model)
+			{
+				throw std::invalid_argument("the execution context was created for a batch of " + std::to_string(net->details->allocated_batch) + " image(s), but " + std::to_string(batch) + " were given");
+			}
+
+			set_batch_network(net, batch);
+			resize_network(net, net->w, net->h);
+			net->details->allocated_batch = batch;
+		}
+		else if (net->batch != batch)
+		{
+#ifdef DARKNET_GPU
+			set_batch_network(net, batch);
+#else
+			// the CPU workspace is used one image at a time, so there is no need for set_batch_network() to reallocate it
+			net->batch = batch;
+			for (int i = 0; i < net->n; i ++)
+			{
+				net->layers[i].batch = batch;
+			}
+#endif
+		}
+
+		return;
+	}
+
+
+	/// Resize (or letterbox) the BGR image into @p dst, which must have room for one network input.
+	static inline void mat_to_input(Darknet::Network * net, const cv::Mat & mat, float * dst)
+	{
+		TAT(TATPARMS);
+
+		if (net->details->letterbox)
+		{
+			Darknet::bgr_mat_to_rgb_letterbox_tensor(mat, dst, net->w, net->h, net->details->input_x_offsets);
+		}
+		else
+		{
+			Darknet::bgr_mat_to_rgb_tensor(mat, dst, net->w, net->h, net->details->input_x_offsets);
+		}
+
+		return;
+	}
+
+
+	/** Calls the @p C callback given to @ref darknet_predict_async().  Images which do not get predictions -- dropped from a
+	 * full queue, abandoned when the workers stop, or failed -- are reported with @ref failed() so @p user_data can be
+	 * released.
+	 */
+	struct CPredictionCallback final
+	{
+		DarknetPredictionCallback callback;
+		void * user_data;
+		int classes;
+
+		void operator()(const Darknet::Predictions & predictions)
+		{
+			TAT(TATPARMS);
+
+			std::vector<float> prob(predictions.size() * classes, 0.0f);
+			std::vector<DarknetDetection> dets(predictions.size());
+			for (size_t idx = 0; idx < predictions.size(); idx ++)
+			{
+				const auto & prediction = predictions[idx];
+				auto & det = dets[idx];
+				det.bbox.x			= prediction.normalized_point.x;
+				det.bbox.y			= prediction.normalized_point.y;
+				det.bbox.w			= prediction.normalized_size.width;
+				det.bbox.h			= prediction.normalized_size.height;
+				det.classes			= classes;
+				det.best_class_idx	= prediction.best_class;
+				det.prob			= prob.data() + idx * classes;
+				det.objectness		= 1.0f;
+				for (const auto & [class_idx, probability] : prediction.prob)
+				{
+					det.prob[class_idx] = probability;
+				}
+			}
+
+			callback(user_data, dets.data(), static_cast<int>(dets.size()));
+
+			return;
+		}
+
+		void failed()
+		{
+			TAT(TATPARMS);
+
+			callback(user_data, nullptr, -1);
+
+			return;
+		}
+	};
 }
 
 
@@ -202,6 +430,13 @@ extern "C"
 		return;
 	}
 
+	void darknet_set_letterbox(DarknetNetworkPtr ptr, const bool toggle)
+	{
+		TAT(TATPARMS);
+		Darknet::set_letterbox(ptr, toggle);
+		return;
+	}
+
 	void darknet_network_dimensions(DarknetNetworkPtr ptr, int * w, int * h, int * c)
 	{
 		TAT(TATPARMS);
@@ -233,6 +468,13 @@ extern "C"
 		return Darknet::load_neural_network(cfg, names, weights);
 	}
 
+	DarknetNetworkPtr darknet_create_execution_context(const DarknetNetworkPtr ptr, const int batch_size)
+	{
+		TAT(TATPARMS);
+
+		return Darknet::create_execution_context(ptr, batch_size);
+	}
+
 	void darknet_free_neural_network(DarknetNetworkPtr * ptr)
 	{
 		TAT(TATPARMS);
@@ -246,6 +488,82 @@ extern "C"
 		return;
 	}
 
+	void darknet_set_async_workers(DarknetNetworkPtr ptr, int workers, int queue_depth)
+	{
+		TAT(TATPARMS);
+
+		Darknet::set_async_workers(ptr, std::max(0, workers), std::max(0, queue_depth));
+
+		return;
+	}
+
+	void darknet_set_thread_pool(DarknetNetworkPtr ptr, int threads, const int * cpus, int cpus_count)
+	{
+		TAT(TATPARMS);
+
+		Darknet::VInt v;
+		if (cpus)
+		{
+			v.assign(cpus, cpus + std::max(0, cpus_count));
+		}
+		Darknet::set_thread_pool(ptr, Darknet::create_thread_pool(std::max(0, threads), v));
+
+		return;
+	}
+
+	int darknet_predict_async(DarknetNetworkPtr ptr, const unsigned char * bgr, int width, int height, int channels, DarknetPredictionCallback callback, void * user_data)
+	{
+		TAT(TATPARMS);
+
+		// exceptions must not cross into the C caller, so report them with the return value instead
+		try
+		{
+			if (bgr == nullptr or callback == nullptr or width < 1 or height < 1 or (channels != 3 and channels != 4))
+			{
+				throw std::invalid_argument("darknet_predict_async() requires a callback and an 8-bit BGR or BGRA image");
+			}
+
+			// the predictor copies the image, so wrapping the caller's pixels without a copy is safe
+			const cv::Mat mat(height, width, CV_8UC(channels), const_cast<unsigned char *>(bgr));
+
+			auto c_callback = std::make_shared<CPredictionCallback>();
+			c_callback->callback	= callback;
+			c_callback->user_data	= user_data;
+			c_callback->classes		= static_cast<int>(Darknet::get_class_names(ptr).size());
+
+			Darknet::predict_async(ptr, mat,
+					[c_callback](cv::Mat, Darknet::Predictions predictions)
+					{
+						(*c_callback)(predictions);
+					},
+					[c_callback](cv::Mat, std::exception_ptr)
+					{
+						c_callback->failed();
+					});
+		}
+		catch (const std::exception & e)
+		{
+			Darknet::display_error_msg("darknet_predict_async() failed: " + std::string(e.what()) + "\n");
+			return -1;
+		}
+		catch (...)
+		{
+			Darknet::display_error_msg("darknet_predict_async() failed\n");
+			return -1;
+		}
+
+		return 0;
+	}
+
+	void darknet_wait_async_predictions(DarknetNetworkPtr ptr)
+	{
+		TAT(TATPARMS);
+
+		Darknet::wait_async_predictions(ptr);
+
+		return;
+	}
+
 	void darknet_clear_skipped_classes(DarknetNetworkPtr ptr)
 	{
 		TAT(TATPARMS);
@@ -1003,6 +1321,22 @@ void Darknet::fix_out_of_bound_values(Darknet::NetworkPtr ptr, const bool toggle
 }
 
 
+void Darknet::set_letterbox(Darknet::NetworkPtr ptr, const bool toggle)
+{
+	TAT(TATPARMS);
+
+	Darknet::Network * net = reinterpret_cast<Darknet::Network*>(ptr);
+	if (net == nullptr)
+	{
+		throw std::invalid_argument("pointer to neural network cannot be NULL");
+	}
+
+	net->details->letterbox = toggle;
+
+	return;
+}
+
+
 void Darknet::set_annotation_font(Darknet::NetworkPtr ptr, const cv::LineTypes line_type, const cv::HersheyFonts font_face, const int font_thickness, const double font_scale)
 {
 	TAT(TATPARMS);
@@ -1240,6 +1574,20 @@ void Darknet::free_neural_network(Darknet::NetworkPtr & ptr)
 }
 
 
+Darknet::NetworkPtr Darknet::create_execution_context(const Darknet::NetworkPtr ptr, const int batch_size)
+{
+	TAT(TATPARMS);
+
+	const Darknet::Network * model = reinterpret_cast<const Darknet::Network *>(ptr);
+	if (model == nullptr)
+	{
+		throw std::invalid_argument("cannot create an execution context without a network pointer");
+	}
+
+	return make_network_context(*model, batch_size);
+}
+
+
 void Darknet::network_dimensions(Darknet::NetworkPtr & ptr, int & w, int & h, int & c)
 {
 	TAT(TATPARMS);
@@ -1279,8 +1627,16 @@ Darknet::Predictions Darknet::predict(const Darknet::NetworkPtr ptr, const cv::M
 	const cv::Size network_dimensions(net->w, net->h);
 	const cv::Size original_image_size = mat.size();
 
+	if (net->c == 3 and mat.depth() == CV_8U and (mat.channels() == 3 or mat.channels() == 4))
+	{
+		// resize (or letterbox), convert BGR to RGB and normalize in a single pass straight into the network's input tensor
+		const float * input = prepare_input_tensor(ptr, mat);
+
+		return predict(ptr, input, original_image_size);
+	}
+
 	cv::Mat bgr;
-	if (mat.size() != network_dimensions)
+	if (mat.size() != network_dimensions and not net->details->letterbox)
 	{
 		// Note that INTER_NEAREST gives us *speed*, not image quality.
 		//
@@ -1328,80 +1684,163 @@ Darknet::Predictions Darknet::predict(Darknet::NetworkPtr ptr, Darknet::Image &
 	if (original_image_size.width	< 1) original_image_size.width	= img.w;
 	if (original_image_size.height	< 1) original_image_size.height	= img.h;
 
+	if (net->details->letterbox and (img.w != net->w or img.h != net->h))
+	{
+		Darknet::Image boxed = Darknet::letterbox_image(img, net->w, net->h);
+		Darknet::free_image(img);
+		img = boxed;
+	}
+
+	set_inference_batch(net, 1);
 	network_predict(*net, img.data); /// todo pass net by ref or pointer, not copy constructor!
 	Darknet::free_image(img);
 
-	int nboxes = 0;
-	const float hierarchy_threshold = 0.5f;
-	auto darknet_results = get_network_boxes(net, img.w, img.h, net->details->detection_threshold, hierarchy_threshold, 0, 1, &nboxes, 0);
+	return get_predictions(net, img.w, img.h, original_image_size);
+}
 
-	if (net->details->non_maximal_suppression_threshold)
-	{
-		auto & layer = net->layers[net->n - 1];
-		do_nms_sort(darknet_results, nboxes, layer.classes, net->details->non_maximal_suppression_threshold);
-	}
 
-	Predictions predictions;
-	predictions.reserve(nboxes); // this is likely too many (depends on the detection threshold) but gets us in the ballpark
+std::vector<Darknet::Predictions> Darknet::predict(const Darknet::NetworkPtr ptr, const std::vector<cv::Mat> & mats)
+{
+	TAT(TATPARMS);
 
-	for (int detection_idx = 0; detection_idx < nboxes; detection_idx ++)
+	Darknet::Network * net = reinterpret_cast<Darknet::Network *>(ptr);
+	if (net == nullptr)
 	{
-		auto & det = darknet_results[detection_idx];
+		throw std::invalid_argument("cannot predict without a network pointer");
+	}
 
-		/* The "det" object has an array called det.prob[].  That array is large enough for 1 entry per class in the network.
-		 * Each entry will be set to 0.0f, except for the ones that correspond to the class that was detected.  Note that it
-		 * is possible that multiple entries are non-zero!  We need to look at every entry and remember which ones are set.
-		 */
+	std::vector<Darknet::Predictions> results;
+	if (mats.empty())
+	{
+		return results;
+	}
 
-		Prediction pred;
-		pred.best_class = -1;
+	if (mats.size() == 1)
+	{
+		results.push_back(predict(ptr, mats[0]));
+		return results;
+	}
 
-		for (int class_idx = 0; class_idx < det.classes; class_idx ++)
+	if (net->c != 3)
+	{
+		throw std::invalid_argument("a batch of images can only be predicted with 3-channel networks");
+	}
+	for (const auto & mat : mats)
+	{
+		if (mat.empty() or mat.depth() != CV_8U or (mat.channels() != 3 and mat.channels() != 4))
 		{
-			const auto probability = det.prob[class_idx];
-			if (probability >= net->details->detection_threshold)
-			{
-				// remember this probability since it is higher than the user-specified threshold
-				pred.prob[class_idx] = probability;
-				if (pred.best_class == -1 or probability > det.prob[pred.best_class])
-				{
-					pred.best_class = class_idx;
-				}
-			}
+			throw std::invalid_argument("a batch of images must contain 8-bit BGR or BGRA images");
 		}
+	}
 
-		// most of the output from Darknet/YOLO will have a confidence of 0.0f which we need to completely ignore
-		if (pred.best_class == -1)
-		{
-			continue;
-		}
+	const int batch = static_cast<int>(mats.size());
+	const size_t input_size = static_cast<size_t>(net->w) * net->h * net->c;
+
+	auto & tensor = net->details->input_tensor;
+	if (tensor.size() < input_size * batch)
+	{
+		tensor.resize(input_size * batch, 0.0f);
+	}
+
+	for (int idx = 0; idx < batch; idx ++)
+	{
+		mat_to_input(net, mats[idx], tensor.data() + input_size * idx);
+	}
+
+	// one forward pass for the entire batch
+	set_inference_batch(net, batch);
+	network_predict(*net, tensor.data());
+
+	const bool letter = net->details->letterbox;
+	const float hierarchy_threshold = 0.5f;
 
-		// optional:  sometimes there are classes we want to completely ignore
-		if (net->details->classes_to_ignore.count(pred.best_class))
+	results.reserve(batch);
+	for (int idx = 0; idx < batch; idx ++)
+	{
+		const cv::Size original_image_size = mats[idx].size();
+		const int boxes_w = letter ? original_image_size.width	: net->w;
+		const int boxes_h = letter ? original_image_size.height	: net->h;
+
+		int nboxes = 0;
+		Darknet::Detection * darknet_results = make_network_boxes_arena(net, boxes_w, boxes_h, net->details->detection_threshold, 1, &nboxes, letter ? 1 : 0, idx);
+		if (darknet_results)
 		{
+			results.push_back(to_predictions(net, darknet_results, nboxes, original_image_size, false));
 			continue;
 		}
 
-		if (net->details->fix_out_of_bound_normalized_coordinates)
-		{
-			fix_out_of_bound_normalized_rect(det.bbox.x, det.bbox.y, det.bbox.w, det.bbox.h);
-		}
+		darknet_results = make_network_boxes_batch(net, net->details->detection_threshold, &nboxes, idx);
+		fill_network_boxes_batch(net, boxes_w, boxes_h, net->details->detection_threshold, hierarchy_threshold, 0, 1, darknet_results, letter ? 1 : 0, idx);
+
+		results.push_back(to_predictions(net, darknet_results, nboxes, original_image_size, true));
+	}
+
+	return results;
+}
 
-		const int w = std::round(det.bbox.w * original_image_size.width				);
-		const int h = std::round(det.bbox.h * original_image_size.height			);
-		const int x = std::round(det.bbox.x * original_image_size.width	- w / 2.0f	);
-		const int y = std::round(det.bbox.y * original_image_size.height- h / 2.0f	);
 
-		pred.rect				= cv::Rect(cv::Point(x, y), cv::Size(w, h));
-		pred.normalized_point	= cv::Point2f(det.bbox.x, det.bbox.y);
-		pred.normalized_size	= cv::Size2f(det.bbox.w, det.bbox.h);
+float * Darknet::get_input_tensor(const Darknet::NetworkPtr ptr)
+{
+	TAT(TATPARMS);
 
-		predictions.push_back(pred);
+	Darknet::Network * net = reinterpret_cast<Darknet::Network *>(ptr);
+	if (net == nullptr)
+	{
+		throw std::invalid_argument("cannot get the input tensor without a network pointer");
 	}
 
-	free_detections(darknet_results, nboxes);
+	// the tensor may be larger than needed if it was used for a batch of images
+	auto & tensor = net->details->input_tensor;
+	const size_t size = static_cast<size_t>(net->w) * net->h * net->c;
+	if (tensor.size() < size)
+	{
+		tensor.resize(size, 0.0f);
+	}
 
-	return predictions;
+	return tensor.data();
+}
+
+
+float * Darknet::prepare_input_tensor(const Darknet::NetworkPtr ptr, const cv::Mat & mat)
+{
+	TAT(TATPARMS);
+
+	Darknet::Network * net = reinterpret_cast<Darknet::Network *>(ptr);
+	if (net == nullptr)
+	{
+		throw std::invalid_argument("cannot prepare the input tensor without a network pointer");
+	}
+	if (net->c != 3)
+	{
+		throw std::invalid_argument("the input tensor can only be prepared for 3-channel networks");
+	}
+
+	float * tensor = get_input_tensor(ptr);
+	mat_to_input(net, mat, tensor);
+
+	return tensor;
+}
+
+
+Darknet::Predictions Darknet::predict(const Darknet::NetworkPtr ptr, const float * input, const cv::Size original_image_size)
+{
+	TAT(TATPARMS);
+
+	Darknet::Network * net = reinterpret_cast<Darknet::Network *>(ptr);
+	if (net == nullptr)
+	{
+		throw std::invalid_argument("cannot predict without a network pointer");
+	}
+	if (input == nullptr)
+	{
+		throw std::invalid_argument("cannot predict without an input tensor");
+	}
+
+	// the input is only ever read by the first layer
+	set_inference_batch(net, 1);
+	network_predict(*net, const_cast<float *>(input));
+
+	return get_predictions(net, net->w, net->h, original_image_size.area() > 0 ? original_image_size : cv::Size(net->w, net->h));
 }
 
 
@@ -1648,6 +2087,7 @@ Darknet::SInt Darknet::skipped_classes(Darknet::NetworkPtr ptr, const Darknet::S
 			net->details->classes_to_ignore.insert(idx);
 		}
 	}
+	update_classes_to_decode(*net);
 
 	return net->details->classes_to_ignore;
 }
@@ -1664,6 +2104,7 @@ Darknet::SInt Darknet::clear_skipped_classes(Darknet::NetworkPtr ptr)
 	}
 
 	net->details->classes_to_ignore.clear();
+	update_classes_to_decode(*net);
 
 	return net->details->classes_to_ignore;
 }
@@ -1683,6 +2124,7 @@ Darknet::SInt Darknet::add_skipped_class(Darknet::NetworkPtr ptr, const int clas
 	{
 		net->details->classes_to_ignore.insert(class_to_skip);
 	}
+	update_classes_to_decode(*net);
 
 	return net->details->classes_to_ignore;
 }
@@ -1699,6 +2141,7 @@ Darknet::SInt Darknet::del_skipped_class(Darknet::NetworkPtr ptr, const int clas
 	}
 
 	net->details->classes_to_ignore.erase(class_to_include);
+	update_classes_to_decode(*net);
 
 	return net->details->classes_to_ignore;
 }
@@ -69,6 +69,9 @@ void darknet_set_non_maximal_suppression_threshold(DarknetNetworkPtr ptr, float
 /// This is the @p C equivalent to @ref Darknet::fix_out_of_bound_values().
 void darknet_fix_out_of_bound_values(DarknetNetworkPtr ptr, const bool toggle);
 
+/// This is the @p C equivalent to @ref Darknet::set_letterbox().
+void darknet_set_letterbox(DarknetNetworkPtr ptr, const bool toggle);
+
 /// This is the @p C equivalent to @ref Darknet::network_dimensions().
 void darknet_network_dimensions(DarknetNetworkPtr ptr, int * w, int * h, int * c);
 
@@ -78,6 +81,9 @@ DarknetNetworkPtr darknet_load_neural_network(const char * const cfg_filename, c
 /// This is the @p C equivalent to @ref Darknet::free_neural_network().
 void darknet_free_neural_network(DarknetNetworkPtr * ptr);
 
+/// This is the @p C equivalent to @ref Darknet::create_execution_context().
+DarknetNetworkPtr darknet_create_execution_context(const DarknetNetworkPtr ptr, const int batch_size);
+
 /// This is the @p C equivalent to @ref Darknet::clear_skipped_classes().
 void darknet_clear_skipped_classes(DarknetNetworkPtr ptr);
 
@@ -175,6 +181,33 @@ typedef struct DarknetImage
 	float *data;	///< normalized floats, the number of which is determined by @p "w * h * c"
 } DarknetImage;
 
+/** Callback used by @ref darknet_predict_async().  It is called from a worker thread with the @p user_data given to
+ * @ref darknet_predict_async().  The detections are only valid until the callback returns.  If the image was dropped
+ * because the queue was full, was still queued when the workers were stopped, or could not be processed, @p dets is
+ * @p NULL and @p nboxes is @p -1.  Each image accepted by @ref darknet_predict_async() gets exactly one call.
+ */
+typedef void (*DarknetPredictionCallback)(void * user_data, const DarknetDetection * dets, int nboxes);
+
+/// This is the @p C equivalent to @ref Darknet::set_async_workers().
+void darknet_set_async_workers(DarknetNetworkPtr ptr, int workers, int queue_depth);
+
+/** This is the @p C equivalent to @ref Darknet::create_thread_pool() and @ref Darknet::set_thread_pool().  @p cpus may
+ * be @p NULL when @p cpus_count is zero.
+ */
+void darknet_set_thread_pool(DarknetNetworkPtr ptr, int threads, const int * cpus, int cpus_count);
+
+/** This is the @p C equivalent to the @ref Darknet::predict_async() which takes a callback.  @p bgr points to 8-bit
+ * BGR (3 channels) or BGRA (4 channels) pixels stored one row after the other, such as a @p cv::Mat or a Python @p numpy
+ * array from OpenCV.  The pixels are copied before this function returns.
+ *
+ * @returns Zero when the image was queued.  Any other value means the image was not queued (such as invalid parameters)
+ * and the callback will not be called for it.
+ */
+int darknet_predict_async(DarknetNetworkPtr ptr, const unsigned char * bgr, int width, int height, int channels, DarknetPredictionCallback callback, void * user_data);
+
+/// This is the @p C equivalent to @ref Darknet::wait_async_predictions().
+void darknet_wait_async_predictions(DarknetNetworkPtr ptr);
+
 
 /* ******************************* */
 /* The "old" V2 C API starts here. */
@@ -295,6 +328,14 @@ void do_nms_obj(detection * dets, int total, int classes, float thresh);
 /// This is part of the original @p C API.  Non Maxima Suppression.
 void diounms_sort(detection * dets, int total, int classes, float thresh, NMS_KIND nms_kind, float beta1);
 
+/** Non Maxima Suppression which gives the same results as @ref do_nms_sort() (or @ref diounms_sort() when @p nms_kind
+ * is @p GREEDY_NMS or @p DIOU_NMS) but is much faster when there are many classes or many detections.  Instead of
+ * sorting all the detections once per class, the detections are grouped by class and each group is sorted once.  The
+ * overlap is then calculated 8 boxes at a time with AVX2.  Unlike the other NMS functions, the order of @p dets is
+ * not modified.
+ */
+void do_nms_fast(detection * dets, int total, int classes, float thresh, NMS_KIND nms_kind, float beta1);
+
 /// This is part of the original @p C API.  Convert from data pointer to a %Darknet image.  Used by the Python API.
 void copy_image_from_bytes(DarknetImage im, char *pdata);
 
@@ -16,6 +16,8 @@
 #include <atomic>
 #include <ciso646>
 #include <filesystem>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <map>
 #include <optional>
@@ -279,6 +281,20 @@ namespace Darknet
 	 */
 	void fix_out_of_bound_values(Darknet::NetworkPtr ptr, const bool toggle);
 
+	/** Letterbox images in @ref Darknet::predict() instead of stretching them to the network dimensions.  When set to
+	 * @p true, the image is resized to fit within the network while keeping the aspect ratio, the rest of the input is
+	 * padded with grey, and the bounding boxes are mapped back to the original image.  Networks trained with
+	 * @p letter_box=1 should use this.
+	 *
+	 * Default is the @p letter_box value from the @p [net] section of the .cfg file, or @p true if the @p letterbox
+	 * parameter was used.
+	 *
+	 * @see @ref Darknet::NetworkDetails::letterbox
+	 *
+	 * @since 2026-10-17
+	 */
+	void set_letterbox(Darknet::NetworkPtr ptr, const bool toggle);
+
 	/** Set the font characteristics to use when drawing the bounding boxes and labels in either @ref Darknet::annotate()
 	 * or @ref Darknet::predict_and_annotate().
 	 *
@@ -367,6 +383,24 @@ namespace Darknet
 	 */
 	void free_neural_network(Darknet::NetworkPtr & ptr);
 
+	/** Create a lightweight execution context for a neural network that is already loaded.  The context shares the weights
+	 * of @p ptr, and only allocates its own activations, workspace, and detection buffers (enough for @p batch_size
+	 * images).  It can be used anywhere a network pointer is expected, such as @ref Darknet::predict().
+	 *
+	 * A network pointer must only be used by one thread at a time, but several contexts of the same network may run at
+	 * the same time on different threads.  This costs the size of the activations per context, instead of loading the
+	 * weights again for every thread.
+	 *
+	 * The context starts with a copy of the settings of @p ptr (thresholds, class names, letterbox, ...) which can then be
+	 * changed independently.  Call @ref Darknet::free_neural_network() on each context before freeing @p ptr.
+	 *
+	 * Contexts are only supported when running on the CPU.  An exception is thrown if the network uses the GPU or contains
+	 * layers which cannot share their weights.
+	 *
+	 * @since 2026-10-17
+	 */
+	Darknet::NetworkPtr create_execution_context(const Darknet::NetworkPtr ptr, const int batch_size = 1);
+
 	/// Get the network dimensions (width, height, channels).  @since 2024-07-25
 	void network_dimensions(Darknet::NetworkPtr & ptr, int & w, int & h, int & c);
 
@@ -418,6 +452,52 @@ namespace Darknet
 	 */
 	Predictions predict(const Darknet::NetworkPtr ptr, Darknet::Image & img, cv::Size original_image_size = cv::Size(0, 0));
 
+	/** Get %Darknet to look at several images in a single batched forward pass and return the predictions for each one.
+	 * The images must be 8-bit BGR (or BGRA) and do not need to be the same size, so frames from different cameras can be
+	 * combined.  The results are in the same order as @p mats.
+	 *
+	 * The first call with a larger batch than before reallocates the layer buffers of the network.  After that, switching
+	 * between batches and single images does not allocate.
+	 *
+	 * @since 2026-10-17
+	 */
+	std::vector<Predictions> predict(const Darknet::NetworkPtr ptr, const std::vector<cv::Mat> & mats);
+
+	/** Get access to the network's preallocated input tensor.  This buffer is allocated once per network and is large
+	 * enough for @p width * @p height * @p channels floats in %Darknet's planar RGB format, normalized between @p 0.0 and
+	 * @p 1.0.  It remains valid until the network is freed.
+	 *
+	 * Fill it with @ref Darknet::prepare_input_tensor() (or your own preprocessing) and then call the
+	 * @ref Darknet::predict() overload which takes a @p float pointer.
+	 *
+	 * @since 2026-10-16
+	 */
+	float * get_input_tensor(const Darknet::NetworkPtr ptr);
+
+	/** Resize the BGR (or BGRA) image and convert it directly into the network's preallocated input tensor in a single
+	 * pass.  This replaces the separate resize, colour conversion, split and normalization steps, and does not allocate
+	 * any memory once the tensor and lookup table have been created by the first call.
+	 *
+	 * Resizing uses nearest neighbour, the same as @ref Darknet::predict() has always done.  If letterboxing has been
+	 * enabled with @ref Darknet::set_letterbox(), the image keeps its aspect ratio and the rest of the tensor is padded.
+	 *
+	 * @returns the pointer to the input tensor, same as @ref Darknet::get_input_tensor().
+	 *
+	 * @since 2026-10-16
+	 */
+	float * prepare_input_tensor(const Darknet::NetworkPtr ptr, const cv::Mat & mat);
+
+	/** Get %Darknet to look at an image which has already been converted to the network input format and return all
+	 * predictions.  @p input must contain @p width * @p height * @p channels floats in planar RGB format normalized between
+	 * @p 0.0 and @p 1.0, such as the buffer returned by @ref Darknet::prepare_input_tensor().
+	 *
+	 * @p original_image_size is used to scale the bounding boxes back to the image the tensor was created from.  When
+	 * @ref Darknet::set_letterbox() is enabled the tensor is assumed to have been letterboxed from an image of that size.
+	 *
+	 * @since 2026-10-16
+	 */
+	Predictions predict(const Darknet::NetworkPtr ptr, const float * input, const cv::Size original_image_size);
+
 	/** Get %Darknet to look at the given image and return all predictions.  The image must be in a format supported by
 	 * OpenCV, such as @p JPG or @p PNG.
 	 *
@@ -441,6 +521,109 @@ namespace Darknet
 	 */
 	Predictions predict_and_annotate(const Darknet::NetworkPtr ptr, cv::Mat mat);
 
+	/** Callback used by the asynchronous @ref Darknet::predict_async().  It is given the image and its predictions, and is
+	 * called from one of the worker threads, so it must be thread-safe and should return quickly.
+	 *
+	 * @since 2026-10-17
+	 */
+	using PredictionCallback = std::function<void(cv::Mat, Darknet::Predictions)>;
+
+	/** Callback used by @ref Darknet::predict_async() when an image does not get predictions, because it was dropped from
+	 * a full queue, the workers were stopped before it was processed, or the prediction failed.  It is given the image and
+	 * the reason, and may be called from a worker thread or from the thread which queued another image.
+	 *
+	 * @since 2026-10-17
+	 */
+	using PredictionErrorCallback = std::function<void(cv::Mat, std::exception_ptr)>;
+
+	/** Configure the worker pool used by @ref Darknet::predict_async().  Each worker runs its own execution context of the
+	 * network (see @ref Darknet::create_execution_context()), so the weights are shared.
+	 *
+	 * @param [in] workers The number of images processed at the same time.  Zero uses the number of CPU cores.
+	 * @param [in] queue_depth How many images may wait for a worker.  Zero uses twice the number of workers.  When the
+	 * queue is full, the @em oldest image is dropped to make room for the new one.
+	 *
+	 * Calling this is optional; the first call to @ref Darknet::predict_async() starts a pool with the default values.
+	 * The workers copy the network settings (thresholds, letterbox, ...) when they start, so call this again after
+	 * changing them.  Images still queued in the previous pool are dropped.
+	 *
+	 * @note When the network runs on the GPU, a single worker uses the network itself.  Do not call the synchronous
+	 * @ref Darknet::predict() on the same network while asynchronous predictions are pending.
+	 *
+	 * @since 2026-10-17
+	 */
+	void set_async_workers(Darknet::NetworkPtr ptr, const size_t workers = 0, const size_t queue_depth = 0);
+
+	/** Queue an image to be processed by a worker thread and return immediately.  The image is copied, so the caller may
+	 * reuse it right away (such as the next frame from @p cv::VideoCapture).
+	 *
+	 * If the image is dropped because the queue is full, the future holds a @p std::runtime_error exception.
+	 *
+	 * @see @ref Darknet::set_async_workers()
+	 * @see @ref Darknet::wait_async_predictions()
+	 *
+	 * @since 2026-10-17
+	 */
+	std::future<Predictions> predict_async(const Darknet::NetworkPtr ptr, const cv::Mat & mat);
+
+	/** Similar to the other @ref Darknet::predict_async(), but the predictions are given to @p callback instead of a
+	 * future.  Each image ends with exactly one call to either @p callback or @p error_callback.  When @p error_callback
+	 * is not set, images which are dropped or cannot be processed are silently forgotten.
+	 *
+	 * @since 2026-10-17
+	 */
+	void predict_async(const Darknet::NetworkPtr ptr, const cv::Mat & mat, Darknet::PredictionCallback callback, Darknet::PredictionErrorCallback error_callback = nullptr);
+
+	/// Block until all the images queued with @ref Darknet::predict_async() have been processed.  @since 2026-10-17
+	void wait_async_predictions(const Darknet::NetworkPtr ptr);
+
+	/// The threads used by the CPU inference kernels.  @see @ref Darknet::create_thread_pool()  @since 2026-10-17
+	class ThreadPool;
+	using ThreadPoolPtr = std::shared_ptr<ThreadPool>;
+
+	/** Create a pool of threads for the CPU inference kernels, to be given to one or more networks with
+	 * @ref Darknet::set_thread_pool().  The threads are started right away and wait for work.
+	 *
+	 * @param [in] threads The number of threads, including the one which calls @ref Darknet::predict().  Zero uses one
+	 * thread per CPU in @p cpus, or when @p cpus is empty the number of CPU cores (or @p --threads when it is used).
+	 * @param [in] cpus When not empty, the threads are pinned to these CPUs, and the thread which calls
+	 * @ref Darknet::predict() is pinned to the first one while the network runs.
+	 *
+	 * For example, to give each of 4 cameras a quarter of the cores:
+	 *
+	 * ~~~~{.cpp}
+	 * for (size_t idx = 0; idx < 4; idx ++)
+	 * {
+	 *     Darknet::set_thread_pool(contexts[idx], Darknet::create_thread_pool(0, Darknet::split_cpus(idx, 4)));
+	 * }
+	 * ~~~~
+	 *
+	 * @since 2026-10-17
+	 */
+	ThreadPoolPtr create_thread_pool(const size_t threads = 0, const Darknet::VInt & cpus = {});
+
+	/** Use @p pool for the CPU inference kernels of this network or execution context.  A pool can be shared by several
+	 * networks, in which case they take turns running their kernels on it.  Execution contexts start with the pool of the
+	 * network they were created from, and networks without a pool use a default pool with one thread per CPU core.
+	 * Passing @p nullptr goes back to the default pool.
+	 *
+	 * @see @ref Darknet::create_thread_pool()
+	 *
+	 * @since 2026-10-17
+	 */
+	void set_thread_pool(Darknet::NetworkPtr ptr, Darknet::ThreadPoolPtr pool);
+
+	/** Split the CPUs this process may use into @p count contiguous groups of (nearly) the same size, and return group
+	 * @p index.  Giving each camera (or each execution context) a different @p index and the same @p count splits the
+	 * cores between them the same way every time.
+	 *
+	 * @since 2026-10-17
+	 */
+	Darknet::VInt split_cpus(const size_t index, const size_t count);
+
+	/// The number of images @ref Darknet::predict_async() dropped because the queue was full.  @since 2026-10-17
+	size_t dropped_async_predictions(const Darknet::NetworkPtr ptr);
+
 	/** Get access to the vector of names read from the .names file when the configuration was loaded.
 	 *
 	 * @since 2024-08-06
@@ -539,6 +722,9 @@ namespace Darknet
 	 * single class at a time, call @ref add_skipped_class() which can be called repeatedly without overwriting previous
 	 * settings.
 	 *
+	 * Skipped classes are removed while the YOLO output is decoded, so they are never scored or seen by NMS.  An object
+	 * which has both a skipped and a non-skipped class is reported as the best non-skipped class.
+	 *
 	 * @see @ref Darknet::skipped_classes()
 	 * @see @ref Darknet::clear_skipped_classes()
 	 * @see @ref Darknet::add_skipped_class()
@@ -121,16 +121,23 @@ const Darknet::SArgsAndParms & Darknet::get_all_possible_arguments()
 	static const SArgsAndParms all =
 	{
 		ArgsAndParms("3d"			, ArgsAndParms::EType::kCommand	, "Pass in 2 images as input."),
+		ArgsAndParms("activationbench", ArgsAndParms::EType::kCommand	, "Compare the speed and accuracy of the CPU activation functions."),
 		ArgsAndParms("average"		, ArgsAndParms::EType::kCommand	, ""),
 		ArgsAndParms("calcanchors"	, ArgsAndParms::EType::kFunction, "Recalculate YOLO anchors."),
+		ArgsAndParms("calibrate"	, ArgsAndParms::EType::kCommand	, "Create the INT8 calibration table for a neural network from a directory of images, and compare the mAP% of INT8 and FP32."),
 		ArgsAndParms("cfglayers"	, ArgsAndParms::EType::kCommand, "Display some information on all config files and layers used."),
+		ArgsAndParms("convbench"	, ArgsAndParms::EType::kCommand	, "Compare the speed and accuracy of the CPU convolution algorithms on the layers of one or more .cfg files."),
 		ArgsAndParms("denormalize"	, ArgsAndParms::EType::kCommand	, ""),
 		ArgsAndParms("detect"		, ArgsAndParms::EType::kCommand	, ""),
 		ArgsAndParms("detector"		, ArgsAndParms::EType::kCommand	, "Train or check neural networks."),
+		ArgsAndParms("gemmbench"	, ArgsAndParms::EType::kCommand	, "Benchmark the CPU GEMM kernels using the convolution shapes of one or more .cfg files."),
 		ArgsAndParms("help"			, ArgsAndParms::EType::kCommand	, "Display usage information."),
 		ArgsAndParms("imtest"		, ArgsAndParms::EType::kCommand	, ""),
+		ArgsAndParms("layerbench"	, ArgsAndParms::EType::kCommand	, "Compare the speed of the CPU max pooling, upsampling, and shortcut layers of one or more .cfg files with the previous code."),
 		ArgsAndParms("map"			, ArgsAndParms::EType::kFunction, "Calculate mean average precision for a given dataset."),
+		ArgsAndParms("memplan"		, ArgsAndParms::EType::kCommand	, "Show how much memory the layer outputs of one or more .cfg files use with and without sharing them during CPU inference."),
 		ArgsAndParms("nightmare"	, ArgsAndParms::EType::kCommand	, "Run a neural network in reverse to generate strange images."),
+		ArgsAndParms("nmsbench"		, ArgsAndParms::EType::kCommand	, "Benchmark the non-maximal suppression engines on a synthetic crowded scene."),
 		ArgsAndParms("normalize"	, ArgsAndParms::EType::kCommand	, ""),
 		ArgsAndParms("oneoff"		, ArgsAndParms::EType::kCommand	, ""),
 		ArgsAndParms("ops"			, ArgsAndParms::EType::kCommand	, ""),
@@ -161,16 +168,26 @@ const Darknet::SArgsAndParms & Darknet::get_all_possible_arguments()
 		ArgsAndParms("dontshow"		, "noshow"							, "Do not open a GUI window.  Especially useful when used on a headless server.  This will cause the output image to be saved to disk."),
 		ArgsAndParms("clear"		, ArgsAndParms::EType::kParameter	, "Used during training to reset the \"image count\" to zero, necessary when pre-existing weights are used."),
 		ArgsAndParms("map"			, ArgsAndParms::EType::kParameter	, "Regularly calculate mAP% score while training."),
+		ArgsAndParms("autotune"		, ArgsAndParms::EType::kParameter	, "Time the CPU convolution algorithms on each layer when the network is loaded instead of using shape heuristics."),
+		ArgsAndParms("nchwc"		, ArgsAndParms::EType::kParameter	, "Use the blocked NCHWc activation layout for CPU inference instead of NCHW."),
+		ArgsAndParms("int8"			, ArgsAndParms::EType::kParameter	, "Run the convolutional layers with 8-bit integers on the CPU, using the calibration table created by the \"calibrate\" command."),
+		ArgsAndParms("fp16"			, ArgsAndParms::EType::kParameter	, "Store the convolutional weights as 16-bit half precision floats for CPU inference."),
+		ArgsAndParms("bf16"			, ArgsAndParms::EType::kParameter	, "Store the convolutional weights as 16-bit bfloat16 for CPU inference."),
+		ArgsAndParms("nofuse"		, ArgsAndParms::EType::kParameter	, "Do not fuse the bias, activation, and shortcut layers into the convolutions for CPU inference."),
+		ArgsAndParms("noplan"		, ArgsAndParms::EType::kParameter	, "Do not share the layer outputs or write the route inputs in place for CPU inference."),
+		ArgsAndParms("noschedule"	, ArgsAndParms::EType::kParameter	, "Do not run the small layers of independent branches at the same time for CPU inference."),
 
 		ArgsAndParms("camera"	, "c"			, 0		, "The camera (webcam) index, where numbering is typically sequential and begins with zero."),
 		ArgsAndParms("thresh"	, "threshold"	, 0.24f	),
 
+		ArgsAndParms("threads", "", 0, "The number of threads used by the CPU inference kernels.  The default is one per CPU core."),
+
 		ArgsAndParms("saveweights", "", 0, "How often the .weights are saved during training.  For example, this could be set to \"500\" to save the weights every 500 iteration."),
 
 		ArgsAndParms("avgframes"			), //-- takes an int  3
 		ArgsAndParms("benchmark"			),
 		ArgsAndParms("benchmarklayers"		),
-		ArgsAndParms("letterbox"			),
+		ArgsAndParms("letterbox"			, ArgsAndParms::EType::kParameter, "Letterbox images (keep the aspect ratio and pad) instead of stretching them to the network dimensions."),
 		ArgsAndParms("points"				), //-- takes an int?  0
 		ArgsAndParms("random"				, ArgsAndParms::EType::kParameter, "Randomize the list of images.  Default is to sort alphabetically."),
 		ArgsAndParms("show"					, ArgsAndParms::EType::kParameter, "Visually display the anchors."),
@@ -0,0 +1,352 @@
+/* Darknet/YOLO:  https://github.com/hank-ai/darknet
+ * Copyright 2026 Stephane Charette
+ */
+
+#include "darknet_internal.hpp"
+
+
+Darknet::AsyncPredictor::AsyncPredictor(Darknet::Network & net, size_t workers, size_t queue_depth) :
+	max_queue_depth(0),
+	busy(0),
+	stopping(false),
+	dropped_count(0)
+{
+	TAT(TATPARMS);
+
+	if (workers == 0)
+	{
+		workers = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	try
+	{
+		for (size_t idx = 0; idx < workers; idx ++)
+		{
+			contexts.push_back(make_network_context(net, 1));
+		}
+	}
+	catch (const std::exception &)
+	{
+		// typically because we're running on the GPU; a single worker can still use the network directly
+		for (auto ptr : contexts)
+		{
+			free_network_ptr(ptr);
+			free(ptr);
+		}
+		contexts.clear();
+		contexts.push_back(&net);
+	}
+
+	if (contexts.size() > 1)
+	{
+		// the workers run at the same time, so each one gets its own share of the threads of the network instead of all
+		// of them taking turns on the same threads
+		const auto & pool = Darknet::get_thread_pool(net);
+		const size_t threads = std::max(1, pool.size() / static_cast<int>(contexts.size()));
+		for (size_t idx = 0; idx < contexts.size(); idx ++)
+		{
+			const auto cpus = Darknet::split_cpus(pool.cpus(), idx, contexts.size());
+			Darknet::set_thread_pool(contexts[idx], Darknet::create_thread_pool(cpus.empty() ? threads : cpus.size(), cpus));
+		}
+	}
+
+	max_queue_depth = (queue_depth ? queue_depth : 2 * contexts.size());
+
+	for (auto ptr : contexts)
+	{
+		threads.emplace_back(&AsyncPredictor::run, this, ptr);
+	}
+
+	return;
+}
+
+
+Darknet::AsyncPredictor::~AsyncPredictor()
+{
+	TAT(TATPARMS);
+
+	std::deque<Request> abandoned;
+	if (true)
+	{
+		std::lock_guard lock(queue_mutex);
+		stopping = true;
+		abandoned.swap(queue);
+	}
+	work_available.notify_all();
+
+	const auto error = std::make_exception_ptr(std::runtime_error("the asynchronous predictor was stopped"));
+	for (auto & request : abandoned)
+	{
+		fail(request, error);
+	}
+
+	for (auto & thread : threads)
+	{
+		thread.join();
+	}
+
+	for (auto ptr : contexts)
+	{
+		Darknet::Network * net = reinterpret_cast<Darknet::Network *>(ptr);
+		if (net->details and net->details->model)
+		{
+			free_network_ptr(ptr);
+			free(ptr);
+		}
+	}
+
+	return;
+}
+
+
+std::future<Darknet::Predictions> Darknet::AsyncPredictor::submit(const cv::Mat & mat)
+{
+	TAT(TATPARMS);
+
+	Request request;
+	request.mat = mat.clone(); // the caller is free to reuse their image (e.g., cv::VideoCapture) as soon as we return
+	auto future = request.promise.get_future();
+
+	enqueue(std::move(request));
+
+	return future;
+}
+
+
+void Darknet::AsyncPredictor::submit(const cv::Mat & mat, Darknet::PredictionCallback callback, Darknet::PredictionErrorCallback error_callback)
+{
+	TAT(TATPARMS);
+
+	if (not callback)
+	{
+		throw std::invalid_argument("cannot queue an asynchronous prediction without a callback");
+	}
+
+	Request request;
+	request.mat = mat.clone();
+	request.callback = std::move(callback);
+	request.error_callback = std::move(error_callback);
+
+	enqueue(std::move(request));
+
+	return;
+}
+
+
+void Darknet::AsyncPredictor::wait()
+{
+	TAT(TATPARMS);
+
+	std::unique_lock lock(queue_mutex);
+	idle.wait(lock, [&]{ return queue.empty() and busy == 0; });
+
+	return;
+}
+
+
+void Darknet::AsyncPredictor::fail(Request & request, const std::exception_ptr & error)
+{
+	TAT(TATPARMS);
+
+	if (not request.callback)
+	{
+		request.promise.set_exception(error);
+	}
+	else if (request.error_callback)
+	{
+		try
+		{
+			request.error_callback(request.mat, error);
+		}
+		catch (const std::exception & e)
+		{
+			Darknet::display_warning_msg("asynchronous prediction error callback failed: " + std::string(e.what()) + "\n");
+		}
+	}
+
+	return;
+}
+
+
+void Darknet::AsyncPredictor::enqueue(Request && request)
+{
+	TAT(TATPARMS);
+
+	std::optional<Request> oldest;
+	if (true)
+	{
+		std::lock_guard lock(queue_mutex);
+		if (queue.size() >= max_queue_depth)
+		{
+			oldest = std::move(queue.front());
+			queue.pop_front();
+			dropped_count ++;
+		}
+		queue.push_back(std::move(request));
+	}
+	work_available.notify_one();
+
+	// the dropped request is completed outside of the lock since a future continuation could call back into us
+	if (oldest.has_value())
+	{
+		fail(*oldest, std::make_exception_ptr(std::runtime_error("the image was dropped because the prediction queue is full")));
+	}
+
+	return;
+}
+
+
+void Darknet::AsyncPredictor::run(Darknet::NetworkPtr ptr)
+{
+	TAT(TATPARMS);
+
+	while (true)
+	{
+		Request request;
+		if (true)
+		{
+			std::unique_lock lock(queue_mutex);
+			work_available.wait(lock, [&]{ return stopping or not queue.empty(); });
+			if (stopping)
+			{
+				break;
+			}
+			request = std::move(queue.front());
+			queue.pop_front();
+			busy ++;
+		}
+
+		Darknet::Predictions predictions;
+		std::exception_ptr error;
+		try
+		{
+			predictions = Darknet::predict(ptr, request.mat);
+		}
+		catch (const std::exception & e)
+		{
+			if (request.callback and not request.error_callback)
+			{
+				Darknet::display_warning_msg("asynchronous prediction failed: " + std::string(e.what()) + "\n");
+			}
+			error = std::current_exception();
+		}
+
+		if (error)
+		{
+			fail(request, error);
+		}
+		else if (not request.callback)
+		{
+			request.promise.set_value(std::move(predictions));
+		}
+		else
+		{
+			// the callback got its predictions, so an exception thrown by the callback itself is not reported to it again
+			try
+			{
+				request.callback(request.mat, predictions);
+			}
+			catch (const std::exception & e)
+			{
+				Darknet::display_warning_msg("asynchronous prediction callback failed: " + std::string(e.what()) + "\n");
+			}
+		}
+
+		if (true)
+		{
+			std::lock_guard lock(queue_mutex);
+			busy --;
+		}
+		idle.notify_all();
+	}
+
+	return;
+}
+
+
+namespace
+{
+	/// Protects @ref Darknet::NetworkDetails::async_predictor, which is created the first time it is needed.
+	std::mutex async_predictor_mutex;
+
+	std::shared_ptr<Darknet::AsyncPredictor> get_async_predictor(Darknet::NetworkPtr ptr, const bool create)
+	{
+		TAT(TATPARMS);
+
+		Darknet::Network * net = reinterpret_cast<Darknet::Network *>(ptr);
+		if (net == nullptr or net->details == nullptr)
+		{
+			throw std::invalid_argument("cannot use asynchronous predictions without a network pointer");
+		}
+
+		std::lock_guard lock(async_predictor_mutex);
+		if (create and not net->details->async_predictor)
+		{
+			net->details->async_predictor = std::make_shared<Darknet::AsyncPredictor>(*net, 0, 0);
+		}
+
+		return net->details->async_predictor;
+	}
+}
+
+
+void Darknet::set_async_workers(Darknet::NetworkPtr ptr, const size_t workers, const size_t queue_depth)
+{
+	TAT(TATPARMS);
+
+	Darknet::Network * net = reinterpret_cast<Darknet::Network *>(ptr);
+	if (net == nullptr or net->details == nullptr)
+	{
+		throw std::invalid_argument("cannot start asynchronous predictions without a network pointer");
+	}
+
+	std::lock_guard lock(async_predictor_mutex);
+
+	// stop the previous workers (if any) before starting new ones so we don't briefly have twice the contexts
+	net->details->async_predictor.reset();
+	net->details->async_predictor = std::make_shared<Darknet::AsyncPredictor>(*net, workers, queue_depth);
+
+	return;
+}
+
+
+std::future<Darknet::Predictions> Darknet::predict_async(const Darknet::NetworkPtr ptr, const cv::Mat & mat)
+{
+	TAT(TATPARMS);
+
+	return get_async_predictor(ptr, true)->submit(mat);
+}
+
+
+void Darknet::predict_async(const Darknet::NetworkPtr ptr, const cv::Mat & mat, Darknet::PredictionCallback callback, Darknet::PredictionErrorCallback error_callback)
+{
+	TAT(TATPARMS);
+
+	get_async_predictor(ptr, true)->submit(mat, std::move(callback), std::move(error_callback));
+
+	return;
+}
+
+
+void Darknet::wait_async_predictions(const Darknet::NetworkPtr ptr)
+{
+	TAT(TATPARMS);
+
+	auto predictor = get_async_predictor(ptr, false);
+	if (predictor)
+	{
+		predictor->wait();
+	}
+
+	return;
+}
+
+
+size_t Darknet::dropped_async_predictions(const Darknet::NetworkPtr ptr)
+{
+	TAT(TATPARMS);
+
+	auto predictor = get_async_predictor(ptr, false);
+
+	return predictor ? predictor->dropped() : 0;
+}
@@ -0,0 +1,75 @@
+/* Darknet/YOLO:  https://github.com/hank-ai/darknet
+ * Copyright 2026 Stephane Charette
+ */
+
+#pragma once
+
+#include "darknet.hpp"
+
+
+namespace Darknet
+{
+	/** Worker pool behind @ref Darknet::predict_async().  Each worker thread owns an execution context of the network
+	 * (see @ref Darknet::create_execution_context()) so the weights are only loaded once, and the images wait in a bounded
+	 * queue.  When the queue is full, the oldest image is dropped to make room for the new one, which is what a live
+	 * video stream wants when inference cannot keep up.
+	 *
+	 * If contexts are not supported (such as when running on the GPU) a single worker uses the network itself.
+	 *
+	 * This is owned by @ref Darknet::NetworkDetails and stopped before the network is freed.
+	 *
+	 * @since 2026-10-17
+	 */
+	class AsyncPredictor final
+	{
+		public:
+
+			/// A @p workers or @p queue_depth of zero means "pick something sensible".
+			AsyncPredictor(Darknet::Network & net, size_t workers, size_t queue_depth);
+
+			/// Stops the workers.  Images still in the queue are dropped, and their requests fail.
+			~AsyncPredictor();
+
+			/// Queue an image and get a future for the predictions.
+			std::future<Darknet::Predictions> submit(const cv::Mat & mat);
+
+			/** Queue an image, and call @p callback from a worker thread once the predictions are available, or
+			 * @p error_callback (when set) if the image is dropped or cannot be processed.
+			 */
+			void submit(const cv::Mat & mat, Darknet::PredictionCallback callback, Darknet::PredictionErrorCallback error_callback);
+
+			/// Block until the queue is empty and no worker is busy.
+			void wait();
+
+			/// Number of images dropped because the queue was full.
+			size_t dropped() const { return dropped_count; }
+
+		private:
+
+			struct Request
+			{
+				cv::Mat mat;
+				std::promise<Darknet::Predictions> promise;
+				Darknet::PredictionCallback callback;
+				Darknet::PredictionErrorCallback error_callback;
+			};
+
+			/// Complete a request which will not get predictions, either by setting the exception or with the error callback.
+			static void fail(Request & request, const std::exception_ptr & error);
+
+			void enqueue(Request && request);
+			void run(Darknet::NetworkPtr ptr);
+
+			std::vector<Darknet::NetworkPtr> contexts;
+			std::vector<std::thread> threads;
+
+			std::mutex queue_mutex;
+			std::condition_variable work_available;
+			std::condition_variable idle;
+			std::deque<Request> queue;
+			size_t max_queue_depth;
+			size_t busy;
+			bool stopping;
+			std::atomic<size_t> dropped_count;
+	};
+}
@@ -1275,6 +1275,7 @@ Darknet::CfgFile & Darknet::CfgFile::parse_net_section()
 		net.mixup = 3;
 	}
 	net.letter_box = s.find_int("letter_box", 0);
+	net.details->letterbox = (net.letter_box != 0);
 	net.mosaic_bound = s.find_int("mosaic_bound", 0);
 	net.contrastive = s.find_int("contrastive", 0);
 	net.contrastive_jit_flip = s.find_int("contrastive_jit_flip", 0);
@@ -408,11 +408,17 @@ Darknet::CfgAndState & Darknet::CfgAndState::process_arguments(const VStr & v, D
 	}
 #endif
 
+	if (net and args.count("letterbox"))
+	{
+		net->details->letterbox = true;
+	}
+
 	if (net and args.count("skipclasses"))
 	{
 		const ArgsAndParms & arg = get("skipclasses");
 
 		parse_skip_classes(net->details->classes_to_ignore, arg.str);
+		update_classes_to_decode(*net);
 	}
 
 #if 0 // for debug purposes, display all arguments
@@ -1,4 +1,9 @@
 #include "darknet_internal.hpp"
+#include "gemm.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 
 namespace
@@ -892,6 +897,165 @@ Darknet::Image Darknet::bgr_mat_to_rgb_image(const cv::Mat & mat)
 }
 
 
+namespace
+{
+	/** Nearest neighbour resize of the 8-bit BGR or BGRA @p mat into the @p inner_w x @p inner_h rectangle which starts at
+	 * (@p inner_x, @p inner_y) within the planar RGB @p dst tensor of size @p dst_w x @p dst_h.  Pixels outside of the
+	 * rectangle are not touched.  Used by both @ref Darknet::bgr_mat_to_rgb_tensor() and
+	 * @ref Darknet::bgr_mat_to_rgb_letterbox_tensor().
+	 */
+	static inline void bgr_mat_into_tensor_rect(const cv::Mat & mat, float * dst, const int dst_w, const int dst_h, const int inner_x, const int inner_y, const int inner_w, const int inner_h, std::vector<int> & x_offsets)
+	{
+		TAT(TATPARMS);
+
+		if (mat.empty() or mat.depth() != CV_8U or (mat.channels() != 3 and mat.channels() != 4))
+		{
+			throw std::invalid_argument("expected an 8-bit BGR or BGRA image");
+		}
+		if (dst == nullptr or dst_w < 1 or dst_h < 1 or inner_w < 1 or inner_h < 1)
+		{
+			throw std::invalid_argument("invalid destination tensor");
+		}
+
+		const int channels		= mat.channels();
+		const size_t plane_size	= static_cast<size_t>(dst_w) * dst_h;
+		float * const r_plane	= dst + plane_size * 0;
+		float * const g_plane	= dst + plane_size * 1;
+		float * const b_plane	= dst + plane_size * 2;
+		const float scale		= 1.0f / 255.0f;
+
+		// same source coordinates as cv::resize() with INTER_NEAREST
+		const double fx = static_cast<double>(mat.cols) / inner_w;
+		const double fy = static_cast<double>(mat.rows) / inner_h;
+
+		x_offsets.resize(inner_w);
+		for (int x = 0; x < inner_w; x ++)
+		{
+			x_offsets[x] = std::min(static_cast<int>(std::floor(x * fx)), mat.cols - 1) * channels;
+		}
+
+		// The vector path reads 4 bytes per pixel.  With 3-channel images this reads 1 byte past the last pixel, which is
+		// only a problem on the very last row of the image, so on that row we stop the vector loop early.
+		int last_row_vector_width = inner_w;
+		while (last_row_vector_width > 0 and x_offsets[last_row_vector_width - 1] + 4 > mat.cols * channels)
+		{
+			last_row_vector_width --;
+		}
+
+#if defined(__AVX2__)
+		static const bool use_avx2 = is_fma_avx2();
+		const __m256i byte_mask	= _mm256_set1_epi32(0xff);
+		const __m256 vscale		= _mm256_set1_ps(scale);
+#endif
+
+		for (int y = 0; y < inner_h; y ++)
+		{
+			const int src_y			= std::min(static_cast<int>(std::floor(y * fy)), mat.rows - 1);
+			const uint8_t * src		= mat.ptr<uint8_t>(src_y);
+			const size_t offset		= static_cast<size_t>(inner_y + y) * dst_w + inner_x;
+			float * r				= r_plane + offset;
+			float * g				= g_plane + offset;
+			float * b				= b_plane + offset;
+			int x					= 0;
+
+#if defined(__AVX2__)
+			if (use_avx2)
+			{
+				const int vector_width = (src_y == mat.rows - 1) ? last_row_vector_width : inner_w;
+				for (; x + 8 <= vector_width; x += 8)
+				{
+					// gather 8 pixels as 32-bit words:  B | G << 8 | R << 16 | (next byte or alpha) << 24
+					const __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(x_offsets.data() + x));
+					const __m256i px = _mm256_i32gather_epi32(reinterpret_cast<const int *>(src), idx, 1);
+
+					const __m256i bb = _mm256_and_si256(px, byte_mask);
+					const __m256i gg = _mm256_and_si256(_mm256_srli_epi32(px, 8), byte_mask);
+					const __m256i rr = _mm256_and_si256(_mm256_srli_epi32(px, 16), byte_mask);
+
+					_mm256_storeu_ps(r + x, _mm256_mul_ps(_mm256_cvtepi32_ps(rr), vscale));
+					_mm256_storeu_ps(g + x, _mm256_mul_ps(_mm256_cvtepi32_ps(gg), vscale));
+					_mm256_storeu_ps(b + x, _mm256_mul_ps(_mm256_cvtepi32_ps(bb), vscale));
+				}
+			}
+#endif
+
+			for (; x < inner_w; x ++)
+			{
+				const uint8_t * px = src + x_offsets[x];
+				b[x] = px[0] * scale;
+				g[x] = px[1] * scale;
+				r[x] = px[2] * scale;
+			}
+		}
+
+		return;
+	}
+}
+
+
+void Darknet::bgr_mat_to_rgb_tensor(const cv::Mat & mat, float * dst, const int dst_w, const int dst_h, std::vector<int> & x_offsets)
+{
+	TAT(TATPARMS);
+
+	bgr_mat_into_tensor_rect(mat, dst, dst_w, dst_h, 0, 0, dst_w, dst_h, x_offsets);
+
+	return;
+}
+
+
+cv::Rect Darknet::bgr_mat_to_rgb_letterbox_tensor(const cv::Mat & mat, float * dst, const int dst_w, const int dst_h, std::vector<int> & x_offsets)
+{
+	TAT(TATPARMS);
+
+	if (mat.empty())
+	{
+		throw std::invalid_argument("expected an 8-bit BGR or BGRA image");
+	}
+	if (dst == nullptr or dst_w < 1 or dst_h < 1)
+	{
+		throw std::invalid_argument("invalid destination tensor");
+	}
+
+	// same rules as letterbox_image_into() and correct_yolo_boxes() so the boxes map back to the right place
+	int new_w = mat.cols;
+	int new_h = mat.rows;
+	if (((float)dst_w / mat.cols) < ((float)dst_h / mat.rows))
+	{
+		new_w = dst_w;
+		new_h = (mat.rows * dst_w) / mat.cols;
+	}
+	else
+	{
+		new_h = dst_h;
+		new_w = (mat.cols * dst_h) / mat.rows;
+	}
+	new_w = std::max(1, std::min(new_w, dst_w));
+	new_h = std::max(1, std::min(new_h, dst_h));
+
+	const cv::Rect inner((dst_w - new_w) / 2, (dst_h - new_h) / 2, new_w, new_h);
+
+	// only the bars on each side need to be padded, the inner rectangle is completely overwritten
+	const float pad = 0.5f;
+	const size_t plane_size = static_cast<size_t>(dst_w) * dst_h;
+	for (int c = 0; c < 3; c ++)
+	{
+		float * plane = dst + plane_size * c;
+		std::fill(plane, plane + static_cast<size_t>(inner.y) * dst_w, pad);
+		for (int y = inner.y; y < inner.y + inner.height; y ++)
+		{
+			float * row = plane + static_cast<size_t>(y) * dst_w;
+			std::fill(row, row + inner.x, pad);
+			std::fill(row + inner.x + inner.width, row + dst_w, pad);
+		}
+		std::fill(plane + static_cast<size_t>(inner.y + inner.height) * dst_w, plane + plane_size, pad);
+	}
+
+	bgr_mat_into_tensor_rect(mat, dst, dst_w, dst_h, inner.x, inner.y, inner.width, inner.height, x_offsets);
+
+	return inner;
+}
+
+
 cv::Mat Darknet::image_to_mat(const Darknet::Image & img)
 {
 	TAT(TATPARMS);
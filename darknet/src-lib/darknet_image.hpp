@@ -82,6 +82,34 @@ namespace Darknet
 	 */
 	Darknet::Image bgr_mat_to_rgb_image(const cv::Mat & mat);
 
+	/** Fused version of @p cv::resize() (nearest neighbour), @ref bgr_mat_to_rgb_image(), and the normalization to
+	 * @p 0.0 - @p 1.0.  The 8-bit BGR or BGRA @p mat is resized to @p dst_w x @p dst_h and written in planar RGB format
+	 * directly into @p dst, which must have room for @p dst_w * @p dst_h * 3 floats.  The alpha channel is ignored.
+	 *
+	 * This is a single pass over the output with no intermediate images.  The only other memory used is
+	 * @p x_offsets, which the caller should keep and pass in again next time so steady-state calls never allocate.
+	 *
+	 * The pixels sampled are identical to @p cv::resize() with @p cv::INTER_NEAREST.
+	 *
+	 * @see @ref Darknet::predict()
+	 *
+	 * @since 2026-10-16
+	 */
+	void bgr_mat_to_rgb_tensor(const cv::Mat & mat, float * dst, const int dst_w, const int dst_h, std::vector<int> & x_offsets);
+
+	/** Letterbox version of @ref Darknet::bgr_mat_to_rgb_tensor().  The image is resized to fit within @p dst_w x @p dst_h
+	 * while keeping the aspect ratio, centered, and the remaining bars are padded with @p 0.5 (grey), the same layout as
+	 * @ref Darknet::letterbox_image_into().  Resizing and colour conversion are done in a single pass directly into
+	 * @p dst, but using nearest neighbour instead of bilinear.
+	 *
+	 * @returns the rectangle within the tensor which contains the image.
+	 *
+	 * @see @ref Darknet::set_letterbox()
+	 *
+	 * @since 2026-10-17
+	 */
+	cv::Rect bgr_mat_to_rgb_letterbox_tensor(const cv::Mat & mat, float * dst, const int dst_w, const int dst_h, std::vector<int> & x_offsets);
+
 	/** Convert the usual @ref Darknet::Image format to OpenCV @p cv::Mat.  The mat object will be in @p RGB format,
 	 * not @p BGR.
 	 *
@@ -73,7 +73,23 @@ namespace Darknet
 		int i;				///< The entry index into the W x H output array for the given YOLO layer.
 		int obj_index;		///< The index into the YOLO output array -- as obtained from @ref yolo_entry_index() -- which is used to get the objectness value.  E.g., a value of @p "l.output[obj_index] == 0.999f" would indicate that there is an object at this location.
 	};
-	using Output_Object_Cache = std::list<Output_Object>;
+	using Output_Object_Cache = std::vector<Output_Object>;
+
+	/** Reusable storage for the objects decoded from the YOLO output layers by @ref Darknet::predict().  Instead of
+	 * allocating a @ref Darknet::Detection and its @p prob array for every object, the detections are views into flat
+	 * arrays owned by the network.  The arrays only ever grow, so once they are large enough for a busy scene the
+	 * post-processing does not allocate anything.
+	 *
+	 * @see @ref make_network_boxes_arena()
+	 *
+	 * @since 2026-10-17
+	 */
+	struct DetectionArena
+	{
+		Output_Object_Cache objects;			///< Where the objects are located in the output of the YOLO layers.
+		std::vector<Darknet::Detection> dets;	///< One detection per object.  The @p prob pointers point into @ref prob.
+		std::vector<float> prob;				///< The class probabilities, @p classes floats per object.
+	};
 
 	class CfgLine;
 	class CfgSection;
@@ -323,10 +339,12 @@ void init_cpu();
  * location of all objects found so we don't have to look through the entire YOLO output again when creating the
  * boxes.
  */
-int yolo_num_detections_v3(Darknet::Network * net, const int index, const float thresh, Darknet::Output_Object_Cache & cache);
+int yolo_num_detections_v3(Darknet::Network * net, const int index, const float thresh, Darknet::Output_Object_Cache & cache, const int batch = 0);
 
-/// Convert everything we've detected into bounding boxes and confidence scores for each class.
-int get_yolo_detections_v3(Darknet::Network * net, int w, int h, int netw, int neth, float thresh, int *map, int relative, Darknet::Detection *dets, int letter, Darknet::Output_Object_Cache & cache);
+/** Convert everything we've detected into bounding boxes and confidence scores for each class.  When
+ * @p classes_to_decode is set, only those classes are scored, and objects which have none of them are not returned.
+ */
+int get_yolo_detections_v3(Darknet::Network * net, int w, int h, int netw, int neth, float thresh, int *map, int relative, Darknet::Detection *dets, int letter, Darknet::Output_Object_Cache & cache, const Darknet::VInt * classes_to_decode = nullptr);
 
 #include "darknet_args_and_parms.hpp"
 #include "darknet_cfg_and_state.hpp"
@@ -339,6 +357,8 @@ int get_yolo_detections_v3(Darknet::Network * net, int w, int h, int netw, int n
 #include "darknet_utils.hpp"
 #include "darknet_image.hpp"
 #include "darknet_network.hpp"
+#include "darknet_async.hpp"
+#include "darknet_thread_pool.hpp"
 #include "image_opencv.hpp"
 #include "Timing.hpp"
 #include "darknet_cfg.hpp"
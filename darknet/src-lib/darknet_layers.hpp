@@ -231,6 +231,60 @@ namespace Darknet
 		float *weights;
 		float *weight_updates;
 
+		/** Copy of @ref weights rearranged into the panels read by the CPU GEMM microkernel, created once the network
+		 * is loaded for inference.  See @ref pack_conv_weights().  This is @p nullptr while training.  When
+		 * @ref packed_weights_format is one of the 16-bit formats, each float holds 2 weights.
+		 *
+		 * @since 2026-10-17
+		 */
+		float *packed_weights;
+		int packed_weights_kernel; ///< The @ref Darknet::EGemmKernel used to create @ref packed_weights and @ref winograd_weights.
+		int packed_weights_format; ///< The @ref Darknet::EWeightFormat of @ref packed_weights and @ref winograd_weights.
+
+		/** Filters transformed for the Winograd F(4x4, 3x3) convolution and packed for the CPU GEMM microkernel.  When
+		 * set, this is used instead of @ref packed_weights.  See @ref winograd_transform_weights().
+		 *
+		 * @since 2026-10-17
+		 */
+		float *winograd_weights;
+
+		/** Number of channels per block when the CPU inference forward path of this layer uses the blocked NCHWc
+		 * layout, or zero for the usual NCHW layout.  See @ref nchwc_prepare_network().
+		 *
+		 * @since 2026-10-17
+		 */
+		int nchwc_block;
+		int nchwc_input;	///< Non-zero when the input of this layer is stored as NCHWc.
+		int nchwc_output;	///< Non-zero when @ref output is stored as NCHWc instead of NCHW.
+
+		/** Convolution weights rearranged into blocks of @ref nchwc_block filters, followed by the biases padded to a
+		 * multiple of the block size.  See @ref nchwc_prepare_network().
+		 *
+		 * @since 2026-10-17
+		 */
+		float *nchwc_weights;
+
+		/** Weights quantized to signed 8-bit integers (one scale per filter) and packed for the INT8 GEMM microkernel.
+		 * When set, the CPU inference forward path quantizes the input and uses the INT8 GEMM.  See
+		 * @ref int8_prepare_network().
+		 *
+		 * @since 2026-10-17
+		 */
+		int8_t *int8_weights;
+		int int8_kernel;			///< The @ref Darknet::EInt8Kernel used to create @ref int8_weights.
+		float int8_input_scale;		///< Value of one step of the quantized input, from the calibration table.
+		float *int8_scales;			///< Value of one step of the 32-bit sums for each filter:  the input scale times the weight scale.
+		int32_t *int8_offsets;		///< The @p 128 added to each quantized input times the sum of the quantized weights of each filter.
+
+		/** Non-zero when the CPU inference forward path of this convolutional layer adds the bias and applies the
+		 * activation while the GEMM writes the output, instead of in separate passes.  See @ref fuse_conv_epilogues().
+		 *
+		 * @since 2026-10-17
+		 */
+		int fused_activation;
+		int fused_shortcut;			///< Non-zero when the sum of the next @p [shortcut] layer is also done by this layer, which then writes to the output of that layer instead of @ref output.
+		int fused_into_previous;	///< Non-zero when this @p [shortcut] layer is done by the previous convolutional layer, so its forward pass does nothing.
+
 		float scale_x_y;
 		int objectness_smooth;
 		int new_coords;
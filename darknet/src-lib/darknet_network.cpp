@@ -1,3 +1,9 @@
+#include "gemm.hpp"
+#include "winograd.hpp"
+#include "nchwc.hpp"
+#include "quantize.hpp"
+#include "memory_plan.hpp"
+#include "layer_schedule.hpp"
 #include "darknet_internal.hpp"
 
 
@@ -15,6 +21,10 @@ Darknet::NetworkDetails::NetworkDetails()
 	non_maximal_suppression_threshold		= 0.45f;
 
 	fix_out_of_bound_normalized_coordinates	= true;
+	letterbox								= false;
+	allocated_batch							= 1;
+	model									= nullptr;
+	activation_arena						= nullptr;
 
 	cv_line_type							= cv::LineTypes::LINE_4;
 	cv_font_face							= cv::HersheyFonts::FONT_HERSHEY_PLAIN;
@@ -234,6 +244,15 @@ void forward_network(Darknet::Network & net, Darknet::NetworkState state)
 
 	state.workspace = net.workspace;
 
+	// the CPU kernels of this network run on the threads of its pool
+	Darknet::ThreadPoolScope scope(Darknet::get_thread_pool(net));
+
+	// the small layers of independent branches may run at the same time, see layer_schedule.cpp
+	if (run_layer_schedule(net, state))
+	{
+		return;
+	}
+
 	for (int i = 0; i < net.n; ++i)
 	{
 		state.index = i;
@@ -551,11 +570,11 @@ int recalculate_workspace_size(Darknet::Network * net)
 	else
 	{
 		free(net->workspace);
-		net->workspace = (float*)xcalloc(1, workspace_size);
+		net->workspace = (float*)xcalloc(1, std::max(workspace_size, sizeof(float)));
 	}
 #else
 	free(net->workspace);
-	net->workspace = (float*)xcalloc(1, workspace_size);
+	net->workspace = (float*)xcalloc(1, std::max(workspace_size, sizeof(float)));
 #endif
 
 	return 0;
@@ -592,6 +611,9 @@ int resize_network(Darknet::Network * net, int w, int h)
 {
 	TAT(TATPARMS);
 
+	// the layers reallocate their own outputs, so any shared outputs are split up and then planned again at the end
+	const bool planned = release_inference_memory(*net);
+
 #ifdef DARKNET_GPU
 	cuda_set_device(net->gpu_index);
 	if (cfg_and_state.gpu_index >= 0)
@@ -724,6 +746,11 @@ int resize_network(Darknet::Network * net, int w, int h)
 	}
 	*cfg_and_state.output << " begins at " << (void*)net->workspace << std::endl;
 
+	if (planned)
+	{
+		plan_inference_memory(*net);
+	}
+
 	return 0;
 }
 
@@ -1203,6 +1230,95 @@ void fill_network_boxes(Darknet::Network * net, int w, int h, float thresh, floa
 }
 
 
+Darknet::Detection * make_network_boxes_arena(Darknet::Network * net, int w, int h, float thresh, int relative, int * num, int letter, int batch)
+{
+	TAT(TATPARMS);
+
+	Darknet::DetectionArena & arena = net->details->detection_arena;
+	arena.objects.clear();
+
+	int nboxes = 0;
+	int classes = 0;
+	for (int i = 0; i < net->n; ++i)
+	{
+		const Darknet::Layer & l = net->layers[i];
+		if (l.type == Darknet::ELayerType::YOLO)
+		{
+			if (l.embedding_output)
+			{
+				return nullptr;
+			}
+			if (classes and classes != l.classes)
+			{
+				darknet_fatal_error(DARKNET_LOC, "Different [yolo] layers have different number of classes = %d and %d - check your cfg-file!", classes, l.classes);
+			}
+			classes = l.classes;
+			nboxes += yolo_num_detections_v3(net, i, thresh, arena.objects, batch);
+		}
+		else if (l.type == Darknet::ELayerType::GAUSSIAN_YOLO or l.type == Darknet::ELayerType::REGION)
+		{
+			// old output layers still need the detections created by get_network_boxes()
+			return nullptr;
+		}
+	}
+
+	// these only grow, so once a busy frame has been seen we no longer allocate anything
+	if (arena.dets.size() < static_cast<size_t>(nboxes))
+	{
+		arena.dets.resize(nboxes);
+	}
+	if (arena.prob.size() < static_cast<size_t>(nboxes) * classes)
+	{
+		arena.prob.resize(static_cast<size_t>(nboxes) * classes);
+	}
+
+	Darknet::Detection * dets = arena.dets.data();
+	for (int i = 0; i < nboxes; ++i)
+	{
+		dets[i] = Darknet::Detection();
+		dets[i].prob = arena.prob.data() + static_cast<size_t>(i) * classes;
+	}
+
+	// skipped classes are filtered out while decoding, so there may be fewer detections than objects
+	const Darknet::VInt * classes_to_decode = (net->details->classes_to_ignore.empty() ? nullptr : &net->details->classes_to_decode);
+	*num = get_yolo_detections_v3(net, w, h, net->w, net->h, thresh, nullptr, relative, dets, letter, arena.objects, classes_to_decode);
+
+	return dets;
+}
+
+
+void update_classes_to_decode(Darknet::Network & net)
+{
+	TAT(TATPARMS);
+
+	auto & details = *net.details;
+	details.classes_to_decode.clear();
+
+	if (not details.classes_to_ignore.empty())
+	{
+		// the number of classes comes from the output layers since the .names file may be missing or shorter
+		int classes = 0;
+		for (int i = 0; i < net.n; ++i)
+		{
+			if (net.layers[i].type == Darknet::ELayerType::YOLO)
+			{
+				classes = std::max(classes, net.layers[i].classes);
+			}
+		}
+		details.classes_to_decode.reserve(classes);
+		for (int idx = 0; idx < classes; idx ++)
+		{
+			if (details.classes_to_ignore.count(idx) == 0)
+			{
+				details.classes_to_decode.push_back(idx);
+			}
+		}
+	}
+
+	return;
+}
+
+
 static inline void fill_network_boxes_v3(Darknet::Network * net, int w, int h, float thresh, float hier, int *map, int relative, Darknet::Detection *dets, int letter, Darknet::Output_Object_Cache & cache)
 {
 	TAT(TATPARMS);
@@ -1573,10 +1689,194 @@ void free_network_ptr(DarknetNetworkPtr ptr)
 }
 
 
+Darknet::Network * make_network_context(const Darknet::Network & model, const int batch)
+{
+	TAT(TATPARMS);
+
+	if (model.gpu_index >= 0)
+	{
+		throw std::invalid_argument("execution contexts are only supported when running on the CPU");
+	}
+	if (model.details == nullptr or model.details->model != nullptr)
+	{
+		throw std::invalid_argument("execution contexts must be created from a neural network, not from another context");
+	}
+	if (batch < 1)
+	{
+		throw std::invalid_argument("execution contexts need a batch size of at least 1");
+	}
+
+	// only layers where inference touches nothing but the buffers below can safely share their weights
+	for (int i = 0; i < model.n; ++i)
+	{
+		const Darknet::Layer & l = model.layers[i];
+		switch (l.type)
+		{
+			case Darknet::ELayerType::CONVOLUTIONAL:
+			{
+				if (l.xnor or l.binary or l.antialiasing)
+				{
+					throw std::invalid_argument("execution contexts do not support binary or antialiased convolutional layers");
+				}
+				break;
+			}
+			case Darknet::ELayerType::CONNECTED:
+			case Darknet::ELayerType::MAXPOOL:
+			case Darknet::ELayerType::LOCAL_AVGPOOL:
+			case Darknet::ELayerType::AVGPOOL:
+			case Darknet::ELayerType::ROUTE:
+			case Darknet::ELayerType::SHORTCUT:
+			case Darknet::ELayerType::UPSAMPLE:
+			case Darknet::ELayerType::REORG:
+			case Darknet::ELayerType::SCALE_CHANNELS:
+			case Darknet::ELayerType::SAM:
+			case Darknet::ELayerType::YOLO:
+			case Darknet::ELayerType::GAUSSIAN_YOLO:
+			case Darknet::ELayerType::REGION:
+			case Darknet::ELayerType::DROPOUT:
+			{
+				break;
+			}
+			default:
+			{
+				throw std::invalid_argument("execution contexts do not support layer #" + std::to_string(i) + " (type #" + std::to_string((int)l.type) + ")");
+			}
+		}
+	}
+
+	Darknet::Network * net = (Darknet::Network*)xcalloc(1, sizeof(Darknet::Network));
+
+	// start with a shallow copy so the weights, biases, and all the configuration values are shared with the model
+	*net = model;
+	net->batch = batch;
+	net->input = nullptr;
+	net->truth = nullptr;
+	net->delta = nullptr;
+
+	net->details = new Darknet::NetworkDetails(*model.details);
+	net->details->input_tensor.clear();
+	net->details->input_x_offsets.clear();
+	net->details->allocated_batch = batch;
+	net->details->model = &model;
+	net->details->async_predictor.reset();
+	net->details->detection_arena = Darknet::DetectionArena();
+	net->details->activation_arena = nullptr;
+	net->details->layer_schedule.reset();
+
+	size_t workspace_size = 0;
+	net->layers = (Darknet::Layer*)xcalloc(net->n, sizeof(Darknet::Layer));
+	for (int i = 0; i < net->n; ++i)
+	{
+		Darknet::Layer & l = net->layers[i];
+		l = model.layers[i];
+		l.batch = batch;
+
+		if (l.workspace_size > workspace_size)
+		{
+			workspace_size = l.workspace_size;
+		}
+
+		if (l.type == Darknet::ELayerType::DROPOUT)
+		{
+			// dropout does nothing during inference and uses the output of the previous layer
+			l.output	= net->layers[i - 1].output;
+			l.delta		= net->layers[i - 1].delta;
+			continue;
+		}
+
+		const size_t size = static_cast<size_t>(l.outputs) * batch;
+		l.output = (float*)xcalloc(size, sizeof(float));
+		if (l.delta)			l.delta				= (float*)xcalloc(size, sizeof(float));
+		if (l.activation_input)	l.activation_input	= (float*)xcalloc(size, sizeof(float));
+		if (l.x)				l.x					= (float*)xcalloc(size, sizeof(float));
+		if (l.x_norm)			l.x_norm			= (float*)xcalloc(size, sizeof(float));
+		if (l.indexes)			l.indexes			= (int*)xcalloc(size, sizeof(int));
+
+		if (l.type == Darknet::ELayerType::SHORTCUT)
+		{
+			// the shortcut keeps a list of the outputs it adds, which must be those of this context and not the model
+			l.layers_output = (float**)xcalloc(l.n, sizeof(float*));
+		}
+	}
+
+	for (int i = 0; i < net->n; ++i)
+	{
+		Darknet::Layer & l = net->layers[i];
+		for (int j = 0; l.type == Darknet::ELayerType::SHORTCUT and j < l.n; ++j)
+		{
+			l.layers_output[j] = net->layers[l.input_layers[j]].output;
+		}
+	}
+
+	net->output = net->layers[net->n - 1].output;
+	net->workspace = (float*)xcalloc(1, std::max(workspace_size, sizeof(float)));
+
+	if (model.details->activation_arena)
+	{
+		plan_inference_memory(*net);
+	}
+
+	return net;
+}
+
+
+void free_network_context(Darknet::Network & net)
+{
+	TAT(TATPARMS);
+
+	free_inference_memory(net);
+
+	for (int i = 0; i < net.n; ++i)
+	{
+		Darknet::Layer & l = net.layers[i];
+		if (l.type == Darknet::ELayerType::DROPOUT)
+		{
+			continue;
+		}
+
+		if (l.type == Darknet::ELayerType::SHORTCUT)
+		{
+			free(l.layers_output);
+		}
+
+		free(l.output);
+		free(l.delta);
+		free(l.activation_input);
+		free(l.x);
+		free(l.x_norm);
+		free(l.indexes);
+	}
+	free(net.layers);
+	free(net.workspace);
+	net.layers = nullptr;
+	net.workspace = nullptr;
+
+	delete net.details;
+	net.details = nullptr;
+
+	return;
+}
+
+
 void free_network(Darknet::Network & net)
 {
 	TAT(TATPARMS);
 
+	if (net.details)
+	{
+		// the asynchronous workers may still be using this network
+		net.details->async_predictor.reset();
+	}
+
+	if (net.details and net.details->model)
+	{
+		// execution contexts only own their buffers, the weights belong to the model
+		free_network_context(net);
+		return;
+	}
+
+	free_inference_memory(net);
+
 	for (int i = 0; i < net.n; ++i)
 	{
 		free_layer(net.layers[i]);
@@ -1764,6 +2064,324 @@ void fuse_conv_batchnorm(Darknet::Network & net)
 }
 
 
+std::vector<Darknet::VInt> get_layer_inputs(const Darknet::Network & net)
+{
+	TAT(TATPARMS);
+
+	std::vector<Darknet::VInt> inputs(net.n);
+	for (int i = 0; i < net.n; i ++)
+	{
+		const Darknet::Layer & l = net.layers[i];
+		if (l.type != Darknet::ELayerType::ROUTE)
+		{
+			inputs[i].push_back(i - 1);
+		}
+		if (l.type == Darknet::ELayerType::ROUTE or l.type == Darknet::ELayerType::SHORTCUT)
+		{
+			inputs[i].insert(inputs[i].end(), l.input_layers, l.input_layers + l.n);
+		}
+		else if (l.type == Darknet::ELayerType::SAM or l.type == Darknet::ELayerType::SCALE_CHANNELS)
+		{
+			inputs[i].push_back(l.index);
+		}
+	}
+
+	return inputs;
+}
+
+
+bool layer_reads_only_its_inputs(const Darknet::Layer & l)
+{
+	TAT(TATPARMS);
+
+	switch (l.type)
+	{
+		case Darknet::ELayerType::CONVOLUTIONAL:
+		case Darknet::ELayerType::MAXPOOL:
+		{
+			// antialiasing runs a second layer on the output
+			return not l.antialiasing;
+		}
+		case Darknet::ELayerType::CONNECTED:
+		case Darknet::ELayerType::LOCAL_AVGPOOL:
+		case Darknet::ELayerType::AVGPOOL:
+		case Darknet::ELayerType::ROUTE:
+		case Darknet::ELayerType::SHORTCUT:
+		case Darknet::ELayerType::UPSAMPLE:
+		case Darknet::ELayerType::REORG:
+		case Darknet::ELayerType::SCALE_CHANNELS:
+		case Darknet::ELayerType::SAM:
+		case Darknet::ELayerType::YOLO:
+		case Darknet::ELayerType::GAUSSIAN_YOLO:
+		case Darknet::ELayerType::REGION:
+		{
+			return true;
+		}
+		default:
+		{
+			// dropout (for example) uses the output of the previous layer
+			return false;
+		}
+	}
+}
+
+
+int fuse_conv_epilogues(Darknet::Network & net)
+{
+	TAT(TATPARMS);
+
+	// number of layers which read the output of each layer
+	const auto inputs = get_layer_inputs(net);
+	Darknet::VInt readers(net.n, 0);
+	for (const auto & v : inputs)
+	{
+		for (const int p : v)
+		{
+			if (p >= 0)
+			{
+				readers[p] ++;
+			}
+		}
+	}
+
+	for (int j = 0; j < net.n; ++j)
+	{
+		Darknet::Layer & l = net.layers[j];
+		l.fused_activation		= 0;
+		l.fused_shortcut		= 0;
+		l.fused_into_previous	= 0;
+	}
+
+	int activations = 0;
+	int shortcuts = 0;
+	for (int j = 0; j < net.n; ++j)
+	{
+		Darknet::Layer & l = net.layers[j];
+		if (l.type != Darknet::ELayerType::CONVOLUTIONAL	or
+			(l.packed_weights == nullptr and l.winograd_weights == nullptr) or
+			l.int8_weights		or	// see int8_prepare_network()
+			l.nchwc_weights		or	// see nchwc_prepare_network()
+			l.batch_normalize	or	// see fuse_conv_batchnorm()
+			l.xnor				or
+			l.binary			or
+			not gemm_epilogue_supports(l.activation))
+		{
+			continue;
+		}
+
+		l.fused_activation = 1;
+		activations ++;
+
+		if (j + 1 >= net.n)
+		{
+			continue;
+		}
+
+		// The shortcut must add exactly one other layer to this one, element by element, and nothing else may read the
+		// output of this layer since it is never written.  Antialiasing blurs the output after the activation.
+		Darknet::Layer & shortcut = net.layers[j + 1];
+		if (shortcut.type == Darknet::ELayerType::SHORTCUT	and
+			shortcut.n == 1						and
+			shortcut.nweights == 0				and
+			shortcut.nchwc_block == 0			and
+			shortcut.input_layers[0] != j		and
+			shortcut.input_sizes[0] == shortcut.outputs	and
+			shortcut.outputs == l.outputs		and
+			shortcut.batch == l.batch			and
+			readers[j] == 1						and
+			not l.antialiasing					and
+			gemm_epilogue_supports(shortcut.activation))
+		{
+			l.fused_shortcut = 1;
+			shortcut.fused_into_previous = 1;
+			shortcuts ++;
+		}
+	}
+
+	if (cfg_and_state.is_verbose and activations)
+	{
+		*cfg_and_state.output
+			<< "Fused the bias and activation into " << activations << " convolutional layer" << (activations == 1 ? "" : "s") << ","
+			<< " and " << shortcuts << " shortcut layer" << (shortcuts == 1 ? "" : "s") << " into the previous convolution." << std::endl;
+	}
+
+	return shortcuts;
+}
+
+
+void pack_conv_weights(Darknet::Network & net)
+{
+	TAT(TATPARMS);
+
+	if (cfg_and_state.gpu_index >= 0)
+	{
+		// the GPU uses cuDNN or its own GEMM, not the CPU microkernels
+		return;
+	}
+
+	const bool autotune = cfg_and_state.is_set("autotune");
+
+	int packed_layers = 0;
+	int winograd_layers = 0;
+	for (int j = 0; j < net.n; ++j)
+	{
+		Darknet::Layer & l = net.layers[j];
+		if (l.type != Darknet::ELayerType::CONVOLUTIONAL)
+		{
+			continue;
+		}
+
+		pack_convolutional_weights(l);
+
+		if (l.packed_weights and (autotune ? winograd_is_supported(l) : winograd_is_preferred(l)))
+		{
+			winograd_transform_weights(l);
+
+			if (autotune)
+			{
+				// Winograd is compared with the implicit GEMM since that is what the other 3x3 layers use
+				const auto result = compare_convolution_algorithms(l, 3);
+				const bool use_winograd = result.winograd_error <= winograd_max_error and result.winograd_milliseconds < result.implicit_milliseconds;
+
+				if (cfg_and_state.is_verbose)
+				{
+					*cfg_and_state.output
+						<< "Autotune layer #" << j << ":"
+						<< " implicit GEMM=" << result.implicit_milliseconds << " ms,"
+						<< " Winograd=" << result.winograd_milliseconds << " ms,"
+						<< " error=" << result.winograd_error
+						<< " -> " << (use_winograd ? "Winograd" : "implicit GEMM") << std::endl;
+				}
+
+				if (not use_winograd)
+				{
+					free(l.winograd_weights);
+					l.winograd_weights = nullptr;
+				}
+			}
+		}
+
+		if (l.winograd_weights)
+		{
+			// the im2col weights are no longer needed
+			free(l.packed_weights);
+			l.packed_weights = nullptr;
+			winograd_layers ++;
+		}
+		else if (l.packed_weights)
+		{
+			packed_layers ++;
+		}
+	}
+
+	if (cfg_and_state.is_verbose and (packed_layers or winograd_layers))
+	{
+		*cfg_and_state.output
+			<< "Packed the weights for the " << gemm_packed_kernel_name(gemm_packed_kernel()) << " GEMM kernel:"
+			<< " " << packed_layers << " GEMM layer" << (packed_layers == 1 ? "" : "s") << ","
+			<< " " << winograd_layers << " Winograd layer" << (winograd_layers == 1 ? "" : "s") << "." << std::endl;
+	}
+
+	if (cfg_and_state.is_set("int8"))
+	{
+		// the calibration table is created by the "calibrate" command next to the .weights file
+		std::filesystem::path table = net.details->weights_path;
+		table.replace_extension(".int8");
+		if (std::filesystem::exists(table))
+		{
+			int8_prepare_network(net, int8_load_calibration(table, net));
+		}
+		else
+		{
+			Darknet::display_warning_msg("cannot use INT8 since the calibration table \"" + table.string() + "\" does not exist (see the \"calibrate\" command)\n");
+		}
+	}
+
+	if (cfg_and_state.is_set("nchwc"))
+	{
+		nchwc_prepare_network(net);
+	}
+
+	if (cfg_and_state.is_set("fp16") or cfg_and_state.is_set("bf16"))
+	{
+		const auto format = cfg_and_state.is_set("bf16") ? Darknet::EWeightFormat::BF16 : Darknet::EWeightFormat::FP16;
+
+		// The forward path of the layers with 16-bit packed weights never reads the single precision weights, so they
+		// are released.  Shared weights (see "share_index") are kept since the same array belongs to several layers.
+		bool shared = false;
+		for (int j = 0; j < net.n; ++j)
+		{
+			shared = shared or (net.layers[j].share_layer != nullptr);
+		}
+
+		size_t released = 0;
+		size_t remaining = 0;
+		for (int j = 0; j < net.n and not shared; ++j)
+		{
+			Darknet::Layer & l = net.layers[j];
+			if (l.type != Darknet::ELayerType::CONVOLUTIONAL or l.weights == nullptr)
+			{
+				continue;
+			}
+
+			if (l.packed_weights or l.winograd_weights)
+			{
+				free(l.weights);
+				l.weights = nullptr;
+				released += l.nweights * sizeof(float);
+			}
+			else
+			{
+				remaining += l.nweights * sizeof(float);
+			}
+		}
+
+		if (cfg_and_state.is_verbose)
+		{
+			*cfg_and_state.output
+				<< "Stored the packed weights as " << gemm_weight_format_name(format) << ":"
+				<< " released " << size_to_IEC_string(released) << " of single precision weights,"
+				<< " " << size_to_IEC_string(remaining) << " remain in other layers." << std::endl;
+		}
+	}
+
+	if (not cfg_and_state.is_set("nofuse"))
+	{
+		fuse_conv_epilogues(net);
+	}
+
+	// the packed layers no longer use im2col, so most (if not all) of the workspace can be released
+	size_t old_workspace_size = 0;
+	for (int j = 0; j < net.n; ++j)
+	{
+		old_workspace_size = std::max(old_workspace_size, net.layers[j].workspace_size);
+	}
+	recalculate_workspace_size(&net);
+	if (cfg_and_state.is_verbose)
+	{
+		size_t new_workspace_size = 0;
+		for (int j = 0; j < net.n; ++j)
+		{
+			new_workspace_size = std::max(new_workspace_size, net.layers[j].workspace_size);
+		}
+		*cfg_and_state.output << "Workspace reduced from " << size_to_IEC_string(old_workspace_size) << " to " << size_to_IEC_string(new_workspace_size) << "." << std::endl;
+	}
+
+	if (not cfg_and_state.is_set("noplan"))
+	{
+		// done last since the fused shortcuts decide which outputs are written
+		const auto memory = plan_inference_memory(net);
+		if (cfg_and_state.is_verbose)
+		{
+			*cfg_and_state.output
+				<< "Layer outputs reduced from " << size_to_IEC_string(memory.unplanned_bytes) << " to " << size_to_IEC_string(memory.planned_bytes) << ","
+				<< " " << memory.zero_copy_routes << " route layer" << (memory.zero_copy_routes == 1 ? "" : "s") << " no longer copy." << std::endl;
+		}
+	}
+
+	return;
+}
+
 void forward_blank_layer(Darknet::Layer & l, Darknet::NetworkState state)
 {
 	TAT(TATPARMS);
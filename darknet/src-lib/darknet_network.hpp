@@ -9,6 +9,9 @@
 
 namespace Darknet
 {
+	class AsyncPredictor;
+	struct LayerSchedule;
+
 	/** A place to store other details related to the neural network which we cannot easily add to the usual
 	 * @ref Darknet::Network structure.  These are typically C++ objects, or things added post %Darknet V3 (2024-08).
 	 *
@@ -71,6 +74,13 @@ namespace Darknet
 			 */
 			bool fix_out_of_bound_normalized_coordinates;
 
+			/** Letterbox the images given to @ref Darknet::predict() instead of stretching them to the network dimensions.
+			 * Default is the @p letter_box value from the @p [net] section of the .cfg file.
+			 * @see @ref Darknet::set_letterbox()
+			 * @since 2026-10-17
+			 */
+			bool letterbox;
+
 			/** The OpenCV line type to use when drawing lines such as bounding boxes.  Possible values include
 			 * @p cv::LineTypes::LINE_4, @p cv::LineTypes::LINE_8, and @p cv::LineTypes::CV_LINE_AA.  @p LINE_4 is the fastest
 			 * but lowest quality, while @p LINE_AA (anti-alias) is the slowest with highest quality.
@@ -139,6 +149,71 @@ namespace Darknet
 			 * @since 2024-10-07
 			 */
 			SInt classes_to_ignore;
+
+			/** The classes which are @em not in @ref classes_to_ignore, in ascending order.  This is what the YOLO output
+			 * is decoded with, so skipped classes are never scored, never turned into detections, and never seen by NMS.
+			 * Only used when @ref classes_to_ignore is not empty.
+			 *
+			 * @see @ref update_classes_to_decode()
+			 *
+			 * @since 2026-10-17
+			 */
+			VInt classes_to_decode;
+
+			/** Preallocated input tensor used by @ref Darknet::predict() when given a @p cv::Mat.  Sized once to
+			 * @p w * @p h * @p c floats (planar RGB, normalized to @p 0.0 - @p 1.0) and then reused for every frame.
+			 * @see @ref Darknet::get_input_tensor()
+			 * @since 2026-10-16
+			 */
+			std::vector<float> input_tensor;
+
+			/** Column lookup table reused by @ref Darknet::bgr_mat_to_rgb_tensor() so steady-state preprocessing does not
+			 * allocate.
+			 * @since 2026-10-16
+			 */
+			std::vector<int> input_x_offsets;
+
+			/** The largest batch size for which the layer buffers have been allocated.  Networks are loaded with a batch
+			 * size of @p 1, and this grows the first time @ref Darknet::predict() is given a larger set of images.
+			 * @since 2026-10-17
+			 */
+			int allocated_batch;
+
+			/** When set, this network is an execution context created by @ref Darknet::create_execution_context().  It owns
+			 * the activations, workspace and detection buffers, but the weights belong to this other network.
+			 * @since 2026-10-17
+			 */
+			const Network * model;
+
+			/** The worker pool used by @ref Darknet::predict_async().  Created the first time it is needed, and stopped
+			 * before the network is freed.
+			 * @since 2026-10-17
+			 */
+			std::shared_ptr<AsyncPredictor> async_predictor;
+
+			/** Reused by @ref Darknet::predict() to decode the YOLO output without allocating.
+			 * @since 2026-10-17
+			 */
+			DetectionArena detection_arena;
+
+			/** The single buffer which holds the output of every layer once @ref plan_inference_memory() has been called,
+			 * or @p nullptr when each layer has its own output.
+			 * @since 2026-10-17
+			 */
+			float * activation_arena;
+
+			/** The threads used by the CPU inference kernels of this network, or @p nullptr to use the default pool.
+			 * @see @ref Darknet::set_thread_pool()
+			 * @since 2026-10-17
+			 */
+			std::shared_ptr<ThreadPool> thread_pool;
+
+			/** The order in which CPU inference runs the layers, including which of them run at the same time.  Built the
+			 * first time it is needed, and again when the layers are moved or resized.
+			 * @see @ref run_layer_schedule()
+			 * @since 2026-10-17
+			 */
+			std::shared_ptr<LayerSchedule> layer_schedule;
 	};
 
 
@@ -321,6 +396,17 @@ Darknet::Network make_network(int n);
  */
 void free_network(Darknet::Network & net);
 
+/** Create an execution context which shares the weights of @p model but has its own activations, workspace, and
+ * detection buffers, allocated for up to @p batch images.  Several contexts can run @ref forward_network() at the same
+ * time on different threads.  Only supported on the CPU.
+ *
+ * @see @ref Darknet::create_execution_context()
+ */
+Darknet::Network * make_network_context(const Darknet::Network & model, const int batch);
+
+/// Free the buffers owned by an execution context.  This is called by @ref free_network() when needed.
+void free_network_context(Darknet::Network & net);
+
 float get_current_seq_subdivisions(const Darknet::Network & net);
 int get_sequence_value(const Darknet::Network & net);
 
@@ -349,6 +435,7 @@ Darknet::Image get_network_image_layer(Darknet::Network & net, int i);
 void visualize_network(Darknet::Network & net);
 int resize_network(Darknet::Network * net, int w, int h);
 void set_batch_network(Darknet::Network * net, int b);
+int recalculate_workspace_size(Darknet::Network * net);
 int get_network_input_size(Darknet::Network & net);
 
 float get_network_cost(const Darknet::Network & net);
@@ -363,9 +450,91 @@ void reject_similar_weights(Darknet::Network & net, float sim_threshold);
 
 float *network_predict(Darknet::Network & net, float *input);
 det_num_pair* network_predict_batch(Darknet::Network *net, Darknet::Image im, int batch_size, int w, int h, float thresh, float hier, int *map, int relative, int letter);
+Darknet::Detection * make_network_boxes_batch(Darknet::Network * net, float thresh, int *num, int batch);
+
+/** Decode and fill in the detections for image @p batch of the last forward pass using the network's reusable
+ * @ref Darknet::DetectionArena.  The detections belong to the network and remain valid until the next call, so they
+ * must @em not be given to @ref free_detections().
+ *
+ * @returns @p nullptr if the network has output layers which the arena does not support (such as @p [region] or
+ * @p [Gaussian_yolo]), in which case @ref get_network_boxes() must be used instead.
+ *
+ * @since 2026-10-17
+ */
+Darknet::Detection * make_network_boxes_arena(Darknet::Network * net, int w, int h, float thresh, int relative, int * num, int letter, int batch);
+void fill_network_boxes_batch(Darknet::Network * net, int w, int h, float thresh, float hier, int *map, int relative, Darknet::Detection *dets, int letter, int batch);
+
+/** Rebuild @ref Darknet::NetworkDetails::classes_to_decode.  This must be called every time
+ * @ref Darknet::NetworkDetails::classes_to_ignore is modified.
+ *
+ * @since 2026-10-17
+ */
+void update_classes_to_decode(Darknet::Network & net);
 void free_batch_detections(det_num_pair *det_num_pairs, int n);
 void fuse_conv_batchnorm(Darknet::Network & net);
 
+/** The layers whose output is read by each layer of @p net, where @p -1 is the network input.  This is the previous
+ * layer (except for routes), the @p input_layers of the route and shortcut layers, and the @p index of the SAM and
+ * scale_channels layers.
+ *
+ * @since 2026-10-17
+ */
+std::vector<Darknet::VInt> get_layer_inputs(const Darknet::Network & net);
+
+/** Whether @p l is one of the layer types which write every value of their output, and read nothing other than the
+ * outputs listed by @ref get_layer_inputs().  The layer outputs are only shared (see @ref plan_inference_memory()) and
+ * the layers only run out of order (see @ref run_layer_schedule()) when the network is made entirely of these layers.
+ *
+ * @since 2026-10-17
+ */
+bool layer_reads_only_its_inputs(const Darknet::Layer & l);
+
+/** Let the CPU inference forward path of the convolutional layers which use the packed GEMM or Winograd weights add
+ * the bias and apply the activation while the output is written, instead of making separate passes over the output.
+ * See @ref Darknet::GemmEpilogue.
+ *
+ * When such a layer is followed by a @p [shortcut] which adds one other layer without weights, and nothing else reads
+ * the output of the convolution, the sum and the activation of the shortcut are done in the same epilogue:  the
+ * convolution writes straight into the output of the shortcut, and the forward pass of the shortcut does nothing.
+ *
+ * This is called by @ref pack_conv_weights() unless @p --nofuse is used.
+ *
+ * @returns the number of fused shortcut layers
+ *
+ * @since 2026-10-17
+ */
+int fuse_conv_epilogues(Darknet::Network & net);
+
+/** Rearrange the weights of every convolutional layer into the panels read by the CPU GEMM microkernel.  This must be
+ * called after @ref fuse_conv_batchnorm() since the packed copy is not updated when the original weights change.
+ * Only used for inference, and does nothing when running on the GPU.
+ *
+ * This is also where 3x3 stride 1 layers are switched to the Winograd convolution, either using the shape heuristic in
+ * @ref winograd_is_preferred() or, when @p --autotune is used, by timing both algorithms on each layer and rejecting
+ * Winograd when its output is too far from the im2col output.
+ *
+ * When @p --int8 is used, the layers listed in the calibration table (the .weights filename with a .int8 extension) are
+ * quantized by @ref int8_prepare_network().
+ *
+ * When @p --nchwc is used, @ref nchwc_prepare_network() then switches the layers which can use it to the blocked NCHWc
+ * layout.
+ *
+ * When @p --fp16 or @p --bf16 is used, the packed and Winograd weights are stored as 16-bit values, and the single
+ * precision weights of those layers are released since the forward pass no longer reads them.  The network can then
+ * only be used for CPU inference.
+ *
+ * Unless @p --nofuse is used, @ref fuse_conv_epilogues() then moves the bias, the activation, and the following
+ * shortcut layers into the output of the packed layers.
+ *
+ * Since the packed layers use the implicit GEMM (or Winograd) instead of @p im2col_cpu_ext(), the workspace is then
+ * shrunk to what the remaining layers need.
+ *
+ * Unless @p --noplan is used, @ref plan_inference_memory() finally moves the layer outputs into a single shared buffer.
+ *
+ * @since 2026-10-17
+ */
+void pack_conv_weights(Darknet::Network & net);
+
 float validate_detector_map(const char * datacfg, const char * cfgfile, const char * weightfile, float thresh_calc_avg_iou, const float iou_thresh, const int map_points, int letter_box, Darknet::Network *existing_net);
 void train_detector(const char *datacfg, const char *cfgfile, const char *weightfile, int *gpus, int ngpus, int clear, int dont_show, int calc_map, float thresh, float iou_thresh, int show_imgs, int benchmark_layers, const char* chart_path);
 void test_detector(const char *datacfg, const char *cfgfile, const char *weightfile, const char *filename, float thresh, float hier_thresh, int dont_show, int ext_output, int save_labels, const char *outfile, int letter_box, int benchmark_layers);
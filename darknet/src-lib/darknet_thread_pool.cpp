@@ -0,0 +1,488 @@
+/* Darknet/YOLO:  https://github.com/hank-ai/darknet
+ * Copyright 2026 Stephane Charette
+ */
+
+#include "darknet_internal.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+
+namespace
+{
+	static auto & cfg_and_state = Darknet::CfgAndState::get();
+
+	/// The pool used by @ref Darknet::parallel_for() on this thread, see @ref Darknet::ThreadPoolScope.
+	thread_local Darknet::ThreadPool * current_pool = nullptr;
+
+	/// Set while this thread runs a task, so nested loops stay on this thread.
+	thread_local bool in_task = false;
+
+	/** How long an idle thread keeps checking for more work before it sleeps.  The layers of a network are only a few
+	 * microseconds apart, so the threads don't sleep while an image is processed, but they stop using the CPU soon after.
+	 */
+	const auto spin_duration = std::chrono::microseconds(200);
+
+
+	/// Give @p variable a value for the lifetime of this object, and put back the previous one even if an exception is thrown.
+	template <typename T>
+	class ScopedValue final
+	{
+		public:
+
+			ScopedValue(T & variable, const T value) :
+				variable(variable),
+				previous(variable)
+			{
+				variable = value;
+			}
+
+			~ScopedValue()
+			{
+				variable = previous;
+			}
+
+		private:
+
+			T & variable;
+			const T previous;
+	};
+
+
+	inline void spin_pause()
+	{
+		// no TAT() here since this is called in a tight loop
+
+#if defined(__x86_64__) || defined(_M_X64)
+		_mm_pause();
+#else
+		std::this_thread::yield();
+#endif
+	}
+
+
+	/// The CPUs this thread is allowed to run on, or an empty list when this is not known.
+	Darknet::VInt get_affinity()
+	{
+		TAT(TATPARMS);
+
+		Darknet::VInt cpus;
+
+#ifdef __linux__
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+		{
+			for (int cpu = 0; cpu < CPU_SETSIZE; cpu ++)
+			{
+				if (CPU_ISSET(cpu, &set))
+				{
+					cpus.push_back(cpu);
+				}
+			}
+		}
+#endif
+
+		return cpus;
+	}
+
+
+	/// Restrict this thread to @p cpus.  Does nothing on platforms where this is not supported.
+	void set_affinity(const Darknet::VInt & cpus)
+	{
+		TAT(TATPARMS);
+
+#ifdef __linux__
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (const int cpu : cpus)
+		{
+			if (cpu >= 0 and cpu < CPU_SETSIZE)
+			{
+				CPU_SET(cpu, &set);
+			}
+		}
+
+		if (CPU_COUNT(&set) > 0 and pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0 and cfg_and_state.is_verbose)
+		{
+			*cfg_and_state.output << "Failed to pin a thread to CPU #" << cpus[0] << "." << std::endl;
+		}
+#endif
+
+		return;
+	}
+
+
+	int default_thread_count()
+	{
+		TAT(TATPARMS);
+
+		const int threads = cfg_and_state.get("threads", 0);
+		if (threads > 0)
+		{
+			return threads;
+		}
+
+#ifdef DARKNET_OPENMP
+		return omp_get_max_threads();
+#else
+		return std::max(1u, std::thread::hardware_concurrency());
+#endif
+	}
+}
+
+
+Darknet::ThreadPool::ThreadPool(size_t threads, const VInt & cpus) :
+	cpu_list(cpus),
+	current_task(nullptr),
+	generation(0),
+	busy(0),
+	stopping(false),
+	failed(false)
+{
+	TAT(TATPARMS);
+
+	if (threads == 0)
+	{
+		threads = cpus.empty() ? default_thread_count() : cpus.size();
+	}
+
+	ranges.reset(new Range[threads]);
+	for (size_t idx = 1; idx < threads; idx ++)
+	{
+		workers.emplace_back(&ThreadPool::run, this, static_cast<int>(idx));
+	}
+
+	return;
+}
+
+
+Darknet::ThreadPool::~ThreadPool()
+{
+	TAT(TATPARMS);
+
+	if (true)
+	{
+		std::lock_guard lock(mutex);
+		stopping = true;
+		generation ++;
+	}
+	work_available.notify_all();
+
+	for (auto & thread : workers)
+	{
+		thread.join();
+	}
+
+	return;
+}
+
+
+void Darknet::ThreadPool::parallel_for(const int count, const std::function<void(int)> & task)
+{
+	TAT(TATPARMS);
+
+	if (count <= 0)
+	{
+		return;
+	}
+
+	if (count == 1 or workers.empty() or in_task)
+	{
+		for (int i = 0; i < count; i ++)
+		{
+			task(i);
+		}
+		return;
+	}
+
+	std::lock_guard loop_lock(loop_mutex);
+
+	// each thread starts with a contiguous share of the iterations, the same as a static OpenMP schedule
+	const int64_t threads = size();
+	for (int64_t idx = 0; idx < threads; idx ++)
+	{
+		ranges[idx].next.store(static_cast<int>(count * idx / threads), std::memory_order_relaxed);
+		ranges[idx].end = static_cast<int>(count * (idx + 1) / threads);
+	}
+	ScopedValue<const std::function<void(int)> *> scoped_task(current_task, &task);
+	failed = false;
+	busy = static_cast<int>(workers.size());
+
+	if (true)
+	{
+		std::lock_guard lock(mutex);
+		generation ++;
+	}
+	work_available.notify_all();
+
+	// the tasks which throw don't leave work(), so we always wait for the workers to be done with the task
+	work(0);
+
+	const auto timestamp = std::chrono::steady_clock::now();
+	while (busy.load(std::memory_order_acquire) and std::chrono::steady_clock::now() - timestamp < spin_duration)
+	{
+		spin_pause();
+	}
+	if (busy.load(std::memory_order_acquire))
+	{
+		std::unique_lock lock(mutex);
+		work_done.wait(lock, [&] { return busy.load(std::memory_order_acquire) == 0; });
+	}
+
+	if (failed)
+	{
+		std::exception_ptr error;
+		if (true)
+		{
+			std::lock_guard lock(mutex);
+			error.swap(first_error);
+		}
+		std::rethrow_exception(error);
+	}
+
+	return;
+}
+
+
+void Darknet::ThreadPool::set_error(std::exception_ptr error)
+{
+	TAT(TATPARMS);
+
+	std::lock_guard lock(mutex);
+	if (not first_error)
+	{
+		first_error = error;
+	}
+	failed = true;
+
+	return;
+}
+
+
+void Darknet::ThreadPool::work(const int index)
+{
+	// no TAT() here since the time is already counted by the kernel which called parallel_for()
+
+	ScopedValue<bool> scoped_in_task(in_task, true);
+
+	// start with our own iterations, then steal whatever the other threads have not started yet
+	const int threads = size();
+	for (int k = 0; k < threads; k ++)
+	{
+		Range & range = ranges[(index + k) % threads];
+		for (int i = range.next.fetch_add(1, std::memory_order_relaxed); i < range.end; i = range.next.fetch_add(1, std::memory_order_relaxed))
+		{
+			// once a task has thrown, the remaining iterations are only taken so the loop ends
+			if (failed.load(std::memory_order_relaxed))
+			{
+				continue;
+			}
+
+			try
+			{
+				(*current_task)(i);
+			}
+			catch (...)
+			{
+				set_error(std::current_exception());
+			}
+		}
+	}
+
+	return;
+}
+
+
+void Darknet::ThreadPool::run(const int index)
+{
+	TAT(TATPARMS);
+
+	if (not cpu_list.empty())
+	{
+		set_affinity({cpu_list[index % cpu_list.size()]});
+	}
+
+	uint64_t seen = 0;
+	while (true)
+	{
+		const auto timestamp = std::chrono::steady_clock::now();
+		while (generation.load(std::memory_order_acquire) == seen and std::chrono::steady_clock::now() - timestamp < spin_duration)
+		{
+			spin_pause();
+		}
+
+		if (generation.load(std::memory_order_acquire) == seen)
+		{
+			std::unique_lock lock(mutex);
+			work_available.wait(lock, [&] { return generation.load(std::memory_order_acquire) != seen; });
+		}
+
+		seen = generation.load(std::memory_order_acquire);
+		if (stopping)
+		{
+			break;
+		}
+
+		work(index);
+
+		if (busy.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			std::lock_guard lock(mutex);
+			work_done.notify_one();
+		}
+	}
+
+	return;
+}
+
+
+Darknet::ThreadPoolScope::ThreadPoolScope(ThreadPool & pool) :
+	previous(current_pool)
+{
+	TAT(TATPARMS);
+
+	current_pool = &pool;
+
+	if (not pool.cpus().empty())
+	{
+		previous_cpus = get_affinity();
+		set_affinity({pool.cpus()[0]});
+	}
+
+	return;
+}
+
+
+Darknet::ThreadPoolScope::~ThreadPoolScope()
+{
+	TAT(TATPARMS);
+
+	if (not previous_cpus.empty())
+	{
+		set_affinity(previous_cpus);
+	}
+
+	current_pool = previous;
+
+	return;
+}
+
+
+Darknet::ThreadPool & Darknet::default_thread_pool()
+{
+	TAT(TATPARMS);
+
+	static ThreadPool pool(0, {});
+
+	return pool;
+}
+
+
+Darknet::ThreadPool & Darknet::get_thread_pool(const Darknet::Network & net)
+{
+	TAT(TATPARMS);
+
+	if (net.details and net.details->thread_pool)
+	{
+		return *net.details->thread_pool;
+	}
+
+	return default_thread_pool();
+}
+
+
+void Darknet::parallel_for(const int count, const std::function<void(int)> & task)
+{
+	TAT(TATPARMS);
+
+	(current_pool ? *current_pool : default_thread_pool()).parallel_for(count, task);
+
+	return;
+}
+
+
+int Darknet::parallel_threads()
+{
+	TAT(TATPARMS);
+
+	if (in_task)
+	{
+		return 1;
+	}
+
+	return (current_pool ? *current_pool : default_thread_pool()).size();
+}
+
+
+Darknet::VInt Darknet::split_cpus(const Darknet::VInt & cpus, const size_t index, const size_t count)
+{
+	TAT(TATPARMS);
+
+	if (cpus.empty() or count == 0 or index >= count)
+	{
+		return {};
+	}
+
+	const size_t begin	= cpus.size() * index / count;
+	const size_t end	= cpus.size() * (index + 1) / count;
+	if (begin == end)
+	{
+		// more parts than CPUs, so some of them have to share
+		return {cpus[index % cpus.size()]};
+	}
+
+	return Darknet::VInt(cpus.begin() + begin, cpus.begin() + end);
+}
+
+
+Darknet::VInt Darknet::split_cpus(const size_t index, const size_t count)
+{
+	TAT(TATPARMS);
+
+	if (count == 0 or index >= count)
+	{
+		throw std::invalid_argument("cannot get part #" + std::to_string(index) + " of " + std::to_string(count) + " parts of the CPUs");
+	}
+
+	Darknet::VInt cpus = get_affinity();
+	if (cpus.empty())
+	{
+		for (unsigned int cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu ++)
+		{
+			cpus.push_back(cpu);
+		}
+	}
+
+	return split_cpus(cpus, index, count);
+}
+
+
+Darknet::ThreadPoolPtr Darknet::create_thread_pool(const size_t threads, const Darknet::VInt & cpus)
+{
+	TAT(TATPARMS);
+
+	return std::make_shared<Darknet::ThreadPool>(threads, cpus);
+}
+
+
+void Darknet::set_thread_pool(Darknet::NetworkPtr ptr, Darknet::ThreadPoolPtr pool)
+{
+	TAT(TATPARMS);
+
+	Darknet::Network * net = reinterpret_cast<Darknet::Network *>(ptr);
+	if (net == nullptr or net->details == nullptr)
+	{
+		throw std::invalid_argument("cannot set the thread pool without a network pointer");
+	}
+
+	net->details->thread_pool = pool;
+
+	return;
+}
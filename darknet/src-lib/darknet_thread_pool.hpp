@@ -0,0 +1,138 @@
+/* Darknet/YOLO:  https://github.com/hank-ai/darknet
+ * Copyright 2026 Stephane Charette
+ */
+
+#pragma once
+
+#include "darknet.hpp"
+
+
+namespace Darknet
+{
+	/** Threads which run the loops of the CPU inference kernels, instead of OpenMP.  The threads are started once and
+	 * wait for work, so small layers don't pay to start a team of threads, and several networks (or execution contexts)
+	 * in the same process can each be given their own cores instead of all of them fighting for every core.
+	 *
+	 * The thread which calls @ref parallel_for() does its share of the work, so a pool of @p N threads starts @p N-1
+	 * workers.  When the pool is given a list of CPUs, the workers are pinned to the CPUs after the first one, and the
+	 * thread which runs the network is pinned to the first CPU while @ref forward_network() runs (see
+	 * @ref ThreadPoolScope).
+	 *
+	 * Each thread starts with its own contiguous share of the iterations, and once it runs out it steals iterations from
+	 * the others, so a thread which was delayed doesn't hold up everyone else.
+	 *
+	 * @see @ref Darknet::create_thread_pool()
+	 * @see @ref Darknet::set_thread_pool()
+	 *
+	 * @since 2026-10-17
+	 */
+	class ThreadPool final
+	{
+		public:
+
+			/** A @p threads of zero uses one thread per CPU in @p cpus, or when @p cpus is empty the number of OpenMP
+			 * threads (which is the number of cores unless @p OMP_NUM_THREADS is set).
+			 */
+			ThreadPool(size_t threads, const VInt & cpus);
+
+			/// Stops the workers.
+			~ThreadPool();
+
+			/// The number of threads, including the one which calls @ref parallel_for().
+			int size() const { return static_cast<int>(workers.size()) + 1; }
+
+			/// The CPUs given to the constructor, which may be empty.
+			const VInt & cpus() const { return cpu_list; }
+
+			/** Call @p task once for every index from @p 0 to @p count-1, spread across the threads, and return once they
+			 * have all been done.  Only one loop runs at a time, so other threads calling this wait their turn.
+			 *
+			 * If a task throws, the iterations which have not started yet are skipped, and once all of the threads are
+			 * done the first exception is rethrown on the thread which called this.
+			 */
+			void parallel_for(const int count, const std::function<void(int)> & task);
+
+		private:
+
+			/// The iterations which a thread has not started yet.  Each one is on its own cache line.
+			struct alignas(64) Range
+			{
+				std::atomic<int> next;
+				int end;
+			};
+
+			void run(const int index);
+			void work(const int index);
+			void set_error(std::exception_ptr error);
+
+			VInt cpu_list;
+			std::vector<std::thread> workers;
+			std::unique_ptr<Range[]> ranges;
+
+			std::mutex loop_mutex;
+			std::mutex mutex;
+			std::condition_variable work_available;
+			std::condition_variable work_done;
+			const std::function<void(int)> * current_task;
+			std::atomic<uint64_t> generation;
+			std::atomic<int> busy;
+			std::atomic<bool> stopping;
+
+			/// The first exception thrown by a task of the current loop, protected by @p mutex.
+			std::exception_ptr first_error;
+			std::atomic<bool> failed;
+	};
+
+
+	/** While this exists, the calls to @ref Darknet::parallel_for() made by this thread use @p pool.  Created by
+	 * @ref forward_network() with the pool of the network.  When the pool was given a list of CPUs, this thread is
+	 * pinned to the first one until the scope ends.
+	 *
+	 * @since 2026-10-17
+	 */
+	class ThreadPoolScope final
+	{
+		public:
+
+			ThreadPoolScope(ThreadPool & pool);
+			~ThreadPoolScope();
+
+		private:
+
+			ThreadPool * previous;
+			VInt previous_cpus;
+	};
+
+
+	/** The pool used by the networks which were not given one with @ref Darknet::set_thread_pool().  The size comes from
+	 * @p --threads when it is used.
+	 *
+	 * @since 2026-10-17
+	 */
+	ThreadPool & default_thread_pool();
+
+	/// The pool used by @p net, which is the default pool unless one was set.  @since 2026-10-17
+	ThreadPool & get_thread_pool(const Darknet::Network & net);
+
+	/** Call @p task once for every index from @p 0 to @p count-1 using the pool of the current @ref ThreadPoolScope (or
+	 * the default pool).  When called from within a task, the loop runs on the current thread, the same way nested
+	 * OpenMP loops run on a single thread.
+	 *
+	 * @since 2026-10-17
+	 */
+	void parallel_for(const int count, const std::function<void(int)> & task);
+
+	/** Split @p cpus into @p count contiguous groups of (nearly) the same size, and return group @p index.  When there
+	 * are more groups than CPUs, each group gets one CPU and some of them share.
+	 *
+	 * @since 2026-10-17
+	 */
+	VInt split_cpus(const VInt & cpus, const size_t index, const size_t count);
+
+	/** The number of threads which @ref Darknet::parallel_for() would use, so a kernel can split its work in as many
+	 * parts.  This is @p 1 from within a task.
+	 *
+	 * @since 2026-10-17
+	 */
+	int parallel_threads();
+}
@@ -875,6 +875,7 @@ void validate_detector(char *datacfg, char *cfgfile, char *weightfile, const cha
 	}
 	//set_batch_network(&net, 1);
 	fuse_conv_batchnorm(net);
+	pack_conv_weights(net);
 	calculate_binary_weights(&net);
 	*cfg_and_state.output
 		<< "Learning Rate: "	<< net.learning_rate
@@ -1019,14 +1020,7 @@ void validate_detector(char *datacfg, char *cfgfile, char *weightfile, const cha
 			Darknet::Detection * dets = get_network_boxes(&net, w, h, thresh, .5, map, 0, &nboxes, letter_box);
 			if (nms)
 			{
-				if (l.nms_kind == DEFAULT_NMS)
-				{
-					do_nms_sort(dets, nboxes, l.classes, nms);
-				}
-				else
-				{
-					diounms_sort(dets, nboxes, l.classes, nms, l.nms_kind, l.beta_nms);
-				}
+				do_nms_fast(dets, nboxes, l.classes, nms, l.nms_kind, l.beta_nms);
 			}
 
 			if (coco)
@@ -1106,6 +1100,7 @@ void validate_detector_recall(char *datacfg, char *cfgfile, char *weightfile)
 	}
 	//set_batch_network(&net, 1);
 	fuse_conv_batchnorm(net);
+	pack_conv_weights(net);
 
 	//list *plist = get_paths("data/coco_val_5k.list");
 	list *options = read_data_cfg(datacfg);
@@ -1226,6 +1221,7 @@ float validate_detector_map(const char * datacfg, const char * cfgfile, const ch
 		}
 		//set_batch_network(&net, 1);
 		fuse_conv_batchnorm(net);
+		pack_conv_weights(net);
 		calculate_binary_weights(&net);
 		Darknet::load_names(&net, option_find_str(options, "names", "unknown.names"));
 	}
@@ -1371,14 +1367,7 @@ float validate_detector_map(const char * datacfg, const char * cfgfile, const ch
 			}
 			if (nms)
 			{
-				if (l.nms_kind == DEFAULT_NMS)
-				{
-					do_nms_sort(dets, nboxes, l.classes, nms);
-				}
-				else
-				{
-					diounms_sort(dets, nboxes, l.classes, nms, l.nms_kind, l.beta_nms);
-				}
+				do_nms_fast(dets, nboxes, l.classes, nms, l.nms_kind, l.beta_nms);
 			}
 
 			char labelpath[4096];
@@ -2081,6 +2070,7 @@ void test_detector(const char *datacfg, const char *cfgfile, const char *weightf
 	}
 	net.benchmark_layers = benchmark_layers;
 	fuse_conv_batchnorm(net);
+	pack_conv_weights(net);
 	calculate_binary_weights(&net);
 
 	Darknet::load_names(&net, option_find_str(options, "names", "unknown.names"));
@@ -2160,14 +2150,7 @@ void test_detector(const char *datacfg, const char *cfgfile, const char *weightf
 		Darknet::Detection * dets = get_network_boxes(&net, im.w, im.h, thresh, hier_thresh, 0, 1, &nboxes, letter_box);
 		if (nms)
 		{
-			if (l.nms_kind == DEFAULT_NMS)
-			{
-				do_nms_sort(dets, nboxes, l.classes, nms);
-			}
-			else
-			{
-				diounms_sort(dets, nboxes, l.classes, nms, l.nms_kind, l.beta_nms);
-			}
+			do_nms_fast(dets, nboxes, l.classes, nms, l.nms_kind, l.beta_nms);
 		}
 
 		// Load the image explicitly asking for 3 color channels
@@ -354,23 +354,33 @@ void asm_cpuid(uint32_t* abcd, uint32_t eax)
 #ifdef _WIN32
 //  Windows
 #define cpuid(info, x)    __cpuidex(info, x, 0)
+#define xgetbv0()         _xgetbv(0)
 #else
 //  GCC Intrinsics
 void cpuid(int info[4], int InfoType) {
 	__cpuid_count(InfoType, 0, info[0], info[1], info[2], info[3]);
 }
+
+/// Read XCR0, the register state saved by the OS on a context switch.  Only valid when CPUID reports OSXSAVE.
+static inline uint64_t xgetbv0()
+{
+	uint32_t eax = 0, edx = 0;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (static_cast<uint64_t>(edx) << 32) | eax;
+}
 #endif
 
 
 //  Misc.
 static int HW_MMX, HW_x64, HW_RDRAND, HW_BMI1, HW_BMI2, HW_ADX, HW_PREFETCHWT1;
 static int HW_ABM;      // Advanced Bit Manipulation
+static int HW_OSXSAVE;  // XGETBV can read which registers the OS saves
 
 //  SIMD: 128-bit
 static int HW_SSE, HW_SSE2, HW_SSE3, HW_SSSE3, HW_SSE41, HW_SSE42, HW_SSE4a, HW_AES, HW_SHA;
 
 //  SIMD: 256-bit
-static int HW_AVX, HW_XOP, HW_FMA3, HW_FMA4, HW_AVX2;
+static int HW_AVX, HW_XOP, HW_FMA3, HW_FMA4, HW_AVX2, HW_F16C;
 
 //  SIMD: 512-bit
 static int HW_AVX512F;    //  AVX512 Foundation
@@ -382,6 +392,7 @@ static int HW_AVX512BW;   //  AVX512 Byte + Word
 static int HW_AVX512DQ;   //  AVX512 Doubleword + Quadword
 static int HW_AVX512IFMA; //  AVX512 Integer 52-bit Fused Multiply-Add
 static int HW_AVX512VBMI; //  AVX512 Vector Byte Manipulation Instructions
+static int HW_AVX512VNNI; //  AVX512 Vector Neural Network Instructions
 
 // https://stackoverflow.com/questions/6121792/how-to-check-if-a-cpu-supports-the-sse3-instruction-set
 void check_cpu_features(void)
@@ -410,8 +421,11 @@ void check_cpu_features(void)
 
 		HW_AVX = (info[2] & ((uint32_t)1 << 28)) != 0;
 		HW_FMA3 = (info[2] & ((uint32_t)1 << 12)) != 0;
+		HW_F16C = (info[2] & ((uint32_t)1 << 29)) != 0;
 
 		HW_RDRAND = (info[2] & ((uint32_t)1 << 30)) != 0;
+
+		HW_OSXSAVE = (info[2] & ((uint32_t)1 << 27)) != 0;
 	}
 	if (nIds >= 0x00000007) {
 		cpuid(info, 0x00000007);
@@ -432,6 +446,7 @@ void check_cpu_features(void)
 		HW_AVX512DQ = (info[1] & ((uint32_t)1 << 17)) != 0;
 		HW_AVX512IFMA = (info[1] & ((uint32_t)1 << 21)) != 0;
 		HW_AVX512VBMI = (info[2] & ((uint32_t)1 << 1)) != 0;
+		HW_AVX512VNNI = (info[2] & ((uint32_t)1 << 11)) != 0;
 	}
 	if (nExIds >= 0x80000001) {
 		cpuid(info, 0x80000001);
@@ -441,6 +456,23 @@ void check_cpu_features(void)
 		HW_FMA4 = (info[2] & ((uint32_t)1 << 16)) != 0;
 		HW_XOP = (info[2] & ((uint32_t)1 << 11)) != 0;
 	}
+
+	/* The CPU may support AVX or AVX-512 while the OS (or the hypervisor) does not save the YMM, ZMM and opmask
+	 * registers, in which case using them faults or corrupts other threads.  XCR0 bits 1 and 2 are the SSE and YMM
+	 * state, and bits 5 to 7 are the opmask and the two halves of the ZMM state.
+	 */
+	const uint64_t xcr0 = HW_OSXSAVE ? xgetbv0() : 0;
+	const bool os_avx = (xcr0 & 0x06) == 0x06;
+	const bool os_avx512 = os_avx and (xcr0 & 0xe0) == 0xe0;
+	if (not os_avx)
+	{
+		HW_AVX = HW_AVX2 = HW_FMA3 = HW_FMA4 = HW_XOP = HW_F16C = 0;
+	}
+	if (not os_avx512)
+	{
+		HW_AVX512F = HW_AVX512CD = HW_AVX512PF = HW_AVX512ER = HW_AVX512VL = 0;
+		HW_AVX512BW = HW_AVX512DQ = HW_AVX512IFMA = HW_AVX512VBMI = HW_AVX512VNNI = 0;
+	}
 }
 
 int is_avx()
@@ -489,6 +521,74 @@ int is_fma_avx2()
 	return result;
 }
 
+int is_avx512()
+{
+	TAT(TATPARMS);
+
+	static int result = -1;
+
+	if (result == -1)
+	{
+		check_cpu_features();
+		result = HW_AVX512F && HW_FMA3;
+		if (result == 1)
+		{
+			*cfg_and_state.output << "AVX-512 detected." << std::endl;
+		}
+	}
+
+	return result;
+}
+
+int is_avx512bw()
+{
+	TAT(TATPARMS);
+
+	static int result = -1;
+
+	if (result == -1)
+	{
+		check_cpu_features();
+		result = HW_AVX512F && HW_AVX512BW;
+	}
+
+	return result;
+}
+
+int is_avx512_vnni()
+{
+	TAT(TATPARMS);
+
+	static int result = -1;
+
+	if (result == -1)
+	{
+		check_cpu_features();
+		result = HW_AVX512F && HW_AVX512BW && HW_AVX512VNNI;
+		if (result == 1)
+		{
+			*cfg_and_state.output << "AVX-512 VNNI detected." << std::endl;
+		}
+	}
+
+	return result;
+}
+
+int is_f16c()
+{
+	TAT(TATPARMS);
+
+	static int result = -1;
+
+	if (result == -1)
+	{
+		check_cpu_features();
+		result = HW_AVX && HW_F16C;
+	}
+
+	return result;
+}
+
 // https://software.intel.com/sites/landingpage/IntrinsicsGuide
 void gemm_nn(int M, int N, int K, float ALPHA,
 	float *A, int lda,
@@ -1474,37 +1574,7 @@ void activate_array_cpu_custom(float *x, const int n, const ACTIVATION a)
 {
 	TAT(TATPARMS);
 
-	int i = 0;
-	if (a == LINEAR)
-	{}
-	else if (a == LEAKY)
-	{
-		if (is_fma_avx2()) {
-			__m256i all256_sing1 = _mm256_set_epi32(0x80000000, 0x80000000, 0x80000000, 0x80000000, 0x80000000, 0x80000000, 0x80000000, 0x80000000);
-			__m256 all256_01 = _mm256_set1_ps(0.1F);
-
-			for (i = 0; i < n - 8; i += 8) {
-				//x[i] = (x[i]>0) ? x[i] : .1*x[i];
-
-				__m256 src256 = _mm256_loadu_ps(&x[i]);
-				__m256 mult256 = _mm256_mul_ps((src256), all256_01); // mult * 0.1
-
-				__m256i sign256 = _mm256_and_si256(_mm256_castps_si256(src256), all256_sing1); // check sign in 8 x 32-bit floats
-
-				__m256 result256 = _mm256_blendv_ps(src256, mult256, _mm256_castsi256_ps(sign256)); // (sign>0) ? src : mult;
-				_mm256_storeu_ps(&x[i], result256);
-			}
-		}
-
-		for (; i < n; ++i) {
-			x[i] = (x[i]>0) ? x[i] : .1*x[i];
-		}
-	}
-	else {
-		for (i = 0; i < n; ++i) {
-			x[i] = activate(x[i], a);
-		}
-	}
+	activate_array_simd(x, n, a);
 }
 
 void float_to_bit(float *src, unsigned char *dst, size_t size)
@@ -1699,6 +1769,30 @@ int is_fma_avx2()
 	return 0;
 }
 
+int is_avx512()
+{
+	TAT(TATPARMS);
+	return 0;
+}
+
+int is_avx512bw()
+{
+	TAT(TATPARMS);
+	return 0;
+}
+
+int is_avx512_vnni()
+{
+	TAT(TATPARMS);
+	return 0;
+}
+
+int is_f16c()
+{
+	TAT(TATPARMS);
+	return 0;
+}
+
 void gemm_nn(int M, int N, int K, float ALPHA,
 	float *A, int lda,
 	float *B, int ldb,
@@ -2071,21 +2165,7 @@ void activate_array_cpu_custom(float *x, const int n, const ACTIVATION a)
 {
 	TAT(TATPARMS);
 
-	int i;
-	if (a == LINEAR)
-	{
-	}
-	else if (a == LEAKY)
-	{
-		for (i = 0; i < n; ++i) {
-			x[i] = (x[i]>0) ? x[i] : .1*x[i];
-		}
-	}
-	else {
-		for (i = 0; i < n; ++i) {
-			x[i] = activate(x[i], a);
-		}
-	}
+	activate_array_simd(x, n, a);
 }
 
 void float_to_bit(float *src, unsigned char *dst, size_t size)
@@ -2391,9 +2471,10 @@ void gemm_cpu(int TA, int TB, int M, int N, int K, float ALPHA,
 	}
 
 	is_avx();   // initialize static variable
-	if (is_fma_avx2() && !TA && !TB)
+	if (!TA && !TB)
 	{
-		gemm_nn_fast(M, N, K, ALPHA, A, lda, B, ldb, C, ldc);
+		// cache-blocked with packed panels; this is where the convolutional layers spend nearly all of their time
+		gemm_packed(M, N, K, ALPHA, A, lda, B, ldb, C, ldc);
 	}
 	else
 	{
@@ -2645,4 +2726,6 @@ void init_cpu()
 
 	is_avx();
 	is_fma_avx2();
+	is_avx512();
+	is_avx512_vnni();
 }
@@ -32,6 +32,10 @@ static inline unsigned char get_bit(unsigned char const*const src, size_t index)
 
 int is_avx();
 int is_fma_avx2();
+int is_avx512();
+int is_avx512bw();
+int is_avx512_vnni();
+int is_f16c();
 
 void float_to_bit(float *src, unsigned char *dst, size_t size);
 
@@ -91,6 +95,7 @@ void gemm_nn_bin_transposed_32bit_packed(int M, int N, int K, float ALPHA,
     float *C, int ldc, float *mean_arr);
 
 
+/// The previous CPU max pooling for inference, kept for comparison in the @p layerbench command.  See @ref maxpool_cpu().
 void forward_maxpool_layer_avx(float *src, float *dst, int *indexes, int size, int w, int h, int out_w, int out_h, int c,
     int pad, int stride, int batch);
 
@@ -107,6 +112,244 @@ void gemm_cpu(int TA, int TB, int M, int N, int K, float ALPHA,
         float BETA,
         float *C, int ldc);
 
+/// @{ The previous CPU kernels for @p C += @p ALPHA * @p A * @p B, kept for comparison in the @p gemmbench command.
+void gemm_nn(int M, int N, int K, float ALPHA,
+        float *A, int lda,
+        float *B, int ldb,
+        float *C, int ldc);
+
+void gemm_nn_fast(int M, int N, int K, float ALPHA,
+        float *A, int lda,
+        float *B, int ldb,
+        float *C, int ldc);
+/// @}
+
+namespace Darknet
+{
+	/** The register-tiled microkernels which can be used by @ref gemm_packed().
+	 * @since 2026-10-17
+	 */
+	enum class EGemmKernel
+	{
+		AUTO	,	///< pick the fastest kernel supported by the CPU
+		GENERIC	,	///< plain C++, 4 x 8 tiles
+		AVX2	,	///< AVX2 + FMA, 6 x 16 tiles
+		AVX512	,	///< AVX-512F, 12 x 32 tiles
+	};
+
+	/** Precision of the matrices packed by @ref gemm_prepack_a().  The 16-bit formats halve the memory and the memory
+	 * bandwidth needed by the weights, and are widened back to single precision one cache block at a time, so the
+	 * microkernels and the accumulation are the same as with @ref FP32.
+	 * @since 2026-10-17
+	 */
+	enum class EWeightFormat
+	{
+		FP32	,	///< single precision
+		FP16	,	///< IEEE half precision, widened with F16C or AVX-512F
+		BF16	,	///< bfloat16 (the upper 16 bits of a single precision float), widened with a shift
+	};
+
+	/** The input image of a convolution, so @ref gemm_prepacked_implicit() can read the im2col matrix straight from
+	 * the image instead of needing @ref im2col_cpu_ext() to expand it into a workspace.
+	 * @since 2026-10-17
+	 */
+	struct ConvolutionInput
+	{
+		const float * image;	///< @p channels x @p height x @p width
+		int channels;
+		int height;
+		int width;
+		int ksize;
+		int pad;
+		int stride_x;
+		int stride_y;
+		int dilation;
+		int out_w;
+		int out_h;
+	};
+
+	/** Work done by @ref gemm_prepacked() and @ref gemm_prepacked_implicit() on each block of @p C right after the last
+	 * block of @p K, while the block is still in the cache, instead of in separate passes over the whole matrix:
+	 *
+	 *     C = add_activation(activation(A * B + bias) + add)
+	 *
+	 * This is the bias, the activation, and the element-wise sum of a following @p [shortcut] layer of a convolution.
+	 * @since 2026-10-17
+	 */
+	struct GemmEpilogue
+	{
+		const float * bias;			///< one value per row of @p C, or @p nullptr
+		ACTIVATION activation;		///< see @ref gemm_epilogue_supports()
+		const float * add;			///< matrix with the same shape and leading dimension as @p C, or @p nullptr
+		ACTIVATION add_activation;	///< applied after adding @ref add
+	};
+
+	/** The microkernels which can be used by @ref gemm_int8_prepacked_implicit().
+	 * @since 2026-10-17
+	 */
+	enum class EInt8Kernel
+	{
+		AUTO		,	///< pick the fastest kernel supported by the CPU
+		GENERIC		,	///< plain C++, 4 x 8 tiles
+		AVX2		,	///< AVX2 @p vpmaddubsw, 4 x 16 tiles
+		AVX512BW	,	///< AVX-512BW @p vpmaddubsw, 12 x 32 tiles
+		AVX512VNNI	,	///< AVX-512 VNNI @p vpdpbusd, 12 x 32 tiles
+	};
+
+	/** The quantized input image of a convolution for @ref gemm_int8_prepacked_implicit().  The image is stored as
+	 * @p height x @p width x @p channels (channels last), the padding is already included in the image, and each value
+	 * is an unsigned 8-bit integer where @p 128 means zero.
+	 * @since 2026-10-17
+	 */
+	struct QuantizedConvolutionInput
+	{
+		const uint8_t * image;
+		int channels;		///< padded to a multiple of 4
+		int height;			///< including the padding
+		int width;			///< including the padding
+		int ksize;
+		int stride_x;
+		int stride_y;
+		int dilation;
+		int out_w;
+		int out_h;
+	};
+}
+
+/** Cache-blocked single-precision GEMM for the CPU which computes @p C += @p ALPHA * @p A * @p B, where none of the
+ * matrices are transposed.  Blocks of @p A and @p B are packed into contiguous panels sized for the caches, and a
+ * register-tiled microkernel computes one tile of @p C at a time.  This is what @ref gemm_cpu() uses for the
+ * convolutional layers.
+ *
+ * @since 2026-10-17
+ */
+void gemm_packed(int M, int N, int K, float ALPHA,
+        const float *A, int lda,
+        const float *B, int ldb,
+        float *C, int ldc);
+
+/** Select the microkernel used by @ref gemm_packed().  The default is @ref Darknet::EGemmKernel::AUTO.
+ *
+ * @returns @p false (and leaves the current kernel alone) if the CPU or the build does not support @p kernel.
+ *
+ * @since 2026-10-17
+ */
+bool gemm_packed_set_kernel(Darknet::EGemmKernel kernel);
+
+/// The microkernel currently used by @ref gemm_packed().  This is never @ref Darknet::EGemmKernel::AUTO.
+Darknet::EGemmKernel gemm_packed_kernel();
+
+/// Short name of a microkernel, such as @p "avx2 6x16".
+const char * gemm_packed_kernel_name(Darknet::EGemmKernel kernel);
+
+/// Short name of a weight format, such as @p "fp16".  @since 2026-10-17
+const char * gemm_weight_format_name(Darknet::EWeightFormat format);
+
+/** Number of floats needed by @ref gemm_prepack_a() to pack a @p M x @p K matrix for @p kernel.  With the 16-bit
+ * formats each float holds 2 values.
+ *
+ * @since 2026-10-17
+ */
+size_t gemm_prepack_a_size(Darknet::EGemmKernel kernel, Darknet::EWeightFormat format, int M, int K);
+
+/** Rearrange all of the row-major @p M x @p K matrix @p A into the panels which the @p kernel microkernel reads, so
+ * @ref gemm_prepacked() doesn't have to pack @p A every time it is called.  This is meant for matrices which never
+ * change, such as the weights of a convolutional layer.  @p packed_A must have room for @ref gemm_prepack_a_size()
+ * floats.  With the 16-bit formats the values are rounded to the nearest representable value.
+ *
+ * @since 2026-10-17
+ */
+void gemm_prepack_a(Darknet::EGemmKernel kernel, Darknet::EWeightFormat format, int M, int K, const float *A, int lda, float *packed_A);
+
+/** Same as @ref gemm_packed() with an @p ALPHA of @p 1, but @p A was already packed by @ref gemm_prepack_a().  The
+ * given @p kernel and @p format are the ones used to pack @p A, and the kernel may not be the currently selected
+ * kernel.
+ *
+ * When an @p epilogue is given, @p C is overwritten instead of accumulated, and the epilogue is applied to each block
+ * of @p C as soon as it is complete.
+ *
+ * @since 2026-10-17
+ */
+void gemm_prepacked(Darknet::EGemmKernel kernel, Darknet::EWeightFormat format, int M, int N, int K,
+        const float *packed_A,
+        const float *B, int ldb,
+        float *C, int ldc,
+        const Darknet::GemmEpilogue *epilogue = nullptr);
+
+/** Implicit GEMM for a convolution:  same as @ref gemm_prepacked() where @p B would be the output of @ref im2col_cpu_ext()
+ * for @p input, but each block of @p B is packed straight from the image so the im2col matrix is never created.  @p N
+ * is the number of output pixels, and @p K is @p channels x @p ksize x @p ksize.
+ *
+ * @since 2026-10-17
+ */
+void gemm_prepacked_implicit(Darknet::EGemmKernel kernel, Darknet::EWeightFormat format, int M,
+        const float *packed_A,
+        const Darknet::ConvolutionInput & input,
+        float *C, int ldc,
+        const Darknet::GemmEpilogue *epilogue = nullptr);
+
+/** Whether @p activation can be applied by a @ref Darknet::GemmEpilogue, which is every activation that only depends
+ * on one value at a time.  The @p NORM_CHAN activations combine all of the channels of each pixel.
+ *
+ * @since 2026-10-17
+ */
+bool gemm_epilogue_supports(ACTIVATION activation);
+
+/** Apply @p epilogue to the @p M x @p N matrix @p C, for the convolutions which don't use @ref gemm_prepacked().
+ * @p C, the bias, and the added matrix must already point to the first row and column.  This is called for small
+ * tiles, so it is single-threaded.
+ *
+ * @since 2026-10-17
+ */
+void gemm_apply_epilogue(const Darknet::GemmEpilogue & epilogue, int M, int N, float *C, int ldc);
+
+/** Select the microkernel used to quantize the weights in @ref gemm_int8_prepack_a().  The default is
+ * @ref Darknet::EInt8Kernel::AUTO.
+ *
+ * @returns @p false (and leaves the current kernel alone) if the CPU or the build does not support @p kernel.
+ *
+ * @since 2026-10-17
+ */
+bool gemm_int8_set_kernel(Darknet::EInt8Kernel kernel);
+
+/// The currently selected INT8 microkernel.  This is never @ref Darknet::EInt8Kernel::AUTO.
+Darknet::EInt8Kernel gemm_int8_kernel();
+
+/// Short name of an INT8 microkernel, such as @p "avx512-vnni 12x32".
+const char * gemm_int8_kernel_name(Darknet::EInt8Kernel kernel);
+
+/** Largest magnitude of the quantized weights given to @p kernel.  This is @p 127 except for the @p vpmaddubsw kernels,
+ * where the sum of 2 products of an unsigned input and a signed weight must fit in a signed 16-bit integer, so the
+ * weights are limited to 7 bits.
+ *
+ * @since 2026-10-17
+ */
+int gemm_int8_weight_limit(Darknet::EInt8Kernel kernel);
+
+/** Number of bytes needed by @ref gemm_int8_prepack_a() to pack a @p M x @p K matrix for @p kernel.
+ * @since 2026-10-17
+ */
+size_t gemm_int8_prepack_a_size(Darknet::EInt8Kernel kernel, int M, int K);
+
+/** Rearrange the row-major signed 8-bit @p M x @p K matrix @p A into the panels which the @p kernel microkernel reads.
+ * @p K must be a multiple of 4.
+ *
+ * @since 2026-10-17
+ */
+void gemm_int8_prepack_a(Darknet::EInt8Kernel kernel, int M, int K, const int8_t *A, int lda, int8_t *packed_A);
+
+/** Implicit INT8 GEMM for a convolution:  @p C = @p A * @p B where @p A was packed by @ref gemm_int8_prepack_a() and
+ * @p B is the im2col matrix of the quantized @p input with the rows ordered as filter row, filter column, and channel.
+ * The unsigned inputs are multiplied with the signed weights and summed in 32-bit integers, so each row of @p C is too
+ * large by @p 128 times the sum of that row of @p A, which the caller is expected to subtract.  @p C is overwritten.
+ *
+ * @since 2026-10-17
+ */
+void gemm_int8_prepacked_implicit(Darknet::EInt8Kernel kernel, int M,
+        const int8_t *packed_A,
+        const Darknet::QuantizedConvolutionInput & input,
+        int32_t *C, int ldc);
+
 #ifdef DARKNET_GPU
 void gemm_ongpu(int TA, int TB, int M, int N, int K, float ALPHA,
         float *A_gpu, int lda,
@@ -0,0 +1,543 @@
+/** @file
+ * INT8 GEMM for the quantized convolutions, blocked and packed the same way as the single-precision GEMM in
+ * gemm_packed.cpp.
+ *
+ * The inputs are unsigned 8-bit integers and the weights are signed 8-bit integers.  Both are packed in groups of 4
+ * consecutive values of @p K, which is what the x86 integer dot product instructions read:  @p vpdpbusd (AVX-512 VNNI)
+ * multiplies 4 unsigned bytes with 4 signed bytes and adds the sum to a 32-bit integer, while @p vpmaddubsw followed by
+ * @p vpmaddwd (AVX2 and AVX-512BW) does the same in 2 steps through a saturating 16-bit sum of 2 products.
+ *
+ * @p B is always the implicit im2col matrix of a quantized image which is stored with the channels last, so a group of 4
+ * values of @p K is a single 32-bit load from the image.
+ */
+
+#include "gemm.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define DARKNET_INT8_X86
+#endif
+
+#if defined(__GNUC__)
+#define DARKNET_INT8_TARGET(features) __attribute__((target(features)))
+#else
+#define DARKNET_INT8_TARGET(features)
+#endif
+
+
+namespace
+{
+	/** Computes one full @p MR x @p NR tile of @p C for @p kc4 groups of 4 values of @p K, where @p A and @p B are
+	 * packed panels.  The tile is added to @p C when @p accumulate is set, otherwise it overwrites @p C.
+	 */
+	using Microkernel = void (*)(const int kc4, const int8_t * a, const uint8_t * b, int32_t * c, const int ldc, const bool accumulate);
+
+	struct Int8KernelInfo
+	{
+		Darknet::EInt8Kernel type;
+		const char * name;
+		int mr;						///< rows of @p C computed by the microkernel
+		int nr;						///< columns of @p C computed by the microkernel
+		int kc;						///< depth of the packed panels, a multiple of 4 (the @p B panel stays in the L1 cache)
+		int nc;						///< columns of @p B packed at once (L2 cache)
+		int weight_limit;			///< largest magnitude of the quantized weights
+		Microkernel microkernel;
+	};
+
+	/// Largest @p MR x @p NR of all the microkernels, used for the partial tiles along the edges of @p C.
+	constexpr int max_tile_size = 12 * 32;
+
+	// Note there is no TAT() in the microkernels or in the packing:  they are called for every tile.
+
+	inline int32_t load_group(const int8_t * a)
+	{
+		int32_t value;
+		std::memcpy(&value, a, sizeof(value));
+
+		return value;
+	}
+
+	template <int MR, int NR>
+	void microkernel_generic(const int kc4, const int8_t * a, const uint8_t * b, int32_t * c, const int ldc, const bool accumulate)
+	{
+		int32_t acc[MR][NR] = {};
+
+		for (int p = 0; p < kc4; p ++)
+		{
+			for (int i = 0; i < MR; i ++)
+			{
+				for (int j = 0; j < NR; j ++)
+				{
+					for (int q = 0; q < 4; q ++)
+					{
+						acc[i][j] += a[i * 4 + q] * b[j * 4 + q];
+					}
+				}
+			}
+			a += MR * 4;
+			b += NR * 4;
+		}
+
+		for (int i = 0; i < MR; i ++)
+		{
+			for (int j = 0; j < NR; j ++)
+			{
+				c[i * ldc + j] = accumulate ? c[i * ldc + j] + acc[i][j] : acc[i][j];
+			}
+		}
+	}
+
+#ifdef DARKNET_INT8_X86
+
+	/// 4 rows x 16 columns:  8 accumulators + 2 for @p B + 1 broadcast + the 16-bit ones + 2 temporaries.
+	DARKNET_INT8_TARGET("avx2")
+	void microkernel_avx2_4x16(const int kc4, const int8_t * a, const uint8_t * b, int32_t * c, const int ldc, const bool accumulate)
+	{
+		const __m256i ones = _mm256_set1_epi16(1);
+
+		__m256i c0_0 = _mm256_setzero_si256(), c0_1 = _mm256_setzero_si256();
+		__m256i c1_0 = _mm256_setzero_si256(), c1_1 = _mm256_setzero_si256();
+		__m256i c2_0 = _mm256_setzero_si256(), c2_1 = _mm256_setzero_si256();
+		__m256i c3_0 = _mm256_setzero_si256(), c3_1 = _mm256_setzero_si256();
+
+		#define INT8_AVX2_DOT(r)																\
+			a_r = _mm256_set1_epi32(load_group(a + 4 * r));										\
+			c##r##_0 = _mm256_add_epi32(c##r##_0, _mm256_madd_epi16(_mm256_maddubs_epi16(b_0, a_r), ones));	\
+			c##r##_1 = _mm256_add_epi32(c##r##_1, _mm256_madd_epi16(_mm256_maddubs_epi16(b_1, a_r), ones));
+
+		#define INT8_AVX2_STORE(r)																\
+			if (accumulate)																		\
+			{																					\
+				c##r##_0 = _mm256_add_epi32(c##r##_0, _mm256_loadu_si256((const __m256i *)(c + r * ldc)));		\
+				c##r##_1 = _mm256_add_epi32(c##r##_1, _mm256_loadu_si256((const __m256i *)(c + r * ldc + 8)));	\
+			}																					\
+			_mm256_storeu_si256((__m256i *)(c + r * ldc), c##r##_0);							\
+			_mm256_storeu_si256((__m256i *)(c + r * ldc + 8), c##r##_1);
+
+		for (int p = 0; p < kc4; p ++)
+		{
+			const __m256i b_0 = _mm256_loadu_si256((const __m256i *)b);
+			const __m256i b_1 = _mm256_loadu_si256((const __m256i *)(b + 32));
+			__m256i a_r;
+
+			INT8_AVX2_DOT(0) INT8_AVX2_DOT(1) INT8_AVX2_DOT(2) INT8_AVX2_DOT(3)
+
+			a += 4 * 4;
+			b += 16 * 4;
+		}
+
+		INT8_AVX2_STORE(0) INT8_AVX2_STORE(1) INT8_AVX2_STORE(2) INT8_AVX2_STORE(3)
+
+		#undef INT8_AVX2_DOT
+		#undef INT8_AVX2_STORE
+	}
+
+	#define INT8_AVX512_INIT(r)																	\
+		__m512i c##r##_0 = _mm512_setzero_si512();												\
+		__m512i c##r##_1 = _mm512_setzero_si512();
+
+	#define INT8_AVX512_STORE(r)																\
+		if (accumulate)																			\
+		{																						\
+			c##r##_0 = _mm512_add_epi32(c##r##_0, _mm512_loadu_si512(c + r * ldc));				\
+			c##r##_1 = _mm512_add_epi32(c##r##_1, _mm512_loadu_si512(c + r * ldc + 16));		\
+		}																						\
+		_mm512_storeu_si512(c + r * ldc, c##r##_0);												\
+		_mm512_storeu_si512(c + r * ldc + 16, c##r##_1);
+
+	/// 12 rows x 32 columns:  24 accumulators + 2 for @p B + 1 broadcast + the 16-bit ones + 2 temporaries.
+	DARKNET_INT8_TARGET("avx512f,avx512bw")
+	void microkernel_avx512bw_12x32(const int kc4, const int8_t * a, const uint8_t * b, int32_t * c, const int ldc, const bool accumulate)
+	{
+		const __m512i ones = _mm512_set1_epi16(1);
+
+		INT8_AVX512_INIT(0) INT8_AVX512_INIT(1) INT8_AVX512_INIT(2)  INT8_AVX512_INIT(3)
+		INT8_AVX512_INIT(4) INT8_AVX512_INIT(5) INT8_AVX512_INIT(6)  INT8_AVX512_INIT(7)
+		INT8_AVX512_INIT(8) INT8_AVX512_INIT(9) INT8_AVX512_INIT(10) INT8_AVX512_INIT(11)
+
+		#define INT8_AVX512BW_DOT(r)															\
+			a_r = _mm512_set1_epi32(load_group(a + 4 * r));										\
+			c##r##_0 = _mm512_add_epi32(c##r##_0, _mm512_madd_epi16(_mm512_maddubs_epi16(b_0, a_r), ones));	\
+			c##r##_1 = _mm512_add_epi32(c##r##_1, _mm512_madd_epi16(_mm512_maddubs_epi16(b_1, a_r), ones));
+
+		for (int p = 0; p < kc4; p ++)
+		{
+			const __m512i b_0 = _mm512_loadu_si512(b);
+			const __m512i b_1 = _mm512_loadu_si512(b + 64);
+			__m512i a_r;
+
+			INT8_AVX512BW_DOT(0) INT8_AVX512BW_DOT(1) INT8_AVX512BW_DOT(2)  INT8_AVX512BW_DOT(3)
+			INT8_AVX512BW_DOT(4) INT8_AVX512BW_DOT(5) INT8_AVX512BW_DOT(6)  INT8_AVX512BW_DOT(7)
+			INT8_AVX512BW_DOT(8) INT8_AVX512BW_DOT(9) INT8_AVX512BW_DOT(10) INT8_AVX512BW_DOT(11)
+
+			a += 12 * 4;
+			b += 32 * 4;
+		}
+
+		INT8_AVX512_STORE(0) INT8_AVX512_STORE(1) INT8_AVX512_STORE(2)  INT8_AVX512_STORE(3)
+		INT8_AVX512_STORE(4) INT8_AVX512_STORE(5) INT8_AVX512_STORE(6)  INT8_AVX512_STORE(7)
+		INT8_AVX512_STORE(8) INT8_AVX512_STORE(9) INT8_AVX512_STORE(10) INT8_AVX512_STORE(11)
+
+		#undef INT8_AVX512BW_DOT
+	}
+
+	/// 12 rows x 32 columns:  24 accumulators + 2 for @p B, and the broadcasts are folded into @p vpdpbusd.
+	DARKNET_INT8_TARGET("avx512f,avx512bw,avx512vnni")
+	void microkernel_avx512vnni_12x32(const int kc4, const int8_t * a, const uint8_t * b, int32_t * c, const int ldc, const bool accumulate)
+	{
+		INT8_AVX512_INIT(0) INT8_AVX512_INIT(1) INT8_AVX512_INIT(2)  INT8_AVX512_INIT(3)
+		INT8_AVX512_INIT(4) INT8_AVX512_INIT(5) INT8_AVX512_INIT(6)  INT8_AVX512_INIT(7)
+		INT8_AVX512_INIT(8) INT8_AVX512_INIT(9) INT8_AVX512_INIT(10) INT8_AVX512_INIT(11)
+
+		#define INT8_AVX512VNNI_DOT(r)															\
+			a_r = _mm512_set1_epi32(load_group(a + 4 * r));										\
+			c##r##_0 = _mm512_dpbusd_epi32(c##r##_0, b_0, a_r);									\
+			c##r##_1 = _mm512_dpbusd_epi32(c##r##_1, b_1, a_r);
+
+		for (int p = 0; p < kc4; p ++)
+		{
+			const __m512i b_0 = _mm512_loadu_si512(b);
+			const __m512i b_1 = _mm512_loadu_si512(b + 64);
+			__m512i a_r;
+
+			INT8_AVX512VNNI_DOT(0) INT8_AVX512VNNI_DOT(1) INT8_AVX512VNNI_DOT(2)  INT8_AVX512VNNI_DOT(3)
+			INT8_AVX512VNNI_DOT(4) INT8_AVX512VNNI_DOT(5) INT8_AVX512VNNI_DOT(6)  INT8_AVX512VNNI_DOT(7)
+			INT8_AVX512VNNI_DOT(8) INT8_AVX512VNNI_DOT(9) INT8_AVX512VNNI_DOT(10) INT8_AVX512VNNI_DOT(11)
+
+			a += 12 * 4;
+			b += 32 * 4;
+		}
+
+		INT8_AVX512_STORE(0) INT8_AVX512_STORE(1) INT8_AVX512_STORE(2)  INT8_AVX512_STORE(3)
+		INT8_AVX512_STORE(4) INT8_AVX512_STORE(5) INT8_AVX512_STORE(6)  INT8_AVX512_STORE(7)
+		INT8_AVX512_STORE(8) INT8_AVX512_STORE(9) INT8_AVX512_STORE(10) INT8_AVX512_STORE(11)
+
+		#undef INT8_AVX512VNNI_DOT
+	}
+
+	#undef INT8_AVX512_INIT
+	#undef INT8_AVX512_STORE
+
+#endif // DARKNET_INT8_X86
+
+	const Int8KernelInfo all_kernels[] =
+	{
+		//	type								name					mr	nr	kc		nc		limit	microkernel
+		{Darknet::EInt8Kernel::GENERIC		,	"generic 4x8"		,	4,	8,	1024,	512,	127,	microkernel_generic<4, 8>		},
+#ifdef DARKNET_INT8_X86
+		{Darknet::EInt8Kernel::AVX2			,	"avx2 4x16"			,	4,	16,	1024,	512,	63,		microkernel_avx2_4x16			},
+		{Darknet::EInt8Kernel::AVX512BW		,	"avx512bw 12x32"	,	12,	32,	768,	384,	63,		microkernel_avx512bw_12x32		},
+		{Darknet::EInt8Kernel::AVX512VNNI	,	"avx512-vnni 12x32"	,	12,	32,	768,	384,	127,	microkernel_avx512vnni_12x32	},
+#endif
+	};
+
+	std::atomic<const Int8KernelInfo *> selected_kernel(nullptr);
+
+	const Int8KernelInfo * find_kernel(const Darknet::EInt8Kernel type)
+	{
+		TAT(TATPARMS);
+
+		for (const auto & info : all_kernels)
+		{
+			if (info.type == type)
+			{
+				return &info;
+			}
+		}
+
+		return nullptr;
+	}
+
+	const Int8KernelInfo & get_kernel(const Darknet::EInt8Kernel type)
+	{
+		TAT(TATPARMS);
+
+		const Int8KernelInfo * info = find_kernel(type);
+		if (info == nullptr)
+		{
+			throw std::invalid_argument("cannot use an unavailable INT8 GEMM kernel");
+		}
+
+		return *info;
+	}
+
+	bool is_supported(const Darknet::EInt8Kernel type)
+	{
+		TAT(TATPARMS);
+
+		switch (type)
+		{
+			case Darknet::EInt8Kernel::GENERIC:		return true;
+			case Darknet::EInt8Kernel::AVX2:		return is_fma_avx2() == 1 and find_kernel(type) != nullptr;
+			case Darknet::EInt8Kernel::AVX512BW:	return is_avx512bw() == 1 and find_kernel(type) != nullptr;
+			case Darknet::EInt8Kernel::AVX512VNNI:	return is_avx512_vnni() == 1 and find_kernel(type) != nullptr;
+			default:								return false;
+		}
+	}
+
+	inline int round_up(const int value, const int multiple)
+	{
+		return (value + multiple - 1) / multiple * multiple;
+	}
+
+	/// Split K evenly into blocks which are a multiple of 4.  Matrices packed by @ref gemm_int8_prepack_a() use the same blocks.
+	int k_block_size(const Int8KernelInfo & info, const int K)
+	{
+		const int k_blocks = (K + info.kc - 1) / info.kc;
+
+		return round_up((K + k_blocks - 1) / k_blocks, 4);
+	}
+
+	/// Copy a @p mc x @p kc block of @p A into panels of @p mr rows, padding the last panel with zeros.
+	void pack_a(const int mc, const int kc, const int8_t * A, const int lda, const int mr, int8_t * dst)
+	{
+		for (int ir = 0; ir < mc; ir += mr)
+		{
+			const int rows = std::min(mr, mc - ir);
+			for (int i = 0; i < mr; i ++)
+			{
+				for (int p = 0; p < kc; p ++)
+				{
+					dst[((p / 4) * mr + i) * 4 + p % 4] = i < rows ? A[(ir + i) * lda + p] : 0;
+				}
+			}
+			dst += mr * kc;
+		}
+	}
+
+	/** Copy a @p kc x @p nc block of the implicit im2col matrix of @p in into panels of @p nr columns.  Row @p k of the
+	 * matrix is channel @p k % channels of filter tap @p k / channels, and column @p j is output pixel @p j.  Since the
+	 * channels are last in the image, each group of 4 rows of one column is 4 consecutive bytes of the image.
+	 */
+	void pack_b_image(const int kc, const int nc, const Darknet::QuantizedConvolutionInput & in, const int row0, const int col0, const int nr, uint8_t * dst)
+	{
+		int32_t pixel_offset[max_tile_size];
+
+		for (int jr = 0; jr < nc; jr += nr)
+		{
+			const int cols = std::min(nr, nc - jr);
+			for (int j = 0; j < cols; j ++)
+			{
+				const int pixel	= col0 + jr + j;
+				const int oy	= pixel / in.out_w;
+				const int ox	= pixel % in.out_w;
+				pixel_offset[j]	= (oy * in.stride_y * in.width + ox * in.stride_x) * in.channels;
+			}
+
+			uint8_t * panel = dst + jr * kc;
+			for (int p = 0; p < kc; p += 4)
+			{
+				const int row		= row0 + p;
+				const int tap		= row / in.channels;
+				const int ky		= tap / in.ksize;
+				const int kx		= tap % in.ksize;
+				const uint8_t * src	= in.image + (ky * in.width + kx) * in.dilation * in.channels + row % in.channels;
+
+				for (int j = 0; j < cols; j ++)
+				{
+					std::memcpy(panel + j * 4, src + pixel_offset[j], 4);
+				}
+				if (cols < nr)
+				{
+					std::memset(panel + cols * 4, 0, (nr - cols) * 4);
+				}
+				panel += nr * 4;
+			}
+		}
+	}
+
+	/// Single-threaded blocked GEMM over all @p M rows and @p N columns of @p C, starting at column @p col0 of @p B.
+	void gemm_int8_rectangle(const Int8KernelInfo & info, const int M, const int N, const int K, const int8_t * packed_A, const Darknet::QuantizedConvolutionInput & in, const int col0, int32_t * C, const int ldc)
+	{
+		TAT(TATPARMS);
+
+		// the packing buffer is kept per thread so steady-state inference does not allocate
+		thread_local std::vector<uint8_t> b_buffer;
+
+		const int k_step	= k_block_size(info, K);
+		const int m_padded	= round_up(M, info.mr);
+		const size_t b_size	= static_cast<size_t>(round_up(std::min(N, info.nc), info.nr)) * k_step;
+		if (b_buffer.size() < b_size)
+		{
+			b_buffer.resize(b_size);
+		}
+
+		int32_t tile[max_tile_size];
+
+		for (int jc = 0; jc < N; jc += info.nc)
+		{
+			const int nc = std::min(info.nc, N - jc);
+
+			for (int pc = 0; pc < K; pc += k_step)
+			{
+				const int kc			= std::min(k_step, K - pc);
+				const bool accumulate	= pc > 0;
+				const int8_t * a_block	= packed_A + static_cast<size_t>(pc) * m_padded;
+
+				pack_b_image(kc, nc, in, pc, col0 + jc, info.nr, b_buffer.data());
+
+				for (int jr = 0; jr < nc; jr += info.nr)
+				{
+					const int cols = std::min(info.nr, nc - jr);
+					const uint8_t * b_panel = b_buffer.data() + jr * kc;
+
+					for (int ir = 0; ir < M; ir += info.mr)
+					{
+						const int rows = std::min(info.mr, M - ir);
+						const int8_t * a_panel = a_block + ir * kc;
+						int32_t * c = C + ir * ldc + jc + jr;
+
+						if (rows == info.mr and cols == info.nr)
+						{
+							info.microkernel(kc / 4, a_panel, b_panel, c, ldc, accumulate);
+						}
+						else
+						{
+							// partial tile along the edge of C
+							info.microkernel(kc / 4, a_panel, b_panel, tile, info.nr, false);
+							for (int i = 0; i < rows; i ++)
+							{
+								for (int j = 0; j < cols; j ++)
+								{
+									c[i * ldc + j] = accumulate ? c[i * ldc + j] + tile[i * info.nr + j] : tile[i * info.nr + j];
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+
+bool gemm_int8_set_kernel(Darknet::EInt8Kernel kernel)
+{
+	TAT(TATPARMS);
+
+	if (kernel == Darknet::EInt8Kernel::AUTO)
+	{
+		kernel =
+			is_supported(Darknet::EInt8Kernel::AVX512VNNI)	? Darknet::EInt8Kernel::AVX512VNNI	:
+			is_supported(Darknet::EInt8Kernel::AVX512BW)	? Darknet::EInt8Kernel::AVX512BW	:
+			is_supported(Darknet::EInt8Kernel::AVX2)		? Darknet::EInt8Kernel::AVX2		:
+			Darknet::EInt8Kernel::GENERIC;
+	}
+
+	if (not is_supported(kernel))
+	{
+		return false;
+	}
+
+	selected_kernel = find_kernel(kernel);
+
+	return true;
+}
+
+
+Darknet::EInt8Kernel gemm_int8_kernel()
+{
+	TAT(TATPARMS);
+
+	const Int8KernelInfo * info = selected_kernel.load(std::memory_order_relaxed);
+	if (info == nullptr)
+	{
+		gemm_int8_set_kernel(Darknet::EInt8Kernel::AUTO);
+		info = selected_kernel.load();
+	}
+
+	return info->type;
+}
+
+
+const char * gemm_int8_kernel_name(const Darknet::EInt8Kernel kernel)
+{
+	TAT(TATPARMS);
+
+	if (kernel == Darknet::EInt8Kernel::AUTO)
+	{
+		return "auto";
+	}
+
+	const Int8KernelInfo * info = find_kernel(kernel);
+
+	return info ? info->name : "unavailable";
+}
+
+
+int gemm_int8_weight_limit(const Darknet::EInt8Kernel kernel)
+{
+	TAT(TATPARMS);
+
+	return get_kernel(kernel).weight_limit;
+}
+
+
+size_t gemm_int8_prepack_a_size(const Darknet::EInt8Kernel kernel, const int M, const int K)
+{
+	TAT(TATPARMS);
+
+	return static_cast<size_t>(round_up(M, get_kernel(kernel).mr)) * K;
+}
+
+
+void gemm_int8_prepack_a(const Darknet::EInt8Kernel kernel, const int M, const int K, const int8_t *A, const int lda, int8_t *packed_A)
+{
+	TAT(TATPARMS);
+
+	const Int8KernelInfo & info = get_kernel(kernel);
+
+	if (K % 4)
+	{
+		throw std::invalid_argument("the depth of an INT8 GEMM must be a multiple of 4");
+	}
+
+	// one block for each slice of K, and each block has the panels for all of M
+	const int m_padded	= round_up(M, info.mr);
+	const int k_step	= k_block_size(info, K);
+	for (int pc = 0; pc < K; pc += k_step)
+	{
+		const int kc = std::min(k_step, K - pc);
+		pack_a(M, kc, A + pc, lda, info.mr, packed_A + static_cast<size_t>(pc) * m_padded);
+	}
+}
+
+
+void gemm_int8_prepacked_implicit(const Darknet::EInt8Kernel kernel, int M,
+		const int8_t *packed_A,
+		const Darknet::QuantizedConvolutionInput & input,
+		int32_t *C, int ldc)
+{
+	TAT(TATPARMS);
+
+	const Int8KernelInfo & info = get_kernel(kernel);
+
+	const int N = input.out_w * input.out_h;
+	const int K = input.ksize * input.ksize * input.channels;
+	if (M <= 0 or N <= 0 or K <= 0)
+	{
+		return;
+	}
+
+	const int threads = Darknet::parallel_threads();
+
+	// each thread computes all the rows of a range of output pixels, so the packed input is never shared
+	const int n_panels	= (N + info.nr - 1) / info.nr;
+	const int parts		= std::max(1, std::min(threads, n_panels));
+	const int n_step	= round_up((N + parts - 1) / parts, info.nr);
+
+	if (parts == 1)
+	{
+		gemm_int8_rectangle(info, M, N, K, packed_A, input, 0, C, ldc);
+		return;
+	}
+
+	Darknet::parallel_for(parts, [&](const int part)
+	{
+		const int j0 = part * n_step;
+		if (j0 < N)
+		{
+			gemm_int8_rectangle(info, M, std::min(n_step, N - j0), K, packed_A, input, j0, C + j0, ldc);
+		}
+	});
+}
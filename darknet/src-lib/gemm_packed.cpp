@@ -0,0 +1,985 @@
+/** @file
+ * Cache-blocked single-precision GEMM with packed panels and register-tiled microkernels, in the style of GotoBLAS.
+ *
+ * For each @p KC x @p NC block of @p B (sized for the L3 cache) and each @p MC x @p KC block of @p A (sized for the L2
+ * cache), both blocks are copied into panels laid out in the exact order in which the microkernel reads them:  @p A in
+ * panels of @p MR rows and @p B in panels of @p NR columns.  The microkernel keeps an entire @p MR x @p NR tile of @p C
+ * in registers while it walks through @p KC, so the innermost loop is nothing but loads, broadcasts, and FMAs.
+ *
+ * The AVX2 and AVX-512 microkernels are compiled with function-level target attributes, so both exist in the same
+ * binary and the one to use is selected at runtime.
+ *
+ * When a @ref Darknet::GemmEpilogue is given, the bias, the activation, and the sum of a @p [shortcut] layer are applied
+ * to each block of @p C as soon as its last block of @p K has been multiplied, while the block is still in the cache,
+ * instead of each of them reading and writing the entire output of the layer again.
+ *
+ * Matrices packed ahead of time by @ref gemm_prepack_a() may be stored as 16-bit @p fp16 or @p bf16 values.  Each block
+ * of such a matrix is widened into the per-thread @p A buffer right before it is used, which is the same amount of work
+ * as packing a block of a plain matrix, so the microkernels only ever see single precision panels.
+ */
+
+#include "gemm.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define DARKNET_GEMM_X86
+#endif
+
+#if defined(__GNUC__)
+#define DARKNET_GEMM_TARGET(features) __attribute__((target(features)))
+#else
+#define DARKNET_GEMM_TARGET(features)
+#endif
+
+
+namespace
+{
+	/// Computes @p C += @p A * @p B for one full @p MR x @p NR tile, where @p A and @p B are packed panels.
+	using Microkernel = void (*)(const int kc, const float * a, const float * b, float * c, const int ldc);
+
+	struct GemmKernelInfo
+	{
+		Darknet::EGemmKernel type;
+		const char * name;
+		int mr;						///< rows of @p C computed by the microkernel
+		int nr;						///< columns of @p C computed by the microkernel
+		int mc;						///< rows of @p A packed at once (L2 cache)
+		int kc;						///< depth of the packed panels (the @p B panel stays in the L1 cache)
+		int nc;						///< columns of @p B packed at once (L3 cache)
+		Microkernel microkernel;
+	};
+
+	/// Largest @p MR x @p NR of all the microkernels, used for the partial tiles along the edges of @p C.
+	constexpr int max_tile_size = 12 * 32;
+
+	// Note there is no TAT() in the microkernels or in the packing:  they are called for every tile.
+
+	template <int MR, int NR>
+	void microkernel_generic(const int kc, const float * a, const float * b, float * c, const int ldc)
+	{
+		float acc[MR][NR] = {};
+
+		for (int p = 0; p < kc; p ++)
+		{
+			for (int i = 0; i < MR; i ++)
+			{
+				const float a_i = a[i];
+				for (int j = 0; j < NR; j ++)
+				{
+					acc[i][j] += a_i * b[j];
+				}
+			}
+			a += MR;
+			b += NR;
+		}
+
+		for (int i = 0; i < MR; i ++)
+		{
+			for (int j = 0; j < NR; j ++)
+			{
+				c[i * ldc + j] += acc[i][j];
+			}
+		}
+	}
+
+#ifdef DARKNET_GEMM_X86
+
+	/// 6 rows x 16 columns:  12 accumulators + 2 for @p B + 1 broadcast = 15 of the 16 @p ymm registers.
+	DARKNET_GEMM_TARGET("avx2,fma")
+	void microkernel_avx2_6x16(const int kc, const float * a, const float * b, float * c, const int ldc)
+	{
+		#define GEMM_AVX2_LOAD(r)													\
+			__m256 c##r##_0 = _mm256_loadu_ps(c + r * ldc);						\
+			__m256 c##r##_1 = _mm256_loadu_ps(c + r * ldc + 8);
+
+		#define GEMM_AVX2_FMA(r)													\
+			a_r = _mm256_broadcast_ss(a + r);										\
+			c##r##_0 = _mm256_fmadd_ps(a_r, b_0, c##r##_0);							\
+			c##r##_1 = _mm256_fmadd_ps(a_r, b_1, c##r##_1);
+
+		#define GEMM_AVX2_STORE(r)													\
+			_mm256_storeu_ps(c + r * ldc, c##r##_0);								\
+			_mm256_storeu_ps(c + r * ldc + 8, c##r##_1);
+
+		GEMM_AVX2_LOAD(0) GEMM_AVX2_LOAD(1) GEMM_AVX2_LOAD(2)
+		GEMM_AVX2_LOAD(3) GEMM_AVX2_LOAD(4) GEMM_AVX2_LOAD(5)
+
+		for (int p = 0; p < kc; p ++)
+		{
+			const __m256 b_0 = _mm256_loadu_ps(b);
+			const __m256 b_1 = _mm256_loadu_ps(b + 8);
+			__m256 a_r;
+
+			GEMM_AVX2_FMA(0) GEMM_AVX2_FMA(1) GEMM_AVX2_FMA(2)
+			GEMM_AVX2_FMA(3) GEMM_AVX2_FMA(4) GEMM_AVX2_FMA(5)
+
+			a += 6;
+			b += 16;
+		}
+
+		GEMM_AVX2_STORE(0) GEMM_AVX2_STORE(1) GEMM_AVX2_STORE(2)
+		GEMM_AVX2_STORE(3) GEMM_AVX2_STORE(4) GEMM_AVX2_STORE(5)
+
+		#undef GEMM_AVX2_LOAD
+		#undef GEMM_AVX2_FMA
+		#undef GEMM_AVX2_STORE
+	}
+
+	/// 12 rows x 32 columns:  24 accumulators + 2 for @p B + 1 broadcast = 27 of the 32 @p zmm registers.
+	DARKNET_GEMM_TARGET("avx512f")
+	void microkernel_avx512_12x32(const int kc, const float * a, const float * b, float * c, const int ldc)
+	{
+		#define GEMM_AVX512_LOAD(r)													\
+			__m512 c##r##_0 = _mm512_loadu_ps(c + r * ldc);						\
+			__m512 c##r##_1 = _mm512_loadu_ps(c + r * ldc + 16);
+
+		#define GEMM_AVX512_FMA(r)													\
+			a_r = _mm512_set1_ps(a[r]);												\
+			c##r##_0 = _mm512_fmadd_ps(a_r, b_0, c##r##_0);							\
+			c##r##_1 = _mm512_fmadd_ps(a_r, b_1, c##r##_1);
+
+		#define GEMM_AVX512_STORE(r)												\
+			_mm512_storeu_ps(c + r * ldc, c##r##_0);								\
+			_mm512_storeu_ps(c + r * ldc + 16, c##r##_1);
+
+		GEMM_AVX512_LOAD(0) GEMM_AVX512_LOAD(1) GEMM_AVX512_LOAD(2)  GEMM_AVX512_LOAD(3)
+		GEMM_AVX512_LOAD(4) GEMM_AVX512_LOAD(5) GEMM_AVX512_LOAD(6)  GEMM_AVX512_LOAD(7)
+		GEMM_AVX512_LOAD(8) GEMM_AVX512_LOAD(9) GEMM_AVX512_LOAD(10) GEMM_AVX512_LOAD(11)
+
+		for (int p = 0; p < kc; p ++)
+		{
+			const __m512 b_0 = _mm512_loadu_ps(b);
+			const __m512 b_1 = _mm512_loadu_ps(b + 16);
+			__m512 a_r;
+
+			GEMM_AVX512_FMA(0) GEMM_AVX512_FMA(1) GEMM_AVX512_FMA(2)  GEMM_AVX512_FMA(3)
+			GEMM_AVX512_FMA(4) GEMM_AVX512_FMA(5) GEMM_AVX512_FMA(6)  GEMM_AVX512_FMA(7)
+			GEMM_AVX512_FMA(8) GEMM_AVX512_FMA(9) GEMM_AVX512_FMA(10) GEMM_AVX512_FMA(11)
+
+			a += 12;
+			b += 32;
+		}
+
+		GEMM_AVX512_STORE(0) GEMM_AVX512_STORE(1) GEMM_AVX512_STORE(2)  GEMM_AVX512_STORE(3)
+		GEMM_AVX512_STORE(4) GEMM_AVX512_STORE(5) GEMM_AVX512_STORE(6)  GEMM_AVX512_STORE(7)
+		GEMM_AVX512_STORE(8) GEMM_AVX512_STORE(9) GEMM_AVX512_STORE(10) GEMM_AVX512_STORE(11)
+
+		#undef GEMM_AVX512_LOAD
+		#undef GEMM_AVX512_FMA
+		#undef GEMM_AVX512_STORE
+	}
+
+#endif // DARKNET_GEMM_X86
+
+	const GemmKernelInfo all_kernels[] =
+	{
+		//	type							name				mr	nr	mc		kc		nc		microkernel
+		{Darknet::EGemmKernel::GENERIC	,	"generic 4x8"	,	4,	8,	128,	256,	2048,	microkernel_generic<4, 8>	},
+#ifdef DARKNET_GEMM_X86
+		{Darknet::EGemmKernel::AVX2		,	"avx2 6x16"		,	6,	16,	144,	256,	3072,	microkernel_avx2_6x16		},
+		{Darknet::EGemmKernel::AVX512	,	"avx512 12x32"	,	12,	32,	144,	192,	3072,	microkernel_avx512_12x32	},
+#endif
+	};
+
+	std::atomic<const GemmKernelInfo *> selected_kernel(nullptr);
+
+	const GemmKernelInfo * find_kernel(const Darknet::EGemmKernel type)
+	{
+		TAT(TATPARMS);
+
+		for (const auto & info : all_kernels)
+		{
+			if (info.type == type)
+			{
+				return &info;
+			}
+		}
+
+		return nullptr;
+	}
+
+	bool is_supported(const Darknet::EGemmKernel type)
+	{
+		TAT(TATPARMS);
+
+		switch (type)
+		{
+			case Darknet::EGemmKernel::GENERIC:	return true;
+			case Darknet::EGemmKernel::AVX2:	return is_fma_avx2() == 1 and find_kernel(type) != nullptr;
+			case Darknet::EGemmKernel::AVX512:	return is_avx512() == 1 and find_kernel(type) != nullptr;
+			default:							return false;
+		}
+	}
+
+	const GemmKernelInfo & current_kernel()
+	{
+		TAT(TATPARMS);
+
+		const GemmKernelInfo * info = selected_kernel.load(std::memory_order_relaxed);
+		if (info == nullptr)
+		{
+			gemm_packed_set_kernel(Darknet::EGemmKernel::AUTO);
+			info = selected_kernel.load();
+		}
+
+		return *info;
+	}
+
+	inline int round_up(const int value, const int multiple)
+	{
+		return (value + multiple - 1) / multiple * multiple;
+	}
+
+	/// Copy a @p mc x @p kc block of @p A (scaled by @p alpha) into panels of @p mr rows, padding the last panel with zeros.
+	void pack_a(const int mc, const int kc, const float * A, const int lda, const float alpha, const int mr, float * dst)
+	{
+		for (int ir = 0; ir < mc; ir += mr)
+		{
+			const int rows = std::min(mr, mc - ir);
+			for (int i = 0; i < rows; i ++)
+			{
+				const float * src = A + (ir + i) * lda;
+				for (int p = 0; p < kc; p ++)
+				{
+					dst[p * mr + i] = alpha * src[p];
+				}
+			}
+			for (int i = rows; i < mr; i ++)
+			{
+				for (int p = 0; p < kc; p ++)
+				{
+					dst[p * mr + i] = 0.0f;
+				}
+			}
+			dst += mr * kc;
+		}
+	}
+
+	/// Round to the nearest half precision value, where overflow becomes infinity and tiny values become subnormals.
+	uint16_t float_to_fp16(const float value)
+	{
+		uint32_t x;
+		std::memcpy(&x, &value, sizeof(x));
+
+		const uint16_t sign = (x >> 16) & 0x8000;
+		x &= 0x7fffffff;
+
+		if (x > 0x7f800000)
+		{
+			return sign | 0x7e00;	// NaN
+		}
+		if (x >= 0x477ff000)
+		{
+			return sign | 0x7c00;	// 65520 and above round to infinity
+		}
+		if (x < 0x38800000)
+		{
+			// below 2^-14 the half precision value is a subnormal, which is a multiple of 2^-24
+			return sign | static_cast<uint16_t>(std::nearbyint(std::fabs(value) * 16777216.0f));
+		}
+
+		// change the exponent bias from 127 to 15, and round the mantissa from 23 to 10 bits with ties to even
+		x -= 112u << 23;
+		x += 0x0fff + ((x >> 13) & 1);
+
+		return sign | static_cast<uint16_t>(x >> 13);
+	}
+
+	float fp16_to_float(const uint16_t half)
+	{
+		const uint32_t sign		= static_cast<uint32_t>(half & 0x8000) << 16;
+		const uint32_t exponent	= (half >> 10) & 0x1f;
+		const uint32_t mantissa	= half & 0x03ff;
+
+		if (exponent == 0)
+		{
+			const float value = mantissa / 16777216.0f;
+			return sign ? -value : value;
+		}
+
+		const uint32_t x = sign | (exponent == 31 ? 0x7f800000 : (exponent + 112) << 23) | (mantissa << 13);
+		float value;
+		std::memcpy(&value, &x, sizeof(value));
+
+		return value;
+	}
+
+	/// Round to the nearest bfloat16 value, which is a single precision float without the lower 16 bits of the mantissa.
+	uint16_t float_to_bf16(const float value)
+	{
+		uint32_t x;
+		std::memcpy(&x, &value, sizeof(x));
+
+		if ((x & 0x7fffffff) > 0x7f800000)
+		{
+			return static_cast<uint16_t>((x >> 16) | 0x0040);	// NaN
+		}
+
+		x += 0x7fff + ((x >> 16) & 1);
+
+		return static_cast<uint16_t>(x >> 16);
+	}
+
+	float bf16_to_float(const uint16_t bf16)
+	{
+		const uint32_t x = static_cast<uint32_t>(bf16) << 16;
+		float value;
+		std::memcpy(&value, &x, sizeof(value));
+
+		return value;
+	}
+
+	/// Convert @p count 16-bit values to single precision.
+	using Widen = void (*)(const uint16_t * src, const size_t count, float * dst);
+
+	void widen_fp16_generic(const uint16_t * src, const size_t count, float * dst)
+	{
+		for (size_t i = 0; i < count; i ++)
+		{
+			dst[i] = fp16_to_float(src[i]);
+		}
+	}
+
+	void widen_bf16_generic(const uint16_t * src, const size_t count, float * dst)
+	{
+		for (size_t i = 0; i < count; i ++)
+		{
+			dst[i] = bf16_to_float(src[i]);
+		}
+	}
+
+#ifdef DARKNET_GEMM_X86
+
+	DARKNET_GEMM_TARGET("avx2,f16c")
+	void widen_fp16_avx2(const uint16_t * src, const size_t count, float * dst)
+	{
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			_mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i))));
+		}
+		widen_fp16_generic(src + i, count - i, dst + i);
+	}
+
+	DARKNET_GEMM_TARGET("avx2")
+	void widen_bf16_avx2(const uint16_t * src, const size_t count, float * dst)
+	{
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256i x = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+			_mm256_storeu_ps(dst + i, _mm256_castsi256_ps(_mm256_slli_epi32(x, 16)));
+		}
+		widen_bf16_generic(src + i, count - i, dst + i);
+	}
+
+	DARKNET_GEMM_TARGET("avx512f")
+	void widen_fp16_avx512(const uint16_t * src, const size_t count, float * dst)
+	{
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			_mm512_storeu_ps(dst + i, _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i))));
+		}
+		widen_fp16_generic(src + i, count - i, dst + i);
+	}
+
+	DARKNET_GEMM_TARGET("avx512f")
+	void widen_bf16_avx512(const uint16_t * src, const size_t count, float * dst)
+	{
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			const __m512i x = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i)));
+			_mm512_storeu_ps(dst + i, _mm512_castsi512_ps(_mm512_slli_epi32(x, 16)));
+		}
+		widen_bf16_generic(src + i, count - i, dst + i);
+	}
+
+#endif // DARKNET_GEMM_X86
+
+	Widen find_widen(const Darknet::EWeightFormat format)
+	{
+		TAT(TATPARMS);
+
+		const bool bf16 = (format == Darknet::EWeightFormat::BF16);
+
+#ifdef DARKNET_GEMM_X86
+		if (is_avx512() == 1)
+		{
+			return bf16 ? widen_bf16_avx512 : widen_fp16_avx512;
+		}
+		if (is_fma_avx2() == 1 and (bf16 or is_f16c() == 1))
+		{
+			return bf16 ? widen_bf16_avx2 : widen_fp16_avx2;
+		}
+#endif
+
+		return bf16 ? widen_bf16_generic : widen_fp16_generic;
+	}
+
+	/// The fastest conversion supported by the CPU for one of the 16-bit formats.
+	Widen widen_function(const Darknet::EWeightFormat format)
+	{
+		static const Widen widen_fp16 = find_widen(Darknet::EWeightFormat::FP16);
+		static const Widen widen_bf16 = find_widen(Darknet::EWeightFormat::BF16);
+
+		return format == Darknet::EWeightFormat::BF16 ? widen_bf16 : widen_fp16;
+	}
+
+	/** Copy a @p kc x @p nc block of @p B into panels of @p nr columns, padding the last panel with zeros.  @p B is read
+	 * one row at a time so the reads are sequential even when @p B is much larger than the caches.
+	 */
+	void pack_b(const int kc, const int nc, const float * B, const int ldb, const int nr, float * dst)
+	{
+		const int full_cols = nc / nr * nr;
+
+		for (int p = 0; p < kc; p ++)
+		{
+			const float * src = B + p * ldb;
+			float * panel = dst + p * nr;
+			for (int jr = 0; jr < full_cols; jr += nr)
+			{
+				std::memcpy(panel, src + jr, nr * sizeof(float));
+				panel += kc * nr;
+			}
+			if (full_cols < nc)
+			{
+				const int cols = nc - full_cols;
+				std::memcpy(panel, src + full_cols, cols * sizeof(float));
+				std::fill(panel + cols, panel + nr, 0.0f);
+			}
+		}
+	}
+
+	/** Same as @ref pack_b() but for the implicit im2col matrix of a convolution:  row @p k of @p B is channel @p k /
+	 * (ksize x ksize) shifted by the filter offset of @p k, and column @p j is output pixel @p j.  Each element is read
+	 * straight from the input image, or is zero when it falls in the padding.
+	 */
+	void pack_b_image(const int kc, const int nc, const Darknet::ConvolutionInput & in, const int row0, const int col0, const int nr, float * dst)
+	{
+		const int kernel_area = in.ksize * in.ksize;
+
+		for (int p = 0; p < kc; p ++)
+		{
+			const int row		= row0 + p;
+			const int channel	= row / kernel_area;
+			const int ky		= (row % kernel_area) / in.ksize;
+			const int kx		= row % in.ksize;
+			const float * im	= in.image + static_cast<size_t>(channel) * in.height * in.width;
+
+			// first and last output columns for which the input column is within the image
+			const int x_offset	= kx * in.dilation - in.pad;
+			const int ox_first	= std::max(0, (-x_offset + in.stride_x - 1) / in.stride_x);
+			const int ox_last	= std::min(in.out_w, (in.width - x_offset + in.stride_x - 1) / in.stride_x);
+
+			float * panel	= dst + p * nr;
+			int lane		= 0;
+
+			// write the next few columns of this row of B, continuing in the next panel when this one is full
+			auto fill_zeros = [&](int count)
+			{
+				while (count > 0)
+				{
+					const int chunk = std::min(count, nr - lane);
+					std::fill(panel + lane, panel + lane + chunk, 0.0f);
+					count -= chunk;
+					lane += chunk;
+					if (lane == nr)
+					{
+						lane = 0;
+						panel += kc * nr;
+					}
+				}
+			};
+			auto copy_pixels = [&](const float * src, int count)
+			{
+				while (count > 0)
+				{
+					const int chunk = std::min(count, nr - lane);
+					if (in.stride_x == 1)
+					{
+						std::memcpy(panel + lane, src, chunk * sizeof(float));
+					}
+					else
+					{
+						for (int t = 0; t < chunk; t ++)
+						{
+							panel[lane + t] = src[t * in.stride_x];
+						}
+					}
+					src += chunk * in.stride_x;
+					count -= chunk;
+					lane += chunk;
+					if (lane == nr)
+					{
+						lane = 0;
+						panel += kc * nr;
+					}
+				}
+			};
+
+			// each output row is split into the left padding, the pixels within the image, and the right padding
+			int oy = col0 / in.out_w;
+			int ox = col0 % in.out_w;
+			for (int j = 0; j < nc; oy ++, ox = 0)
+			{
+				const int end	= ox + std::min(nc - j, in.out_w - ox);
+				const int iy	= oy * in.stride_y - in.pad + ky * in.dilation;
+				j += end - ox;
+
+				if (iy < 0 or iy >= in.height)
+				{
+					fill_zeros(end - ox);
+					continue;
+				}
+
+				const int first	= std::min(end, std::max(ox, ox_first));
+				const int last	= std::max(first, std::min(end, ox_last));
+				fill_zeros(first - ox);
+				copy_pixels(im + static_cast<size_t>(iy) * in.width + first * in.stride_x + x_offset, last - first);
+				fill_zeros(end - last);
+			}
+
+			if (lane)
+			{
+				std::fill(panel + lane, panel + nr, 0.0f);
+			}
+		}
+	}
+
+	/// Multiply a packed block of @p A with a packed block of @p B, one microkernel tile at a time.
+	void macro_kernel(const GemmKernelInfo & info, const int mc, const int nc, const int kc, const float * a_packed, const float * b_packed, float * C, const int ldc)
+	{
+		const int mr = info.mr;
+		const int nr = info.nr;
+
+		float tile[max_tile_size];
+
+		for (int jr = 0; jr < nc; jr += nr)
+		{
+			const int cols = std::min(nr, nc - jr);
+			const float * b_panel = b_packed + jr * kc;
+
+			for (int ir = 0; ir < mc; ir += mr)
+			{
+				const int rows = std::min(mr, mc - ir);
+				const float * a_panel = a_packed + ir * kc;
+				float * c = C + ir * ldc + jr;
+
+				if (rows == mr and cols == nr)
+				{
+					info.microkernel(kc, a_panel, b_panel, c, ldc);
+				}
+				else
+				{
+					// partial tile along the edge of C
+					std::fill(tile, tile + mr * nr, 0.0f);
+					info.microkernel(kc, a_panel, b_panel, tile, nr);
+					for (int i = 0; i < rows; i ++)
+					{
+						for (int j = 0; j < cols; j ++)
+						{
+							c[i * ldc + j] += tile[i * nr + j];
+						}
+					}
+				}
+			}
+		}
+	}
+
+	/** Split K evenly instead of leaving a thin block at the end, e.g., 288 is done as 2 x 144 instead of 256 + 32.
+	 * Matrices packed by @ref gemm_prepack_a() use the same blocks.
+	 */
+	int k_block_size(const GemmKernelInfo & info, const int K)
+	{
+		const int k_blocks = (K + info.kc - 1) / info.kc;
+
+		return (K + k_blocks - 1) / k_blocks;
+	}
+
+	/// Apply the epilogue to @p rows x @p cols values of @p C.  The bias and the added matrix start at the same place as @p C.
+	void apply_epilogue(const Darknet::GemmEpilogue & e, const int rows, const int cols, float * C, const int ldc)
+	{
+		for (int i = 0; i < rows; i ++)
+		{
+			float * c = C + static_cast<size_t>(i) * ldc;
+
+			if (e.bias)
+			{
+				const float bias = e.bias[i];
+				for (int j = 0; j < cols; j ++)
+				{
+					c[j] += bias;
+				}
+			}
+
+			activate_array_simd(c, cols, e.activation);
+
+			if (e.add)
+			{
+				const float * add = e.add + static_cast<size_t>(i) * ldc;
+				for (int j = 0; j < cols; j ++)
+				{
+					c[j] += add[j];
+				}
+
+				activate_array_simd(c, cols, e.add_activation);
+			}
+		}
+	}
+
+	/// The same epilogue for the block of @p C which starts at @p row and @p col.
+	Darknet::GemmEpilogue offset_epilogue(const Darknet::GemmEpilogue & e, const int row, const int col, const int ldc)
+	{
+		Darknet::GemmEpilogue result = e;
+		if (result.bias)
+		{
+			result.bias += row;
+		}
+		if (result.add)
+		{
+			result.add += static_cast<size_t>(row) * ldc + col;
+		}
+
+		return result;
+	}
+
+	/** The @p A matrix is either a plain row-major matrix which gets packed one block at a time, or an entire matrix which
+	 * was packed ahead of time by @ref gemm_prepack_a().
+	 */
+	struct OperandA
+	{
+		const float * A;		///< plain row-major matrix, or @p nullptr when @ref packed is used
+		int lda;
+		float alpha;
+		const float * packed;	///< matrix from @ref gemm_prepack_a(), or @p nullptr
+		int m_padded;			///< rows of @ref packed, rounded up to a multiple of @p MR
+		Darknet::EWeightFormat format;	///< precision of @ref packed
+	};
+
+	/// The @p B matrix is either a plain row-major matrix, or the implicit im2col matrix of a convolution.
+	struct OperandB
+	{
+		const float * B;						///< plain row-major matrix, or @p nullptr when @ref image is used
+		int ldb;
+		const Darknet::ConvolutionInput * image;	///< input of the convolution, or @p nullptr
+	};
+
+	/** Single-threaded blocked GEMM over @p M rows and @p N columns of @p C, starting at row @p row0 of @p A and column
+	 * @p col0 of @p B.  The @p epilogue (if any) starts at the same place as @p C.
+	 */
+	void gemm_packed_rectangle(const GemmKernelInfo & info, const int M, const int N, const int K, const OperandA & a, const int row0, const OperandB & b, const int col0, float * C, const int ldc, const Darknet::GemmEpilogue * epilogue)
+	{
+		TAT(TATPARMS);
+
+		// the packing buffers are kept per thread so steady-state inference does not allocate
+		thread_local std::vector<float> a_buffer;
+		thread_local std::vector<float> b_buffer;
+
+		// 16-bit matrices are widened into the A buffer one block at a time
+		const bool widen = (a.packed and a.format != Darknet::EWeightFormat::FP32);
+
+		const size_t a_size = static_cast<size_t>(round_up(std::min(M, info.mc), info.mr)) * std::min(K, info.kc);
+		const size_t b_size = static_cast<size_t>(round_up(std::min(N, info.nc), info.nr)) * std::min(K, info.kc);
+		if ((a.packed == nullptr or widen) and a_buffer.size() < a_size)
+		{
+			a_buffer.resize(a_size);
+		}
+		if (b_buffer.size() < b_size)
+		{
+			b_buffer.resize(b_size);
+		}
+
+		const int k_step = k_block_size(info, K);
+
+		for (int jc = 0; jc < N; jc += info.nc)
+		{
+			const int nc = std::min(info.nc, N - jc);
+
+			for (int pc = 0; pc < K; pc += k_step)
+			{
+				const int kc = std::min(k_step, K - pc);
+				if (b.image)
+				{
+					pack_b_image(kc, nc, *b.image, pc, col0 + jc, info.nr, b_buffer.data());
+				}
+				else
+				{
+					pack_b(kc, nc, b.B + pc * b.ldb + col0 + jc, b.ldb, info.nr, b_buffer.data());
+				}
+
+				for (int ic = 0; ic < M; ic += info.mc)
+				{
+					const int mc = std::min(info.mc, M - ic);
+
+					const float * a_block = a_buffer.data();
+					if (a.packed)
+					{
+						const size_t offset = static_cast<size_t>(pc) * a.m_padded + static_cast<size_t>(row0 + ic) * kc;
+						if (widen)
+						{
+							const size_t count = static_cast<size_t>(round_up(mc, info.mr)) * kc;
+							widen_function(a.format)(reinterpret_cast<const uint16_t *>(a.packed) + offset, count, a_buffer.data());
+						}
+						else
+						{
+							a_block = a.packed + offset;
+						}
+					}
+					else
+					{
+						pack_a(mc, kc, a.A + (row0 + ic) * a.lda + pc, a.lda, a.alpha, info.mr, a_buffer.data());
+					}
+
+					float * c_block = C + ic * ldc + jc;
+					if (epilogue and pc == 0)
+					{
+						// C is overwritten, so clear each block right before it is first used instead of clearing all of C
+						for (int i = 0; i < mc; i ++)
+						{
+							std::fill(c_block + i * ldc, c_block + i * ldc + nc, 0.0f);
+						}
+					}
+
+					macro_kernel(info, mc, nc, kc, a_block, b_buffer.data(), c_block, ldc);
+
+					if (epilogue and pc + kc >= K)
+					{
+						// this block of C is complete and still in the cache
+						apply_epilogue(offset_epilogue(*epilogue, ic, jc, ldc), mc, nc, c_block, ldc);
+					}
+				}
+			}
+		}
+	}
+
+	void gemm_blocked(const GemmKernelInfo & info, const int M, const int N, const int K, const OperandA & a, const OperandB & b, float * C, const int ldc, const Darknet::GemmEpilogue * epilogue = nullptr)
+	{
+		TAT(TATPARMS);
+
+		if (M <= 0 or N <= 0 or K <= 0)
+		{
+			return;
+		}
+
+		const int threads = Darknet::parallel_threads();
+
+		// Split C into one rectangle per thread.  For convolutions N is the output width x height which is usually the
+		// large dimension, so split the columns first, and only split the rows when there are not enough columns.
+		const int n_panels	= (N + info.nr - 1) / info.nr;
+		const int m_panels	= (M + info.mr - 1) / info.mr;
+		const int n_parts	= std::max(1, std::min(threads, n_panels / 4));
+		const int m_parts	= std::max(1, std::min(threads / n_parts, m_panels));
+		const int n_step	= round_up((N + n_parts - 1) / n_parts, info.nr);
+		const int m_step	= round_up((M + m_parts - 1) / m_parts, info.mr);
+		const int parts		= n_parts * m_parts;
+
+		if (parts == 1)
+		{
+			gemm_packed_rectangle(info, M, N, K, a, 0, b, 0, C, ldc, epilogue);
+			return;
+		}
+
+		Darknet::parallel_for(parts, [&](const int part)
+		{
+			const int i0 = (part / n_parts) * m_step;
+			const int j0 = (part % n_parts) * n_step;
+			if (i0 < M and j0 < N)
+			{
+				const Darknet::GemmEpilogue part_epilogue = epilogue ? offset_epilogue(*epilogue, i0, j0, ldc) : Darknet::GemmEpilogue();
+				gemm_packed_rectangle(info, std::min(m_step, M - i0), std::min(n_step, N - j0), K, a, i0, b, j0, C + i0 * ldc + j0, ldc, epilogue ? &part_epilogue : nullptr);
+			}
+		});
+	}
+}
+
+
+bool gemm_packed_set_kernel(Darknet::EGemmKernel kernel)
+{
+	TAT(TATPARMS);
+
+	if (kernel == Darknet::EGemmKernel::AUTO)
+	{
+		kernel =
+			is_supported(Darknet::EGemmKernel::AVX512)	? Darknet::EGemmKernel::AVX512	:
+			is_supported(Darknet::EGemmKernel::AVX2)	? Darknet::EGemmKernel::AVX2	:
+			Darknet::EGemmKernel::GENERIC;
+	}
+
+	if (not is_supported(kernel))
+	{
+		return false;
+	}
+
+	selected_kernel = find_kernel(kernel);
+
+	return true;
+}
+
+
+Darknet::EGemmKernel gemm_packed_kernel()
+{
+	TAT(TATPARMS);
+
+	return current_kernel().type;
+}
+
+
+const char * gemm_packed_kernel_name(const Darknet::EGemmKernel kernel)
+{
+	TAT(TATPARMS);
+
+	if (kernel == Darknet::EGemmKernel::AUTO)
+	{
+		return "auto";
+	}
+
+	const GemmKernelInfo * info = find_kernel(kernel);
+
+	return info ? info->name : "unavailable";
+}
+
+
+void gemm_packed(int M, int N, int K, float ALPHA,
+		const float *A, int lda,
+		const float *B, int ldb,
+		float *C, int ldc)
+{
+	TAT(TATPARMS);
+
+	const OperandA a = {A, lda, ALPHA, nullptr, 0, Darknet::EWeightFormat::FP32};
+	const OperandB b = {B, ldb, nullptr};
+
+	gemm_blocked(current_kernel(), M, N, K, a, b, C, ldc);
+}
+
+
+const char * gemm_weight_format_name(const Darknet::EWeightFormat format)
+{
+	TAT(TATPARMS);
+
+	switch (format)
+	{
+		case Darknet::EWeightFormat::FP32:	return "fp32";
+		case Darknet::EWeightFormat::FP16:	return "fp16";
+		case Darknet::EWeightFormat::BF16:	return "bf16";
+	}
+
+	return "unknown";
+}
+
+
+size_t gemm_prepack_a_size(const Darknet::EGemmKernel kernel, const Darknet::EWeightFormat format, const int M, const int K)
+{
+	TAT(TATPARMS);
+
+	const GemmKernelInfo * info = find_kernel(kernel);
+	if (info == nullptr)
+	{
+		throw std::invalid_argument("cannot pack a matrix for an unavailable GEMM kernel");
+	}
+
+	const size_t values = static_cast<size_t>(round_up(M, info->mr)) * K;
+
+	return format == Darknet::EWeightFormat::FP32 ? values : (values + 1) / 2;
+}
+
+
+void gemm_prepack_a(const Darknet::EGemmKernel kernel, const Darknet::EWeightFormat format, const int M, const int K, const float *A, const int lda, float *packed_A)
+{
+	TAT(TATPARMS);
+
+	const GemmKernelInfo * info = find_kernel(kernel);
+	if (info == nullptr)
+	{
+		throw std::invalid_argument("cannot pack a matrix for an unavailable GEMM kernel");
+	}
+
+	// one block for each slice of K, and each block has the panels for all of M
+	const int m_padded	= round_up(M, info->mr);
+	const int k_step	= k_block_size(*info, K);
+
+	// the 16-bit formats are packed as single precision first, and then rounded
+	std::vector<float> block(format == Darknet::EWeightFormat::FP32 ? 0 : static_cast<size_t>(m_padded) * k_step);
+	uint16_t * packed16 = reinterpret_cast<uint16_t *>(packed_A);
+
+	for (int pc = 0; pc < K; pc += k_step)
+	{
+		const int kc = std::min(k_step, K - pc);
+		const size_t offset = static_cast<size_t>(pc) * m_padded;
+
+		if (format == Darknet::EWeightFormat::FP32)
+		{
+			pack_a(M, kc, A + pc, lda, 1.0f, info->mr, packed_A + offset);
+			continue;
+		}
+
+		pack_a(M, kc, A + pc, lda, 1.0f, info->mr, block.data());
+		for (size_t i = 0; i < static_cast<size_t>(m_padded) * kc; i ++)
+		{
+			packed16[offset + i] = (format == Darknet::EWeightFormat::FP16) ? float_to_fp16(block[i]) : float_to_bf16(block[i]);
+		}
+	}
+}
+
+
+void gemm_prepacked(const Darknet::EGemmKernel kernel, const Darknet::EWeightFormat format, int M, int N, int K,
+		const float *packed_A,
+		const float *B, int ldb,
+		float *C, int ldc,
+		const Darknet::GemmEpilogue *epilogue)
+{
+	TAT(TATPARMS);
+
+	const GemmKernelInfo * info = find_kernel(kernel);
+	if (info == nullptr)
+	{
+		throw std::invalid_argument("cannot multiply a matrix packed for an unavailable GEMM kernel");
+	}
+
+	const OperandA a = {nullptr, 0, 1.0f, packed_A, round_up(M, info->mr), format};
+	const OperandB b = {B, ldb, nullptr};
+
+	gemm_blocked(*info, M, N, K, a, b, C, ldc, epilogue);
+}
+
+
+void gemm_prepacked_implicit(const Darknet::EGemmKernel kernel, const Darknet::EWeightFormat format, int M,
+		const float *packed_A,
+		const Darknet::ConvolutionInput & input,
+		float *C, int ldc,
+		const Darknet::GemmEpilogue *epilogue)
+{
+	TAT(TATPARMS);
+
+	const GemmKernelInfo * info = find_kernel(kernel);
+	if (info == nullptr)
+	{
+		throw std::invalid_argument("cannot multiply a matrix packed for an unavailable GEMM kernel");
+	}
+
+	const OperandA a = {nullptr, 0, 1.0f, packed_A, round_up(M, info->mr), format};
+	const OperandB b = {nullptr, 0, &input};
+
+	gemm_blocked(*info, M, input.out_w * input.out_h, input.channels * input.ksize * input.ksize, a, b, C, ldc, epilogue);
+}
+
+
+bool gemm_epilogue_supports(const ACTIVATION activation)
+{
+	TAT(TATPARMS);
+
+	return
+		activation != NORM_CHAN			and
+		activation != NORM_CHAN_SOFTMAX	and
+		activation != NORM_CHAN_SOFTMAX_MAXVAL;
+}
+
+
+void gemm_apply_epilogue(const Darknet::GemmEpilogue & epilogue, int M, int N, float *C, int ldc)
+{
+	// no TAT() since this is called for every tile
+
+	apply_epilogue(epilogue, M, N, C, ldc);
+}
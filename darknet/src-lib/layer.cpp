@@ -71,6 +71,19 @@ namespace
 		return;
 	}
 
+	void static inline free_and_clear(int8_t* & ptr)
+	{
+		TAT(TATPARMS);
+
+		if (ptr)
+		{
+			free(ptr);
+			ptr = nullptr;
+		}
+
+		return;
+	}
+
 	void static inline free_sublayer(Darknet::Layer* & l)
 	{
 		TAT(TATPARMS);
@@ -183,6 +196,12 @@ void free_layer_custom(Darknet::Layer & l, int keep_cudnn_desc)
 	if (l.weights_ema)					free_and_clear(l.weights_ema);
 	if (l.weights)						free_and_clear(l.weights);
 	if (l.weight_updates)				free_and_clear(l.weight_updates);
+	if (l.packed_weights)				free_and_clear(l.packed_weights);
+	if (l.winograd_weights)				free_and_clear(l.winograd_weights);
+	if (l.nchwc_weights)				free_and_clear(l.nchwc_weights);
+	if (l.int8_weights)					free_and_clear(l.int8_weights);
+	if (l.int8_scales)					free_and_clear(l.int8_scales);
+	if (l.int8_offsets)					free_and_clear(l.int8_offsets);
 	if (l.align_bit_weights)			free_and_clear(l.align_bit_weights);
 	if (l.mean_arr)						free_and_clear(l.mean_arr);
 
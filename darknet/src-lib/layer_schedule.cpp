@@ -0,0 +1,305 @@
+/** @file
+ * Run the independent branches of a network at the same time during CPU inference.
+ *
+ * The CPU kernels split each layer between the threads of the network (see @ref Darknet::parallel_for()), which works
+ * well for the large layers.  But the CSP, PAN and SPP blocks of the larger networks are made of several branches with
+ * many small layers, and a layer with only a few million operations spends almost as long waking up the threads and
+ * waiting for the slowest one as it does working.  Those small layers are better off running at the same time as the
+ * small layers of the other branches, each of them on a single thread.
+ *
+ * The schedule is built from the memory each layer reads and writes:  the outputs of the layers listed by
+ * @ref get_layer_inputs() (plus the output of the @p [shortcut] added by a fused convolution) are read, and the output
+ * of the layer itself (or that of the fused @p [shortcut]) is written.  Two layers stay in order when one of them
+ * writes memory which the other one reads or writes.  Since this uses the addresses and not only the layer indexes,
+ * the outputs shared by @ref plan_inference_memory() are handled the same way:  a layer which reuses the output of a
+ * layer which is no longer needed waits for the last layer which reads it.
+ *
+ * Each layer goes in the first step which comes after all of the layers it must follow.  The large layers of a step
+ * then run one at a time using all of the threads, and the small ones run at the same time, one layer per thread.
+ * Since each layer still runs exactly the same code on exactly the same inputs, the outputs are identical to running
+ * the layers one at a time.
+ */
+
+#include "layer_schedule.hpp"
+
+
+namespace
+{
+	static auto & cfg_and_state = Darknet::CfgAndState::get();
+
+	/** Layers with fewer operations than this for each thread run on a single thread at the same time as other layers,
+	 * instead of being split between all of the threads.
+	 */
+	constexpr double small_layer_operations = 1.0e6;
+
+
+	/// A range of memory read or written by a layer.
+	struct Span
+	{
+		uintptr_t begin;
+		uintptr_t end;
+	};
+
+
+	Span output_span(const Darknet::Layer & l)
+	{
+		TAT(TATPARMS);
+
+		const uintptr_t begin = reinterpret_cast<uintptr_t>(l.output);
+
+		return {begin, begin + static_cast<size_t>(l.outputs) * l.batch * sizeof(float)};
+	}
+
+
+	bool overlap(const std::vector<Span> & lhs, const std::vector<Span> & rhs)
+	{
+		TAT(TATPARMS);
+
+		for (const auto & a : lhs)
+		{
+			for (const auto & b : rhs)
+			{
+				if (a.begin < b.end and b.begin < a.end)
+				{
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+
+	/// Rough number of operations done by a layer, only used to tell the small layers from the large ones.
+	double estimated_operations(const Darknet::Layer & l)
+	{
+		TAT(TATPARMS);
+
+		const double outputs = static_cast<double>(l.outputs) * l.batch;
+
+		switch (l.type)
+		{
+			case Darknet::ELayerType::CONVOLUTIONAL:
+			{
+				return l.bflops * 1.0e9 * l.batch;
+			}
+			case Darknet::ELayerType::CONNECTED:
+			{
+				return 2.0 * l.inputs * outputs;
+			}
+			case Darknet::ELayerType::MAXPOOL:
+			case Darknet::ELayerType::LOCAL_AVGPOOL:
+			{
+				return outputs * l.size * l.size;
+			}
+			default:
+			{
+				return outputs;
+			}
+		}
+	}
+
+
+	/// Run one layer the same way as @ref forward_network().
+	void run_layer(Darknet::Network & net, Darknet::NetworkState state, const int index, float * workspace)
+	{
+		// no TAT() here since the time is counted by the layer
+
+		state.index		= index;
+		state.workspace	= workspace;
+		if (index > 0)
+		{
+			state.input = net.layers[index - 1].output;
+		}
+
+		Darknet::Layer & l = net.layers[index];
+		l.forward(l, state);
+
+		return;
+	}
+
+
+	bool is_current(const Darknet::LayerSchedule & schedule, const Darknet::Network & net, const int threads)
+	{
+		TAT(TATPARMS);
+
+		if (schedule.threads != threads or schedule.workspace != net.workspace or schedule.outputs.size() != static_cast<size_t>(net.n))
+		{
+			return false;
+		}
+
+		for (int i = 0; i < net.n; ++i)
+		{
+			if (schedule.outputs[i] != net.layers[i].output)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+
+Darknet::LayerSchedule build_layer_schedule(const Darknet::Network & net, const int threads)
+{
+	TAT(TATPARMS);
+
+	Darknet::LayerSchedule schedule;
+	schedule.concurrent_layers	= 0;
+	schedule.workspace			= net.workspace;
+	schedule.threads			= threads;
+	for (int i = 0; i < net.n; ++i)
+	{
+		schedule.outputs.push_back(net.layers[i].output);
+	}
+
+	const int n = net.n;
+	for (int i = 0; i < n; ++i)
+	{
+		if (not layer_reads_only_its_inputs(net.layers[i]))
+		{
+			return schedule;
+		}
+	}
+
+	// the memory read and written by each layer
+	const auto inputs = get_layer_inputs(net);
+	std::vector<std::vector<Span>> reads(n);
+	std::vector<std::vector<Span>> writes(n);
+	for (int i = 0; i < n; ++i)
+	{
+		const Darknet::Layer & l = net.layers[i];
+		for (const int p : inputs[i])
+		{
+			if (p >= 0)
+			{
+				reads[i].push_back(output_span(net.layers[p]));
+			}
+		}
+		writes[i].push_back(output_span(l));
+
+		if (l.fused_shortcut and i + 1 < n)
+		{
+			// the convolution writes the output of the shortcut, and reads what the shortcut adds
+			const Darknet::Layer & shortcut = net.layers[i + 1];
+			reads[i].push_back(output_span(net.layers[shortcut.input_layers[0]]));
+			writes[i].push_back(output_span(shortcut));
+		}
+	}
+
+	// each layer goes in the step after the last layer it must follow
+	Darknet::VInt level(n, 0);
+	int levels = 0;
+	for (int j = 0; j < n; ++j)
+	{
+		for (int k = 0; k < j; ++k)
+		{
+			if (level[k] >= level[j] and (overlap(writes[j], reads[k]) or overlap(writes[j], writes[k]) or overlap(reads[j], writes[k])))
+			{
+				level[j] = level[k] + 1;
+			}
+		}
+		levels = std::max(levels, level[j] + 1);
+	}
+
+	std::vector<Darknet::VInt> layers_of_level(levels);
+	for (int i = 0; i < n; ++i)
+	{
+		layers_of_level[level[i]].push_back(i);
+	}
+
+	// the large layers run by themselves on all of the threads, and the small ones run at the same time
+	std::vector<size_t> workspace_sizes;
+	for (const auto & layers : layers_of_level)
+	{
+		Darknet::VInt small;
+		for (const int i : layers)
+		{
+			if (layers.size() > 1 and estimated_operations(net.layers[i]) < threads * small_layer_operations)
+			{
+				small.push_back(i);
+			}
+			else
+			{
+				schedule.steps.push_back({i});
+			}
+		}
+
+		if (small.size() == 1)
+		{
+			schedule.steps.push_back(small);
+		}
+		else if (small.size() > 1)
+		{
+			// the first layer uses the network workspace, so it goes to the layer which needs the most
+			std::stable_sort(small.begin(), small.end(), [&](const int a, const int b) { return net.layers[a].workspace_size > net.layers[b].workspace_size; });
+			for (size_t idx = 1; idx < small.size(); idx ++)
+			{
+				workspace_sizes.resize(std::max(workspace_sizes.size(), idx));
+				workspace_sizes[idx - 1] = std::max(workspace_sizes[idx - 1], net.layers[small[idx]].workspace_size);
+			}
+
+			schedule.concurrent_layers += small.size();
+			schedule.steps.push_back(small);
+		}
+	}
+
+	for (const size_t size : workspace_sizes)
+	{
+		schedule.workspaces.emplace_back(std::max(size_t(1), (size + sizeof(float) - 1) / sizeof(float)));
+	}
+
+	return schedule;
+}
+
+
+bool run_layer_schedule(Darknet::Network & net, Darknet::NetworkState state)
+{
+	TAT(TATPARMS);
+
+	if (state.train or net.details == nullptr or cfg_and_state.gpu_index >= 0 or cfg_and_state.is_set("noschedule"))
+	{
+		return false;
+	}
+
+	const int threads = Darknet::parallel_threads();
+	if (threads < 2)
+	{
+		return false;
+	}
+
+	auto & schedule = net.details->layer_schedule;
+	if (not schedule or not is_current(*schedule, net, threads))
+	{
+		schedule = std::make_shared<Darknet::LayerSchedule>(build_layer_schedule(net, threads));
+
+		if (cfg_and_state.is_verbose and schedule->concurrent_layers)
+		{
+			*cfg_and_state.output
+				<< "Scheduled " << schedule->concurrent_layers << " of " << net.n << " layers to run at the same time as other layers,"
+				<< " using " << schedule->steps.size() << " steps." << std::endl;
+		}
+	}
+
+	if (schedule->concurrent_layers == 0)
+	{
+		return false;
+	}
+
+	for (const auto & step : schedule->steps)
+	{
+		if (step.size() == 1)
+		{
+			run_layer(net, state, step[0], net.workspace);
+			continue;
+		}
+
+		Darknet::parallel_for(step.size(), [&](const int idx)
+		{
+			run_layer(net, state, step[idx], idx == 0 ? net.workspace : schedule->workspaces[idx - 1].data());
+		});
+	}
+
+	return true;
+}
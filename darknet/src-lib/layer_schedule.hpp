@@ -0,0 +1,51 @@
+#pragma once
+
+/** @file
+ * Run the independent branches of a network at the same time during CPU inference.  See layer_schedule.cpp for details.
+ */
+
+#include "darknet_internal.hpp"
+
+
+namespace Darknet
+{
+	/** The order in which @ref run_layer_schedule() runs the layers of a network.
+	 * @since 2026-10-17
+	 */
+	struct LayerSchedule
+	{
+		/// The layers in the order they run.  When a step has more than one layer, they run at the same time.
+		std::vector<VInt> steps;
+
+		/// The extra workspaces used when several layers run at the same time.  The first one uses the network workspace.
+		std::vector<std::vector<float>> workspaces;
+
+		/// Number of layers which run at the same time as other layers.  The schedule is not used when this is zero.
+		int concurrent_layers;
+
+		/// What the schedule was built for, so it can be built again when the outputs move or the pool changes.
+		std::vector<const float *> outputs;
+		const float * workspace;
+		int threads;
+	};
+}
+
+
+/** Decide which layers can run at the same time when @p net runs on @p threads threads.  Two layers are kept in order
+ * when one of them reads or writes memory which the other one writes, which includes the layer outputs shared by
+ * @ref plan_inference_memory().
+ *
+ * @since 2026-10-17
+ */
+Darknet::LayerSchedule build_layer_schedule(const Darknet::Network & net, const int threads);
+
+/** Run the layers of @p net for inference the same way as @ref forward_network(), except the small layers of the
+ * branches which don't depend on each other run at the same time on the threads of the network.  The outputs are the
+ * same as when the layers run one at a time.
+ *
+ * @returns @p false without running anything when the layers should run one at a time, such as when training, using
+ * the GPU, using @p --noschedule, or when the network has no independent branches
+ *
+ * @since 2026-10-17
+ */
+bool run_layer_schedule(Darknet::Network & net, Darknet::NetworkState state);
@@ -1,4 +1,5 @@
 #include "gemm.hpp"
+#include "nchwc.hpp"
 #include "darknet_internal.hpp"
 
 namespace
@@ -256,6 +257,12 @@ void forward_maxpool_layer(Darknet::Layer & l, Darknet::NetworkState state)
 {
 	TAT(TATPARMS);
 
+	if (l.nchwc_block and not state.train)
+	{
+		forward_maxpool_layer_nchwc(l, state);
+		return;
+	}
+
 	if (l.maxpool_depth)
 	{
 		int b, i, j, k, g;
@@ -287,9 +294,9 @@ void forward_maxpool_layer(Darknet::Layer & l, Darknet::NetworkState state)
 	}
 
 
-	if (!state.train && l.stride_x == l.stride_y)
+	if (!state.train)
 	{
-		forward_maxpool_layer_avx(state.input, l.output, l.indexes, l.size, l.w, l.h, l.out_w, l.out_h, l.c, l.pad, l.stride, l.batch);
+		maxpool_cpu(state.input, l.batch, l.c, l.h, l.w, l.size, l.stride_x, l.stride_y, l.pad, l.out_h, l.out_w, l.output);
 	}
 	else
 	{
@@ -0,0 +1,303 @@
+/** @file
+ * Shared layer output buffers for CPU inference.
+ *
+ * Every layer normally allocates its own output when the network is created, and keeps it for the life of the network,
+ * even though most outputs are only read by the next layer.  The @p [route] layers then copy the outputs of the layers
+ * they concatenate into yet another buffer.  With one network (or execution context) per camera, all of this is
+ * multiplied by the number of cameras.
+ *
+ * The planner first decides where each output goes relative to the other layers:
+ *
+ * - The inputs of a @p [route] layer are written directly at their offset inside the output of the route, so the route
+ *   has nothing left to copy.  Each layer can only be placed inside of one route; the other routes still copy it.
+ * - A @p [route] layer with a single input (typically to take one group of channels) points at that part of its input.
+ * - A convolutional layer which writes the sum of the following @p [shortcut] layer (see @ref fuse_conv_epilogues())
+ *   never writes its own output, so it points at the output of the shortcut.
+ *
+ * This only works with a batch size of @p 1, since a batch of outputs is not laid out the way a batch of routes is.
+ * The layers which end up pointing inside of the same output form a tree, and the layer at the root decides the size.
+ * A liveness analysis then finds the first layer which writes into each tree and the last layer which reads from it,
+ * and the trees which are never needed at the same time share the same memory.  The outputs of the YOLO layers and of
+ * the last layer are kept until the end, since they are read once the network has finished.
+ *
+ * The layers read each other's outputs through @ref Darknet::Layer::output when they run, so nothing else needs to
+ * change other than the @p [route] layers skipping the copies which are already in place (see
+ * @ref forward_route_layer()) and the list of outputs kept by the @p [shortcut] layers.
+ */
+
+#include "memory_plan.hpp"
+
+
+namespace
+{
+	static auto & cfg_and_state = Darknet::CfgAndState::get();
+
+
+	/// Outputs which are read once the network has finished.
+	bool is_network_output(const Darknet::Network & net, const int index)
+	{
+		TAT(TATPARMS);
+
+		const auto type = net.layers[index].type;
+
+		return
+			index + 1 == net.n							or
+			type == Darknet::ELayerType::YOLO			or
+			type == Darknet::ELayerType::GAUSSIAN_YOLO	or
+			type == Darknet::ELayerType::REGION;
+	}
+
+
+	size_t output_size(const Darknet::Layer & l)
+	{
+		TAT(TATPARMS);
+
+		return static_cast<size_t>(l.outputs) * l.batch;
+	}
+
+
+	void point_shortcuts_at_outputs(Darknet::Network & net)
+	{
+		TAT(TATPARMS);
+
+		for (int i = 0; i < net.n; ++i)
+		{
+			Darknet::Layer & l = net.layers[i];
+			if (l.type == Darknet::ELayerType::SHORTCUT and l.layers_output)
+			{
+				for (int j = 0; j < l.n; ++j)
+				{
+					l.layers_output[j] = net.layers[l.input_layers[j]].output;
+				}
+			}
+		}
+		net.output = net.layers[net.n - 1].output;
+
+		return;
+	}
+
+
+	bool release(Darknet::Network & net, const bool reallocate)
+	{
+		TAT(TATPARMS);
+
+		if (net.details == nullptr or net.details->activation_arena == nullptr)
+		{
+			return false;
+		}
+
+		for (int i = 0; i < net.n; ++i)
+		{
+			Darknet::Layer & l = net.layers[i];
+			l.output = reallocate ? (float*)xcalloc(output_size(l), sizeof(float)) : nullptr;
+		}
+
+		free(net.details->activation_arena);
+		net.details->activation_arena = nullptr;
+
+		if (reallocate)
+		{
+			point_shortcuts_at_outputs(net);
+		}
+
+		return true;
+	}
+}
+
+
+Darknet::ActivationMemory plan_inference_memory(Darknet::Network & net)
+{
+	TAT(TATPARMS);
+
+	release(net, true);
+
+	Darknet::ActivationMemory result = {0, 0, 0, 0};
+	for (int i = 0; i < net.n; ++i)
+	{
+		if (net.layers[i].type != Darknet::ELayerType::DROPOUT)
+		{
+			result.unplanned_bytes += output_size(net.layers[i]) * sizeof(float);
+		}
+	}
+	result.planned_bytes = result.unplanned_bytes;
+	result.buffers = net.n;
+
+	if (net.n == 0 or net.details == nullptr or cfg_and_state.gpu_index >= 0)
+	{
+		return result;
+	}
+
+	for (int i = 0; i < net.n; ++i)
+	{
+		if (not layer_reads_only_its_inputs(net.layers[i]))
+		{
+			return result;
+		}
+	}
+
+	const int n = net.n;
+	auto inputs = get_layer_inputs(net);
+
+	// The layer which contains the output of each layer, and where.  -1 means the layer has its own output.
+	Darknet::VInt parent(n, -1);
+	std::vector<size_t> offset(n, 0);
+
+	for (int i = 0; i + 1 < n; ++i)
+	{
+		const Darknet::Layer & l = net.layers[i];
+		if (l.fused_shortcut)
+		{
+			// the convolution writes the output of the shortcut, and reads what the shortcut adds
+			parent[i] = i + 1;
+			inputs[i].push_back(net.layers[i + 1].input_layers[0]);
+		}
+	}
+
+	// Routes are visited in order, so the route itself cannot have been placed yet and no loops can be created.
+	for (int i = 0; i < n; ++i)
+	{
+		const Darknet::Layer & l = net.layers[i];
+		if (l.type != Darknet::ELayerType::ROUTE or l.batch != 1)
+		{
+			continue;
+		}
+
+		if (l.n == 1)
+		{
+			parent[i] = l.input_layers[0];
+			offset[i] = static_cast<size_t>(l.input_sizes[0] / l.groups) * l.group_id;
+			result.zero_copy_routes ++;
+		}
+		else if (l.groups == 1)
+		{
+			bool all_in_place = true;
+			size_t position = 0;
+			for (int j = 0; j < l.n; ++j)
+			{
+				const int index = l.input_layers[j];
+				if (parent[index] < 0)
+				{
+					parent[index] = i;
+					offset[index] = position;
+				}
+				else
+				{
+					all_in_place = false;
+				}
+				position += l.input_sizes[j];
+			}
+
+			if (all_in_place)
+			{
+				result.zero_copy_routes ++;
+			}
+		}
+	}
+
+	// The root of the tree for each layer, and the offset from the start of the root.
+	Darknet::VInt root(n);
+	std::vector<size_t> position(n);
+	for (int i = 0; i < n; ++i)
+	{
+		root[i] = i;
+		position[i] = 0;
+		while (parent[root[i]] >= 0)
+		{
+			position[i] += offset[root[i]];
+			root[i] = parent[root[i]];
+		}
+	}
+
+	// The first layer which writes into each tree, and the last one which reads from it.
+	Darknet::VInt first(n, n);
+	Darknet::VInt last(n, -1);
+	for (int i = 0; i < n; ++i)
+	{
+		const int r = root[i];
+		first[r] = std::min(first[r], i);
+		last[r] = std::max(last[r], is_network_output(net, i) ? n : i);
+		for (const int p : inputs[i])
+		{
+			if (p >= 0)
+			{
+				last[root[p]] = std::max(last[root[p]], i);
+			}
+		}
+	}
+
+	// Place the largest trees first.  Each one goes in the first gap which is big enough between the trees already
+	// placed which are needed at the same time.  Sizes are rounded up to 64 bytes so every output is aligned the same.
+	const auto aligned_size = [&](const int r) { return (output_size(net.layers[r]) + 15) / 16 * 16; };
+
+	Darknet::VInt roots;
+	for (int i = 0; i < n; ++i)
+	{
+		if (root[i] == i)
+		{
+			roots.push_back(i);
+		}
+	}
+	std::stable_sort(roots.begin(), roots.end(), [&](const int a, const int b) { return aligned_size(a) > aligned_size(b); });
+
+	std::vector<size_t> start(n, 0);
+	size_t arena_size = 0;
+	Darknet::VInt placed;
+	for (const int r : roots)
+	{
+		std::vector<std::pair<size_t, size_t>> used;
+		for (const int p : placed)
+		{
+			if (first[p] <= last[r] and first[r] <= last[p])
+			{
+				used.push_back({start[p], start[p] + aligned_size(p)});
+			}
+		}
+		std::sort(used.begin(), used.end());
+
+		size_t candidate = 0;
+		for (const auto & [begin, end] : used)
+		{
+			if (candidate + aligned_size(r) <= begin)
+			{
+				break;
+			}
+			candidate = std::max(candidate, end);
+		}
+
+		start[r] = candidate;
+		arena_size = std::max(arena_size, candidate + aligned_size(r));
+		placed.push_back(r);
+	}
+
+	net.details->activation_arena = (float*)xcalloc(std::max(arena_size, size_t(1)), sizeof(float));
+	for (int i = 0; i < n; ++i)
+	{
+		Darknet::Layer & l = net.layers[i];
+		free(l.output);
+		l.output = net.details->activation_arena + start[root[i]] + position[i];
+	}
+	point_shortcuts_at_outputs(net);
+
+	result.planned_bytes = arena_size * sizeof(float);
+	result.buffers = roots.size();
+
+	return result;
+}
+
+
+bool release_inference_memory(Darknet::Network & net)
+{
+	TAT(TATPARMS);
+
+	return release(net, true);
+}
+
+
+void free_inference_memory(Darknet::Network & net)
+{
+	TAT(TATPARMS);
+
+	release(net, false);
+
+	return;
+}
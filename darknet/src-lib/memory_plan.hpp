@@ -0,0 +1,51 @@
+#pragma once
+
+/** @file
+ * Shared layer output buffers for CPU inference.  See memory_plan.cpp for details.
+ */
+
+#include "darknet_internal.hpp"
+
+
+namespace Darknet
+{
+	/** Size of the layer outputs before and after @ref plan_inference_memory().
+	 * @since 2026-10-17
+	 */
+	struct ActivationMemory
+	{
+		size_t unplanned_bytes;	///< every layer with its own output
+		size_t planned_bytes;	///< the single buffer shared by all the layers
+		int buffers;			///< number of separate buffers placed inside of the shared one
+		int zero_copy_routes;	///< @p [route] layers where every input is already in place, so nothing is copied
+	};
+}
+
+
+/** Replace the output of every layer with a place inside of a single buffer, which is stored in
+ * @ref Darknet::NetworkDetails::activation_arena.  The inputs of the @p [route] layers are written directly into the
+ * output of the route, and layers whose outputs are never needed at the same time share the same memory.  Only used
+ * for CPU inference, and only when every layer type is understood.  Any previous plan is released first, so this can
+ * be called again once the layers have been resized.
+ *
+ * @returns the size of the layer outputs before and after, which is the same when the network cannot be planned
+ *
+ * @since 2026-10-17
+ */
+Darknet::ActivationMemory plan_inference_memory(Darknet::Network & net);
+
+/** Give every layer its own output again, so the layers can be resized.  Does nothing if
+ * @ref plan_inference_memory() was not called.
+ *
+ * @returns @p true if the network had been planned
+ *
+ * @since 2026-10-17
+ */
+bool release_inference_memory(Darknet::Network & net);
+
+/** Free the buffer allocated by @ref plan_inference_memory(), and clear the output of every layer so it is not freed
+ * a second time.  Called when the network is freed.
+ *
+ * @since 2026-10-17
+ */
+void free_inference_memory(Darknet::Network & net);
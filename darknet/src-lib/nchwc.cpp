@@ -0,0 +1,797 @@
+/** @file
+ * Blocked "NCHWc" activation layout for CPU inference.
+ *
+ * In the usual NCHW layout every channel is a separate plane, so the values which a convolution combines for one
+ * output pixel are a whole plane apart.  The NCHWc layout groups the channels into blocks of @p B (16 with AVX-512,
+ * 8 otherwise) and stores the @p B values of each pixel next to each other:
+ *
+ *     NCHW:   [channel][y][x]
+ *     NCHWc:  [channel / B][y][x][channel % B]
+ *
+ * so a single vector register holds one pixel of @p B channels, and a cache line holds entire vectors instead of 16
+ * neighbouring pixels of a single channel.
+ *
+ * The convolution is computed directly, without im2col or a GEMM:  up to 12 output pixels for 2 blocks of filters are
+ * kept in registers, and for every input channel and filter tap the weights of the filters are loaded once and
+ * multiplied with a broadcast of each input pixel.  The weights are rearranged when the network is loaded so they are
+ * read sequentially.  The input is first copied into the workspace with the padding filled in, so the kernels never
+ * check the bounds.  Pooling and upsampling work on entire blocks.  The route and shortcut layers don't need anything
+ * special:  when the number of channels of each input is a multiple of @p B, slicing and concatenating channels and
+ * adding tensors of the same shape are the same memory operations in both layouts.
+ *
+ * A layer only produces a blocked output when every layer which reads it can read the blocked layout, so the first
+ * convolutional layer converts the NCHW network input, and the convolutional layers which feed the YOLO heads write
+ * the usual NCHW layout.
+ */
+
+#include "nchwc.hpp"
+#include "gemm.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define DARKNET_NCHWC_X86
+#endif
+
+#if defined(__GNUC__)
+#define DARKNET_NCHWC_TARGET(features) __attribute__((target(features)))
+#else
+#define DARKNET_NCHWC_TARGET(features)
+#endif
+
+
+namespace
+{
+	static auto & cfg_and_state = Darknet::CfgAndState::get();
+
+	/// Approximate number of output pixels computed by each task of the convolution.
+	constexpr int pixels_per_task = 256;
+
+	/** Everything the convolution kernels need to know about the input.  The input has already been padded, so the
+	 * kernels never need to check the bounds.
+	 */
+	struct ConvolutionArgs
+	{
+		size_t in_block_stride;		///< distance between blocks of input channels
+		int in_blocks;				///< number of blocks of input channels (1 when the input is NCHW)
+		int in_lanes;				///< number of input channels per block (all of them when the input is NCHW)
+		int in_lane_stride;			///< distance between the input channels of a block
+		int in_pixel_stride;		///< distance between horizontal neighbours in the input
+		int in_row_stride;			///< distance between vertical neighbours in the input
+		int size;
+		int dilation;
+		int step;					///< distance between the inputs of neighbouring output pixels
+	};
+
+	// Note there is no TAT() in the kernels:  they are called for every few pixels.
+	//
+	// Each kernel computes XT output pixels for NB blocks of B filters, where the top-left filter tap of the first
+	// pixel is @p in and the other pixels are @p a.step further along.  The weights of each block are read
+	// sequentially, see rearrange_convolutional_weights(), and the blocks are @p block_stride apart.  The sums start
+	// from @p init, which is either the biases (with an @p init_step of zero) or the partial sums of the previous
+	// input channels.  The results are written to @p out as XT groups of NB x B filters.
+
+	template <int XT, int NB>
+	void tile_generic(const ConvolutionArgs & a, const float * in, const float * weights, const size_t block_stride, const float * init, const int init_step, float * out)
+	{
+		constexpr int B = 8;
+		float acc[XT][NB * B];
+		for (int t = 0; t < XT; t ++)
+		{
+			for (int j = 0; j < NB * B; j ++)
+			{
+				acc[t][j] = init[t * init_step + j];
+			}
+		}
+
+		const float * w = weights;
+		for (int cb = 0; cb < a.in_blocks; cb ++)
+		{
+			for (int ky = 0; ky < a.size; ky ++)
+			{
+				for (int kx = 0; kx < a.size; kx ++)
+				{
+					const float * p = in + cb * a.in_block_stride + (ky * a.in_row_stride + kx * a.in_pixel_stride) * a.dilation;
+					for (int c = 0; c < a.in_lanes; c ++)
+					{
+						const float * q = p + c * a.in_lane_stride;
+						for (int t = 0; t < XT; t ++)
+						{
+							const float v = q[t * a.step];
+							for (int k = 0; k < NB; k ++)
+							{
+								for (int j = 0; j < B; j ++)
+								{
+									acc[t][k * B + j] += v * w[k * block_stride + j];
+								}
+							}
+						}
+						w += B;
+					}
+				}
+			}
+		}
+
+		std::memcpy(out, acc, sizeof(acc));
+	}
+
+#ifdef DARKNET_NCHWC_X86
+
+	template <int XT, int NB>
+	DARKNET_NCHWC_TARGET("avx2,fma")
+	void tile_avx2(const ConvolutionArgs & a, const float * in, const float * weights, const size_t block_stride, const float * init, const int init_step, float * out)
+	{
+		// 6 pixels x 2 blocks:  12 accumulators + 2 for the weights + 1 broadcast = 15 of the 16 ymm registers
+		constexpr int B = 8;
+		__m256 acc[XT][NB];
+		for (int t = 0; t < XT; t ++)
+		{
+			for (int k = 0; k < NB; k ++)
+			{
+				acc[t][k] = _mm256_loadu_ps(init + t * init_step + k * B);
+			}
+		}
+
+		const float * w = weights;
+		for (int cb = 0; cb < a.in_blocks; cb ++)
+		{
+			for (int ky = 0; ky < a.size; ky ++)
+			{
+				for (int kx = 0; kx < a.size; kx ++)
+				{
+					const float * p = in + cb * a.in_block_stride + (ky * a.in_row_stride + kx * a.in_pixel_stride) * a.dilation;
+					for (int c = 0; c < a.in_lanes; c ++)
+					{
+						const float * q = p + c * a.in_lane_stride;
+						__m256 w_c[NB];
+						for (int k = 0; k < NB; k ++)
+						{
+							w_c[k] = _mm256_loadu_ps(w + k * block_stride);
+						}
+						for (int t = 0; t < XT; t ++)
+						{
+							const __m256 v = _mm256_broadcast_ss(q + t * a.step);
+							for (int k = 0; k < NB; k ++)
+							{
+								acc[t][k] = _mm256_fmadd_ps(v, w_c[k], acc[t][k]);
+							}
+						}
+						w += B;
+					}
+				}
+			}
+		}
+
+		for (int t = 0; t < XT; t ++)
+		{
+			for (int k = 0; k < NB; k ++)
+			{
+				_mm256_storeu_ps(out + (t * NB + k) * B, acc[t][k]);
+			}
+		}
+	}
+
+	template <int XT, int NB>
+	DARKNET_NCHWC_TARGET("avx512f")
+	void tile_avx512(const ConvolutionArgs & a, const float * in, const float * weights, const size_t block_stride, const float * init, const int init_step, float * out)
+	{
+		// 12 pixels x 2 blocks:  24 accumulators + 2 for the weights + 1 broadcast = 27 of the 32 zmm registers
+		constexpr int B = 16;
+		__m512 acc[XT][NB];
+		for (int t = 0; t < XT; t ++)
+		{
+			for (int k = 0; k < NB; k ++)
+			{
+				acc[t][k] = _mm512_loadu_ps(init + t * init_step + k * B);
+			}
+		}
+
+		const float * w = weights;
+		for (int cb = 0; cb < a.in_blocks; cb ++)
+		{
+			for (int ky = 0; ky < a.size; ky ++)
+			{
+				for (int kx = 0; kx < a.size; kx ++)
+				{
+					const float * p = in + cb * a.in_block_stride + (ky * a.in_row_stride + kx * a.in_pixel_stride) * a.dilation;
+					for (int c = 0; c < a.in_lanes; c ++)
+					{
+						const float * q = p + c * a.in_lane_stride;
+						__m512 w_c[NB];
+						for (int k = 0; k < NB; k ++)
+						{
+							w_c[k] = _mm512_loadu_ps(w + k * block_stride);
+						}
+						for (int t = 0; t < XT; t ++)
+						{
+							const __m512 v = _mm512_set1_ps(q[t * a.step]);
+							for (int k = 0; k < NB; k ++)
+							{
+								acc[t][k] = _mm512_fmadd_ps(v, w_c[k], acc[t][k]);
+							}
+						}
+						w += B;
+					}
+				}
+			}
+		}
+
+		for (int t = 0; t < XT; t ++)
+		{
+			for (int k = 0; k < NB; k ++)
+			{
+				_mm512_storeu_ps(out + (t * NB + k) * B, acc[t][k]);
+			}
+		}
+	}
+
+#endif
+
+	using TileFunction = void (*)(const ConvolutionArgs & a, const float * in, const float * weights, const size_t block_stride, const float * init, const int init_step, float * out);
+
+	/// A kernel and the number of pixels it computes.
+	struct Tile
+	{
+		int pixels;
+		TileFunction function;
+	};
+
+	/// The kernels of one instruction set, from the widest to a single pixel, for 1 and 2 blocks of filters.
+	struct TileKernels
+	{
+		Tile one_block[5];
+		Tile two_blocks[5];
+	};
+
+	const TileKernels & tile_kernels(const int block)
+	{
+		TAT(TATPARMS);
+
+		static const TileKernels generic =
+		{
+			{{4, tile_generic<4, 1>}, {2, tile_generic<2, 1>}, {1, tile_generic<1, 1>}},
+			{{4, tile_generic<4, 2>}, {2, tile_generic<2, 2>}, {1, tile_generic<1, 2>}}
+		};
+
+#ifdef DARKNET_NCHWC_X86
+		static const TileKernels avx2 =
+		{
+			{{12, tile_avx2<12, 1>}, {8, tile_avx2<8, 1>}, {4, tile_avx2<4, 1>}, {2, tile_avx2<2, 1>}, {1, tile_avx2<1, 1>}},
+			{{6, tile_avx2<6, 2>}, {4, tile_avx2<4, 2>}, {2, tile_avx2<2, 2>}, {1, tile_avx2<1, 2>}}
+		};
+
+		static const TileKernels avx512 =
+		{
+			{{12, tile_avx512<12, 1>}, {8, tile_avx512<8, 1>}, {4, tile_avx512<4, 1>}, {2, tile_avx512<2, 1>}, {1, tile_avx512<1, 1>}},
+			{{12, tile_avx512<12, 2>}, {8, tile_avx512<8, 2>}, {4, tile_avx512<4, 2>}, {2, tile_avx512<2, 2>}, {1, tile_avx512<1, 2>}}
+		};
+
+		if (block == 16)
+		{
+			return avx512;
+		}
+		if (gemm_packed_kernel() != Darknet::EGemmKernel::GENERIC)
+		{
+			return avx2;
+		}
+#endif
+
+		return generic;
+	}
+
+	/** Compute @p count output pixels whose inputs start at @p in and are @p a.step apart, and store them in
+	 * @p partial.  The sums start from @p bias for the first input channels, and from @p partial for the others.
+	 */
+	void convolve_run(const Tile * tiles, const ConvolutionArgs & a, const float * in, const int count, const float * weights, const size_t block_stride, const float * bias, float * partial, const int values)
+	{
+		int t = 0;
+		for (int i = 0; i < 5 and tiles[i].function; i ++)
+		{
+			// the widest kernel as often as possible, then each of the smaller ones at most once
+			while (t + tiles[i].pixels <= count)
+			{
+				float * out = partial + t * values;
+				tiles[i].function(a, in + t * a.step, weights, block_stride, bias ? bias : out, bias ? 0 : values, out);
+				t += tiles[i].pixels;
+			}
+		}
+	}
+
+	/** Copy @p planes planes of @p h x @p w pixels with @p lanes values each into the middle of a larger zero-filled
+	 * buffer with @p pad pixels on all 4 sides.
+	 */
+	void pad_image(const float * src, float * dst, const int planes, const int h, const int w, const int lanes, const int pad)
+	{
+		TAT(TATPARMS);
+
+		const size_t row		= static_cast<size_t>(w + 2 * pad) * lanes;
+		const size_t border		= static_cast<size_t>(pad) * lanes;
+
+		Darknet::parallel_for(planes, [&](const int p)
+		{
+			const float * s = src + static_cast<size_t>(p) * h * w * lanes;
+			float * d = dst + static_cast<size_t>(p) * (h + 2 * pad) * row;
+
+			std::fill(d, d + pad * row, 0.0f);
+			d += pad * row;
+			for (int y = 0; y < h; y ++)
+			{
+				std::fill(d, d + border, 0.0f);
+				std::memcpy(d + border, s, w * lanes * sizeof(float));
+				std::fill(d + border + w * lanes, d + row, 0.0f);
+				s += w * lanes;
+				d += row;
+			}
+			std::fill(d, d + pad * row, 0.0f);
+		});
+	}
+
+	/// Size of the rearranged weights for one block of filters.
+	inline size_t weights_per_block(const Darknet::Layer & l)
+	{
+		return static_cast<size_t>(l.c) * l.size * l.size * l.nchwc_block;
+	}
+
+	/** Rearrange the weights of @p l into @p [filter block][input block][ky][kx][input channel][filter], where the
+	 * input blocks match the layout of the input, followed by the biases padded to a multiple of the block size.
+	 */
+	void rearrange_convolutional_weights(Darknet::Layer & l)
+	{
+		TAT(TATPARMS);
+
+		const int block			= l.nchwc_block;
+		const int kk			= l.size * l.size;
+		const int out_blocks	= (l.n + block - 1) / block;
+		const int in_lanes		= l.nchwc_input ? block : l.c;
+		const size_t per_block	= weights_per_block(l);
+
+		free(l.nchwc_weights);
+		l.nchwc_weights = (float*)xcalloc(out_blocks * (per_block + block), sizeof(float));
+
+		for (int f = 0; f < l.n; f ++)
+		{
+			float * dst = l.nchwc_weights + (f / block) * per_block + f % block;
+			for (int c = 0; c < l.c; c ++)
+			{
+				const int cb = c / in_lanes;
+				const int ci = c % in_lanes;
+				for (int k = 0; k < kk; k ++)
+				{
+					dst[((static_cast<size_t>(cb) * kk + k) * in_lanes + ci) * block] = l.weights[(static_cast<size_t>(f) * l.c + c) * kk + k];
+				}
+			}
+			l.nchwc_weights[out_blocks * per_block + f] = l.biases[f];
+		}
+
+		return;
+	}
+
+	/// Whether @p l can use the blocked layout, regardless of its neighbours.
+	bool is_supported(const Darknet::Network & net, const Darknet::Layer & l, const int block)
+	{
+		TAT(TATPARMS);
+
+		switch (l.type)
+		{
+			case Darknet::ELayerType::CONVOLUTIONAL:
+			{
+				return
+					l.weights != nullptr		and
+					l.int8_weights == nullptr	and	// see int8_prepare_network()
+					not l.xnor					and
+					not l.binary				and
+					l.groups == 1				and
+					not l.batch_normalize		and	// see fuse_conv_batchnorm()
+					not l.antialiasing			and
+					l.activation != NORM_CHAN	and
+					l.activation != NORM_CHAN_SOFTMAX	and
+					l.activation != NORM_CHAN_SOFTMAX_MAXVAL;
+			}
+			case Darknet::ELayerType::MAXPOOL:
+			{
+				return not l.maxpool_depth and not l.antialiasing and l.c % block == 0;
+			}
+			case Darknet::ELayerType::UPSAMPLE:
+			{
+				return not l.reverse and l.c % block == 0;
+			}
+			case Darknet::ELayerType::ROUTE:
+			{
+				for (int i = 0; i < l.n; i ++)
+				{
+					if ((net.layers[l.input_layers[i]].out_c / l.groups) % block)
+					{
+						return false;
+					}
+				}
+				return true;
+			}
+			case Darknet::ELayerType::SHORTCUT:
+			{
+				// only the element-wise sum is the same in both layouts
+				for (int i = 0; i < l.n; i ++)
+				{
+					if (l.input_sizes[i] != l.outputs)
+					{
+						return false;
+					}
+				}
+				return l.nweights == 0 and l.out_c % block == 0;
+			}
+			default:
+			{
+				return false;
+			}
+		}
+	}
+}
+
+
+int nchwc_block_size()
+{
+	TAT(TATPARMS);
+
+	return gemm_packed_kernel() == Darknet::EGemmKernel::AVX512 ? 16 : 8;
+}
+
+
+int nchwc_prepare_network(Darknet::Network & net)
+{
+	TAT(TATPARMS);
+
+	const int block = nchwc_block_size();
+
+	// outputs read by each layer, where -1 is the network input
+	const auto inputs = get_layer_inputs(net);
+	std::vector<std::vector<int>> consumers(net.n);
+	for (int i = 0; i < net.n; i ++)
+	{
+		for (const int p : inputs[i])
+		{
+			if (p >= 0)
+			{
+				consumers[p].push_back(i);
+			}
+		}
+	}
+
+	std::vector<bool> uses_block(net.n);
+	std::vector<bool> blocked_output(net.n);
+	for (int i = 0; i < net.n; i ++)
+	{
+		uses_block[i] = is_supported(net, net.layers[i], block);
+	}
+
+	const auto is_blocked = [&](const int p) { return p >= 0 and blocked_output[p]; };
+
+	// Convolutional layers can read either layout, but the other layers only work when their inputs and output are
+	// all blocked.  Each layer which drops out may force its neighbours to drop out too, so repeat until it settles.
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+
+		for (int i = 0; i < net.n; i ++)
+		{
+			const Darknet::Layer & l = net.layers[i];
+			blocked_output[i] =
+				uses_block[i]			and
+				i + 1 < net.n			and	// the network output is always NCHW
+				l.out_c % block == 0	and
+				std::all_of(consumers[i].begin(), consumers[i].end(), [&](const int c) { return uses_block[c]; });
+		}
+
+		for (int i = 0; i < net.n; i ++)
+		{
+			if (uses_block[i] and net.layers[i].type != Darknet::ELayerType::CONVOLUTIONAL and
+				(not blocked_output[i] or not std::all_of(inputs[i].begin(), inputs[i].end(), is_blocked)))
+			{
+				uses_block[i] = false;
+				changed = true;
+			}
+		}
+	}
+
+	int count = 0;
+	for (int i = 0; i < net.n; i ++)
+	{
+		Darknet::Layer & l = net.layers[i];
+
+		const bool blocked_input = is_blocked(i - 1);
+		if (l.type == Darknet::ELayerType::CONVOLUTIONAL and not blocked_input and not blocked_output[i])
+		{
+			// nothing to gain over the GEMM when neither side is blocked
+			uses_block[i] = false;
+		}
+
+		free(l.nchwc_weights);
+		l.nchwc_weights	= nullptr;
+		l.nchwc_block	= uses_block[i] ? block : 0;
+		l.nchwc_input	= uses_block[i] and blocked_input;
+		l.nchwc_output	= uses_block[i] and blocked_output[i];
+
+		if (not uses_block[i])
+		{
+			continue;
+		}
+
+		count ++;
+
+		if (l.type == Darknet::ELayerType::CONVOLUTIONAL)
+		{
+			rearrange_convolutional_weights(l);
+
+			// the GEMM weights are no longer needed
+			free(l.packed_weights);
+			free(l.winograd_weights);
+			l.packed_weights	= nullptr;
+			l.winograd_weights	= nullptr;
+		}
+	}
+
+	if (cfg_and_state.is_verbose)
+	{
+		*cfg_and_state.output << "Using the NCHW" << block << "c layout for " << count << " of " << net.n << " layers." << std::endl;
+	}
+
+	return count;
+}
+
+
+size_t nchwc_convolutional_workspace_size(const Darknet::Layer & l)
+{
+	TAT(TATPARMS);
+
+	const int pad = l.pad * l.dilation;
+	if (pad == 0)
+	{
+		return 0;
+	}
+
+	return static_cast<size_t>(l.c) * (l.h + 2 * pad) * (l.w + 2 * pad) * sizeof(float);
+}
+
+
+void forward_convolutional_layer_nchwc(Darknet::Layer & l, Darknet::NetworkState state)
+{
+	TAT(TATPARMS);
+
+	const int block			= l.nchwc_block;
+	const auto & kernels	= tile_kernels(block);
+	const int out_blocks	= (l.n + block - 1) / block;
+	const size_t per_block	= weights_per_block(l);
+	const float * biases	= l.nchwc_weights + out_blocks * per_block;
+	const int pad			= l.pad * l.dilation;
+	const int padded_w		= l.w + 2 * pad;
+	const int padded_h		= l.h + 2 * pad;
+	const int lanes			= l.nchwc_input ? block : 1;	// contiguous values per input pixel
+	const size_t plane		= static_cast<size_t>(padded_w) * padded_h * lanes;
+	const size_t out_plane	= static_cast<size_t>(l.out_w) * l.out_h;
+
+	ConvolutionArgs a;
+	a.in_blocks			= l.nchwc_input ? l.c / block : 1;
+	a.in_lanes			= l.nchwc_input ? block : l.c;
+	a.in_block_stride	= plane;
+	a.in_lane_stride	= l.nchwc_input ? 1 : static_cast<int>(plane);
+	a.in_pixel_stride	= lanes;
+	a.in_row_stride		= padded_w * lanes;
+	a.size				= l.size;
+	a.dilation			= l.dilation;
+	a.step				= l.stride_x * lanes;
+
+	// With stride 1 consecutive rows can be processed as one long row of padded_w pixels each, which includes the
+	// (size - 1) * dilation pixels past the end of each output row.  Those are computed and thrown away, but the
+	// kernels get to use full tiles even when the output is only 13 pixels wide.
+	const bool flat				= l.stride_x == 1 and l.stride_y == 1;
+	const int rows_per_task		= flat ? std::max(1, pixels_per_task / padded_w) : 1;
+	const int tasks_per_block	= (l.out_h + rows_per_task - 1) / rows_per_task;
+
+	// keep the weights of 2 blocks of filters for each chunk of input channels within about 16 KiB
+	const size_t weights_per_input_block	= static_cast<size_t>(l.size) * l.size * a.in_lanes * block;
+	const int chunk_blocks					= std::max(1, static_cast<int>(16384 / (2 * weights_per_input_block * sizeof(float))));
+
+	for (int b = 0; b < l.batch; b ++)
+	{
+		const float * input = state.input + static_cast<size_t>(b) * l.inputs;
+		if (pad)
+		{
+			pad_image(input, state.workspace, l.c / lanes, l.h, l.w, lanes, pad);
+			input = state.workspace;
+		}
+		float * output = l.output + static_cast<size_t>(b) * l.outputs;
+
+		// each task is a few rows of 2 blocks of filters
+		const int pairs = (out_blocks + 1) / 2;
+
+		Darknet::parallel_for(pairs * tasks_per_block, [&](const int task)
+		{
+			const int ob			= task / tasks_per_block * 2;
+			const int blocks		= std::min(2, out_blocks - ob);
+			const int first_row		= (task % tasks_per_block) * rows_per_task;
+			const int last_row		= std::min(l.out_h, first_row + rows_per_task);
+			const Tile * tiles		= blocks == 2 ? kernels.two_blocks : kernels.one_block;
+			const float * weights	= l.nchwc_weights + ob * per_block;
+			const float * bias		= biases + ob * block;
+
+			// the values are the blocks one after the other
+			const auto store_pixel = [&](const int oy, const int ox, const float * values)
+			{
+				const size_t pixel = static_cast<size_t>(oy) * l.out_w + ox;
+				if (l.nchwc_output)
+				{
+					for (int k = 0; k < blocks; k ++)
+					{
+						std::memcpy(output + ((ob + k) * out_plane + pixel) * block, values + k * block, block * sizeof(float));
+					}
+				}
+				else
+				{
+					// the convolutional layers in front of the YOLO heads write NCHW
+					const int filters = std::min(blocks * block, l.n - ob * block);
+					for (int j = 0; j < filters; j ++)
+					{
+						output[(ob * block + j) * out_plane + pixel] = values[j];
+					}
+				}
+			};
+
+			const int values = blocks * block;
+
+			// pixel i of the task is at input + offsets(i) * lanes, and is stored as output pixel (oy, ox)
+			const int first		= flat ? first_row * padded_w : 0;
+			const int count		= flat ? (last_row - 1) * padded_w + l.out_w - first : (last_row - first_row) * l.out_w;
+			const int run_width	= flat ? count : l.out_w;
+
+			thread_local std::vector<float> partial;
+			if (partial.size() < static_cast<size_t>(count) * values)
+			{
+				partial.resize(static_cast<size_t>(count) * values);
+			}
+
+			// the input channels are split into chunks so the weights being used stay in the L1 cache
+			for (int cb = 0; cb < a.in_blocks; cb += chunk_blocks)
+			{
+				ConvolutionArgs chunk = a;
+				chunk.in_blocks = std::min(chunk_blocks, a.in_blocks - cb);
+				const float * in = input + cb * a.in_block_stride;
+				const float * w = weights + cb * weights_per_input_block;
+
+				for (int i = 0; i < count; i += run_width)
+				{
+					const int oy = first_row + i / run_width;
+					const float * row = flat ? in + first * lanes : in + oy * l.stride_y * a.in_row_stride;
+					convolve_run(tiles, chunk, row, run_width, w, per_block, cb == 0 ? bias : nullptr, partial.data() + static_cast<size_t>(i) * values, values);
+				}
+			}
+
+			for (int i = 0; i < count; i ++)
+			{
+				const int oy = flat ? (first + i) / padded_w : first_row + i / l.out_w;
+				const int ox = flat ? (first + i) % padded_w : i % l.out_w;
+				if (ox < l.out_w)
+				{
+					store_pixel(oy, ox, partial.data() + static_cast<size_t>(i) * values);
+				}
+			}
+		});
+	}
+
+	// the bias was added by the kernels, and the activations are element-wise so the layout doesn't matter
+	if (l.activation == SWISH) activate_array_swish(l.output, l.outputs*l.batch, l.activation_input, l.output);
+	else if (l.activation == MISH) activate_array_mish(l.output, l.outputs*l.batch, l.activation_input, l.output);
+	else if (l.activation == HARD_MISH) activate_array_hard_mish(l.output, l.outputs*l.batch, l.activation_input, l.output);
+	else activate_array_cpu_custom(l.output, l.outputs*l.batch, l.activation);
+
+	return;
+}
+
+
+namespace
+{
+	template <int B>
+	void maxpool_nchwc(const Darknet::Layer & l, const float * input)
+	{
+		const int offset	= -l.pad / 2;
+		const int blocks	= l.c / B;
+
+		for (int b = 0; b < l.batch; b ++)
+		{
+			Darknet::parallel_for(blocks, [&](const int cb)
+			{
+				const float * in	= input + static_cast<size_t>(b) * l.inputs + static_cast<size_t>(cb) * l.h * l.w * B;
+				float * out			= l.output + static_cast<size_t>(b) * l.outputs + static_cast<size_t>(cb) * l.out_h * l.out_w * B;
+
+				for (int oy = 0; oy < l.out_h; oy ++)
+				{
+					for (int ox = 0; ox < l.out_w; ox ++)
+					{
+						// clip the window to the image, the same as treating the padding as -FLT_MAX
+						const int y0 = offset + oy * l.stride_y;
+						const int x0 = offset + ox * l.stride_x;
+						const int y1 = std::min(l.h, y0 + l.size);
+						const int x1 = std::min(l.w, x0 + l.size);
+
+						float max[B];
+						std::fill(max, max + B, -FLT_MAX);
+
+						for (int iy = std::max(0, y0); iy < y1; iy ++)
+						{
+							for (int ix = std::max(0, x0); ix < x1; ix ++)
+							{
+								const float * p = in + (static_cast<size_t>(iy) * l.w + ix) * B;
+								for (int j = 0; j < B; j ++)
+								{
+									max[j] = std::max(max[j], p[j]);
+								}
+							}
+						}
+
+						std::memcpy(out + (static_cast<size_t>(oy) * l.out_w + ox) * B, max, sizeof(max));
+					}
+				}
+			});
+		}
+	}
+
+	template <int B>
+	void upsample_nchwc(const Darknet::Layer & l, const float * input)
+	{
+		const int blocks = l.c / B;
+
+		for (int b = 0; b < l.batch; b ++)
+		{
+			Darknet::parallel_for(blocks, [&](const int cb)
+			{
+				const float * in	= input + static_cast<size_t>(b) * l.inputs + static_cast<size_t>(cb) * l.h * l.w * B;
+				float * out			= l.output + static_cast<size_t>(b) * l.outputs + static_cast<size_t>(cb) * l.out_h * l.out_w * B;
+
+				for (int oy = 0; oy < l.out_h; oy ++)
+				{
+					const float * row = in + static_cast<size_t>(oy / l.stride) * l.w * B;
+					for (int ox = 0; ox < l.out_w; ox ++)
+					{
+						const float * p = row + (ox / l.stride) * B;
+						float * q = out + (static_cast<size_t>(oy) * l.out_w + ox) * B;
+						for (int j = 0; j < B; j ++)
+						{
+							q[j] = l.scale * p[j];
+						}
+					}
+				}
+			});
+		}
+	}
+}
+
+
+void forward_maxpool_layer_nchwc(Darknet::Layer & l, Darknet::NetworkState state)
+{
+	TAT(TATPARMS);
+
+	if (l.nchwc_block == 16)
+	{
+		maxpool_nchwc<16>(l, state.input);
+	}
+	else
+	{
+		maxpool_nchwc<8>(l, state.input);
+	}
+
+	return;
+}
+
+
+void forward_upsample_layer_nchwc(Darknet::Layer & l, Darknet::NetworkState state)
+{
+	TAT(TATPARMS);
+
+	if (l.nchwc_block == 16)
+	{
+		upsample_nchwc<16>(l, state.input);
+	}
+	else
+	{
+		upsample_nchwc<8>(l, state.input);
+	}
+
+	return;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+/** @file
+ * Blocked NCHWc activation layout for CPU inference.  See nchwc.cpp for details.
+ */
+
+#include "darknet_internal.hpp"
+
+
+/** Number of channels per block used by the NCHWc layout with the current GEMM microkernel:  16 with AVX-512 (one
+ * @p zmm register) and 8 otherwise.
+ *
+ * @since 2026-10-17
+ */
+int nchwc_block_size();
+
+/** Decide which layers of @p net use the blocked NCHWc layout, and rearrange the weights of those convolutional
+ * layers.  Like @ref pack_conv_weights() this must be called after the batchnorm has been fused.
+ *
+ * A layer only uses the blocked layout when every layer which reads its output can also read the blocked layout, so
+ * the conversions happen in the first convolutional layer (which reads the NCHW network input) and in the
+ * convolutional layers which feed the YOLO heads (which write NCHW).  Everything else keeps the usual NCHW layout.
+ *
+ * @returns the number of layers which use the blocked layout
+ *
+ * @since 2026-10-17
+ */
+int nchwc_prepare_network(Darknet::Network & net);
+
+/** Size of the workspace needed by @ref forward_convolutional_layer_nchwc() for a copy of the input with the padding
+ * filled in.
+ *
+ * @since 2026-10-17
+ */
+size_t nchwc_convolutional_workspace_size(const Darknet::Layer & l);
+
+/// @{ CPU inference forward path for layers where @ref Darknet::Layer::nchwc_block is set.  @since 2026-10-17
+void forward_convolutional_layer_nchwc(Darknet::Layer & l, Darknet::NetworkState state);
+void forward_maxpool_layer_nchwc(Darknet::Layer & l, Darknet::NetworkState state);
+void forward_upsample_layer_nchwc(Darknet::Layer & l, Darknet::NetworkState state);
+/// @}
@@ -0,0 +1,574 @@
+/** @file
+ * INT8 post-training quantization of the convolutional layers for CPU inference.
+ *
+ * The weights of each filter are quantized symmetrically with their own scale, and the input of each layer with a
+ * single scale which is measured ahead of time by running the network on a set of representative images (see the
+ * @p calibrate command):
+ *
+ *     input  ~= input_scale * q_input			(q_input  in [-127, 127])
+ *     weight ~= weight_scale[f] * q_weight		(q_weight in [-127, 127], or [-63, 63] for the vpmaddubsw kernels)
+ *
+ *     output[f] = input_scale * weight_scale[f] * sum(q_weight * q_input) + bias[f]
+ *
+ * The x86 dot product instructions multiply unsigned bytes with signed bytes, so the quantized inputs are stored as
+ * @p q_input + 128.  The GEMM then computes sum(q_weight * q_input) + 128 * sum(q_weight), and the second term is a
+ * constant per filter which is subtracted before the result is converted back to floating point.  The bias and the
+ * activation are applied in floating point, so the output of every layer is the usual NCHW float tensor and the
+ * other layers are not affected.
+ *
+ * The input is quantized into the workspace with the channels last and the padding included, so the INT8 GEMM can read
+ * the im2col matrix straight from the image.  See gemm_int8.cpp.
+ */
+
+#include "quantize.hpp"
+#include "gemm.hpp"
+#include "memory_plan.hpp"
+
+
+namespace
+{
+	static auto & cfg_and_state = Darknet::CfgAndState::get();
+
+	/// Number of bins in the histograms of the input magnitudes used to pick the clipping thresholds.
+	constexpr int histogram_bins = 2048;
+
+	/// Quantized value of zero, such as in the padding.
+	constexpr uint8_t zero_point = 128;
+
+	/// Number of pixels converted at a time by @ref quantize_image().
+	constexpr int quantize_tile = 64;
+
+	inline int round_up(const int value, const int multiple)
+	{
+		return (value + multiple - 1) / multiple * multiple;
+	}
+
+	/// Number of input channels in the quantized image, padded so each group of 4 channels is one 32-bit load.
+	inline int quantized_channels(const Darknet::Layer & l)
+	{
+		return round_up(l.c, 4);
+	}
+
+	/// The input of a layer is the output of the previous layer.  See @ref forward_network().
+	void layer_input(const Darknet::Network & net, const int index, const float * & input, size_t & count)
+	{
+		TAT(TATPARMS);
+
+		const Darknet::Layer & prev = net.layers[index - 1];
+		input = prev.output;
+		count = static_cast<size_t>(prev.outputs) * prev.batch;
+	}
+
+	/** Load the image and resize it into the network input the same way @ref Darknet::predict() does, so the calibration
+	 * sees exactly what the quantized layers will see during inference.
+	 */
+	void load_calibration_image(Darknet::Network & net, const std::string & filename, float * dst)
+	{
+		TAT(TATPARMS);
+
+		cv::Mat mat = cv::imread(filename);
+		if (mat.empty())
+		{
+			darknet_fatal_error(DARKNET_LOC, "failed to load image file \"%s\"", filename.c_str());
+		}
+
+		if (net.details->letterbox)
+		{
+			Darknet::bgr_mat_to_rgb_letterbox_tensor(mat, dst, net.w, net.h, net.details->input_x_offsets);
+		}
+		else
+		{
+			Darknet::bgr_mat_to_rgb_tensor(mat, dst, net.w, net.h, net.details->input_x_offsets);
+		}
+
+		return;
+	}
+
+	/** Pick the clipping threshold for a histogram of magnitudes which minimizes the expected squared error:  values
+	 * below the threshold are rounded to one of 127 steps, which adds an error of step^2 / 12 on average, and values
+	 * above the threshold are clipped.
+	 */
+	float best_threshold(const std::vector<double> & histogram, const float largest)
+	{
+		TAT(TATPARMS);
+
+		const int bins		= static_cast<int>(histogram.size());
+		const double width	= static_cast<double>(largest) / bins;
+
+		double below = 0.0;
+		for (const double count : histogram)
+		{
+			below += count;
+		}
+
+		// totals of the bins above the threshold, which grow as the threshold is lowered one bin at a time
+		double count		= 0.0;
+		double sum			= 0.0;
+		double sum_squared	= 0.0;
+
+		double best_error	= std::numeric_limits<double>::max();
+		float best			= largest;
+
+		for (int t = bins; t > 0; t --)
+		{
+			if (t < bins)
+			{
+				const double x = (t + 0.5) * width;
+				count		+= histogram[t];
+				sum			+= histogram[t] * x;
+				sum_squared	+= histogram[t] * x * x;
+				below		-= histogram[t];
+			}
+
+			const double threshold	= t * width;
+			const double step		= threshold / 127.0;
+			const double error		= below * step * step / 12.0 + sum_squared - 2.0 * threshold * sum + threshold * threshold * count;
+			if (error < best_error)
+			{
+				best_error	= error;
+				best		= static_cast<float>(threshold);
+			}
+		}
+
+		return best;
+	}
+
+	/// Quantize the weights of @p l for @p kernel, with the filter taps ordered as expected by @ref gemm_int8_prepacked_implicit().
+	void quantize_convolutional_weights(Darknet::Layer & l, const Darknet::EInt8Kernel kernel, const float input_scale)
+	{
+		TAT(TATPARMS);
+
+		const int limit		= gemm_int8_weight_limit(kernel);
+		const int channels	= quantized_channels(l);
+		const int taps		= l.size * l.size;
+		const int K			= taps * channels;
+
+		std::vector<int8_t> quantized(static_cast<size_t>(l.n) * K, 0);
+
+		l.int8_kernel		= static_cast<int>(kernel);
+		l.int8_input_scale	= input_scale;
+		l.int8_scales		= (float*)xcalloc(l.n, sizeof(float));
+		l.int8_offsets		= (int32_t*)xcalloc(l.n, sizeof(int32_t));
+
+		for (int f = 0; f < l.n; f ++)
+		{
+			const float * w = l.weights + static_cast<size_t>(f) * l.c * taps;
+
+			float largest = 0.0f;
+			for (int i = 0; i < l.c * taps; i ++)
+			{
+				largest = std::max(largest, std::fabs(w[i]));
+			}
+			const float step = largest > 0.0f ? largest / limit : 1.0f;
+
+			int32_t sum = 0;
+			for (int c = 0; c < l.c; c ++)
+			{
+				for (int tap = 0; tap < taps; tap ++)
+				{
+					const int q = std::clamp(static_cast<int>(std::lround(w[c * taps + tap] / step)), -limit, limit);
+					quantized[static_cast<size_t>(f) * K + tap * channels + c] = static_cast<int8_t>(q);
+					sum += q;
+				}
+			}
+
+			l.int8_scales[f]	= step * input_scale;
+			l.int8_offsets[f]	= zero_point * sum;
+		}
+
+		l.int8_weights = (int8_t*)xcalloc(gemm_int8_prepack_a_size(kernel, l.n, K), sizeof(int8_t));
+		gemm_int8_prepack_a(kernel, l.n, K, quantized.data(), K, l.int8_weights);
+
+		return;
+	}
+
+	/// Quantize one NCHW image into the padded channels-last layout read by @ref gemm_int8_prepacked_implicit().
+	void quantize_image(const Darknet::Layer & l, const float * src, const int pad, uint8_t * dst)
+	{
+		TAT(TATPARMS);
+
+		const int channels	= quantized_channels(l);
+		const int padded_w	= l.w + 2 * pad;
+		const int padded_h	= l.h + 2 * pad;
+		const float inverse	= 1.0f / l.int8_input_scale;
+		const std::vector<float> zeros(l.w, 0.0f);
+
+		Darknet::parallel_for(padded_h, [&](const int y)
+		{
+			uint8_t * row = dst + static_cast<size_t>(y) * padded_w * channels;
+
+			// the padding and the extra channels are zero
+			std::memset(row, zero_point, static_cast<size_t>(padded_w) * channels);
+
+			const int iy = y - pad;
+			if (iy < 0 or iy >= l.h)
+			{
+				return;
+			}
+
+			// each group of 4 channels is converted a few pixels at a time into 32-bit words, which are then scattered
+			// into the channels-last row;  the missing channels of the last group read a row of zeros
+			for (int c = 0; c < l.c; c += 4)
+			{
+				const float * in[4];
+				for (int k = 0; k < 4; k ++)
+				{
+					in[k] = (c + k < l.c) ? src + (static_cast<size_t>(c + k) * l.h + iy) * l.w : zeros.data();
+				}
+
+				uint8_t * out = row + pad * channels + c;
+				for (int x0 = 0; x0 < l.w; x0 += quantize_tile)
+				{
+					const int count = std::min(quantize_tile, l.w - x0);
+					uint32_t words[quantize_tile];
+					for (int x = 0; x < count; x ++)
+					{
+						uint32_t word = 0;
+						for (int k = 0; k < 4; k ++)
+						{
+							// adding 0.5 to the positive value and truncating rounds to the nearest integer
+							const float q = std::clamp(in[k][x0 + x] * inverse, -127.0f, 127.0f) + (zero_point + 0.5f);
+							word |= static_cast<uint32_t>(static_cast<int32_t>(q)) << (8 * k);
+						}
+						words[x] = word;
+					}
+					for (int x = 0; x < count; x ++)
+					{
+						std::memcpy(out + static_cast<size_t>(x0 + x) * channels, &words[x], sizeof(uint32_t));
+					}
+				}
+			}
+		});
+	}
+}
+
+
+bool int8_is_supported(const Darknet::Network & net, const int index)
+{
+	TAT(TATPARMS);
+
+	const Darknet::Layer & l = net.layers[index];
+
+	if (index == 0 or l.type != Darknet::ELayerType::CONVOLUTIONAL)
+	{
+		return false;
+	}
+
+	if (index + 1 < net.n)
+	{
+		const auto next = net.layers[index + 1].type;
+		if (next == Darknet::ELayerType::YOLO			or
+			next == Darknet::ELayerType::GAUSSIAN_YOLO	or
+			next == Darknet::ELayerType::REGION)
+		{
+			return false;
+		}
+	}
+
+	return
+		l.weights != nullptr		and
+		not l.xnor					and
+		not l.binary				and
+		l.groups == 1				and
+		not l.batch_normalize		and	// see fuse_conv_batchnorm()
+		not l.antialiasing;
+}
+
+
+std::vector<float> int8_calibrate(Darknet::Network & net, const Darknet::VStr & filenames)
+{
+	TAT(TATPARMS);
+
+	std::vector<int> layers;
+	for (int i = 0; i < net.n; i ++)
+	{
+		if (int8_is_supported(net, i))
+		{
+			layers.push_back(i);
+		}
+	}
+
+	std::vector<float> largest(net.n, 0.0f);
+	std::vector<std::vector<double>> histograms(net.n);
+	std::vector<float> input_image(static_cast<size_t>(net.w) * net.h * net.c);
+
+	// the inputs are read once the whole network has run, so the layers cannot share their outputs (which would have
+	// been overwritten by the later layers) while calibrating
+	const bool planned = release_inference_memory(net);
+
+	for (const int pass : {1, 2})
+	{
+		size_t counter = 0;
+		for (const auto & filename : filenames)
+		{
+			counter ++;
+			*cfg_and_state.output << "\rcalibration pass " << pass << "/2:  image #" << counter << " of " << filenames.size() << " " << std::flush;
+
+			load_calibration_image(net, filename, input_image.data());
+			network_predict(net, input_image.data());
+
+			for (const int i : layers)
+			{
+				const float * input = nullptr;
+				size_t count = 0;
+				layer_input(net, i, input, count);
+
+				if (pass == 1)
+				{
+					float m = largest[i];
+					for (size_t j = 0; j < count; j ++)
+					{
+						m = std::max(m, std::fabs(input[j]));
+					}
+					largest[i] = m;
+				}
+				else if (largest[i] > 0.0f)
+				{
+					auto & histogram = histograms[i];
+					histogram.resize(histogram_bins, 0.0);
+
+					const float bins_per_unit = histogram_bins / largest[i];
+					for (size_t j = 0; j < count; j ++)
+					{
+						const int bin = std::min(histogram_bins - 1, static_cast<int>(std::fabs(input[j]) * bins_per_unit));
+						histogram[bin] += 1.0;
+					}
+				}
+			}
+		}
+		*cfg_and_state.output << std::endl;
+	}
+
+	if (planned)
+	{
+		plan_inference_memory(net);
+	}
+
+	std::vector<float> scales(net.n, 0.0f);
+	for (const int i : layers)
+	{
+		if (largest[i] > 0.0f)
+		{
+			const float threshold = best_threshold(histograms[i], largest[i]);
+			scales[i] = threshold / 127.0f;
+
+			if (cfg_and_state.is_verbose)
+			{
+				*cfg_and_state.output
+					<< "Layer #" << i << ":"
+					<< " largest input=" << largest[i] << ","
+					<< " threshold=" << threshold << ","
+					<< " scale=" << scales[i] << std::endl;
+			}
+		}
+	}
+
+	return scales;
+}
+
+
+void int8_save_calibration(const std::filesystem::path & filename, const std::vector<float> & scales)
+{
+	TAT(TATPARMS);
+
+	std::ofstream ofs(filename);
+	if (not ofs.good())
+	{
+		darknet_fatal_error(DARKNET_LOC, "failed to create the INT8 calibration table \"%s\"", filename.string().c_str());
+	}
+
+	ofs << "# Darknet INT8 calibration table:  layer index and input scale" << std::endl
+		<< std::setprecision(9);
+
+	for (size_t i = 0; i < scales.size(); i ++)
+	{
+		if (scales[i] > 0.0f)
+		{
+			ofs << i << " " << scales[i] << std::endl;
+		}
+	}
+
+	return;
+}
+
+
+std::vector<float> int8_load_calibration(const std::filesystem::path & filename, const Darknet::Network & net)
+{
+	TAT(TATPARMS);
+
+	std::ifstream ifs(filename);
+	if (not ifs.good())
+	{
+		darknet_fatal_error(DARKNET_LOC, "failed to read the INT8 calibration table \"%s\"", filename.string().c_str());
+	}
+
+	std::vector<float> scales(net.n, 0.0f);
+
+	std::string line;
+	while (std::getline(ifs, line))
+	{
+		if (line.empty() or line[0] == '#')
+		{
+			continue;
+		}
+
+		std::stringstream ss(line);
+		int index = -1;
+		float scale = 0.0f;
+		ss >> index >> scale;
+
+		if (ss.fail() or index < 0 or index >= net.n or scale <= 0.0f or net.layers[index].type != Darknet::ELayerType::CONVOLUTIONAL)
+		{
+			darknet_fatal_error(DARKNET_LOC, "invalid line \"%s\" in the INT8 calibration table \"%s\" (was it created for a different network?)", line.c_str(), filename.string().c_str());
+		}
+
+		scales[index] = scale;
+	}
+
+	return scales;
+}
+
+
+int int8_prepare_network(Darknet::Network & net, const std::vector<float> & scales)
+{
+	TAT(TATPARMS);
+
+	const auto kernel = gemm_int8_kernel();
+
+	// The INT8 layers cannot write a fused shortcut (see fuse_conv_epilogues()), and the fused shortcuts decide which
+	// outputs are shared.  When the network was already fused and planned (such as by the "calibrate" command) both are
+	// undone here and done again once the layers have been quantized.
+	const bool planned = release_inference_memory(net);
+	bool fused = false;
+	for (int i = 0; i < net.n; i ++)
+	{
+		fused = fused or net.layers[i].fused_activation;
+	}
+
+	int count = 0;
+	int convolutional_layers = 0;
+	for (int i = 0; i < net.n; i ++)
+	{
+		Darknet::Layer & l = net.layers[i];
+		if (l.type != Darknet::ELayerType::CONVOLUTIONAL)
+		{
+			continue;
+		}
+		convolutional_layers ++;
+
+		const bool was_quantized = l.int8_weights != nullptr;
+		free(l.int8_weights);
+		free(l.int8_scales);
+		free(l.int8_offsets);
+		l.int8_weights	= nullptr;
+		l.int8_scales	= nullptr;
+		l.int8_offsets	= nullptr;
+
+		if (static_cast<size_t>(i) >= scales.size() or scales[i] <= 0.0f or not int8_is_supported(net, i))
+		{
+			if (was_quantized)
+			{
+				// back to floating point
+				pack_convolutional_weights(l);
+			}
+			continue;
+		}
+
+		quantize_convolutional_weights(l, kernel, scales[i]);
+		count ++;
+
+		// the floating point GEMM weights are no longer needed
+		free(l.packed_weights);
+		free(l.winograd_weights);
+		l.packed_weights	= nullptr;
+		l.winograd_weights	= nullptr;
+	}
+
+	if (cfg_and_state.is_verbose)
+	{
+		*cfg_and_state.output
+			<< "Quantized " << count << " of " << convolutional_layers << " convolutional layers to INT8"
+			<< " for the " << gemm_int8_kernel_name(kernel) << " kernel." << std::endl;
+	}
+
+	if (fused)
+	{
+		fuse_conv_epilogues(net);
+	}
+	recalculate_workspace_size(&net);
+	if (planned)
+	{
+		plan_inference_memory(net);
+	}
+
+	return count;
+}
+
+
+size_t int8_convolutional_workspace_size(const Darknet::Layer & l)
+{
+	TAT(TATPARMS);
+
+	const int pad = l.pad * l.dilation;
+	const size_t bytes = static_cast<size_t>(quantized_channels(l)) * (l.h + 2 * pad) * (l.w + 2 * pad);
+
+	// the workspace is allocated as floats
+	return round_up(static_cast<int>(bytes), sizeof(float));
+}
+
+
+void forward_convolutional_layer_int8(Darknet::Layer & l, Darknet::NetworkState state)
+{
+	TAT(TATPARMS);
+
+	const auto kernel		= static_cast<Darknet::EInt8Kernel>(l.int8_kernel);
+	const int pad			= l.pad * l.dilation;
+	const int out_plane		= l.out_w * l.out_h;
+	uint8_t * image			= reinterpret_cast<uint8_t *>(state.workspace);
+
+	Darknet::QuantizedConvolutionInput input;
+	input.image		= image;
+	input.channels	= quantized_channels(l);
+	input.height	= l.h + 2 * pad;
+	input.width		= l.w + 2 * pad;
+	input.ksize		= l.size;
+	input.stride_x	= l.stride_x;
+	input.stride_y	= l.stride_y;
+	input.dilation	= l.dilation;
+	input.out_w		= l.out_w;
+	input.out_h		= l.out_h;
+
+	for (int b = 0; b < l.batch; b ++)
+	{
+		quantize_image(l, state.input + static_cast<size_t>(b) * l.inputs, pad, image);
+
+		// the 32-bit sums are written into the output, and then converted to floating point in place
+		float * output = l.output + static_cast<size_t>(b) * l.outputs;
+		gemm_int8_prepacked_implicit(kernel, l.n, l.int8_weights, input, reinterpret_cast<int32_t *>(output), out_plane);
+
+		Darknet::parallel_for(l.n, [&](const int f)
+		{
+			float * out			= output + static_cast<size_t>(f) * out_plane;
+			const int32_t offset	= l.int8_offsets[f];
+			const float scale		= l.int8_scales[f];
+			const float bias		= l.biases[f];
+
+			for (int i = 0; i < out_plane; i ++)
+			{
+				int32_t sum;
+				std::memcpy(&sum, out + i, sizeof(sum));
+				out[i] = static_cast<float>(sum - offset) * scale + bias;
+			}
+		});
+	}
+
+	if (l.activation == SWISH) activate_array_swish(l.output, l.outputs*l.batch, l.activation_input, l.output);
+	else if (l.activation == MISH) activate_array_mish(l.output, l.outputs*l.batch, l.activation_input, l.output);
+	else if (l.activation == HARD_MISH) activate_array_hard_mish(l.output, l.outputs*l.batch, l.activation_input, l.output);
+	else if (l.activation == NORM_CHAN) activate_array_normalize_channels(l.output, l.outputs*l.batch, l.batch, l.out_c, l.out_w*l.out_h, l.output);
+	else if (l.activation == NORM_CHAN_SOFTMAX) activate_array_normalize_channels_softmax(l.output, l.outputs*l.batch, l.batch, l.out_c, l.out_w*l.out_h, l.output, 0);
+	else if (l.activation == NORM_CHAN_SOFTMAX_MAXVAL) activate_array_normalize_channels_softmax(l.output, l.outputs*l.batch, l.batch, l.out_c, l.out_w*l.out_h, l.output, 1);
+	else activate_array_cpu_custom(l.output, l.outputs*l.batch, l.activation);
+
+	return;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+/** @file
+ * INT8 post-training quantization of the convolutional layers for CPU inference.  See quantize.cpp for details.
+ */
+
+#include "darknet_internal.hpp"
+
+
+/** Whether layer @p index of @p net can be quantized.  The first layer (which reads the image) and the convolutional
+ * layers which feed the YOLO heads always stay in floating point, since they are cheap and the most sensitive to
+ * rounding.  The batchnorm must already have been fused.
+ *
+ * @since 2026-10-17
+ */
+bool int8_is_supported(const Darknet::Network & net, int index);
+
+/** Run @p net in floating point on each of the images and find the scale to use for the quantized input of every layer
+ * which @ref int8_is_supported().  Each image is read twice:  once to find the largest magnitude of each input, and once
+ * to build a histogram of the magnitudes, from which the clipping threshold with the smallest expected squared error
+ * is chosen.
+ *
+ * The layer outputs shared by @ref plan_inference_memory() are split up while the images run, and shared again once
+ * the calibration is done.
+ *
+ * @returns the scale of the input of each layer, or zero for the layers which are not quantized
+ *
+ * @since 2026-10-17
+ */
+std::vector<float> int8_calibrate(Darknet::Network & net, const Darknet::VStr & filenames);
+
+/** Save the input scales from @ref int8_calibrate() as a text file with one "layer scale" line per quantized layer.
+ * @since 2026-10-17
+ */
+void int8_save_calibration(const std::filesystem::path & filename, const std::vector<float> & scales);
+
+/** Load the input scales saved by @ref int8_save_calibration().
+ * @since 2026-10-17
+ */
+std::vector<float> int8_load_calibration(const std::filesystem::path & filename, const Darknet::Network & net);
+
+/** Quantize the weights of the layers which have an input scale and which @ref int8_is_supported(), for the current
+ * @ref gemm_int8_kernel().  Layers without a scale go back to floating point.  Like @ref pack_conv_weights() this must
+ * be called after the batchnorm has been fused.  The workspace size is recalculated, and when the network had already
+ * been fused (see @ref fuse_conv_epilogues()) or planned (see @ref plan_inference_memory()) this is done again, since
+ * the quantized layers cannot write a fused shortcut.
+ *
+ * @returns the number of quantized layers
+ *
+ * @since 2026-10-17
+ */
+int int8_prepare_network(Darknet::Network & net, const std::vector<float> & scales);
+
+/** Size of the workspace needed by @ref forward_convolutional_layer_int8() for the quantized copy of the input.
+ * @since 2026-10-17
+ */
+size_t int8_convolutional_workspace_size(const Darknet::Layer & l);
+
+/** CPU inference forward path for the convolutional layers where @ref Darknet::Layer::int8_weights is set.
+ * @since 2026-10-17
+ */
+void forward_convolutional_layer_int8(Darknet::Layer & l, Darknet::NetworkState state);
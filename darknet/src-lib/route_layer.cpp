@@ -92,7 +92,13 @@ void forward_route_layer(Darknet::Layer & l, Darknet::NetworkState state)
 		int part_input_size = input_size / l.groups;
 		for(j = 0; j < l.batch; ++j){
 			//copy_cpu(input_size, input + j*input_size, 1, l.output + offset + j*l.outputs, 1);
-			copy_cpu(part_input_size, input + j*input_size + part_input_size*l.group_id, 1, l.output + offset + j*l.outputs, 1);
+			float *src = input + j*input_size + part_input_size*l.group_id;
+			float *dst = l.output + offset + j*l.outputs;
+			if (src != dst)
+			{
+				// inputs already written in place are skipped, see plan_inference_memory()
+				copy_cpu(part_input_size, src, 1, dst, 1);
+			}
 		}
 		//offset += input_size;
 		offset += part_input_size;
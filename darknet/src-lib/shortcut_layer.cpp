@@ -171,21 +171,14 @@ void forward_shortcut_layer(Darknet::Layer & l, Darknet::NetworkState state)
 {
 	TAT(TATPARMS);
 
-	int from_w = state.net.layers[l.index].w;
-	int from_h = state.net.layers[l.index].h;
-	int from_c = state.net.layers[l.index].c;
-
-	if (l.nweights == 0 && l.n == 1 && from_w == l.w && from_h == l.h && from_c == l.c) {
-		int size = l.batch * l.w * l.h * l.c;
-		int i;
-		#pragma omp parallel for
-		for(i = 0; i < size; ++i)
-			l.output[i] = state.input[i] + state.net.layers[l.index].output[i];
-	}
-	else {
-		shortcut_multilayer_cpu(l.outputs * l.batch, l.outputs, l.batch, l.n, l.input_sizes, l.layers_output, l.output, state.input, l.weights, l.nweights, l.weights_normalization);
+	if (l.fused_into_previous and not state.train)
+	{
+		// the previous convolutional layer already wrote the sum into l.output, see fuse_conv_epilogues()
+		return;
 	}
 
+	shortcut_forward_cpu(l.outputs, l.batch, l.n, l.input_sizes, l.layers_output, state.input, l.weights, l.nweights, l.weights_normalization, l.output);
+
 	//copy_cpu(l.outputs*l.batch, state.input, 1, l.output, 1);
 	//shortcut_cpu(l.batch, from_w, from_h, from_c, state.net.layers[l.index].output, l.out_w, l.out_h, l.out_c, l.output);
 
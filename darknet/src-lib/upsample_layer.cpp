@@ -1,4 +1,5 @@
 #include "darknet_internal.hpp"
+#include "nchwc.hpp"
 
 Darknet::Layer make_upsample_layer(int batch, int w, int h, int c, int stride)
 {
@@ -73,11 +74,17 @@ void forward_upsample_layer(Darknet::Layer & l, Darknet::NetworkState state)
 {
 	TAT(TATPARMS);
 
-	fill_cpu(l.outputs*l.batch, 0, l.output, 1);
+	if (l.nchwc_block and not state.train)
+	{
+		forward_upsample_layer_nchwc(l, state);
+		return;
+	}
+
 	if(l.reverse){
+		fill_cpu(l.outputs*l.batch, 0, l.output, 1);
 		upsample_cpu(l.output, l.out_w, l.out_h, l.c, l.batch, l.stride, 0, l.scale, state.input);
 	}else{
-		upsample_cpu( state.input, l.w, l.h, l.c, l.batch, l.stride, 1, l.scale, l.output);
+		upsample_forward_cpu(state.input, l.w, l.h, l.c, l.batch, l.stride, l.scale, l.output);
 	}
 }
 
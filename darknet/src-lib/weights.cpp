@@ -627,6 +627,7 @@ DarknetNetworkPtr load_network_custom(const char * cfg, const char * weights, in
 	*net = parse_network_cfg_custom(cfg, batch, 1);
 	load_weights(net, weights);
 	fuse_conv_batchnorm(*net);
+	pack_conv_weights(*net);
 
 	/** @todo V3 Some code seems to also call this next function, and some not.  This was not originally called here, but
 	 * I copied it from several other code locations.  Need to invetigate whether or not it should be here.  2024-08-03
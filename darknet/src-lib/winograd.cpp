@@ -0,0 +1,345 @@
+/** @file
+ * Winograd F(4x4, 3x3) convolution, see "Fast Algorithms for Convolutional Neural Networks" by Lavin and Gray.
+ *
+ * The output is computed in tiles of 4x4 pixels, each of which needs a 6x6 tile of the input.  Both the input tile and
+ * the 3x3 filter are transformed into a 6x6 "Winograd domain" where the convolution becomes an element-wise product, so
+ * 36 multiplications produce 16 outputs instead of the 144 needed by a direct 3x3 convolution.  Summed across the input
+ * channels, each of the 36 element-wise products becomes a matrix multiplication:
+ *
+ *     M[xi] (filters x tiles) = U[xi] (filters x channels) * V[xi] (channels x tiles)
+ *
+ * These 36 GEMMs use the packed SGEMM with the filters @p U pre-transformed and pre-packed when the network is loaded.
+ * The tiles are processed in blocks so the transformed input and output stay in the cache.
+ */
+
+#include "winograd.hpp"
+#include "gemm.hpp"
+
+
+namespace
+{
+	/// Number of elements in a transformed tile.
+	constexpr int winograd_tile = 36;
+
+	/// Try to keep the transformed input and output of each block of tiles within this many floats.
+	constexpr size_t tile_block_budget = 1 << 20;
+
+	// Note there is no TAT() in the transforms:  they are called for every tile.
+
+	/// Multiply a column of 6 values by @p B^T.
+	inline void input_transform_6(const float d0, const float d1, const float d2, const float d3, const float d4, const float d5, float * r, const int stride)
+	{
+		r[0 * stride] = 4.0f * d0 - 5.0f * d2 + d4;
+		r[1 * stride] = -4.0f * (d1 + d2) + d3 + d4;
+		r[2 * stride] = 4.0f * (d1 - d2) - d3 + d4;
+		r[3 * stride] = 2.0f * (d3 - d1) - d2 + d4;
+		r[4 * stride] = 2.0f * (d1 - d3) - d2 + d4;
+		r[5 * stride] = 4.0f * d1 - 5.0f * d3 + d5;
+	}
+
+	/// Multiply a column of 6 values by @p A^T.
+	inline void output_transform_6(const float m0, const float m1, const float m2, const float m3, const float m4, const float m5, float * r)
+	{
+		const float a = m1 + m2;
+		const float b = m1 - m2;
+		const float c = m3 + m4;
+		const float d = m3 - m4;
+
+		r[0] = m0 + a + c;
+		r[1] = b + 2.0f * d;
+		r[2] = a + 4.0f * c;
+		r[3] = b + 8.0f * d + m5;
+	}
+
+	/// Compute @p B^T * @p d * @p B for one 6x6 input tile, and store element @p xi at @p V + @p xi * @p stride.
+	inline void input_transform_tile(const float * d, float * V, const size_t stride)
+	{
+		float tmp[winograd_tile];
+		for (int j = 0; j < 6; j ++)
+		{
+			input_transform_6(d[j], d[6 + j], d[12 + j], d[18 + j], d[24 + j], d[30 + j], tmp + j, 6);
+		}
+
+		float out[winograd_tile];
+		for (int i = 0; i < 6; i ++)
+		{
+			const float * t = tmp + 6 * i;
+			input_transform_6(t[0], t[1], t[2], t[3], t[4], t[5], out + 6 * i, 1);
+		}
+
+		for (int xi = 0; xi < winograd_tile; xi ++)
+		{
+			V[xi * stride] = out[xi];
+		}
+	}
+
+	/// Number of tiles transformed at once for a layer with @p channels inputs and @p filters outputs per group.
+	int tile_block_size(const int channels, const int filters, const int tiles)
+	{
+		const size_t per_tile	= winograd_tile * static_cast<size_t>(channels + filters);
+		const int max_block		= std::max(16, static_cast<int>(tile_block_budget / per_tile));
+		const int blocks		= (tiles + max_block - 1) / max_block;
+
+		// split the tiles evenly so the last block isn't tiny, and round to a multiple of 16 so the GEMM doesn't end
+		// with a partial microkernel tile
+		return std::min(tiles, ((tiles + blocks - 1) / blocks + 15) / 16 * 16);
+	}
+}
+
+
+bool winograd_is_supported(const Darknet::Layer & l)
+{
+	TAT(TATPARMS);
+
+	return
+		l.type		== Darknet::ELayerType::CONVOLUTIONAL	and
+		l.size		== 3									and
+		l.stride_x	== 1									and
+		l.stride_y	== 1									and
+		l.dilation	== 1									and
+		l.weights	!= nullptr								and
+		not l.xnor											and
+		not l.binary;
+}
+
+
+bool winograd_is_preferred(const Darknet::Layer & l)
+{
+	TAT(TATPARMS);
+
+	if (not winograd_is_supported(l))
+	{
+		return false;
+	}
+
+	const int channels	= l.c / l.groups;
+	const int filters	= l.n / l.groups;
+
+	// Each tile costs about 8 FLOPs per transformed element of the input and output, while the GEMM costs 2 FLOPs per
+	// channel x filter, so layers with few channels spend more time in the transforms than they save in the GEMM, and
+	// measure slower than the implicit GEMM.  Small outputs such as 13x13 also waste much of the last row and column of
+	// tiles.
+	return channels >= 64 and filters >= 64 and l.out_w >= 20 and l.out_h >= 20;
+}
+
+
+void winograd_transform_weights(Darknet::Layer & l)
+{
+	TAT(TATPARMS);
+
+	free(l.winograd_weights);
+	l.winograd_weights = nullptr;
+
+	if (not winograd_is_supported(l))
+	{
+		return;
+	}
+
+	// G is the 6x3 filter transform matrix
+	static const double G[6][3] =
+	{
+		{  1.0 /  4.0,  0.0       ,  0.0       },
+		{ -1.0 /  6.0, -1.0 /  6.0, -1.0 /  6.0},
+		{ -1.0 /  6.0,  1.0 /  6.0, -1.0 /  6.0},
+		{  1.0 / 24.0,  1.0 / 12.0,  1.0 /  6.0},
+		{  1.0 / 24.0, -1.0 / 12.0,  1.0 /  6.0},
+		{  0.0       ,  0.0       ,  1.0       }
+	};
+
+	// the transformed filters use the same precision as the packed weights, see pack_convolutional_weights()
+	const auto kernel		= gemm_packed_kernel();
+	const auto format		= static_cast<Darknet::EWeightFormat>(l.packed_weights_format);
+	const int channels		= l.c / l.groups;
+	const int filters		= l.n / l.groups;
+	const size_t per_xi		= gemm_prepack_a_size(kernel, format, filters, channels);
+
+	l.packed_weights_kernel	= static_cast<int>(kernel);
+	l.winograd_weights		= (float*)xcalloc(winograd_tile * per_xi * l.groups, sizeof(float));
+
+	// U[xi] is a filters x channels matrix for each of the 36 elements of the transformed filters
+	std::vector<float> U(winograd_tile * static_cast<size_t>(filters) * channels);
+
+	for (int group = 0; group < l.groups; group ++)
+	{
+		for (int f = 0; f < filters; f ++)
+		{
+			for (int c = 0; c < channels; c ++)
+			{
+				const float * g = l.weights + ((static_cast<size_t>(group) * filters + f) * channels + c) * 9;
+
+				// U = G * g * G^T
+				double tmp[6][3];
+				for (int i = 0; i < 6; i ++)
+				{
+					for (int j = 0; j < 3; j ++)
+					{
+						tmp[i][j] = G[i][0] * g[j] + G[i][1] * g[3 + j] + G[i][2] * g[6 + j];
+					}
+				}
+
+				for (int i = 0; i < 6; i ++)
+				{
+					for (int j = 0; j < 6; j ++)
+					{
+						const double u = tmp[i][0] * G[j][0] + tmp[i][1] * G[j][1] + tmp[i][2] * G[j][2];
+						U[(static_cast<size_t>(i * 6 + j) * filters + f) * channels + c] = static_cast<float>(u);
+					}
+				}
+			}
+		}
+
+		float * packed = l.winograd_weights + static_cast<size_t>(group) * winograd_tile * per_xi;
+		for (int xi = 0; xi < winograd_tile; xi ++)
+		{
+			gemm_prepack_a(kernel, format, filters, channels, U.data() + static_cast<size_t>(xi) * filters * channels, channels, packed + xi * per_xi);
+		}
+	}
+
+	return;
+}
+
+
+void winograd_convolution(const Darknet::Layer & l, const int group, const float * input, float * output, const Darknet::GemmEpilogue * epilogue)
+{
+	TAT(TATPARMS);
+
+	const auto kernel		= static_cast<Darknet::EGemmKernel>(l.packed_weights_kernel);
+	const auto format		= static_cast<Darknet::EWeightFormat>(l.packed_weights_format);
+	const int channels		= l.c / l.groups;
+	const int filters		= l.n / l.groups;
+	const int out_w			= l.out_w;
+	const int out_h			= l.out_h;
+	const int tiles_w		= (out_w + 3) / 4;
+	const int tiles_h		= (out_h + 3) / 4;
+	const int tiles			= tiles_w * tiles_h;
+	const int block			= tile_block_size(channels, filters, tiles);
+	const size_t per_xi		= gemm_prepack_a_size(kernel, format, filters, channels);
+	const float * U			= l.winograd_weights + static_cast<size_t>(group) * winograd_tile * per_xi;
+
+	thread_local std::vector<float> buffer;
+	const size_t v_size = winograd_tile * static_cast<size_t>(channels) * block;
+	const size_t m_size = winograd_tile * static_cast<size_t>(filters) * block;
+	if (buffer.size() < v_size + m_size)
+	{
+		buffer.resize(v_size + m_size);
+	}
+	float * V = buffer.data();
+	float * M = V + v_size;
+
+	for (int t0 = 0; t0 < tiles; t0 += block)
+	{
+		const int count = std::min(block, tiles - t0);
+
+		// V[xi] is a channels x block matrix
+		Darknet::parallel_for(channels, [&](const int c)
+		{
+			const float * im = input + static_cast<size_t>(c) * l.h * l.w;
+			float d[winograd_tile];
+
+			for (int t = 0; t < count; t ++)
+			{
+				const int y0 = ((t0 + t) / tiles_w) * 4 - l.pad;
+				const int x0 = ((t0 + t) % tiles_w) * 4 - l.pad;
+
+				if (y0 >= 0 and x0 >= 0 and y0 + 6 <= l.h and x0 + 6 <= l.w)
+				{
+					for (int i = 0; i < 6; i ++)
+					{
+						std::memcpy(d + 6 * i, im + (y0 + i) * l.w + x0, 6 * sizeof(float));
+					}
+				}
+				else
+				{
+					// the tile overlaps the padding
+					for (int i = 0; i < 6; i ++)
+					{
+						const int y = y0 + i;
+						for (int j = 0; j < 6; j ++)
+						{
+							const int x = x0 + j;
+							d[6 * i + j] = (y >= 0 and y < l.h and x >= 0 and x < l.w) ? im[y * l.w + x] : 0.0f;
+						}
+					}
+				}
+
+				input_transform_tile(d, V + static_cast<size_t>(c) * block + t, static_cast<size_t>(channels) * block);
+			}
+		});
+
+		std::fill(M, M + m_size, 0.0f);
+
+		Darknet::parallel_for(winograd_tile, [&](const int xi)
+		{
+			gemm_prepacked(kernel, format, filters, count, channels, U + xi * per_xi,
+					V + static_cast<size_t>(xi) * channels * block, block,
+					M + static_cast<size_t>(xi) * filters * block, block);
+		});
+
+		// Y = A^T * M * A, clipped to the size of the output
+		const size_t xi_stride = static_cast<size_t>(filters) * block;
+
+		Darknet::parallel_for(filters, [&](const int f)
+		{
+			float * out = output + static_cast<size_t>(f) * out_h * out_w;
+
+			// the rows of each output tile are all the same filter, so the bias is added here instead of by the epilogue
+			const float bias = (epilogue and epilogue->bias) ? epilogue->bias[f] : 0.0f;
+			const Darknet::GemmEpilogue filter_epilogue = epilogue ?
+				Darknet::GemmEpilogue{
+					nullptr,
+					epilogue->activation,
+					epilogue->add ? epilogue->add + static_cast<size_t>(f) * out_h * out_w : nullptr,
+					epilogue->add_activation} :
+				Darknet::GemmEpilogue();
+
+			for (int t = 0; t < count; t ++)
+			{
+				const float * m = M + static_cast<size_t>(f) * block + t;
+
+				float tmp[4 * 6];
+				for (int j = 0; j < 6; j ++)
+				{
+					float col[4];
+					output_transform_6(
+							m[(0 * 6 + j) * xi_stride], m[(1 * 6 + j) * xi_stride], m[(2 * 6 + j) * xi_stride],
+							m[(3 * 6 + j) * xi_stride], m[(4 * 6 + j) * xi_stride], m[(5 * 6 + j) * xi_stride], col);
+					for (int i = 0; i < 4; i ++)
+					{
+						tmp[6 * i + j] = col[i];
+					}
+				}
+
+				const int y0 = ((t0 + t) / tiles_w) * 4;
+				const int x0 = ((t0 + t) % tiles_w) * 4;
+				const int rows = std::min(4, out_h - y0);
+				const int cols = std::min(4, out_w - x0);
+
+				for (int i = 0; i < rows; i ++)
+				{
+					const float * row = tmp + 6 * i;
+					float y[4];
+					output_transform_6(row[0], row[1], row[2], row[3], row[4], row[5], y);
+					for (int j = 0; j < 4; j ++)
+					{
+						y[j] += bias;
+					}
+					std::memcpy(out + (y0 + i) * out_w + x0, y, cols * sizeof(float));
+				}
+
+				if (epilogue)
+				{
+					// the tile is in the L1 cache, so finish it now instead of in another pass over the output
+					Darknet::GemmEpilogue tile_epilogue = filter_epilogue;
+					if (tile_epilogue.add)
+					{
+						tile_epilogue.add += y0 * out_w + x0;
+					}
+					gemm_apply_epilogue(tile_epilogue, rows, cols, out + y0 * out_w + x0, out_w);
+				}
+			}
+		});
+	}
+
+	return;
+}
+
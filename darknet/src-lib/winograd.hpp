@@ -0,0 +1,45 @@
+#pragma once
+
+/** @file
+ * Winograd F(4x4, 3x3) convolution for CPU inference.
+ */
+
+#include "darknet_internal.hpp"
+#include "gemm.hpp"
+
+
+/** Whether @p l is a convolutional layer which the Winograd path can handle:  3x3 filters, stride 1, no dilation, and
+ * regular (non-binary) weights.
+ *
+ * @since 2026-10-17
+ */
+bool winograd_is_supported(const Darknet::Layer & l);
+
+/** Shape heuristic used when the layers are not autotuned.  Winograd does 4x fewer multiplications than im2col, but
+ * the input and output transforms don't depend on the number of filters, so it only pays off when there are enough
+ * channels for the GEMM to be the dominant cost.
+ *
+ * @since 2026-10-17
+ */
+bool winograd_is_preferred(const Darknet::Layer & l);
+
+/** Transform the 3x3 weights of @p l into the 6x6 Winograd domain and store them in @ref Darknet::Layer::winograd_weights,
+ * already packed for the GEMM microkernel.  Like @ref pack_convolutional_weights() this must be called after the
+ * batchnorm has been fused.
+ *
+ * @since 2026-10-17
+ */
+void winograd_transform_weights(Darknet::Layer & l);
+
+/** Convolve one image of one group, which is what @p im2col_cpu_ext() + @p gemm() do in
+ * @ref forward_convolutional_layer().  The @p output is overwritten.  The bias and activation are only applied when an
+ * @p epilogue is given, in which case it is applied to each output tile as soon as it is written.  The bias of the
+ * epilogue starts at the first filter of the group, and the added matrix at the first value of @p output.
+ *
+ * @since 2026-10-17
+ */
+void winograd_convolution(const Darknet::Layer & l, int group, const float * input, float * output, const Darknet::GemmEpilogue * epilogue = nullptr);
+
+/// Winograd outputs which differ from the im2col outputs by more than this (relative to the largest output) are rejected
+/// by the autotuner.  See @ref compare_convolution_algorithms().
+constexpr float winograd_max_error = 1.0e-3f;
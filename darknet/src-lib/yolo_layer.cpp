@@ -819,27 +819,29 @@ void forward_yolo_layer(Darknet::Layer & l, Darknet::NetworkState state)
 {
 	TAT(TATPARMS);
 
+#ifdef DARKNET_GPU
 	memcpy(l.output, state.input, l.outputs * l.batch * sizeof(float));
-
-#ifndef DARKNET_GPU
-	for (int b = 0; b < l.batch; ++b)
+#else
+	// each anchor is copied and activated by the same thread, while it is still in the cache
+	const size_t anchor_size = l.outputs / l.n;
+	Darknet::parallel_for(l.batch * l.n, [&](const int task)
 	{
-		for (int n = 0; n < l.n; ++n)
+		const int b = task / l.n;
+		const int n = task % l.n;
+		int bbox_index = yolo_entry_index(l, b, n*l.w*l.h, 0);
+		memcpy(l.output + bbox_index, state.input + bbox_index, anchor_size * sizeof(float));
+		if (l.new_coords)
 		{
-			int bbox_index = yolo_entry_index(l, b, n*l.w*l.h, 0);
-			if (l.new_coords)
-			{
-				//activate_array(l.output + bbox_index, 4 * l.w*l.h, LOGISTIC);    // x,y,w,h
-			}
-			else
-			{
-				activate_array(l.output + bbox_index, 2 * l.w*l.h, LOGISTIC);        // x,y,
-				int obj_index = yolo_entry_index(l, b, n*l.w*l.h, 4);
-				activate_array(l.output + obj_index, (1 + l.classes)*l.w*l.h, LOGISTIC);
-			}
-			scal_add_cpu(2 * l.w*l.h, l.scale_x_y, -0.5*(l.scale_x_y - 1), l.output + bbox_index, 1);    // scale x,y
+			//activate_array(l.output + bbox_index, 4 * l.w*l.h, LOGISTIC);    // x,y,w,h
 		}
-	}
+		else
+		{
+			activate_array(l.output + bbox_index, 2 * l.w*l.h, LOGISTIC);        // x,y,
+			int obj_index = yolo_entry_index(l, b, n*l.w*l.h, 4);
+			activate_array(l.output + obj_index, (1 + l.classes)*l.w*l.h, LOGISTIC);
+		}
+		scal_add_cpu(2 * l.w*l.h, l.scale_x_y, -0.5*(l.scale_x_y - 1), l.output + bbox_index, 1);    // scale x,y
+	});
 #endif
 
 	// delta is zeroed
@@ -1245,7 +1247,7 @@ int yolo_num_detections(const Darknet::Layer & l, float thresh)
 }
 
 
-int yolo_num_detections_v3(Darknet::Network * net, const int index, const float thresh, Darknet::Output_Object_Cache & cache)
+int yolo_num_detections_v3(Darknet::Network * net, const int index, const float thresh, Darknet::Output_Object_Cache & cache, const int batch)
 {
 	TAT(TATPARMS);
 
@@ -1260,7 +1262,7 @@ int yolo_num_detections_v3(Darknet::Network * net, const int index, const float
 	{
 		for (int i = 0; i < l.w * l.h; ++i)
 		{
-			const int obj_index = yolo_entry_index(l, 0, n * l.w * l.h + i, 4);
+			const int obj_index = yolo_entry_index(l, batch, n * l.w * l.h + i, 4);
 			if (l.output[obj_index] > thresh)
 			{
 				++count;
@@ -1346,10 +1348,13 @@ int get_yolo_detections(const Darknet::Layer & l, int w, int h, int netw, int ne
 }
 
 
-int get_yolo_detections_v3(Darknet::Network * net, int w, int h, int netw, int neth, float thresh, int *map, int relative, Darknet::Detection * dets, int letter, Darknet::Output_Object_Cache & cache)
+int get_yolo_detections_v3(Darknet::Network * net, int w, int h, int netw, int neth, float thresh, int *map, int relative, Darknet::Detection * dets, int letter, Darknet::Output_Object_Cache & cache, const Darknet::VInt * classes_to_decode)
 {
 	TAT(TATPARMS);
 
+	// when some classes are skipped, only the remaining ones are scored and objects without any of them are dropped
+	const bool filter_classes = (classes_to_decode != nullptr);
+
 	int count = 0;
 
 	for (const auto & oo : cache)
@@ -1361,28 +1366,75 @@ int get_yolo_detections_v3(Darknet::Network * net, int w, int h, int netw, int n
 		const Darknet::Layer & l = net->layers[oo.layer_index];
 		const float * predictions = l.output;
 
-		const int row			= i / l.w;
-		const int col			= i % l.w;
 		const float objectness	= predictions[obj_index];
 
-		const int box_index = yolo_entry_index(l, 0, n * l.w * l.h + i, 0);
+		// the entries for an object are l.w * l.h apart, starting with the box (0-3), then objectness (4) and the classes;
+		// working back from obj_index means this also works for any image in a batch
+		const int stride		= l.w * l.h;
+		const int box_index		= obj_index - 4 * stride;
 
-		dets[count].bbox		= get_yolo_box(predictions, l.biases, l.mask[n], box_index, col, row, l.w, l.h, netw, neth, l.w * l.h, l.new_coords);
-		dets[count].objectness	= objectness;
-		dets[count].classes		= l.classes;
+		auto & det = dets[count];
 
-		if (l.embedding_output)
+		float best_prob = 0.0f;
+		det.best_class_idx = -1;
+		const float * class_prob = predictions + obj_index + stride;
+		if (filter_classes)
 		{
-			/// @todo V3 what is this and where does it get used?
-			get_embedding(l.embedding_output, l.w, l.h, l.n * l.embedding_size, l.embedding_size, col, row, n, 0, dets[count].embeddings);
+			std::fill(det.prob, det.prob + l.classes, 0.0f);
+			for (const int j : *classes_to_decode)
+			{
+				const float prob = objectness * class_prob[j * stride];
+				if (prob > thresh)
+				{
+					det.prob[j] = prob;
+					if (prob > best_prob)
+					{
+						best_prob = prob;
+						det.best_class_idx = j;
+					}
+				}
+			}
+
+			if (det.best_class_idx == -1)
+			{
+				// none of the classes we care about -- don't bother decoding the box, and re-use this detection
+				continue;
+			}
+		}
+		else
+		{
+			for (int j = 0; j < l.classes; ++j)
+			{
+				const float prob = objectness * class_prob[j * stride];
+				if (prob > thresh)
+				{
+					det.prob[j] = prob;
+					if (prob > best_prob)
+					{
+						best_prob = prob;
+						det.best_class_idx = j;
+					}
+				}
+				else
+				{
+					det.prob[j] = 0.0f;
+				}
+			}
 		}
 
-		for (int j = 0; j < l.classes; ++j)
+		const int row			= i / l.w;
+		const int col			= i % l.w;
+
+		det.bbox		= get_yolo_box(predictions, l.biases, l.mask[n], box_index, col, row, l.w, l.h, netw, neth, stride, l.new_coords);
+		det.objectness	= objectness;
+		det.classes		= l.classes;
+
+		if (l.embedding_output)
 		{
-			const int class_index = yolo_entry_index(l, 0, n * l.w * l.h + i, 4 + 1 + j);
-			const float prob = objectness * predictions[class_index];
-			dets[count].prob[j] = (prob > thresh) ? prob : 0.0f;
+			/// @todo V3 what is this and where does it get used?
+			get_embedding(l.embedding_output, l.w, l.h, l.n * l.embedding_size, l.embedding_size, col, row, n, 0, det.embeddings);
 		}
+
 		++count;
 	}
 
@@ -22,6 +22,7 @@ See the example code (such as "example.py") which imports this module.
 from ctypes import *
 import os
 import hashlib
+import threading
 
 # Define a structure to represent a bounding box with (x, y, width, height)
 class BOX(Structure):
@@ -323,6 +324,51 @@ def detect_image(network, class_names, image, thresh=.5, hier_thresh=.5, nms=.45
     return sorted(predictions, key=lambda x: x[1])
 
 
+# Callbacks and class names for the images queued with detect_image_async(), keyed by the user_data given to darknet
+_async_requests = {}
+_async_requests_lock = threading.Lock()
+_async_next_id = 1
+
+# Function to queue an image for detection on one of the library's worker threads
+def detect_image_async(network, class_names, frame, callback):
+    """
+    Queue an OpenCV image for detection and return immediately.  The callback is called from a worker thread with
+    a list of (class name, confidence, (x, y, w, h)) in image coordinates, or with None if the image was dropped
+    because the queue was full, was abandoned when the workers stopped, or could not be processed.  Raises
+    RuntimeError if the image could not be queued.  Use set_async_workers() to change the number of workers or the queue depth, and
+    wait_async_predictions() to wait until all queued images have been processed.
+
+    Args:
+        network: Darknet network.
+        class_names: List of class names.
+        frame: Contiguous BGR or BGRA numpy array, such as returned by cv2.imread() or cv2.VideoCapture.read().
+        callback: Function called with the detections.
+    """
+    global _async_next_id
+    height, width = frame.shape[:2]
+    channels = frame.shape[2] if len(frame.shape) > 2 else 1
+    with _async_requests_lock:
+        request_id = _async_next_id
+        _async_next_id += 1
+        _async_requests[request_id] = (callback, class_names, width, height)
+    if predict_async(network, frame.ctypes.data_as(POINTER(c_ubyte)), width, height, channels, _async_prediction_done, request_id) != 0:
+        with _async_requests_lock:
+            _async_requests.pop(request_id, None)
+        raise RuntimeError("failed to queue the image for detection")
+
+@CFUNCTYPE(None, c_void_p, POINTER(DETECTION), c_int)
+def _async_prediction_done(user_data, detections, num):
+    with _async_requests_lock:
+        callback, class_names, width, height = _async_requests.pop(user_data)
+    if num < 0:
+        callback(None)
+        return
+    predictions = []
+    for name, confidence, (x, y, w, h) in remove_negatives(detections, class_names, num):
+        predictions.append((name, confidence, (x * width, y * height, w * width, h * height)))
+    callback(sorted(decode_detection(predictions), key=lambda x: x[1]))
+
+
 # Platform-specific library path and initialization
 if os.name == "posix":
     libpath = "/usr/lib/libdarknet.so"
@@ -464,3 +510,13 @@ del_skipped_class.argtypes = [c_void_p, c_int]
 
 set_output_stream = lib.darknet_set_output_stream
 set_output_stream.argtypes = [c_char_p]
+
+set_async_workers = lib.darknet_set_async_workers
+set_async_workers.argtypes = [c_void_p, c_int, c_int]
+
+predict_async = lib.darknet_predict_async
+predict_async.argtypes = [c_void_p, POINTER(c_ubyte), c_int, c_int, c_int, CFUNCTYPE(None, c_void_p, POINTER(DETECTION), c_int), c_void_p]
+predict_async.restype = c_int
+
+wait_async_predictions = lib.darknet_wait_async_predictions
+wait_async_predictions.argtypes = [c_void_p]
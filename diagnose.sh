@@ -68,11 +68,11 @@ if [ $DARKNET_FOUND -eq 0 ]; then
 fi
 echo ""
 
-# 3. Verificar simple_stream_progressive
+# 3. Verificar camera_server
 echo "📹 Verificando ejecutable de streaming..."
-STREAM_EXEC="darknet/build/src-examples/simple_stream_progressive"
+STREAM_EXEC="darknet/build/src-examples/camera_server"
 if [ -f "$STREAM_EXEC" ]; then
-    check 0 "simple_stream_progressive encontrado"
+    check 0 "camera_server encontrado"
     if [ -x "$STREAM_EXEC" ]; then
         check 0 "  → Es ejecutable"
     else
@@ -80,9 +80,9 @@ if [ -f "$STREAM_EXEC" ]; then
         echo "    Ejecuta: chmod +x $STREAM_EXEC"
     fi
 else
-    check 1 "simple_stream_progressive NO encontrado"
+    check 1 "camera_server NO encontrado"
     echo "  Buscando en src-examples..."
-    ls -la darknet/build/src-examples/ 2>/dev/null | grep stream | head -5
+    ls -la darknet/build/src-examples/ 2>/dev/null | grep -E "stream|camera" | head -5
 fi
 echo ""
 
@@ -198,8 +198,8 @@ if [ ! -f "darknet/build/src-cli/darknet" ] && [ ! -f "darknet/build/darknet" ];
     PROBLEMS=$((PROBLEMS + 1))
 fi
 
-if [ ! -f "darknet/build/src-examples/simple_stream_progressive" ]; then
-    echo -e "${RED}⚠ PROBLEMA CRÍTICO:${NC} simple_stream_progressive no existe"
+if [ ! -f "darknet/build/src-examples/camera_server" ]; then
+    echo -e "${RED}⚠ PROBLEMA CRÍTICO:${NC} camera_server no existe"
     echo "  Solución: Recompilar darknet completamente"
     PROBLEMS=$((PROBLEMS + 1))
 fi
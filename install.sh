@@ -165,10 +165,10 @@ compile_darknet() {
         exit 1
     fi
     
-    if [ ! -f "src-examples/simple_stream_progressive" ]; then
-        print_warning "simple_stream_progressive no se compiló, intentando compilar manualmente..."
-        # Intentar compilar simple_stream_progressive específicamente
-        make simple_stream_progressive || true
+    if [ ! -f "src-examples/camera_server" ]; then
+        print_warning "camera_server no se compiló, intentando compilar manualmente..."
+        # Intentar compilar camera_server específicamente
+        make camera_server || true
     fi
     
     # Hacer ejecutables todos los binarios compilados
@@ -11,14 +11,20 @@ const PORT = 3000;
 // Configuración
 const PROJECT_ROOT = path.join(__dirname, '..', '..');
 const DARKNET_DIR = path.join(PROJECT_ROOT, 'darknet');
-const SIMPLE_STREAM = path.join(DARKNET_DIR, 'build', 'src-examples', 'simple_stream_progressive');
+const CAMERA_SERVER = path.join(DARKNET_DIR, 'build', 'src-examples', 'camera_server');
+const NETWORKS_PER_MODEL = 2; // Redes cargadas por modelo, compartidas entre todas las cámaras
+const BATCH_SIZE = 4;         // Frames de distintas cámaras agrupados en una sola inferencia
+const BATCH_WINDOW_MS = 5;    // Espera máxima para completar un lote
 const LOG_DIR = path.join(PROJECT_ROOT, 'logs');
 const CONFIG_FILE = path.join(PROJECT_ROOT, 'config', 'detection_config.json');
 const CAMERAS_CONFIG_FILE = path.join(PROJECT_ROOT, 'config', 'cameras_config.json');
 const MODELS_CONFIG_FILE = path.join(PROJECT_ROOT, 'config', 'models_config.json');
 
-// Estado de las cámaras
-let cameraProcesses = new Map();
+// Estado de las cámaras (id -> puerto); todas corren dentro de un único proceso camera_server
+let runningCameras = new Map();
+let cameraServer = null;
+let cameraServerStarting = null;
+let cameraServerWaiters = new Map();
 let detectionConfigs = new Map();
 let modelsConfig = { models: [], customModels: [] };
 
@@ -144,7 +150,7 @@ app.post('/api/cameras/:id/restart', async (req, res) => {
         const cameraId = parseInt(req.params.id);
         
         // Detener si está en ejecución
-        if (cameraProcesses.has(cameraId)) {
+        if (runningCameras.has(cameraId)) {
             await stopCamera(cameraId);
             await new Promise(resolve => setTimeout(resolve, 1000)); // Esperar un segundo
         }
@@ -172,7 +178,7 @@ async function startCamera(cameraId) {
     }
     
     // Si ya está ejecutándose, no hacer nada
-    if (cameraProcesses.has(cameraId)) {
+    if (runningCameras.has(cameraId)) {
         return { status: 'already_running', camera };
     }
     
@@ -212,84 +218,187 @@ async function startCamera(cameraId) {
         rtspUrl, 
         camera.name.replace(/\s+/g, '_'), 
         configFile,
+        settingsFile,
         selectedModel.config,
         selectedModel.weights,
         selectedModel.names || 'cfg/coco.names'
     ];
     
     try {
-        // Verificar que el ejecutable existe y es ejecutable
-        try {
-            await fs.access(SIMPLE_STREAM, fs.constants.X_OK);
-        } catch (err) {
-            console.error(`ERROR: No se puede ejecutar ${SIMPLE_STREAM}`);
-            console.error(`  Verifica que el archivo existe y tiene permisos de ejecución`);
-            return { status: 'error', error: `Ejecutable no encontrado o sin permisos: ${SIMPLE_STREAM}`, camera };
+        await ensureCameraServer();
+    } catch (error) {
+        if (!error.code) {
+            console.error(`ERROR: ${error.message}`);
+            return { status: 'error', error: error.message, camera };
         }
-        
-        console.log(`Iniciando cámara ${cameraId} con comando:`);
-        console.log(`  ${SIMPLE_STREAM} ${args.join(' ')}`);
-        
-        const proc = spawn(SIMPLE_STREAM, args, {
-            cwd: DARKNET_DIR,
-            env: { ...process.env, LD_LIBRARY_PATH: '/usr/local/cuda/lib64' }
-        });
-        
-        // Guardar logs
-        const logFile = path.join(LOG_DIR, `camera_${cameraId}.log`);
-        const logStream = await fs.open(logFile, 'w');
-        
-        proc.stdout.on('data', (data) => {
-            logStream.write(data);
-            console.log(`[Camera ${cameraId}]: ${data.toString().trim()}`);
-        });
-        
-        proc.stderr.on('data', (data) => {
-            logStream.write(data);
-            console.error(`[Camera ${cameraId} ERROR]: ${data.toString().trim()}`);
-        });
-        
-        proc.on('error', (error) => {
-            console.error(`Error iniciando cámara ${cameraId}:`, error);
-            logStream.write(`Error: ${error.message}\n`);
-        });
-        
-        proc.on('exit', (code) => {
-            console.log(`Cámara ${cameraId} terminó con código: ${code}`);
-            logStream.close();
-            cameraProcesses.delete(cameraId);
+        console.error(`ERROR: No se puede ejecutar ${CAMERA_SERVER}`);
+        console.error(`  Verifica que el archivo existe y tiene permisos de ejecución`);
+        return { status: 'error', error: `Ejecutable no encontrado o sin permisos: ${CAMERA_SERVER}`, camera };
+    }
+    
+    if (args.some(arg => /[\r\n]/.test(arg))) {
+        return { status: 'failed', camera, error: 'los parámetros de la cámara no pueden tener saltos de línea' };
+    }
+    const command = `add ${cameraId} ${args.map(quoteCommandField).join(' ')}`;
+    console.log(`Iniciando cámara ${cameraId}: ${command}`);
+    const reply = await sendCameraServerCommand(cameraId, command, 10000);
+    
+    if (reply.type === 'started') {
+        runningCameras.set(cameraId, camera.port);
+        return { status: 'started', camera };
+    }
+    
+    console.error(`Cámara ${cameraId} falló al iniciar: ${reply.message}`);
+    return { status: 'failed', camera, error: reply.message };
+}
+
+// Los campos de los comandos van entre comillas para que el servidor de cámaras no corte las rutas
+// o las URLs RTSP con espacios (ver camera_server.cpp)
+function quoteCommandField(value) {
+    return '"' + String(value).replace(/\\/g, '\\\\').replace(/"/g, '\\"') + '"';
+}
+
+// Detener una cámara
+async function stopCamera(cameraId) {
+    if (!runningCameras.has(cameraId)) {
+        return { status: 'not_running' };
+    }
+    
+    if (cameraServer) {
+        await sendCameraServerCommand(cameraId, `remove ${cameraId}`, 5000);
+    }
+    runningCameras.delete(cameraId);
+    return { status: 'stopped' };
+}
+
+// Arrancar (una sola vez) el proceso que aloja todas las cámaras
+async function ensureCameraServer() {
+    if (cameraServer) {
+        return cameraServer;
+    }
+    if (!cameraServerStarting) {
+        cameraServerStarting = startCameraServer().finally(() => {
+            cameraServerStarting = null;
         });
-        
-        cameraProcesses.set(cameraId, proc);
-        
-        // Esperar un momento para ver si inicia correctamente
-        await new Promise(resolve => setTimeout(resolve, 2000));
-        
-        if (proc.exitCode === null) {
-            return { status: 'started', camera };
-        } else {
-            console.error(`Cámara ${cameraId} falló al iniciar. Código de salida: ${proc.exitCode}`);
-            return { status: 'failed', camera, exitCode: proc.exitCode };
+    }
+    return cameraServerStarting;
+}
+
+async function startCameraServer() {
+    await fs.access(CAMERA_SERVER, fs.constants.X_OK);
+    
+    const args = [
+        '--networks', NETWORKS_PER_MODEL.toString(),
+        '--batch', BATCH_SIZE.toString(),
+        '--batch-window', BATCH_WINDOW_MS.toString()
+    ];
+    console.log(`Iniciando servidor de cámaras: ${CAMERA_SERVER} ${args.join(' ')}`);
+    const proc = spawn(CAMERA_SERVER, args, {
+        cwd: DARKNET_DIR,
+        env: { ...process.env, LD_LIBRARY_PATH: '/usr/local/cuda/lib64' }
+    });
+    
+    // Guardar logs
+    const logFile = path.join(LOG_DIR, 'camera_server.log');
+    const logStream = await fs.open(logFile, 'w');
+    let pending = '';
+    
+    proc.stdout.on('data', (data) => {
+        logStream.write(data);
+        pending += data.toString();
+        const lines = pending.split('\n');
+        pending = lines.pop();
+        for (const line of lines) {
+            if (line.startsWith('@')) {
+                handleCameraServerReply(line.substring(1));
+            } else if (line.trim()) {
+                console.log(`[Cámaras]: ${line.trim()}`);
+            }
         }
+    });
+    
+    proc.stderr.on('data', (data) => {
+        logStream.write(data);
+        console.error(`[Cámaras ERROR]: ${data.toString().trim()}`);
+    });
+    
+    proc.on('error', (error) => {
+        console.error('Error iniciando servidor de cámaras:', error);
+        logStream.write(`Error: ${error.message}\n`);
+    });
+    
+    proc.on('exit', (code) => {
+        console.log(`Servidor de cámaras terminó con código: ${code}`);
+        logStream.close();
+        if (cameraServer === proc) {
+            cameraServer = null;
+        }
+        runningCameras.clear();
+        for (const [id, resolve] of cameraServerWaiters) {
+            resolve({ type: 'error', message: 'el servidor de cámaras terminó' });
+        }
+        cameraServerWaiters.clear();
+    });
+    
+    cameraServer = proc;
+    try {
+        await checkCameraServerProtocol();
     } catch (error) {
-        console.error(`Error crítico iniciando cámara ${cameraId}:`, error);
-        return { status: 'error', error: error.message, camera };
+        cameraServer = null;
+        proc.kill();
+        throw error;
     }
+    return proc;
 }
 
-// Detener una cámara
-async function stopCamera(cameraId) {
-    const proc = cameraProcesses.get(cameraId);
-    if (proc) {
-        proc.kill('SIGTERM');
-        await new Promise(resolve => setTimeout(resolve, 1000));
-        if (!proc.killed) {
-            proc.kill('SIGKILL');
+// Campos de prueba con lo que más fácilmente se rompe al entrecomillar: espacios, comillas,
+// barras, campos vacíos y caracteres no ASCII
+const PROTOCOL_CHECK_ID = -1;
+const PROTOCOL_CHECK_FIELDS = ['8081', 'rtsp://usuario:"clave con espacios"@camara/stream', 'C:\\ruta\\con \\"barras\\"\\', '', 'cámara_ñ'];
+
+// Comprobar que camera_server lee los campos igual que los escribe quoteCommandField(): 'echo'
+// los devuelve tal y como los ha leído, otra vez entre comillas
+async function checkCameraServerProtocol() {
+    const expected = PROTOCOL_CHECK_FIELDS.map(quoteCommandField).join(' ');
+    const reply = await sendCameraServerCommand(PROTOCOL_CHECK_ID, `echo ${PROTOCOL_CHECK_ID} ${expected}`, 10000);
+    if (reply.type !== 'echo' || reply.message !== expected) {
+        throw new Error(`el servidor de cámaras no entiende los campos entre comillas (enviado: ${expected}, recibido: ${reply.message})`);
+    }
+}
+
+// Respuestas del servidor de cámaras: "started <id> <puerto>", "stopped <id>", "error <id> <mensaje>"...
+function handleCameraServerReply(line) {
+    const [type, id, ...rest] = line.split(' ');
+    const cameraId = parseInt(id);
+    
+    if (type === 'stopped') {
+        runningCameras.delete(cameraId);
+    }
+    
+    if (type === 'started' || type === 'stopped' || type === 'error' || type === 'echo') {
+        const resolve = cameraServerWaiters.get(cameraId);
+        if (resolve) {
+            cameraServerWaiters.delete(cameraId);
+            resolve({ type, message: rest.join(' ') });
         }
-        cameraProcesses.delete(cameraId);
-        return { status: 'stopped' };
     }
-    return { status: 'not_running' };
+}
+
+// Enviar un comando para una cámara y esperar su respuesta
+function sendCameraServerCommand(cameraId, command, timeoutMs) {
+    return new Promise((resolve) => {
+        const timer = setTimeout(() => {
+            cameraServerWaiters.delete(cameraId);
+            resolve({ type: 'timeout', message: 'sin respuesta del servidor de cámaras' });
+        }, timeoutMs);
+        
+        cameraServerWaiters.set(cameraId, (reply) => {
+            clearTimeout(timer);
+            resolve(reply);
+        });
+        
+        cameraServer.stdin.write(command + '\n');
+    });
 }
 
 // API Endpoints
@@ -298,7 +407,7 @@ async function stopCamera(cameraId) {
 app.get('/api/cameras', (req, res) => {
     const camerasWithStatus = cameras.map(cam => ({
         ...cam,
-        running: cameraProcesses.has(cam.id),
+        running: runningCameras.has(cam.id),
         streamUrl: `http://localhost:${cam.port}/`
     }));
     res.json(camerasWithStatus);
@@ -399,7 +508,7 @@ app.post('/api/cameras/:id/detection-config', async (req, res) => {
         let wasRestarted = false;
         
         // Si la cámara está en ejecución, reiniciarla para aplicar cambios
-        if (cameraProcesses.has(cameraId)) {
+        if (runningCameras.has(cameraId)) {
             console.log(`Reiniciando cámara ${cameraId} para aplicar nueva configuración...`);
             await stopCamera(cameraId);
             await new Promise(resolve => setTimeout(resolve, 1000)); // Esperar un momento
@@ -465,7 +574,7 @@ app.put('/api/cameras/:id', async (req, res) => {
         }
         
         // Si la cámara está en ejecución, detenerla
-        const wasRunning = cameraProcesses.has(cameraId);
+        const wasRunning = runningCameras.has(cameraId);
         if (wasRunning) {
             await stopCamera(cameraId);
         }
@@ -514,7 +623,7 @@ app.delete('/api/cameras/:id', async (req, res) => {
         const cameraId = parseInt(req.params.id);
         
         // Detener la cámara si está en ejecución
-        if (cameraProcesses.has(cameraId)) {
+        if (runningCameras.has(cameraId)) {
             await stopCamera(cameraId);
         }
         
@@ -544,11 +653,11 @@ app.delete('/api/cameras/:id', async (req, res) => {
 app.get('/api/status', (req, res) => {
     res.json({
         totalCameras: cameras.length,
-        runningCameras: cameraProcesses.size,
+        runningCameras: runningCameras.size,
         cameras: cameras.map(c => ({
             id: c.id,
             name: c.name,
-            running: cameraProcesses.has(c.id)
+            running: runningCameras.has(c.id)
         }))
     });
 });
@@ -932,15 +1041,15 @@ async function startServer() {
 process.on('SIGINT', async () => {
     console.log('\nDeteniendo servidor...');
     
-    // Detener todas las cámaras
-    for (const [id, proc] of cameraProcesses) {
+    // Detener todas las cámaras (un único proceso)
+    const proc = cameraServer;
+    if (proc) {
+        proc.stdin.write('quit\n');
         proc.kill('SIGTERM');
-    }
-    
-    await new Promise(resolve => setTimeout(resolve, 2000));
-    
-    for (const [id, proc] of cameraProcesses) {
-        if (!proc.killed) {
+        
+        await new Promise(resolve => setTimeout(resolve, 2000));
+        
+        if (proc.exitCode === null) {
             proc.kill('SIGKILL');
         }
     }